@@ -0,0 +1,26 @@
+#version 450
+
+layout (location = 0) in vec2 inUV;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec4 inColor;
+layout (location = 3) flat in vec4 inAtlasRect;
+layout (location = 4) flat in float inAtlasLayer;
+
+// 所有漫反射贴图打包在一张数组贴图里
+layout (set = 1,binding = 0) uniform sampler2DArray DiffuseMap;
+
+
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+    // 图集里不能靠Sampler平铺，fract之后再映射到子区域，导数用原始UV的，接缝处不会选错Mip
+    vec2 atlasUV = inAtlasRect.xy + fract(inUV) * inAtlasRect.zw;
+    vec2 dx = dFdx(inUV) * inAtlasRect.zw;
+    vec2 dy = dFdy(inUV) * inAtlasRect.zw;
+
+    vec3 lightDir = vec3(0, 1, -1);
+    vec4 diffuse  = textureGrad(DiffuseMap, vec3(atlasUV, inAtlasLayer), dx, dy);
+    diffuse.xyz   = dot(lightDir, inNormal) * diffuse.xyz;
+    outFragColor = diffuse;
+}
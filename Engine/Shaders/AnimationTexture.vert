@@ -11,6 +11,8 @@ layout (binding = 0) uniform MVPBlock
     mat4 viewMatrix;
     mat4 projectionMatrix;
     vec4 AnimIndex;
+    // 图集里的区域：xy偏移，zw缩放；层号在AnimIndex.w
+    vec4 AtlasRect;
 } uboMVP;
 
 layout(set = 1,binding = 1) uniform sampler2D BonesTexture;
@@ -19,6 +21,8 @@ layout(set = 1,binding = 1) uniform sampler2D BonesTexture;
 layout (location = 0) out vec2 outUV;
 layout (location = 1) out vec3 outNormal;
 layout (location = 2) out vec4 outColor;
+layout (location = 3) flat out vec4 outAtlasRect;
+layout (location = 4) flat out float outAtlasLayer;
 
 out gl_PerVertex
 {
@@ -94,6 +98,8 @@ void main()
     outUV       = inUV0;
     outNormal   = normal;
     outColor    = vec4(inSkinPack,1.0f);
+    outAtlasRect  = uboMVP.AtlasRect;
+    outAtlasLayer = uboMVP.AnimIndex.w;
 
     gl_Position = uboMVP.projectionMatrix * uboMVP.viewMatrix * modeMatrix * vec4(inPosition.xyz, 1.0);
 }
\ No newline at end of file
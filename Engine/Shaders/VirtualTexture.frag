@@ -0,0 +1,28 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout (location = 0) in vec2 inUV0;
+
+layout (binding = 1) buffer VirtualTextureFeedback
+{
+    uint Stamps[];
+} vtFeedback;
+
+#include "lib/VirtualTexture.h"
+
+layout (binding = 2) uniform VirtualTextureBlock
+{
+    VirtualTextureParams params;
+    // x是uv的平铺次数
+    vec4 tiling;
+} uboVirtualTexture;
+
+layout (binding = 3) uniform usampler2D PageTable;
+layout (binding = 4) uniform sampler2D PhysicalCache;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+    outFragColor = SampleVirtualTexture(PageTable, PhysicalCache, uboVirtualTexture.params, inUV0 * uboVirtualTexture.tiling.x);
+}
@@ -0,0 +1,23 @@
+#version 450
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec2 inUV0;
+
+layout (binding = 0) uniform MVPBlock
+{
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+} uboMVP;
+
+layout (location = 0) out vec2 outUV0;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main()
+{
+    gl_Position = uboMVP.projectionMatrix * uboMVP.viewMatrix * uboMVP.modelMatrix * vec4(inPosition, 1.0);
+    outUV0 = inUV0;
+}
@@ -0,0 +1,61 @@
+#ifndef VIRTUAL_TEXTURE
+#define VIRTUAL_TEXTURE
+
+// 和VulkanVirtualTexture::Params一致
+struct VirtualTextureParams
+{
+    uvec4 PageInfo;         // 宽, 高, Mip数, 反馈区间起点
+    uvec4 CacheInfo;        // TileSize, Border, 页边长, 物理缓存边长
+    uvec4 FrameInfo;        // x是这一帧的标记
+    uvec4 MipFirstPage[4];  // 每级第一页的序号
+};
+
+// include之前要声明反馈Buffer：buffer VirtualTextureFeedback { uint Stamps[]; } vtFeedback;
+
+uvec2 VirtualTexturePages(VirtualTextureParams params, uint mip)
+{
+    uvec2 mipSize = max(params.PageInfo.xy >> mip, uvec2(1));
+    return (mipSize + params.CacheInfo.x - 1) / params.CacheInfo.x;
+}
+
+// uv超出0到1时平铺；只在选中的一级里双线性过滤，级之间不插值
+vec4 SampleVirtualTexture(usampler2D pageTable, sampler2D physicalCache, VirtualTextureParams params, vec2 uv)
+{
+    // 导数用平铺之前的uv，接缝处不会选错Mip
+    vec2 texel = uv * vec2(params.PageInfo.xy);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+
+    uint numMips  = params.PageInfo.z;
+    uint mip      = uint(clamp(floor(lod), 0.0, float(numMips - 1)));
+    float tile    = float(params.CacheInfo.x);
+    uv = fract(uv);
+
+    uvec2 pages = VirtualTexturePages(params, mip);
+    uvec2 page  = min(uvec2(uv * vec2(max(params.PageInfo.xy >> mip, uvec2(1))) / tile), pages - 1);
+
+    // 同一帧写过就不再写，减少写回
+    uint index = params.PageInfo.w + params.MipFirstPage[mip >> 2][mip & 3] + page.y * pages.x + page.x;
+    if (vtFeedback.Stamps[index] != params.FrameInfo.x) {
+        vtFeedback.Stamps[index] = params.FrameInfo.x;
+    }
+
+    uvec4 entry = texelFetch(pageTable, ivec2(page), int(mip));
+    if (entry.a == 0) {
+        return vec4(0.5, 0.5, 0.5, 1.0);
+    }
+
+    // 页表里是最精细的已加载祖先，祖先页号的规则和CPU上填页表时一致
+    uint residentMip = entry.b;
+    uvec2 residentPage = min(page >> (residentMip - mip), VirtualTexturePages(params, residentMip) - 1);
+    vec2 residentTexel = uv * vec2(max(params.PageInfo.xy >> residentMip, uvec2(1)));
+
+    float border = float(params.CacheInfo.y);
+    vec2 inPage  = clamp(residentTexel - vec2(residentPage) * tile, vec2(0.5 - border), vec2(tile + border - 0.5));
+    vec2 physicalTexel = vec2(entry.xy) * float(params.CacheInfo.z) + border + inPage;
+
+    return textureLod(physicalCache, physicalTexel / float(params.CacheInfo.w), 0.0);
+}
+
+#endif
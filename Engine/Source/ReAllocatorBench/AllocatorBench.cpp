@@ -0,0 +1,880 @@
+﻿#include "Log/Log.h"
+#include "Core/Alignment.h"
+#include "Platform/Vulkan/VulkanMemory.h"
+#include "Platform/Vulkan/VulkanInstance.h"
+#include "Platform/Vulkan/VulkanMaterial.h"
+#include "Platform/Vulkan/VulkanMemoryTracker.h"
+#include "Platform/Vulkan/VulkanTextureStreamer.h"
+#include "Platform/Vulkan/VulkanBuffers/VulkanBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <source_location>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <PreDepth_vert.h>
+#include <PreDepth_frag.h>
+
+using namespace ReEngine;
+
+// 显存子分配器的基准测试
+// 默认把一段分配/释放记录分别在旧的空闲链表和VulkanTLSFAllocator上回放，报告耗时，不需要GPU
+// 用法：ReAllocatorBench [--trace file] [--save file] [--ops N] [--seed N] [--page-size MB] [--repeat N]
+// 没有--trace时按种子生成一段随机记录，--save把它存下来，换了实现之后用同一份记录对比
+// 记录是文本，每行一条：page <字节数>，a <id> <大小> <对齐>，f <id>；#开头是注释
+// --contention [--threads N] [--iterations N]：离屏创建设备，1到N个线程同时经过弹匣分配小块Buffer，报告吞吐随线程数的变化
+// --defrag：离屏创建设备，检查延迟释放的帧序、整理期间的暂存，以及整理不会移动流式贴图和网格之外的Buffer，有检查失败时返回非0
+// --uniform-batch：离屏创建设备，检查批量Uniform的偏移、数据和Ring放不下时的失败路径，有检查失败时返回非0
+// --tracker：检查显存跟踪的统计、快照Diff和JSON往返，有检查失败时返回非0
+struct BenchSettings
+{
+    std::string             TracePath;
+    std::string             SavePath;
+    uint32                  NumOps = 100000;
+    uint32                  Seed = 1;
+    uint32                  PageSize = 256 * 1024 * 1024;
+    uint32                  Repeat = 3;
+
+    bool                    Contention = false;
+    uint32                  MaxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    uint32                  Iterations = 2000;
+
+    bool                    Defrag = false;
+    bool                    UniformBatch = false;
+    bool                    Tracker = false;
+};
+
+struct TraceOp
+{
+    bool                    IsAlloc;
+    uint32                  ID;
+    uint32                  Size;
+    uint32                  Alignment;
+};
+
+struct AllocationTrace
+{
+    uint32                  PageSize = 256 * 1024 * 1024;
+    uint32                  NumIDs = 0;
+    std::vector<TraceOp>    Ops;
+};
+
+// 改成TLSF之前VulkanResourceHeapPage的做法：首次适配扫描空闲链表，释放时追加再排序合并
+class FreeListAllocator
+{
+public:
+    void Init(uint32 maxSize)
+    {
+        m_FreeList.clear();
+        m_FreeList.push_back({ 0, maxSize });
+    }
+
+    bool Allocate(uint32 size, uint32 alignment, uint32& outAllocationOffset, uint32& outAllocationSize, uint32& outAlignedOffset)
+    {
+        for (int32 index = 0; index < m_FreeList.size(); ++index)
+        {
+            VulkanRange& entry         = m_FreeList[index];
+            uint32 alignedOffset       = Align(entry.offset, alignment);
+            uint32 alignmentAdjustment = alignedOffset - entry.offset;
+            uint32 allocatedSize       = alignmentAdjustment + size;
+
+            if (allocatedSize <= entry.size)
+            {
+                outAllocationOffset = entry.offset;
+                outAllocationSize   = allocatedSize;
+                outAlignedOffset    = alignedOffset;
+
+                if (allocatedSize < entry.size) {
+                    entry.size   -= allocatedSize;
+                    entry.offset += allocatedSize;
+                }
+                else {
+                    m_FreeList.erase(m_FreeList.begin() + index);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Free(uint32 allocationOffset, uint32 allocationSize)
+    {
+        m_FreeList.push_back({ allocationOffset, allocationSize });
+        VulkanRange::JoinConsecutiveRanges(m_FreeList);
+    }
+
+    uint32 GetNumFreeBlocks() const
+    {
+        return (uint32)m_FreeList.size();
+    }
+
+private:
+    std::vector<VulkanRange> m_FreeList;
+};
+
+struct ReplayResult
+{
+    double                  Milliseconds = 0.0;
+    uint32                  NumFailed = 0;
+    uint32                  NumFreeBlocks = 0;
+};
+
+static bool LoadTrace(const std::string& filepath, AllocationTrace& outTrace)
+{
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string command;
+        if (!(stream >> command) || command[0] == '#') {
+            continue;
+        }
+
+        TraceOp op = {};
+        if (command == "page") {
+            stream >> outTrace.PageSize;
+            continue;
+        }
+        else if (command == "a") {
+            op.IsAlloc = true;
+            stream >> op.ID >> op.Size >> op.Alignment;
+        }
+        else if (command == "f") {
+            stream >> op.ID;
+        }
+        else {
+            RE_ERROR("Unknown trace command {0}", command);
+            return false;
+        }
+
+        if (stream.fail()) {
+            RE_ERROR("Malformed trace line: {0}", line);
+            return false;
+        }
+
+        outTrace.NumIDs = std::max(outTrace.NumIDs, op.ID + 1);
+        outTrace.Ops.push_back(op);
+    }
+    return true;
+}
+
+static bool SaveTrace(const std::string& filepath, const AllocationTrace& trace)
+{
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "# ReAllocatorBench trace\n";
+    file << "page " << trace.PageSize << "\n";
+    for (const TraceOp& op : trace.Ops)
+    {
+        if (op.IsAlloc) {
+            file << "a " << op.ID << " " << op.Size << " " << op.Alignment << "\n";
+        }
+        else {
+            file << "f " << op.ID << "\n";
+        }
+    }
+    return (bool)file;
+}
+
+// 大小在256B到2MB之间按对数均匀分布，随机顺序释放，让页保持七成左右的占用并产生碎片
+static void GenerateTrace(const BenchSettings& settings, AllocationTrace& outTrace)
+{
+    static const uint32 s_Alignments[] = { 256, 256, 1024, 4096, 65536 };
+
+    std::mt19937 random(settings.Seed);
+    std::uniform_real_distribution<float> sizeLog2(8.0f, 21.0f);
+    std::uniform_int_distribution<uint32> percent(0, 99);
+
+    const uint64 targetBytes = (uint64)settings.PageSize * 7 / 10;
+    std::vector<uint32> liveIDs;
+    std::vector<uint32> sizes;
+    uint64 liveBytes = 0;
+
+    outTrace.PageSize = settings.PageSize;
+    outTrace.Ops.clear();
+    outTrace.Ops.reserve(settings.NumOps + settings.NumOps / 2);
+
+    for (uint32 index = 0; index < settings.NumOps; ++index)
+    {
+        const bool allocate = liveIDs.empty() || (liveBytes < targetBytes && percent(random) < 55);
+        if (allocate)
+        {
+            TraceOp op = {};
+            op.IsAlloc   = true;
+            op.ID        = (uint32)sizes.size();
+            op.Size      = Align((uint32)std::exp2(sizeLog2(random)), 256u);
+            op.Alignment = s_Alignments[random() % (sizeof(s_Alignments) / sizeof(s_Alignments[0]))];
+            outTrace.Ops.push_back(op);
+
+            sizes.push_back(op.Size);
+            liveIDs.push_back(op.ID);
+            liveBytes += op.Size;
+        }
+        else
+        {
+            const uint32 slot = random() % (uint32)liveIDs.size();
+            const uint32 id = liveIDs[slot];
+            liveIDs[slot] = liveIDs.back();
+            liveIDs.pop_back();
+            liveBytes -= sizes[id];
+
+            TraceOp op = {};
+            op.ID = id;
+            outTrace.Ops.push_back(op);
+        }
+    }
+
+    // 最后全部释放，回放结束时页应该是空的
+    for (uint32 id : liveIDs)
+    {
+        TraceOp op = {};
+        op.ID = id;
+        outTrace.Ops.push_back(op);
+    }
+
+    outTrace.NumIDs = (uint32)sizes.size();
+}
+
+// 分配失败的id记下来，它的释放跳过；两个分配器的适配策略不同，失败数可能不一样
+template<typename Allocator, typename FreeFunc>
+static ReplayResult ReplayTrace(const AllocationTrace& trace, Allocator& allocator, FreeFunc freeFunc)
+{
+    std::vector<VulkanRange> allocations(trace.NumIDs, VulkanRange{ 0, 0 });
+    ReplayResult result;
+
+    allocator.Init(trace.PageSize);
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (const TraceOp& op : trace.Ops)
+    {
+        VulkanRange& allocation = allocations[op.ID];
+        if (op.IsAlloc)
+        {
+            uint32 alignedOffset = 0;
+            if (!allocator.Allocate(op.Size, op.Alignment, allocation.offset, allocation.size, alignedOffset))
+            {
+                allocation.size = 0;
+                result.NumFailed += 1;
+            }
+        }
+        else if (allocation.size > 0)
+        {
+            freeFunc(allocator, allocation);
+            allocation.size = 0;
+        }
+    }
+    result.Milliseconds  = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    result.NumFreeBlocks = allocator.GetNumFreeBlocks();
+    return result;
+}
+
+static void RunTraceBench(const AllocationTrace& trace, uint32 repeat)
+{
+    uint32 numAllocs = 0;
+    for (const TraceOp& op : trace.Ops) {
+        numAllocs += op.IsAlloc ? 1 : 0;
+    }
+    RE_INFO("Trace: {0} ops ({1} allocations), page {2} MB", trace.Ops.size(), numAllocs, trace.PageSize / (1024 * 1024));
+
+    // 取多次里最快的一次
+    ReplayResult freeList;
+    ReplayResult tlsf;
+    for (uint32 pass = 0; pass < repeat; ++pass)
+    {
+        FreeListAllocator freeListAllocator;
+        ReplayResult freeListPass = ReplayTrace(trace, freeListAllocator, [](FreeListAllocator& allocator, const VulkanRange& allocation)
+        {
+            allocator.Free(allocation.offset, allocation.size);
+        });
+
+        VulkanTLSFAllocator tlsfAllocator;
+        ReplayResult tlsfPass = ReplayTrace(trace, tlsfAllocator, [](VulkanTLSFAllocator& allocator, const VulkanRange& allocation)
+        {
+            allocator.Free(allocation.offset);
+        });
+
+        if (pass == 0 || freeListPass.Milliseconds < freeList.Milliseconds) {
+            freeList = freeListPass;
+        }
+        if (pass == 0 || tlsfPass.Milliseconds < tlsf.Milliseconds) {
+            tlsf = tlsfPass;
+        }
+    }
+
+    const double numOps = (double)std::max<size_t>(trace.Ops.size(), 1);
+    RE_INFO("{0:<10} {1:>12} {2:>10} {3:>8} {4:>10}", "Allocator", "Total(ms)", "ns/op", "Failed", "FreeBlocks");
+    RE_INFO("{0:<10} {1:>12.3f} {2:>10.1f} {3:>8} {4:>10}", "FreeList", freeList.Milliseconds, freeList.Milliseconds * 1e6 / numOps, freeList.NumFailed, freeList.NumFreeBlocks);
+    RE_INFO("{0:<10} {1:>12.3f} {2:>10.1f} {3:>8} {4:>10}", "TLSF", tlsf.Milliseconds, tlsf.Milliseconds * 1e6 / numOps, tlsf.NumFailed, tlsf.NumFreeBlocks);
+    RE_INFO("Speedup: {0:.2f}x", tlsf.Milliseconds > 0.0 ? freeList.Milliseconds / tlsf.Milliseconds : 0.0);
+}
+
+// 每个线程反复分配一批小块Buffer再全部释放，释放进延迟队列，每种线程数跑完后主线程一次性归还
+static bool RunContentionBench(const BenchSettings& settings)
+{
+    enum
+    {
+        BATCH_SIZE = 64,
+    };
+
+    static const uint32 s_Sizes[] = { 32, 64, 128, 256, 512, 1024, 2048, 8192 };
+
+    WindowProperty property("ReAllocatorBench", 64, 64);
+    property.Headless = true;
+
+    VulkanInstance instance(nullptr, &property);
+    instance.Init();
+    if (!instance.GetDevice())
+    {
+        RE_ERROR("No Vulkan device, contention bench needs one");
+        return false;
+    }
+
+    VulkanResourceHeapManager& heapManager = instance.GetDevice()->GetResourceHeapManager();
+    const VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    std::vector<uint32> threadCounts;
+    for (uint32 numThreads = 1; numThreads < settings.MaxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(settings.MaxThreads);
+
+    RE_INFO("{0:>8} {1:>12} {2:>14} {3:>12} {4:>8}", "Threads", "Total(ms)", "MAllocs/s", "ns/alloc", "Scaling");
+
+    double singleThreadRate = 0.0;
+    for (uint32 numThreads : threadCounts)
+    {
+        std::atomic<uint32> numReady = 0;
+        std::atomic<bool>   started = false;
+        std::atomic<uint32> numFailed = 0;
+
+        std::vector<std::thread> threads;
+        for (uint32 threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+        {
+            threads.emplace_back([&, threadIndex]()
+            {
+                std::mt19937 random(settings.Seed + threadIndex);
+                std::vector<VulkanBufferSubAllocation*> batch(BATCH_SIZE);
+
+                numReady += 1;
+                while (!started) {
+                    std::this_thread::yield();
+                }
+
+                for (uint32 iteration = 0; iteration < settings.Iterations; ++iteration)
+                {
+                    for (VulkanBufferSubAllocation*& allocation : batch)
+                    {
+                        const uint32 size = s_Sizes[random() % (sizeof(s_Sizes) / sizeof(s_Sizes[0]))];
+                        allocation = heapManager.AllocateBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryFlags, __FILE__, __LINE__);
+                        if (allocation) {
+                            allocation->AddRef();
+                        }
+                        else {
+                            numFailed += 1;
+                        }
+                    }
+
+                    for (VulkanBufferSubAllocation* allocation : batch)
+                    {
+                        if (allocation) {
+                            allocation->Release();
+                        }
+                    }
+                }
+            });
+        }
+
+        while (numReady < numThreads) {
+            std::this_thread::yield();
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        started = true;
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        // 线程退出时弹匣已经还给共享堆，这里归还延迟队列
+        heapManager.ProcessPendingReleases(~0ull);
+
+        const double numAllocs = (double)numThreads * settings.Iterations * BATCH_SIZE;
+        const double rate = numAllocs / std::max(milliseconds, 1e-3) / 1000.0;
+        if (numThreads == 1) {
+            singleThreadRate = rate;
+        }
+
+        RE_INFO("{0:>8} {1:>12.3f} {2:>14.3f} {3:>12.1f} {4:>7.2f}x", numThreads, milliseconds, rate, milliseconds * 1e6 * numThreads / numAllocs, singleThreadRate > 0.0 ? rate / singleThreadRate : 0.0);
+        if (numFailed > 0) {
+            RE_WARN("{0} allocations failed with {1} threads", numFailed.load(), numThreads);
+        }
+    }
+
+    instance.Shutdown();
+    return true;
+}
+
+// 检查不通过时报告并计数，一个模式里的检查全部跑完再按失败数返回
+static void Check(bool condition, const char* description, uint32& numFailed)
+{
+    if (!condition)
+    {
+        RE_ERROR("Check failed: {0}", description);
+        numFailed += 1;
+    }
+}
+
+static const VulkanMemoryCallsiteStats* FindCallsite(const VulkanMemorySnapshot& snapshot, const char* file, uint32 line, VulkanMemoryTrackKind kind)
+{
+    for (const VulkanMemoryCallsiteStats& stats : snapshot.Callsites)
+    {
+        if (stats.Line == line && stats.Kind == kind && stats.File == file) {
+            return &stats;
+        }
+    }
+    return nullptr;
+}
+
+// 显存跟踪的不变量：调用点统计、重复释放、快照Diff和JSON往返，先用假句柄在CPU上验证
+// 有设备时再创建一个VMA Buffer，确认它记在调用方的file:line下，释放并归还后调用点消失
+static bool RunTrackerBench(const BenchSettings& settings)
+{
+    enum
+    {
+        NUM_RESOURCES = 32,
+        RESOURCE_SIZE = 1024,
+        NUM_SUB_BUFFERS = 16,
+        SUB_BUFFER_SIZE = 64 * 1024,
+        BUFFER_SIZE = 256 * 1024,
+    };
+
+    static const char* s_File = "TrackerBench";
+
+    VulkanMemoryTracker& tracker = VulkanMemoryTracker::GetInstance();
+    uint32 numFailed = 0;
+
+    // 句柄只当作键用，取数组里的地址保证互不相同
+    std::vector<uint8> handles(NUM_RESOURCES + NUM_SUB_BUFFERS);
+    const VulkanMemorySnapshot baseline = tracker.CaptureSnapshot("Baseline");
+
+    for (uint32 index = 0; index < NUM_RESOURCES; ++index) {
+        tracker.TrackAllocation(VulkanMemoryTrackKind::Resource, &handles[index], RESOURCE_SIZE, 0, s_File, 1);
+    }
+    for (uint32 index = 0; index < NUM_SUB_BUFFERS; ++index) {
+        tracker.TrackAllocation(VulkanMemoryTrackKind::SubBuffer, &handles[NUM_RESOURCES + index], SUB_BUFFER_SIZE, 0, s_File, 2);
+    }
+
+    const VulkanMemorySnapshot before = tracker.CaptureSnapshot("Before");
+    const VulkanMemoryCallsiteStats* resources = FindCallsite(before, s_File, 1, VulkanMemoryTrackKind::Resource);
+    const VulkanMemoryCallsiteStats* subBuffers = FindCallsite(before, s_File, 2, VulkanMemoryTrackKind::SubBuffer);
+    Check(resources && resources->Count == NUM_RESOURCES && resources->Bytes == NUM_RESOURCES * RESOURCE_SIZE, "resource callsite counts every allocation", numFailed);
+    Check(subBuffers && subBuffers->Count == NUM_SUB_BUFFERS && subBuffers->Bytes == NUM_SUB_BUFFERS * SUB_BUFFER_SIZE, "sub buffer callsite counts every allocation", numFailed);
+    Check(before.TotalBytes[(int32)VulkanMemoryTrackKind::Resource] == baseline.TotalBytes[(int32)VulkanMemoryTrackKind::Resource] + NUM_RESOURCES * RESOURCE_SIZE, "resource total includes the callsite", numFailed);
+    Check(std::is_sorted(before.Callsites.begin(), before.Callsites.end(), [](const VulkanMemoryCallsiteStats& a, const VulkanMemoryCallsiteStats& b) {
+        return a.Bytes > b.Bytes;
+    }), "snapshot callsites are sorted by bytes", numFailed);
+
+    // 释放一半，重复释放和未知句柄都应该被忽略
+    for (uint32 index = 0; index < NUM_RESOURCES / 2; ++index) {
+        tracker.UntrackAllocation(&handles[index]);
+    }
+    for (uint32 index = 0; index < NUM_SUB_BUFFERS / 2; ++index) {
+        tracker.UntrackAllocation(&handles[NUM_RESOURCES + index]);
+    }
+    tracker.UntrackAllocation(&handles[0]);
+    tracker.UntrackAllocation(&settings);
+
+    const VulkanMemorySnapshot after = tracker.CaptureSnapshot("After");
+    resources = FindCallsite(after, s_File, 1, VulkanMemoryTrackKind::Resource);
+    subBuffers = FindCallsite(after, s_File, 2, VulkanMemoryTrackKind::SubBuffer);
+    Check(resources && resources->Count == NUM_RESOURCES / 2 && resources->Bytes == NUM_RESOURCES / 2 * RESOURCE_SIZE, "double untrack is ignored", numFailed);
+    Check(resources && resources->PeakBytes == NUM_RESOURCES * RESOURCE_SIZE && resources->TotalAllocations == NUM_RESOURCES, "peak and total allocations survive releases", numFailed);
+    Check(subBuffers && subBuffers->Count == NUM_SUB_BUFFERS / 2, "sub buffer callsite drops released entries", numFailed);
+
+    const VulkanMemorySnapshotDiff diff = VulkanMemorySnapshot::Diff(before, after);
+    Check(diff.DeltaTotalBytes[(int32)VulkanMemoryTrackKind::Resource] == -(int64)(NUM_RESOURCES / 2 * RESOURCE_SIZE), "diff resource total", numFailed);
+    Check(diff.DeltaTotalBytes[(int32)VulkanMemoryTrackKind::SubBuffer] == -(int64)(NUM_SUB_BUFFERS / 2 * SUB_BUFFER_SIZE), "diff sub buffer total", numFailed);
+    Check(diff.Callsites.size() == 2 && diff.Callsites[0].Kind == VulkanMemoryTrackKind::SubBuffer && diff.Callsites[0].DeltaCount == -(int32)(NUM_SUB_BUFFERS / 2), "diff lists both callsites, largest change first", numFailed);
+
+    VulkanMemorySnapshot loaded;
+    const bool parsed = loaded.FromJson(after.ToJson());
+    const VulkanMemorySnapshotDiff roundtrip = VulkanMemorySnapshot::Diff(after, loaded);
+    Check(parsed && roundtrip.Callsites.empty() && loaded.Callsites.size() == after.Callsites.size(), "snapshot survives a JSON roundtrip", numFailed);
+
+    for (uint32 index = 0; index < handles.size(); ++index) {
+        tracker.UntrackAllocation(&handles[index]);
+    }
+    const VulkanMemorySnapshot released = tracker.CaptureSnapshot("Released");
+    Check(!FindCallsite(released, s_File, 1, VulkanMemoryTrackKind::Resource) && !FindCallsite(released, s_File, 2, VulkanMemoryTrackKind::SubBuffer), "released callsites leave the snapshot", numFailed);
+
+    // VMA Buffer记在调用方传进来的位置上
+    WindowProperty property("ReAllocatorBench", 64, 64);
+    property.Headless = true;
+
+    VulkanInstance instance(nullptr, &property);
+    instance.Init();
+    if (instance.GetDevice())
+    {
+        const std::source_location location = std::source_location::current();
+        Ref<VulkanBuffer> buffer = VulkanBuffer::CreateBuffer(instance.GetDevice(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, BUFFER_SIZE, nullptr, location);
+
+        const VulkanMemoryCallsiteStats* vma = FindCallsite(tracker.CaptureSnapshot("Vma"), location.file_name(), location.line(), VulkanMemoryTrackKind::Vma);
+        Check(buffer && vma && vma->Count == 1 && vma->Bytes >= BUFFER_SIZE, "VMA buffer is tracked at the caller", numFailed);
+
+        buffer.reset();
+        instance.GetDevice()->GetResourceHeapManager().ProcessPendingReleases(~0ull);
+        Check(!FindCallsite(tracker.CaptureSnapshot("VmaReleased"), location.file_name(), location.line(), VulkanMemoryTrackKind::Vma), "VMA buffer is untracked once released", numFailed);
+    }
+    else {
+        RE_WARN("No Vulkan device, skipping the VMA checks");
+    }
+
+    RE_INFO("Tracker: {0} checks failed", numFailed);
+    instance.Shutdown();
+    return numFailed == 0;
+}
+
+// 批量Uniform的不变量：偏移对齐且落在Ring里，每个物体的数据互不覆盖，指针和偏移指向同一处
+// 同一帧里Ring放不下第二批时BeginUniformBatch返回false，之后的ApplyUniformBatch不改偏移；Chunk回收后可以再开批
+static bool RunUniformBatchBench(const BenchSettings& settings)
+{
+    enum
+    {
+        NUM_BACK_BUFFERS = 3,
+        RING_SIZE = 3 * 1024 * 1024,
+    };
+
+    WindowProperty property("ReAllocatorBench", 64, 64);
+    property.Headless = true;
+
+    VulkanInstance instance(nullptr, &property);
+    instance.Init();
+    Ref<VulkanDevice> device = instance.GetDevice();
+    if (!device)
+    {
+        RE_ERROR("No Vulkan device, uniform batch bench needs one");
+        return false;
+    }
+
+    uint32 numFailed = 0;
+    {
+        Ref<VulkanDynamicBufferRing> ring = CreateRef<VulkanDynamicBufferRing>();
+        ring->OnCreate(device, NUM_BACK_BUFFERS, RING_SIZE);
+
+        // 只做Prepare，不需要RenderPass
+        Ref<VulkanShader> shader = VulkanShader::Create(device, true, &PREDEPTH_VERT, &PREDEPTH_FRAG, nullptr, nullptr, nullptr, nullptr);
+        Ref<VulkanMaterial> material = VulkanMaterial::Create(device, VK_NULL_HANDLE, VK_NULL_HANDLE, shader, ring);
+
+        const int32 slot = material->GetUniformSlot("uboMVP");
+        Check(slot >= 0, "uboMVP has a uniform slot", numFailed);
+        if (slot < 0)
+        {
+            instance.Shutdown();
+            return false;
+        }
+
+        const VulkanUniformSlot& uniform = material->uniformSlots[slot];
+        const uint32 alignment = ring->GetAlignment();
+        const uint64 capacity = ring->GetStats().Capacity;
+        const std::vector<int32> slots = { slot };
+
+        // 每批占两个半Chunk，第一批放得下，同一帧里的第二批一定放不下
+        const uint32 drawsPerChunk = ring->GetMaxAllocSize() / Align(uniform.DataSize, alignment);
+        const uint32 numChunks = (uint32)(capacity / ring->GetMaxAllocSize());
+        const uint32 drawCount = drawsPerChunk * (numChunks - 1) + drawsPerChunk / 2;
+
+        Check(material->BeginUniformBatch(slots, drawCount), "batch fits in an empty ring", numFailed);
+
+        std::vector<uint32> words(uniform.DataSize / sizeof(uint32));
+        for (uint32 drawIndex = 0; drawIndex < drawCount; ++drawIndex)
+        {
+            std::fill(words.begin(), words.end(), drawIndex * 0x9E3779B9u + settings.Seed);
+            material->SetBatchUniform(drawIndex, 0, words.data(), uniform.DataSize);
+        }
+
+        // Ring只有一个映射的Block，每个物体的数据指针减去偏移都应该是Block的起点
+        bool aligned = true;
+        bool inRange = true;
+        bool intact = true;
+        bool sameBlock = true;
+        const uint8* blockBase = nullptr;
+        for (uint32 drawIndex = 0; drawIndex < drawCount; ++drawIndex)
+        {
+            material->ApplyUniformBatch(drawIndex);
+            const uint32 offset = material->DynamicOffsets[uniform.DynamicIndex];
+            const uint8* data = (const uint8*)material->GetBatchUniformData(drawIndex, 0);
+
+            aligned &= IsAligned(offset, alignment);
+            inRange &= (uint64)offset + uniform.DataSize <= capacity;
+            if (drawIndex == 0) {
+                blockBase = data - offset;
+            }
+            sameBlock &= data - offset == blockBase;
+
+            const uint32 expected = drawIndex * 0x9E3779B9u + settings.Seed;
+            for (uint32 word = 0; word < words.size(); ++word) {
+                intact &= ((const uint32*)data)[word] == expected;
+            }
+        }
+        Check(aligned, "batch offsets are aligned", numFailed);
+        Check(inRange, "batch offsets stay inside the ring", numFailed);
+        Check(sameBlock, "batch data pointers match their offsets", numFailed);
+        Check(intact, "batch draws do not overlap", numFailed);
+
+        Check(!material->BeginUniformBatch({ VulkanMaterial::INVALID_UNIFORM_SLOT }, 1), "invalid slot is rejected", numFailed);
+        Check(!material->BeginUniformBatch(slots, 0), "empty batch is rejected", numFailed);
+
+        // 放不下的一批失败后沿用原来的偏移，调用方改走逐个上传
+        const std::vector<uint32> offsets = material->DynamicOffsets;
+        Check(!material->BeginUniformBatch(slots, drawCount), "second batch in the same frame does not fit", numFailed);
+        material->ApplyUniformBatch(0);
+        Check(material->DynamicOffsets == offsets, "failed batch leaves dynamic offsets alone", numFailed);
+
+        for (uint32 frame = 0; frame < NUM_BACK_BUFFERS; ++frame) {
+            ring->OnBeginFrame();
+        }
+        Check(material->BeginUniformBatch(slots, drawCount), "batch fits again once the chunks are recycled", numFailed);
+
+        RE_INFO("UniformBatch: {0} draws per batch, {1} checks failed", drawCount, numFailed);
+    }
+
+    instance.Shutdown();
+    return numFailed == 0;
+}
+
+// 碎片整理依赖的释放顺序：延迟释放要等所在的帧完成，整理的Pass打开期间VMA的释放暂存到Pass结束
+// 然后隔一个释放一个制造碎片跑几轮VulkanTextureStreamer的整理，这些Buffer不是流式贴图也不是网格，必须原地不动、内容不变
+static bool RunDefragBench(const BenchSettings& settings)
+{
+    enum
+    {
+        NUM_BUFFERS = 256,
+        BUFFER_SIZE = 256 * 1024,
+        NUM_FRAMES_IN_FLIGHT = 3,
+    };
+
+    WindowProperty property("ReAllocatorBench", 64, 64);
+    property.Headless = true;
+
+    VulkanInstance instance(nullptr, &property);
+    instance.Init();
+    Ref<VulkanDevice> device = instance.GetDevice();
+    if (!device)
+    {
+        RE_ERROR("No Vulkan device, defrag bench needs one");
+        return false;
+    }
+
+    VulkanDeviceMemoryManager& memoryManager = device->GetMemoryManager();
+    VulkanResourceHeapManager& heapManager = device->GetResourceHeapManager();
+    const VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    const VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    const VulkanMemoryCategory category = GetBufferMemoryCategory(usageFlags, memoryFlags);
+    const uint64 baseline = memoryManager.GetCategoryUsage(category);
+    uint32 numFailed = 0;
+
+    uint64 frame = NUM_FRAMES_IN_FLIGHT;
+    {
+        heapManager.BeginFrame(frame);
+        Ref<VulkanBuffer> buffer = VulkanBuffer::CreateBuffer(device, usageFlags, memoryFlags, BUFFER_SIZE);
+        const uint64 allocated = memoryManager.GetCategoryUsage(category);
+        buffer.reset();
+
+        heapManager.ProcessPendingReleases(frame - 1);
+        Check(memoryManager.GetCategoryUsage(category) == allocated, "release waits for its frame", numFailed);
+
+        heapManager.HoldVmaReleases();
+        heapManager.ProcessPendingReleases(frame);
+        Check(memoryManager.GetCategoryUsage(category) == allocated, "release is held while a defrag pass is open", numFailed);
+
+        heapManager.ResumeVmaReleases();
+        heapManager.ProcessPendingReleases(frame);
+        Check(memoryManager.GetCategoryUsage(category) == baseline, "held release runs after resume", numFailed);
+    }
+
+    // 隔一个释放一个，留下的写入各自的编号
+    std::vector<Ref<VulkanBuffer>> buffers(NUM_BUFFERS);
+    for (uint32 index = 0; index < NUM_BUFFERS; ++index) {
+        buffers[index] = VulkanBuffer::CreateBuffer(device, usageFlags, memoryFlags, BUFFER_SIZE);
+    }
+
+    std::vector<Ref<VulkanBuffer>> survivors;
+    std::vector<VkBuffer> handles;
+    std::vector<uint32> ids;
+    for (uint32 index = 0; index < NUM_BUFFERS; ++index)
+    {
+        if (index % 2 == 0) {
+            continue;
+        }
+
+        Ref<VulkanBuffer>& buffer = buffers[index];
+        buffer->Map();
+        uint32* data = (uint32*)buffer->Mapped;
+        for (uint32 word = 0; word < BUFFER_SIZE / sizeof(uint32); ++word) {
+            data[word] = index * 0x9E3779B9u + word + settings.Seed;
+        }
+
+        survivors.push_back(buffer);
+        handles.push_back(buffer->Buffer);
+        ids.push_back(index);
+    }
+    buffers.clear();
+
+    // 跑满三轮整理的间隔，期间继续有Buffer析构，释放都要经过暂存
+    VulkanTextureStreamer streamer;
+    streamer.Init(device);
+
+    const uint32 numFrames = VulkanTextureStreamer::DEFRAG_INTERVAL * 3 + VulkanTextureStreamer::UPDATE_INTERVAL * 2;
+    for (uint32 index = 0; index < numFrames; ++index)
+    {
+        frame += 1;
+        heapManager.BeginFrame(frame);
+        streamer.Tick();
+
+        if (index % 64 == 0 && survivors.size() > 1)
+        {
+            survivors.pop_back();
+            handles.pop_back();
+            ids.pop_back();
+        }
+
+        heapManager.ProcessPendingReleases(frame - NUM_FRAMES_IN_FLIGHT);
+    }
+
+    const VulkanTextureStreamingStats stats = streamer.GetStats();
+    Check(stats.DefragmentedBytes == 0, "buffers outside streaming textures and meshes are not moved", numFailed);
+
+    bool sameHandles = true;
+    bool intact = true;
+    for (uint32 index = 0; index < survivors.size(); ++index)
+    {
+        sameHandles &= survivors[index]->Buffer == handles[index];
+
+        const uint32* data = (const uint32*)survivors[index]->Mapped;
+        for (uint32 word = 0; word < BUFFER_SIZE / sizeof(uint32); ++word) {
+            intact &= data[word] == ids[index] * 0x9E3779B9u + word + settings.Seed;
+        }
+    }
+    Check(sameHandles, "surviving buffers keep their handles", numFailed);
+    Check(intact, "surviving buffers keep their contents", numFailed);
+
+    // Pass全部结束后暂存的释放都应该放出来，用量回到开始时
+    streamer.Destroy();
+    survivors.clear();
+    heapManager.ProcessPendingReleases(~0ull);
+    Check(memoryManager.GetCategoryUsage(category) == baseline, "every release reaches the allocator once the passes end", numFailed);
+
+    RE_INFO("Defrag: {0} frames, {1} checks failed", numFrames, numFailed);
+    instance.Shutdown();
+    return numFailed == 0;
+}
+
+int main(int argc, char** argv)
+{
+    Log::Init();
+
+    BenchSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--trace") == 0 && hasValue) {
+            settings.TracePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--save") == 0 && hasValue) {
+            settings.SavePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--ops") == 0 && hasValue) {
+            settings.NumOps = (uint32)std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(arg, "--seed") == 0 && hasValue) {
+            settings.Seed = (uint32)std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--page-size") == 0 && hasValue) {
+            settings.PageSize = (uint32)std::clamp(std::atoi(argv[++i]), 1, 4095) * 1024 * 1024;
+        }
+        else if (std::strcmp(arg, "--repeat") == 0 && hasValue) {
+            settings.Repeat = (uint32)std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(arg, "--contention") == 0) {
+            settings.Contention = true;
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+            settings.MaxThreads = (uint32)std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(arg, "--iterations") == 0 && hasValue) {
+            settings.Iterations = (uint32)std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(arg, "--defrag") == 0) {
+            settings.Defrag = true;
+        }
+        else if (std::strcmp(arg, "--uniform-batch") == 0) {
+            settings.UniformBatch = true;
+        }
+        else if (std::strcmp(arg, "--tracker") == 0) {
+            settings.Tracker = true;
+        }
+        else
+        {
+            RE_ERROR("Usage: ReAllocatorBench [--trace file] [--save file] [--ops N] [--seed N] [--page-size MB] [--repeat N]");
+            RE_ERROR("       ReAllocatorBench --contention [--threads N] [--iterations N]");
+            RE_ERROR("       ReAllocatorBench --defrag [--seed N]");
+            RE_ERROR("       ReAllocatorBench --uniform-batch [--seed N]");
+            RE_ERROR("       ReAllocatorBench --tracker");
+            return 1;
+        }
+    }
+
+    if (settings.Contention) {
+        return RunContentionBench(settings) ? 0 : 1;
+    }
+    if (settings.Defrag) {
+        return RunDefragBench(settings) ? 0 : 1;
+    }
+    if (settings.UniformBatch) {
+        return RunUniformBatchBench(settings) ? 0 : 1;
+    }
+    if (settings.Tracker) {
+        return RunTrackerBench(settings) ? 0 : 1;
+    }
+
+    AllocationTrace trace;
+    if (!settings.TracePath.empty())
+    {
+        if (!LoadTrace(settings.TracePath, trace))
+        {
+            RE_ERROR("Failed to load trace {0}", settings.TracePath);
+            return 1;
+        }
+    }
+    else {
+        GenerateTrace(settings, trace);
+    }
+
+    if (!settings.SavePath.empty() && !SaveTrace(settings.SavePath, trace))
+    {
+        RE_ERROR("Failed to save trace {0}", settings.SavePath);
+        return 1;
+    }
+
+    RunTraceBench(trace, settings.Repeat);
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "Core/Application.h"
+#include "Core/CpuProfiler.h"
 #include "Event/ApplicationEvent.h"
 #include "Log/Log.h"
 #include "Layer/Layer.h"
@@ -14,8 +15,56 @@
 #include "Renderer/RHI/Renderer.h"
 #include "Window/WindowsWindow.h"
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
 namespace ReEngine
 {
+    void Application::ParseCommandLine(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (std::strcmp(arg, "--headless") == 0) {
+                m_WindowProperty.Headless = true;
+            }
+            else if (std::strcmp(arg, "--frames") == 0 && hasValue) {
+                m_Benchmark.NumFrames = (uint32)std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (std::strcmp(arg, "--warmup") == 0 && hasValue) {
+                m_Benchmark.WarmupFrames = (uint32)std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (std::strcmp(arg, "--width") == 0 && hasValue) {
+                m_WindowProperty.Width = (uint32)std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (std::strcmp(arg, "--height") == 0 && hasValue) {
+                m_WindowProperty.Height = (uint32)std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (std::strcmp(arg, "--layer") == 0 && hasValue) {
+                m_Benchmark.LayerName = argv[++i];
+            }
+            else if (std::strcmp(arg, "--report") == 0 && hasValue) {
+                m_Benchmark.ReportPath = argv[++i];
+            }
+            else {
+                RE_CORE_WARN("Unknown command line argument {0}", arg);
+            }
+        }
+
+        //基准要测的是渲染本身，不限帧也不等垂直同步
+        if (m_Benchmark.NumFrames > 0)
+        {
+            m_WindowProperty.MaxFrameRate = 0.0f;
+            m_WindowProperty.JustInTime = false;
+            if (!m_WindowProperty.Headless) {
+                m_WindowProperty.PresentType = PresentMode::Immediate;
+            }
+        }
+    }
+
     void Application::Init()
     {
         m_Window = Window::CreateReWindow(m_WindowProperty);
@@ -24,45 +73,133 @@ namespace ReEngine
         {
                 OnEvent(e);
         });
+
+        //无窗口时没有初始化GLFW，也没有显示器
+        if (!m_WindowProperty.Headless)
+        {
+            const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+            if (videoMode) {
+                m_FramePacer.SetRefreshRate((float)videoMode->refreshRate);
+            }
+        }
+        m_FramePacer.SetMaxFrameRate(m_WindowProperty.MaxFrameRate);
+        m_FramePacer.SetJustInTime(m_WindowProperty.JustInTime);
     }
     
     void Application::Run()
     {
+        RE_PROFILE_THREAD("Main");
+
+        if (m_Benchmark.NumFrames > 0)
+        {
+            auto VulkanContext = dynamic_cast<ReEngine::VulkanContext*>(Renderer::GetContext().get());
+            m_BenchmarkRecorder.Begin(m_Benchmark, VulkanContext->CommandPool->GetFramesInFlight());
+        }
+        uint64 lastGpuFrame = UINT64_MAX;
+
         while (mRunning)
         {
-            float CurrentTime = m_Window->GetTime();
-            Timestep Ts = CurrentTime - m_LastTime;
-            m_LastTime = CurrentTime;
-            
+            const auto frameStart = std::chrono::steady_clock::now();
+
+            //上一帧的Frame Zone已经结束，这里是帧边界
+            RE_PROFILE_FRAME();
+            RE_PROFILE_SCOPE("Frame");
+
             auto Context = Renderer::GetContext().get();
             auto VulkanContext = dynamic_cast<ReEngine::VulkanContext*>(Context);
+
+            //交换链图像会全部换掉，走和窗口大小变化一样的路径，各层一起重建FrameBuffer
+            if (m_PresentModeDirty)
+            {
+                m_PresentModeDirty = false;
+                OnEvent(std::make_shared<WindowResizeEvent>(m_WindowProperty.Width, m_WindowProperty.Height));
+            }
+
+            //限帧和JustInTime的等待放在Acquire和输入之前，等完再采样
+            {
+                RE_PROFILE_SCOPE("FramePacer");
+                m_FramePacer.BeginFrame();
+            }
             
-            VulkanContext->Acquire();
+            {
+                RE_PROFILE_SCOPE("Acquire");
+                VulkanContext->Acquire();
+            }
 
             //响应事件
-            m_Window->PollEvent();
+            {
+                RE_PROFILE_SCOPE("PollEvent");
+                m_Window->PollEvent();
+            }
+
+            float CurrentTime = m_Window->GetTime();
+            Timestep Ts = CurrentTime - m_LastTime;
+            m_LastTime = CurrentTime;
             
             //更新数据
-            for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
-                (*(--it))->OnUpdate(Ts);
+            {
+                RE_PROFILE_SCOPE("OnUpdate");
+                for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
+                    (*(--it))->OnUpdate(Ts);
+            }
 
             //更新UI
-            VulkanContext->BeginUI();
-            for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
-                (*(--it))->OnUIRender(Ts);
-            VulkanContext->EndUI();
+            {
+                RE_PROFILE_SCOPE("OnUIRender");
+                VulkanContext->BeginUI();
+                for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
+                    (*(--it))->OnUIRender(Ts);
+                VulkanContext->EndUI();
+            }
 
-            //绘制每一层
-            for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
-                (*(--it))->OnRender();
+            //绘制每一层，每层的OnRender包一个GPU计时Scope
+            {
+                RE_PROFILE_SCOPE("OnRender");
+                VulkanContext->BeginFrame();
+                for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
+                {
+                    const Ref<Layer>& layer = *(--it);
+                    VulkanGpuScope gpuScope(VulkanContext->GetGpuProfiler(), VulkanContext->GetCommandList(), layer->GetName());
+                    layer->OnRender();
+                }
+            }
 
             //绘制UI
-            VulkanContext->DrawUI();
+            {
+                RE_PROFILE_SCOPE("DrawUI");
+                VulkanContext->DrawUI();
+            }
             
             //present
-            VulkanContext->SwapBuffers(Ts);
+            {
+                RE_PROFILE_SCOPE("SwapBuffers");
+                VulkanContext->SwapBuffers(Ts);
+            }
             
             m_Window->Update(Ts);
+
+            m_FramePacer.EndFrame();
+
+            //GPU的结果晚几帧才有，按帧号去重
+            if (m_BenchmarkRecorder.IsActive())
+            {
+                const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+                m_BenchmarkRecorder.AddCpuFrame(frameMs);
+
+                const VulkanGpuFrameResult& gpuFrame = VulkanContext->GetGpuProfiler().GetLastFrame();
+                if (gpuFrame.FrameNumber != lastGpuFrame && !gpuFrame.Scopes.empty())
+                {
+                    lastGpuFrame = gpuFrame.FrameNumber;
+                    m_BenchmarkRecorder.AddGpuFrame(gpuFrame.FrameNumber, gpuFrame.DurationMs);
+                }
+
+                if (m_BenchmarkRecorder.IsFinished())
+                {
+                    const std::string deviceName = VulkanContext->Instance->GetDevice()->GetDeviceProperties().properties.deviceName;
+                    m_BenchmarkRecorder.Finish(deviceName, m_WindowProperty.Width, m_WindowProperty.Height);
+                    mRunning = false;
+                }
+            }
         }
 
         for (auto it = mLayerStack.end(); it != mLayerStack.begin(); )
@@ -113,6 +250,16 @@ namespace ReEngine
         InLayer->OnDetach();
     }
 
+    void Application::SetPresentMode(PresentMode mode)
+    {
+        if (m_WindowProperty.PresentType == mode) {
+            return;
+        }
+
+        m_WindowProperty.PresentType = mode;
+        m_PresentModeDirty = true;
+    }
+
     bool Application::OnWindowResize(Ref<WindowResizeEvent> e)
     {
         RE_INFO("({0},{1})",e->GetWidth(),e->GetHeight());
@@ -6,6 +6,8 @@
 #include "Layer/LayerStack.h"
 #include "Layer/ImGuiLayer.h"
 #include "Core/SIngletonTemplate.h"
+#include "Core/FramePacer.h"
+#include "Core/Benchmark.h"
 
 namespace ReEngine
 {
@@ -26,8 +28,16 @@ namespace ReEngine
 
         [[nodiscard]]Window& GetWindow() { return *m_Window; }
         [[nodiscard]]const WindowProperty GetWindowInfo(){return m_WindowProperty;}
+        [[nodiscard]]FramePacer& GetFramePacer(){return m_FramePacer;}
+        [[nodiscard]]const BenchmarkSettings& GetBenchmark() const {return m_Benchmark;}
+
+        // 下一帧开始前重建交换链，设备不支持时会退回，实际模式看交换链
+        void SetPresentMode(PresentMode mode);
+        [[nodiscard]]PresentMode GetPresentMode() const {return m_WindowProperty.PresentType;}
 
     public:
+        // Init之前调用，--headless等参数写进窗口属性和基准设置
+        void ParseCommandLine(int argc, char** argv);
         void Init();
         void Run();
         void Shutdown();
@@ -39,6 +49,10 @@ namespace ReEngine
         LayerStack mLayerStack;
         bool mRunning = true;
         float m_LastTime;
+        FramePacer m_FramePacer;
+        bool m_PresentModeDirty = false;
+        BenchmarkSettings m_Benchmark;
+        BenchmarkRecorder m_BenchmarkRecorder;
 
     private:   
         friend void AppInit(Application& app);
@@ -0,0 +1,128 @@
+﻿#include "Benchmark.h"
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace ReEngine
+{
+    FrameTimeSummary FrameTimeSummary::Compute(std::vector<double> samples)
+    {
+        FrameTimeSummary summary;
+        if (samples.empty()) {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        // 最近秩法，p99在样本少时就是最大值
+        auto Percentile = [&samples](double percent) -> double
+        {
+            const size_t rank = (size_t)std::ceil(percent / 100.0 * samples.size());
+            return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+        };
+
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+
+        summary.Count  = (uint32)samples.size();
+        summary.MeanMs = total / samples.size();
+        summary.P50Ms  = Percentile(50.0);
+        summary.P90Ms  = Percentile(90.0);
+        summary.P99Ms  = Percentile(99.0);
+        summary.MaxMs  = samples.back();
+        return summary;
+    }
+
+    static json ToJson(const FrameTimeSummary& summary)
+    {
+        json value;
+        value["count"]  = summary.Count;
+        value["mean"]   = summary.MeanMs;
+        value["p50"]    = summary.P50Ms;
+        value["p90"]    = summary.P90Ms;
+        value["p99"]    = summary.P99Ms;
+        value["max"]    = summary.MaxMs;
+        return value;
+    }
+
+    void BenchmarkRecorder::Begin(const BenchmarkSettings& settings, uint32 numFramesInFlight)
+    {
+        m_Settings          = settings;
+        m_NumFramesInFlight = numFramesInFlight;
+        m_NumFrames         = 0;
+        m_CpuFrames.clear();
+        m_GpuFrames.clear();
+        m_CpuFrames.reserve(settings.NumFrames);
+        m_GpuFrames.reserve(settings.NumFrames);
+    }
+
+    void BenchmarkRecorder::AddCpuFrame(double frameMs)
+    {
+        const uint32 frame = m_NumFrames++;
+        if (frame >= m_Settings.WarmupFrames && m_CpuFrames.size() < m_Settings.NumFrames) {
+            m_CpuFrames.push_back(frameMs);
+        }
+    }
+
+    void BenchmarkRecorder::AddGpuFrame(uint64 gpuFrameNumber, double frameMs)
+    {
+        if (gpuFrameNumber >= m_Settings.WarmupFrames && m_GpuFrames.size() < m_Settings.NumFrames) {
+            m_GpuFrames.push_back(frameMs);
+        }
+    }
+
+    bool BenchmarkRecorder::IsFinished() const
+    {
+        if (m_CpuFrames.size() < m_Settings.NumFrames) {
+            return false;
+        }
+        // 时间戳最多晚FramesInFlight帧读回，多给一帧余量
+        return m_GpuFrames.size() >= m_Settings.NumFrames || m_NumFrames >= m_Settings.WarmupFrames + m_Settings.NumFrames + m_NumFramesInFlight + 1;
+    }
+
+    void BenchmarkRecorder::Finish(const std::string& deviceName, uint32 width, uint32 height)
+    {
+        const FrameTimeSummary cpu = FrameTimeSummary::Compute(m_CpuFrames);
+        const FrameTimeSummary gpu = FrameTimeSummary::Compute(m_GpuFrames);
+
+        RE_CORE_INFO("Benchmark {0} on {1} ({2}x{3}), {4} frames after {5} warmup", m_Settings.LayerName, deviceName, width, height, m_Settings.NumFrames, m_Settings.WarmupFrames);
+        RE_CORE_INFO("CPU ms  mean {0:.3f}  p50 {1:.3f}  p90 {2:.3f}  p99 {3:.3f}  max {4:.3f}", cpu.MeanMs, cpu.P50Ms, cpu.P90Ms, cpu.P99Ms, cpu.MaxMs);
+        if (gpu.Count > 0) {
+            RE_CORE_INFO("GPU ms  mean {0:.3f}  p50 {1:.3f}  p90 {2:.3f}  p99 {3:.3f}  max {4:.3f}", gpu.MeanMs, gpu.P50Ms, gpu.P90Ms, gpu.P99Ms, gpu.MaxMs);
+        }
+        else {
+            RE_CORE_INFO("GPU ms  no timestamp results");
+        }
+
+        if (m_Settings.ReportPath.empty()) {
+            return;
+        }
+
+        json report;
+        report["layer"]         = m_Settings.LayerName;
+        report["device"]        = deviceName;
+        report["width"]         = width;
+        report["height"]        = height;
+        report["frames"]        = m_Settings.NumFrames;
+        report["warmup"]        = m_Settings.WarmupFrames;
+        report["cpu"]           = ToJson(cpu);
+        report["gpu"]           = ToJson(gpu);
+        report["cpuFrames"]     = m_CpuFrames;
+        report["gpuFrames"]     = m_GpuFrames;
+
+        std::ofstream file(m_Settings.ReportPath);
+        if (!file.is_open())
+        {
+            RE_CORE_ERROR("Failed to open {0} for writing.", m_Settings.ReportPath);
+            return;
+        }
+        file << report.dump(4);
+    }
+}
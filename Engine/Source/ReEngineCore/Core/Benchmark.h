@@ -0,0 +1,63 @@
+﻿#pragma once
+#include "Core/Core.h"
+
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    // 命令行：--headless --frames N --warmup N --layer Name --width W --height H --report Path
+    struct BenchmarkSettings
+    {
+        // 0表示不跑基准，正常运行
+        uint32          NumFrames = 0;
+        // 前几帧有管线编译和上传，不计入统计
+        uint32          WarmupFrames = 30;
+        std::string     LayerName;
+        std::string     ReportPath = "Benchmark.json";
+    };
+
+    struct FrameTimeSummary
+    {
+        uint32          Count = 0;
+        double          MeanMs = 0.0;
+        double          P50Ms = 0.0;
+        double          P90Ms = 0.0;
+        double          P99Ms = 0.0;
+        double          MaxMs = 0.0;
+
+        static FrameTimeSummary Compute(std::vector<double> samples);
+    };
+
+    // 固定帧数的基准：热身之后记录每帧的CPU耗时和GPU耗时，结束时输出分位数并写JSON报告
+    // GPU耗时来自时间戳，晚几帧才读回，所以CPU记满之后还要多跑几帧等GPU的结果
+    class BenchmarkRecorder
+    {
+    public:
+        void Begin(const BenchmarkSettings& settings, uint32 numFramesInFlight);
+
+        // 每帧结束时调用，frameMs是这一帧主循环的耗时
+        void AddCpuFrame(double frameMs);
+
+        // gpuFrameNumber是时间戳所属帧的编号，和CPU帧一样从0开始
+        void AddGpuFrame(uint64 gpuFrameNumber, double frameMs);
+
+        // CPU和GPU都记满，或者等GPU的帧数用完（不支持时间戳）
+        bool IsFinished() const;
+
+        // 输出统计，写报告
+        void Finish(const std::string& deviceName, uint32 width, uint32 height);
+
+        FORCE_INLINE bool IsActive() const
+        {
+            return m_Settings.NumFrames > 0;
+        }
+
+    private:
+        BenchmarkSettings       m_Settings;
+        uint32                  m_NumFramesInFlight = 0;
+        uint32                  m_NumFrames = 0;
+        std::vector<double>     m_CpuFrames;
+        std::vector<double>     m_GpuFrames;
+    };
+}
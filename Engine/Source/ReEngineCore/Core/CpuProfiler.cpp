@@ -0,0 +1,160 @@
+﻿#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace ReEngine
+{
+    uint64 CpuProfiler::Now()
+    {
+        return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    CpuProfiler::ThreadBuffer* CpuProfiler::GetThreadBuffer()
+    {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            buffer = GetInstance().RegisterThread();
+        }
+        return buffer;
+    }
+
+    CpuProfiler::ThreadBuffer* CpuProfiler::RegisterThread()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
+        // 线程退出后缓冲保留，导出时它之前的记录还在
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->ThreadIndex = (uint32)m_Threads.size();
+        buffer->Name        = "Thread " + std::to_string(buffer->ThreadIndex);
+        buffer->Events.resize(MAX_EVENTS_PER_THREAD);
+        m_Threads.push_back(std::move(buffer));
+        return m_Threads.back().get();
+    }
+
+    void CpuProfiler::SetThreadName(const char* name)
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(m_Lock);
+        buffer->Name = name;
+    }
+
+    void CpuProfiler::EndFrame()
+    {
+        const uint64 now = Now();
+
+        if (m_FrameStartNs != 0)
+        {
+            m_LastFrameStartNs = m_FrameStartNs;
+            m_LastFrameMs      = (now - m_FrameStartNs) / 1000000.0;
+            m_LastFrameEvents.clear();
+            CollectEvents(*GetThreadBuffer(), m_FrameStartNs, now, m_LastFrameEvents);
+        }
+        m_FrameStartNs = now;
+
+        if (m_CaptureFramesLeft > 0)
+        {
+            m_CaptureFramesLeft -= 1;
+            if (m_CaptureFramesLeft == 0)
+            {
+                if (SaveChromeTrace(m_CapturePath, m_CaptureStartNs, now)) {
+                    RE_CORE_WARN("Captured {0} frames to {1}.", m_CaptureFrames, m_CapturePath);
+                }
+            }
+        }
+        else if (m_CaptureRequested)
+        {
+            m_CaptureRequested  = false;
+            m_CaptureFramesLeft = m_CaptureFrames;
+            m_CaptureStartNs    = now;
+        }
+    }
+
+    void CpuProfiler::RequestCapture(uint32 numFrames, const std::string& filename)
+    {
+        if (IsCapturing()) {
+            return;
+        }
+
+        m_CaptureRequested = true;
+        m_CaptureFrames    = std::min<uint32>(std::max<uint32>(numFrames, 1), MAX_CAPTURE_FRAMES);
+        m_CapturePath      = filename;
+    }
+
+    void CpuProfiler::CollectEvents(ThreadBuffer& buffer, uint64 beginNs, uint64 endNs, std::vector<CpuProfileEvent>& outEvents)
+    {
+        const uint64 writeIndex = buffer.WriteIndex.load(std::memory_order_acquire);
+        const uint64 first      = writeIndex > MAX_EVENTS_PER_THREAD ? writeIndex - MAX_EVENTS_PER_THREAD : 0;
+
+        // 记录按结束时间写入，从新往旧找，结束时间早于范围时后面都不用看了
+        const size_t numBefore = outEvents.size();
+        for (uint64 index = writeIndex; index > first; --index)
+        {
+            const CpuProfileEvent& event = buffer.Events[(index - 1) % MAX_EVENTS_PER_THREAD];
+            if (event.EndNs < beginNs) {
+                break;
+            }
+            if (event.BeginNs >= beginNs && event.BeginNs < endNs) {
+                outEvents.push_back(event);
+            }
+        }
+
+        std::sort(outEvents.begin() + numBefore, outEvents.end(), [](const CpuProfileEvent& a, const CpuProfileEvent& b) {
+            return a.BeginNs < b.BeginNs || (a.BeginNs == b.BeginNs && a.Depth < b.Depth);
+        });
+    }
+
+    bool CpuProfiler::SaveChromeTrace(const std::string& filename, uint64 beginNs, uint64 endNs)
+    {
+        json events = json::array();
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        std::vector<CpuProfileEvent> threadEvents;
+        for (const std::unique_ptr<ThreadBuffer>& buffer : m_Threads)
+        {
+            threadEvents.clear();
+            CollectEvents(*buffer, beginNs, endNs, threadEvents);
+            if (threadEvents.empty()) {
+                continue;
+            }
+
+            json threadName;
+            threadName["name"] = "thread_name";
+            threadName["ph"]   = "M";
+            threadName["pid"]  = 0;
+            threadName["tid"]  = buffer->ThreadIndex;
+            threadName["args"]["name"] = buffer->Name;
+            events.push_back(threadName);
+
+            for (const CpuProfileEvent& event : threadEvents)
+            {
+                json traceEvent;
+                traceEvent["name"] = event.Name;
+                traceEvent["cat"]  = "cpu";
+                traceEvent["ph"]   = "X";
+                traceEvent["ts"]   = (event.BeginNs - beginNs) / 1000.0;
+                traceEvent["dur"]  = (event.EndNs - event.BeginNs) / 1000.0;
+                traceEvent["pid"]  = 0;
+                traceEvent["tid"]  = buffer->ThreadIndex;
+                events.push_back(traceEvent);
+            }
+        }
+
+        json root;
+        root["traceEvents"]     = events;
+        root["displayTimeUnit"] = "ms";
+
+        std::ofstream file(filename);
+        if (!file.is_open())
+        {
+            RE_CORE_ERROR("Failed to open {0} for writing.", filename);
+            return false;
+        }
+        file << root.dump();
+        return true;
+    }
+}
@@ -0,0 +1,151 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Core/SIngletonTemplate.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 编译时设为0，下面的宏全部展开为空
+#ifndef RE_ENABLE_PROFILER
+    #define RE_ENABLE_PROFILER 1
+#endif
+
+namespace ReEngine
+{
+    struct CpuProfileEvent
+    {
+        // 只存指针，名字必须是字符串常量
+        const char*     Name = nullptr;
+        uint64          BeginNs = 0;
+        uint64          EndNs = 0;
+        uint32          Depth = 0;
+    };
+
+    // CPU的分段计时：每个线程一个环形缓冲，Zone结束时写一条记录，写入不加锁
+    // 主线程每帧调用EndFrame，收集这一帧的记录给面板看；请求抓帧时连续记录N帧后导出Chrome trace
+    // 读取发生在帧边界，这时WorkerPool的任务都已经结束，工作线程不会同时写
+    class CpuProfiler : public SingletonTemplate<CpuProfiler>
+    {
+    public:
+        enum
+        {
+            MAX_EVENTS_PER_THREAD = 16384,
+            MAX_CAPTURE_FRAMES    = 600,
+        };
+
+        struct ThreadBuffer
+        {
+            std::string                     Name;
+            uint32                          ThreadIndex = 0;
+            uint32                          Depth = 0;
+            std::vector<CpuProfileEvent>    Events;
+            std::atomic<uint64>             WriteIndex { 0 };
+
+            FORCE_INLINE void Push(const CpuProfileEvent& event)
+            {
+                const uint64 index = WriteIndex.load(std::memory_order_relaxed);
+                Events[index % MAX_EVENTS_PER_THREAD] = event;
+                WriteIndex.store(index + 1, std::memory_order_release);
+            }
+        };
+
+        // steady_clock，纳秒
+        static uint64 Now();
+
+        // 当前线程的缓冲，第一次调用时注册
+        static ThreadBuffer* GetThreadBuffer();
+
+        void SetThreadName(const char* name);
+
+        // 主线程的帧边界
+        void EndFrame();
+
+        // 从下一帧开始连续抓numFrames帧，结束后写到filename
+        void RequestCapture(uint32 numFrames, const std::string& filename);
+
+        FORCE_INLINE bool IsCapturing() const
+        {
+            return m_CaptureFramesLeft > 0 || m_CaptureRequested;
+        }
+
+        // 调用EndFrame的线程上一帧的所有Zone，按开始时间排序，时间相对帧开始
+        FORCE_INLINE const std::vector<CpuProfileEvent>& GetLastFrameEvents() const
+        {
+            return m_LastFrameEvents;
+        }
+
+        FORCE_INLINE uint64 GetLastFrameStartNs() const
+        {
+            return m_LastFrameStartNs;
+        }
+
+        FORCE_INLINE double GetLastFrameMs() const
+        {
+            return m_LastFrameMs;
+        }
+
+    private:
+        ThreadBuffer* RegisterThread();
+
+        // 从每个线程的缓冲里取出[beginNs, endNs)之间开始的记录
+        void CollectEvents(ThreadBuffer& buffer, uint64 beginNs, uint64 endNs, std::vector<CpuProfileEvent>& outEvents);
+
+        bool SaveChromeTrace(const std::string& filename, uint64 beginNs, uint64 endNs);
+
+    private:
+        std::mutex                                  m_Lock;
+        std::vector<std::unique_ptr<ThreadBuffer>>  m_Threads;
+
+        uint64                                      m_FrameStartNs = 0;
+        uint64                                      m_LastFrameStartNs = 0;
+        double                                      m_LastFrameMs = 0.0;
+        std::vector<CpuProfileEvent>                m_LastFrameEvents;
+
+        bool                                        m_CaptureRequested = false;
+        uint32                                      m_CaptureFrames = 0;
+        uint32                                      m_CaptureFramesLeft = 0;
+        uint64                                      m_CaptureStartNs = 0;
+        std::string                                 m_CapturePath;
+    };
+
+    class CpuProfileZone
+    {
+    public:
+        FORCE_INLINE explicit CpuProfileZone(const char* name)
+            : m_Buffer(CpuProfiler::GetThreadBuffer())
+        {
+            m_Event.Name    = name;
+            m_Event.Depth   = m_Buffer->Depth++;
+            m_Event.BeginNs = CpuProfiler::Now();
+        }
+
+        FORCE_INLINE ~CpuProfileZone()
+        {
+            m_Event.EndNs = CpuProfiler::Now();
+            m_Buffer->Depth -= 1;
+            m_Buffer->Push(m_Event);
+        }
+
+    private:
+        CpuProfiler::ThreadBuffer*  m_Buffer;
+        CpuProfileEvent             m_Event;
+    };
+}
+
+#define RE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define RE_PROFILE_CONCAT(a, b) RE_PROFILE_CONCAT_IMPL(a, b)
+
+#if RE_ENABLE_PROFILER
+    #define RE_PROFILE_SCOPE(name) ::ReEngine::CpuProfileZone RE_PROFILE_CONCAT(reProfileZone, __LINE__)(name)
+    #define RE_PROFILE_FUNCTION() RE_PROFILE_SCOPE(__FUNCTION__)
+    #define RE_PROFILE_THREAD(name) ::ReEngine::CpuProfiler::GetInstance().SetThreadName(name)
+    #define RE_PROFILE_FRAME() ::ReEngine::CpuProfiler::GetInstance().EndFrame()
+#else
+    #define RE_PROFILE_SCOPE(name)
+    #define RE_PROFILE_FUNCTION()
+    #define RE_PROFILE_THREAD(name)
+    #define RE_PROFILE_FRAME()
+#endif
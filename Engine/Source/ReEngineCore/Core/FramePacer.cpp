@@ -0,0 +1,105 @@
+﻿#include "FramePacer.h"
+
+#include <thread>
+
+namespace ReEngine
+{
+    void FramePacer::SetMaxFrameRate(float frameRate)
+    {
+        m_MaxFrameRate = frameRate > 0.0f ? frameRate : 0.0f;
+    }
+
+    void FramePacer::SetRefreshRate(float refreshRate)
+    {
+        m_RefreshRate = refreshRate > 0.0f ? refreshRate : 0.0f;
+    }
+
+    void FramePacer::SetJustInTime(bool enable)
+    {
+        m_JustInTime = enable;
+    }
+
+    void FramePacer::BeginFrame()
+    {
+        const Clock::time_point now = Clock::now();
+        const double period = GetFramePeriod();
+        if (period <= 0.0)
+        {
+            m_HasDeadline = false;
+            m_WaitMs      = 0.0f;
+            m_FrameStart  = now;
+            return;
+        }
+
+        const Clock::duration periodDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+
+        // 落后超过一帧时不追赶，从现在重新对齐
+        if (!m_HasDeadline || now > m_Deadline)
+        {
+            m_Deadline    = now + periodDuration;
+            m_HasDeadline = true;
+        }
+
+        Clock::time_point wakeTime = m_Deadline - periodDuration;
+        if (m_JustInTime)
+        {
+            const std::chrono::duration<double, std::milli> lead(m_PredictedWorkMs + SAFETY_MARGIN_US / 1000.0);
+            const Clock::time_point lateStart = m_Deadline - std::chrono::duration_cast<Clock::duration>(lead);
+            if (lateStart > wakeTime) {
+                wakeTime = lateStart;
+            }
+        }
+
+        WaitUntil(wakeTime);
+
+        m_FrameStart = Clock::now();
+        m_WaitMs     = std::chrono::duration<float, std::milli>(m_FrameStart - now).count();
+    }
+
+    void FramePacer::EndFrame()
+    {
+        const float workMs = std::chrono::duration<float, std::milli>(Clock::now() - m_FrameStart).count();
+
+        // 变慢时立刻跟上，变快时慢慢回落，宁可早一点开始也不要错过截止时间
+        if (workMs > m_PredictedWorkMs) {
+            m_PredictedWorkMs = workMs;
+        }
+        else {
+            m_PredictedWorkMs = m_PredictedWorkMs * 0.9f + workMs * 0.1f;
+        }
+
+        const double period = GetFramePeriod();
+        if (period <= 0.0 || !m_HasDeadline)
+        {
+            m_HasDeadline = false;
+            return;
+        }
+
+        m_Deadline += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+    }
+
+    double FramePacer::GetFramePeriod() const
+    {
+        if (m_MaxFrameRate > 0.0f) {
+            return 1.0 / m_MaxFrameRate;
+        }
+        if (m_JustInTime && m_RefreshRate > 0.0f) {
+            return 1.0 / m_RefreshRate;
+        }
+        return 0.0;
+    }
+
+    void FramePacer::WaitUntil(Clock::time_point time)
+    {
+        // Sleep经常多睡一两毫秒，只睡到阈值之前，剩下的自旋
+        const Clock::duration spinTime = std::chrono::microseconds(SPIN_THRESHOLD_US);
+        const Clock::time_point now = Clock::now();
+        if (time - now > spinTime) {
+            std::this_thread::sleep_for(time - now - spinTime);
+        }
+
+        while (Clock::now() < time) {
+            std::this_thread::yield();
+        }
+    }
+}
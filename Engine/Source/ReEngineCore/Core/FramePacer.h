@@ -0,0 +1,83 @@
+﻿#pragma once
+#include "Core/Core.h"
+
+#include <chrono>
+
+namespace ReEngine
+{
+    // 主循环的帧节奏：限帧时按目标帧间隔睡眠，最后一小段自旋，避免Sleep精度不够错过时间点
+    // JustInTime打开时，开始时间往后推到 截止时间 - 预测的CPU耗时 - 余量，输入尽量晚采样
+    // 没有限帧时JustInTime按显示器刷新率算截止时间，配合Fifo/Mailbox不让帧在队列里排队
+    class FramePacer
+    {
+    public:
+        enum
+        {
+            // 剩余时间小于它时不再Sleep，改为自旋
+            SPIN_THRESHOLD_US = 2000,
+            // JustInTime预留给预测误差的余量
+            SAFETY_MARGIN_US  = 1000,
+        };
+
+        // 0表示不限帧
+        void SetMaxFrameRate(float frameRate);
+
+        void SetRefreshRate(float refreshRate);
+
+        void SetJustInTime(bool enable);
+
+        // 采样输入之前调用，按需等到这一帧该开始的时间
+        void BeginFrame();
+
+        // Present提交之后调用，更新CPU耗时的预测
+        void EndFrame();
+
+        FORCE_INLINE float GetMaxFrameRate() const
+        {
+            return m_MaxFrameRate;
+        }
+
+        FORCE_INLINE float GetRefreshRate() const
+        {
+            return m_RefreshRate;
+        }
+
+        FORCE_INLINE bool IsJustInTime() const
+        {
+            return m_JustInTime;
+        }
+
+        // 上一帧在BeginFrame里等了多久
+        FORCE_INLINE float GetWaitMs() const
+        {
+            return m_WaitMs;
+        }
+
+        // BeginFrame返回到EndFrame的平滑耗时
+        FORCE_INLINE float GetPredictedWorkMs() const
+        {
+            return m_PredictedWorkMs;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        // 秒，0表示不需要等待
+        double GetFramePeriod() const;
+
+        static void WaitUntil(Clock::time_point time);
+
+    private:
+        float               m_MaxFrameRate = 0.0f;
+        float               m_RefreshRate = 60.0f;
+        bool                m_JustInTime = false;
+
+        // 这一帧应当提交完的时间，没有时下一帧重新对齐
+        Clock::time_point   m_Deadline;
+        bool                m_HasDeadline = false;
+        Clock::time_point   m_FrameStart;
+
+        float               m_WaitMs = 0.0f;
+        float               m_PredictedWorkMs = 0.0f;
+    };
+}
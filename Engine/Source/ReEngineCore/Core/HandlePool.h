@@ -0,0 +1,152 @@
+#pragma once
+#include "Core.h"
+
+#include <vector>
+
+// 32位的代际句柄，低位是槽位序号，高位是代数
+// 槽位释放后代数加一，旧句柄自然失效，不需要引用计数
+template<typename T>
+struct Handle
+{
+    static constexpr uint32 INDEX_BITS      = 20;
+    static constexpr uint32 INDEX_MASK      = (1u << INDEX_BITS) - 1;
+    static constexpr uint32 GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    // 代数从1开始，0保留给无效句柄
+    uint32 Value = 0;
+
+    FORCE_INLINE uint32 GetIndex() const
+    {
+        return Value & INDEX_MASK;
+    }
+
+    FORCE_INLINE uint32 GetGeneration() const
+    {
+        return Value >> INDEX_BITS;
+    }
+
+    FORCE_INLINE bool IsValid() const
+    {
+        return Value != 0;
+    }
+
+    FORCE_INLINE bool operator==(const Handle& other) const
+    {
+        return Value == other.Value;
+    }
+
+    FORCE_INLINE bool operator!=(const Handle& other) const
+    {
+        return Value != other.Value;
+    }
+
+    static FORCE_INLINE Handle Make(uint32 index, uint32 generation)
+    {
+        Handle handle;
+        handle.Value = (generation << INDEX_BITS) | (index & INDEX_MASK);
+        return handle;
+    }
+};
+
+// 句柄到紧凑数组下标的映射
+// 使用者按Dense下标维护自己的SoA数组，Release时用SwapRemove做同样的交换删除
+template<typename T>
+class HandlePool
+{
+public:
+    typedef Handle<T> HandleType;
+
+    static constexpr uint32 INVALID_INDEX = 0xFFFFFFFF;
+
+    HandleType Allocate()
+    {
+        uint32 slot = 0;
+        if (!m_FreeSlots.empty())
+        {
+            slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        else
+        {
+            slot = (uint32)m_Slots.size();
+            m_Slots.push_back(Slot());
+        }
+
+        Slot& entry = m_Slots[slot];
+        entry.DenseIndex = (uint32)m_DenseToSlot.size();
+        m_DenseToSlot.push_back(slot);
+
+        return HandleType::Make(slot, entry.Generation);
+    }
+
+    // 返回被删除的Dense下标，原来的最后一个元素已经搬到这个位置
+    uint32 Release(HandleType handle)
+    {
+        if (!IsValid(handle)) {
+            return INVALID_INDEX;
+        }
+
+        Slot& entry = m_Slots[handle.GetIndex()];
+        const uint32 denseIndex = entry.DenseIndex;
+        const uint32 lastSlot   = m_DenseToSlot.back();
+
+        m_DenseToSlot[denseIndex]        = lastSlot;
+        m_Slots[lastSlot].DenseIndex     = denseIndex;
+        m_DenseToSlot.pop_back();
+
+        entry.DenseIndex = INVALID_INDEX;
+        entry.Generation = (entry.Generation + 1) & HandleType::GENERATION_MASK;
+        if (entry.Generation == 0) {
+            entry.Generation = 1;
+        }
+        m_FreeSlots.push_back(handle.GetIndex());
+
+        return denseIndex;
+    }
+
+    FORCE_INLINE bool IsValid(HandleType handle) const
+    {
+        const uint32 slot = handle.GetIndex();
+        return handle.IsValid() && slot < m_Slots.size() && m_Slots[slot].Generation == handle.GetGeneration() && m_Slots[slot].DenseIndex != INVALID_INDEX;
+    }
+
+    // 不做代数检查，调用者需要保证句柄有效
+    FORCE_INLINE uint32 GetDenseIndex(HandleType handle) const
+    {
+        return m_Slots[handle.GetIndex()].DenseIndex;
+    }
+
+    FORCE_INLINE uint32 Size() const
+    {
+        return (uint32)m_DenseToSlot.size();
+    }
+
+    void Clear()
+    {
+        while (!m_DenseToSlot.empty())
+        {
+            const uint32 slot = m_DenseToSlot.back();
+            Release(HandleType::Make(slot, m_Slots[slot].Generation));
+        }
+    }
+
+    template<typename Type>
+    static FORCE_INLINE void SwapRemove(std::vector<Type>& dense, uint32 denseIndex)
+    {
+        if (denseIndex != dense.size() - 1) {
+            dense[denseIndex] = std::move(dense.back());
+        }
+        dense.pop_back();
+    }
+
+private:
+    struct Slot
+    {
+        uint32 Generation = 1;
+        uint32 DenseIndex = INVALID_INDEX;
+    };
+
+    std::vector<Slot>   m_Slots;
+    std::vector<uint32> m_DenseToSlot;
+    std::vector<uint32> m_FreeSlots;
+};
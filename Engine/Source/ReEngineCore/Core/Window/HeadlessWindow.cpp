@@ -0,0 +1,30 @@
+#include "HeadlessWindow.h"
+#include "Log/Log.h"
+
+namespace ReEngine
+{
+    HeadlessWindow::HeadlessWindow(const WindowProperty& Props)
+        : m_Width(Props.Width)
+        , m_Height(Props.Height)
+        , m_StartTime(std::chrono::steady_clock::now())
+    {
+        RE_CORE_WARN("Created headless window:{0}({1},{2})", Props.Title, Props.Width, Props.Height);
+
+        m_Context = GraphicsContext::Create(nullptr, &Props);
+        m_Context->Init();
+    }
+
+    HeadlessWindow::~HeadlessWindow()
+    {
+    }
+
+    void HeadlessWindow::ShutDown()
+    {
+        m_Context->Close();
+    }
+
+    float HeadlessWindow::GetTime()
+    {
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - m_StartTime).count();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Core/Window/Window.h"
+
+#include <chrono>
+
+namespace ReEngine
+{
+    // 离屏模式的窗口：不创建GLFW窗口和Surface，只持有GraphicsContext，画到离屏交换链
+    // 没有输入和窗口事件，用于CI和服务器上跑基准测试
+    class HeadlessWindow : public ReEngine::Window
+    {
+    public:
+        HeadlessWindow(const WindowProperty& Props);
+        virtual ~HeadlessWindow() override;
+
+        virtual void Update(Timestep ts) override {}
+        virtual bool IsVSync() const override { return false; }
+        virtual void SetVSync(bool enabled) override {}
+        virtual unsigned GetWindowHeight() const override { return m_Height; }
+        virtual unsigned GetWindowWidth() const override { return m_Width; }
+        virtual void SetEventCallback(const EventCallBackFunc CallBack) override { m_EventCallBack = CallBack; }
+        virtual void PollEvent() override {}
+        virtual void ShutDown() override;
+        inline virtual void* GetNativeWindow() override { return nullptr; }
+        [[nodiscard]]virtual Ref<GraphicsContext> GetGraphicsContext() const override { return m_Context; }
+        [[nodiscard]]virtual float GetTime() override;
+
+    private:
+        Ref<GraphicsContext> m_Context;
+        EventCallBackFunc m_EventCallBack;
+        unsigned int m_Width;
+        unsigned int m_Height;
+        std::chrono::steady_clock::time_point m_StartTime;
+    };
+}
@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 #include "Core/Core.h"
 #include "Core/PCH.h"
 #include "Event/Event.h"
@@ -8,11 +8,28 @@ namespace ReEngine
 {
     using EventCallBackFunc = std::function<void(std::shared_ptr<Event>)>;
 
+    // 交换链的显示模式，设备不支持时Immediate退回Mailbox，Mailbox退回Fifo
+    enum class PresentMode : uint8
+    {
+        Fifo = 0,       // 垂直同步，排队等显示
+        Mailbox,        // 垂直同步，新帧替换还没显示的帧，不撕裂且延迟低
+        Immediate,      // 不等垂直同步，会撕裂
+    };
+
     struct WindowProperty
     {
         std::string  Title;
         int32 Width;
         int32 Height;
+        // 同时在GPU上的帧数，2或3
+        int32 FramesInFlight = 2;
+        PresentMode PresentType = PresentMode::Mailbox;
+        // 帧率上限，0表示不限
+        float MaxFrameRate = 0.0f;
+        // 帧开始尽量推迟到截止时间之前，输入晚一点采样
+        bool JustInTime = false;
+        // 不创建窗口和Surface，画到离屏图像
+        bool Headless = false;
 
         WindowProperty(std::string InTitle = "ReEngine", int32 InWidth = 1280, int32 InHeight = 720):Title(InTitle),Width(InWidth),Height(InHeight){}
     };
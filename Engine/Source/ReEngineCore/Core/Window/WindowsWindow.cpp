@@ -1,5 +1,6 @@
 #include "Core/Window/WindowsWindow.h"
 #include "Core/Window/GLFWWindow.h"
+#include "Core/Window/HeadlessWindow.h"
 #include "Event/ApplicationEvent.h"
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
@@ -143,6 +144,9 @@ namespace ReEngine
 
     Scope<Window> Window::CreateReWindow(const WindowProperty& Property)
     {
+        if (Property.Headless) {
+            return std::make_unique<HeadlessWindow>(Property);
+        }
         return std::make_unique<GLWindow>(Property); // GLFW
         // return new WindowsWindow(Property); // Win
     }
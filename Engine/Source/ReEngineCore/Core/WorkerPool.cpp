@@ -0,0 +1,141 @@
+﻿#include "WorkerPool.h"
+#include "Core/CpuProfiler.h"
+
+namespace ReEngine
+{
+    // 当前线程正在执行某一组的任务
+    static thread_local bool G_InsideParallelFor = false;
+
+    WorkerPool::~WorkerPool()
+    {
+        Shutdown();
+    }
+
+    void WorkerPool::Init(uint32 numWorkers)
+    {
+        if (m_Workers.size() > 0) {
+            return;
+        }
+
+        if (numWorkers == 0)
+        {
+            const uint32 hardwareThreads = std::thread::hardware_concurrency();
+            numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+        numWorkers = numWorkers > MAX_WORKERS ? MAX_WORKERS : numWorkers;
+
+        m_Exit = false;
+        for (uint32 index = 0; index < numWorkers; ++index) {
+            m_Workers.emplace_back(&WorkerPool::WorkerMain, this);
+        }
+    }
+
+    void WorkerPool::Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Exit = true;
+        }
+        m_WakeCondition.notify_all();
+
+        for (int32 index = 0; index < m_Workers.size(); ++index) {
+            m_Workers[index].join();
+        }
+        m_Workers.clear();
+    }
+
+    void WorkerPool::ParallelFor(uint32 numTasks, const TaskFunction& function)
+    {
+        if (numTasks == 0) {
+            return;
+        }
+
+        // 没有工作线程、只有一个任务、嵌套调用或者工作线程被别的调用方占用，直接在调用线程上跑
+        // 嵌套时外层还在等这一组完成，等工作线程会死锁
+        std::unique_lock<std::mutex> runLock(m_RunLock, std::defer_lock);
+        if (m_Workers.empty() || numTasks == 1 || G_InsideParallelFor || !runLock.try_lock())
+        {
+            const bool wasInside = G_InsideParallelFor;
+            G_InsideParallelFor = true;
+            for (uint32 index = 0; index < numTasks; ++index) {
+                function(index);
+            }
+            G_InsideParallelFor = wasInside;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Function   = &function;
+            m_NumTasks   = numTasks;
+            m_NextTask.store(0);
+            m_NumFinished.store(0);
+            m_Generation += 1;
+        }
+        m_WakeCondition.notify_all();
+
+        ExecuteTasks(function, numTasks);
+
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_DoneCondition.wait(lock, [this, numTasks]() { return m_NumFinished.load() == numTasks && m_NumActive == 0; });
+        m_Function = nullptr;
+        m_NumTasks = 0;
+    }
+
+    void WorkerPool::WorkerMain()
+    {
+        RE_PROFILE_THREAD("Worker");
+
+        uint64 generation = 0;
+
+        while (true)
+        {
+            const TaskFunction* function = nullptr;
+            uint32 numTasks = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_Lock);
+                m_WakeCondition.wait(lock, [this, generation]() { return m_Exit || (m_Generation != generation && m_Function != nullptr); });
+                if (m_Exit) {
+                    return;
+                }
+
+                generation = m_Generation;
+                function   = m_Function;
+                numTasks   = m_NumTasks;
+                m_NumActive += 1;
+            }
+
+            ExecuteTasks(*function, numTasks);
+
+            {
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_NumActive -= 1;
+            }
+            m_DoneCondition.notify_all();
+        }
+    }
+
+    void WorkerPool::ExecuteTasks(const TaskFunction& function, uint32 numTasks)
+    {
+        RE_PROFILE_SCOPE("ParallelFor");
+
+        G_InsideParallelFor = true;
+        while (true)
+        {
+            const uint32 taskIndex = m_NextTask.fetch_add(1);
+            if (taskIndex >= numTasks)
+            {
+                G_InsideParallelFor = false;
+                return;
+            }
+
+            function(taskIndex);
+
+            if (m_NumFinished.fetch_add(1) + 1 == numTasks)
+            {
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_DoneCondition.notify_all();
+            }
+        }
+    }
+}
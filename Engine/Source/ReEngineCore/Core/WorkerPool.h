@@ -0,0 +1,68 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Core/SIngletonTemplate.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ReEngine
+{
+    // 常驻的工作线程，ParallelFor把任务编号分给工作线程和调用线程一起执行，返回时这一组全部完成
+    // 同一时间只跑一组任务；任务里嵌套调用ParallelFor，或者另一个线程正在跑一组时，直接在调用线程上顺序执行
+    class WorkerPool : public SingletonTemplate<WorkerPool>
+    {
+    public:
+        typedef std::function<void(uint32 taskIndex)> TaskFunction;
+
+        enum
+        {
+            MAX_WORKERS = 31,
+        };
+
+        virtual ~WorkerPool() override;
+
+        // numWorkers为0时按硬件线程数减去调用线程
+        void Init(uint32 numWorkers = 0);
+
+        void Shutdown();
+
+        // 工作线程数加上调用线程
+        FORCE_INLINE uint32 GetNumThreads() const
+        {
+            return (uint32)m_Workers.size() + 1;
+        }
+
+        // 每个任务编号只执行一次，执行顺序不确定
+        void ParallelFor(uint32 numTasks, const TaskFunction& function);
+
+    private:
+        void WorkerMain();
+
+        // 领取并执行当前这一组剩下的任务
+        void ExecuteTasks(const TaskFunction& function, uint32 numTasks);
+
+    private:
+        std::vector<std::thread>    m_Workers;
+
+        // 占用工作线程的调用方，拿不到的调用方自己执行
+        std::mutex                  m_RunLock;
+
+        std::mutex                  m_Lock;
+        std::condition_variable     m_WakeCondition;
+        std::condition_variable     m_DoneCondition;
+
+        const TaskFunction*         m_Function = nullptr;
+        uint32                      m_NumTasks = 0;
+        uint64                      m_Generation = 0;
+        // 还在领取任务的工作线程，归零之前不能开始下一组
+        uint32                      m_NumActive = 0;
+        bool                        m_Exit = false;
+
+        std::atomic<uint32>         m_NextTask { 0 };
+        std::atomic<uint32>         m_NumFinished { 0 };
+    };
+}
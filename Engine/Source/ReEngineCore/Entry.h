@@ -9,6 +9,8 @@ int main(int argc,char** argv)
 {
     ReEngine::Log::Init();
 
+    ReEngine::Application::GetInstance().ParseCommandLine(argc, argv);
+
     ReEngine::AppInit(ReEngine::Application::GetInstance());
 
     ReEngine::Application::GetInstance().Run();
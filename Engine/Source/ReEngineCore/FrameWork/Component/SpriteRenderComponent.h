@@ -2,6 +2,9 @@
 
 #include "Component.h"
 #include "glm/vec4.hpp"
+#include "Renderer/RHI/SubTexture2D.h"
+
+#include <string>
 
 namespace ReEngine
 {
@@ -14,5 +17,8 @@ namespace ReEngine
         
     public:
         glm::vec4 Color{1.0f,1.0f,1.0f,1.0f};
+        // 为空时只画颜色，否则由Scene打包进精灵图集，Texture在第一次绘制时解析
+        std::string TexturePath;
+        Ref<SubTexture2D> Texture;
     };
 }
\ No newline at end of file
@@ -76,7 +76,16 @@ namespace ReEngine
             for(auto Entity:SpriteRenderGroup)
             {
                 auto [transformComponent,spriteRenderComponent] = SpriteRenderGroup.get<TransformComponent,SpriteRenderComponent>(Entity);
-                Renderer2D::DrawQuad(transformComponent.GetTransform(),spriteRenderComponent.Color);
+                if (!spriteRenderComponent.TexturePath.empty() && !spriteRenderComponent.Texture) {
+                    spriteRenderComponent.Texture = GetSprite(spriteRenderComponent.TexturePath);
+                }
+
+                if (spriteRenderComponent.Texture) {
+                    Renderer2D::DrawQuad(transformComponent.GetTransform(),spriteRenderComponent.Texture,spriteRenderComponent.Color);
+                }
+                else {
+                    Renderer2D::DrawQuad(transformComponent.GetTransform(),spriteRenderComponent.Color);
+                }
             }
             
             Renderer2D::EndScene();
@@ -88,6 +97,33 @@ namespace ReEngine
         return entity;
     }
 
+    Ref<SubTexture2D> Scene::GetSprite(const std::string& path)
+    {
+        auto it = mSprites.find(path);
+        if (it != mSprites.end()) {
+            return it->second;
+        }
+
+        if (mMissingSprites.count(path) > 0) {
+            return nullptr;
+        }
+
+        if (!mSpriteAtlas) {
+            mSpriteAtlas = CreateScope<TextureAtlas2D>();
+        }
+
+        // 失败的只记路径，缓存里只放有效的精灵
+        Ref<SubTexture2D> sprite = mSpriteAtlas->Add(path);
+        if (!sprite)
+        {
+            mMissingSprites.insert(path);
+            return nullptr;
+        }
+
+        mSprites[path] = sprite;
+        return sprite;
+    }
+
     void Scene::OnUpdateRuntime(Timestep ts)
     {
     }
@@ -3,8 +3,11 @@
 #include "Camera/OrthographicCamera.h"
 #include "Core/PCH.h"
 #include "Core/Core.h"
+#include "Renderer/RHI/TextureAtlas2D.h"
 
 #include "ThirdParty/entt/include/entt.hpp"
+
+#include <unordered_set>
 namespace ReEngine
 {
     class Entity;
@@ -33,6 +36,9 @@ namespace ReEngine
 
         Entity GetPrimaryEntity(Entity entity);
 
+        // 精灵贴图打包进场景共享的图集，同一路径只加载一次；失败返回nullptr，调用方退回纯色
+        Ref<SubTexture2D> GetSprite(const std::string& path);
+
         template<typename... Components>
         auto GetAllEntitiesWith()
         {
@@ -48,6 +54,12 @@ namespace ReEngine
         template<typename T>
         void OnComponentAdded(ReEngine::Entity entity,T& component){};
 
+        // 所有精灵共用几张图集页，Renderer2D一批里只占几个贴图槽位
+        Scope<TextureAtlas2D> mSpriteAtlas;
+        std::unordered_map<std::string, Ref<SubTexture2D>> mSprites;
+        // 加载或打包失败的路径，不再每帧重试
+        std::unordered_set<std::string> mMissingSprites;
+
     private:
         friend class Entity;
         friend class SceneSerializer;
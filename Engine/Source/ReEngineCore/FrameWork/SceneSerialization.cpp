@@ -145,6 +145,8 @@ namespace ReEngine
 
 			auto& spriteRendererComponent = entity.GetComponent<SpriteRenderComponent>();
 			out << YAML::Key << "Color" << YAML::Value << spriteRendererComponent.Color;
+			if (!spriteRendererComponent.TexturePath.empty())
+				out << YAML::Key << "TexturePath" << YAML::Value << spriteRendererComponent.TexturePath;
 			out << YAML::EndMap; // SpriteRendererComponent
 		}
 
@@ -242,6 +244,8 @@ namespace ReEngine
 				{
 					auto& src = deserializedEntity.AddComponent<SpriteRenderComponent>();
 					src.Color = spriteRendererComponent["Color"].as<glm::vec4>();
+					if (spriteRendererComponent["TexturePath"])
+						src.TexturePath = spriteRendererComponent["TexturePath"].as<std::string>();
 				}
 			}
 		}
@@ -10,6 +10,10 @@ namespace ReEngine
     bool ReEngine::WindowsInput::IsKeyPressedImpl(int keycode)
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        //离屏模式没有窗口，当作没有输入
+        if (!window) {
+            return false;
+        }
         auto state = glfwGetKey(window, keycode);
         return state == GLFW_PRESS || state == GLFW_REPEAT;
     }
@@ -17,6 +21,9 @@ namespace ReEngine
     bool ReEngine::WindowsInput::IsMouseButtonPressedImpl(int button)
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        if (!window) {
+            return false;
+        }
         auto state = glfwGetMouseButton(window, button);
         return state == GLFW_PRESS;
     }
@@ -24,6 +31,9 @@ namespace ReEngine
     bool WindowsInput::IsMouseButtonReleaseImpl(int button)
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        if (!window) {
+            return true;
+        }
         auto state = glfwGetMouseButton(window, button);
         return state == GLFW_RELEASE;
     }
@@ -31,6 +41,9 @@ namespace ReEngine
     glm::vec2 ReEngine::WindowsInput::GetMousePosImpl()
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        if (!window) {
+            return glm::vec2(0.0f);
+        }
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
         return glm::vec2(xpos, ypos);
@@ -39,6 +52,9 @@ namespace ReEngine
     float ReEngine::WindowsInput::GetMouseXImpl()
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        if (!window) {
+            return 0.0f;
+        }
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
         return (float)xpos;
@@ -47,6 +63,9 @@ namespace ReEngine
     float ReEngine::WindowsInput::GetMouseYImpl()
     {
         auto window = static_cast<GLFWwindow*>(Application::GetInstance().GetWindow().GetNativeWindow());
+        if (!window) {
+            return 0.0f;
+        }
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
         return (float)ypos;
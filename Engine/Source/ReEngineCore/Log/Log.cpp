@@ -16,7 +16,7 @@ namespace ReEngine
         );
 
         CoreLogger = spdlog::stdout_color_mt("ReEngine");
-        CoreLogger->set_level(spdlog::level::err);
+        CoreLogger->set_level(spdlog::level::info);
 
         ClientLogger = spdlog::stdout_color_mt("App");
         ClientLogger->set_level(spdlog::level::trace);
@@ -47,9 +47,9 @@ namespace ReEngine
 //Log Macros
 
 #define RE_CORE_TRACE(...) ::ReEngine::Log::GetCoreLogger()->trace(__VA_ARGS__)
-#define RE_CORE_ERROR(...) ::ReEngine::Log::GetCoreLogger()->info(__VA_ARGS__)
+#define RE_CORE_ERROR(...) ::ReEngine::Log::GetCoreLogger()->error(__VA_ARGS__)
 #define RE_CORE_WARN(...) ::ReEngine::Log::GetCoreLogger()->warn(__VA_ARGS__)
-#define RE_CORE_INFO(...) ::ReEngine::Log::GetCoreLogger()->error(__VA_ARGS__)
+#define RE_CORE_INFO(...) ::ReEngine::Log::GetCoreLogger()->info(__VA_ARGS__)
 #define RE_CORE_FATAL(...) ::ReEngine::Log::GetCoreLogger()->fatal(__VA_ARGS__)
 
 #define RE_TRACE(...) ::ReEngine::Log::GetClientLogger()->trace(__VA_ARGS__)
@@ -90,6 +90,14 @@ namespace ReEngine
         glTextureSubImage2D(mRendererID, 0, 0, 0, mWidth, mHeight, mDataFormat, GL_UNSIGNED_BYTE, data);
     }
 
+    void OpenGLTexture2D::SetSubData(void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+    {
+        RE_CORE_ASSERT(x + width <= mWidth && y + height <= mHeight, "Sub region out of texture!");
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTextureSubImage2D(mRendererID, 0, x, y, width, height, mDataFormat, GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
     void OpenGLTexture2D::Bind(uint32_t slot) const
     {
         glActiveTexture(GL_TEXTURE0 + slot);
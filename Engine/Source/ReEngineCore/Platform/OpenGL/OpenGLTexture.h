@@ -17,6 +17,7 @@ namespace ReEngine
         virtual uint32_t GetRendererID() const override { return mRendererID; }
 
         virtual void SetData(void* data, uint32_t size) override;
+        virtual void SetSubData(void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
 
         virtual void Bind(uint32_t slot = 0) const override;
         virtual void UnBind() const override;
@@ -7,6 +7,7 @@
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtx/quaternion.hpp"
+#include "Core/CpuProfiler.h"
 #include "Math/Math.h"
 #include "Resource/AssetManager/AssetManager.h"
 
@@ -167,12 +168,15 @@ void VulkanModel::LoadSkin(std::unordered_map<uint32, VertexSkin>& skinInfoMap,
     }
 }
 
-Ref<VulkanModel> VulkanModel::LoadFromFile(const std::string& filename, Ref<VulkanDevice> vulkanDevice,Ref<VulkanCommandBuffer> cmdBuffer, const std::vector<VertexAttribute>& attributes)
+Ref<VulkanModel> VulkanModel::LoadFromFile(const std::string& filename, Ref<VulkanDevice> vulkanDevice,Ref<VulkanCommandBuffer> cmdBuffer, const std::vector<VertexAttribute>& attributes, VulkanUploadPriority priority)
 {
+    RE_PROFILE_FUNCTION();
+
     Ref<VulkanModel> model   = CreateRef<VulkanModel>();
     model->Device     = vulkanDevice;
     model->Attributes = attributes;
     model->CmdBuffer  = cmdBuffer;
+    model->UploadPriority = priority;
         
     int assimpFlags = aiProcess_Triangulate | aiProcess_FlipUVs;
         
@@ -206,18 +210,33 @@ Ref<VulkanModel> VulkanModel::LoadFromFile(const std::string& filename, Ref<Vulk
 
     uint32 dataSize = 0;
     uint8* dataPtr  = nullptr;
-    if (!AssetManager::ReadFile(filename, dataPtr, dataSize))
     {
-        RE_CORE_ERROR("Can't Load File");
-        return model;
+        RE_PROFILE_SCOPE("ReadFile");
+        if (!AssetManager::ReadFile(filename, dataPtr, dataSize))
+        {
+            RE_CORE_ERROR("Can't Load File");
+            return model;
+        }
     }
 
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFileFromMemory(dataPtr, dataSize, assimpFlags);
+    const aiScene* scene = nullptr;
+    {
+        RE_PROFILE_SCOPE("Assimp Import");
+        scene = importer.ReadFileFromMemory(dataPtr, dataSize, assimpFlags);
+    }
+
+    {
+        RE_PROFILE_SCOPE("Build Model");
+        model->LoadBones(scene);
+        model->LoadNode(scene->mRootNode, scene);
+        model->LoadAnimations(scene);
+    }
 
-    model->LoadBones(scene);
-    model->LoadNode(scene->mRootNode, scene);
-    model->LoadAnimations(scene);
+    if (cmdBuffer)
+    {
+        model->UploadTicket = vulkanDevice->GetStagingManager().Flush();
+    }
     
     delete[] dataPtr;
 
@@ -252,12 +271,15 @@ Ref<VulkanModel> VulkanModel::Create(std::shared_ptr<VulkanDevice> vulkanDevice,
         {
             primitive->IndexBuffer = VulkanIndexBuffer::Create(vulkanDevice, cmdBuffer, primitive->indices);
         }
+        model->UploadTicket = vulkanDevice->GetStagingManager().Flush();
     }
 
     Ref<VulkanMesh> mesh = CreateRef<VulkanMesh>();
     mesh->m_Primitives.push_back(primitive);
     mesh->m_BoundingBox.Min = glm::vec3(-1.0f, -1.0f, 0.0f);
     mesh->m_BoundingBox.Max = glm::vec3(1.0f, 1.0f, 0.0f);
+    // 没有cmdBuffer时没有GPU Buffer，也要注册，BindDraw会跳过这些Primitive
+    mesh->Register();
     
     Ref<VulkanMeshNode> rootNode = CreateRef<VulkanMeshNode>();
     rootNode->name = "RootNode";
@@ -394,6 +416,9 @@ Ref<VulkanMesh> VulkanModel::LoadMesh(const aiMesh* Inmesh, const aiScene* Insce
     Mesh->m_BoundingBox.Min = mmin;
     Mesh->m_BoundingBox.Max = mmax;
     Mesh->m_BoundingBox.UpdateCorners();
+
+    // 没有GPU Buffer也注册，BindDraw会跳过这些Primitive
+    Mesh->Register();
     
     return Mesh;
 }
@@ -840,8 +865,9 @@ void VulkanModel::LoadPrimitives(std::vector<float>& vertices, std::vector<uint3
             for (int32 i = 0; i < mesh->m_Primitives.size(); ++i)
             {
                 primitive = mesh->m_Primitives[i];
-                primitive->VertexBuffer = VulkanVertexBuffer::Create(Device, CmdBuffer, primitive->vertices, Attributes);
-                primitive->IndexBuffer  = VulkanIndexBuffer::Create(Device, CmdBuffer, primitive->indices);
+                primitive->VertexBuffer = VulkanVertexBuffer::Create(Device, CmdBuffer, primitive->vertices, Attributes, UploadPriority);
+                primitive->IndexBuffer  = VulkanIndexBuffer::Create(Device, CmdBuffer, primitive->indices, VK_INDEX_TYPE_UINT16, UploadPriority);
+                UploadRequest = primitive->IndexBuffer->Buffer->UploadRequest;
             }
         }
     }
@@ -857,8 +883,9 @@ void VulkanModel::LoadPrimitives(std::vector<float>& vertices, std::vector<uint3
 
         if (CmdBuffer)
         {
-            primitive->VertexBuffer = VulkanVertexBuffer::Create(Device, CmdBuffer, primitive->vertices, Attributes);
-            primitive->IndexBuffer  = VulkanIndexBuffer::Create(Device, CmdBuffer, primitive->indices);
+            primitive->VertexBuffer = VulkanVertexBuffer::Create(Device, CmdBuffer, primitive->vertices, Attributes, UploadPriority);
+            primitive->IndexBuffer  = VulkanIndexBuffer::Create(Device, CmdBuffer, primitive->indices, VK_INDEX_TYPE_UINT16, UploadPriority);
+            UploadRequest = primitive->IndexBuffer->Buffer->UploadRequest;
         }
     }
 
@@ -50,17 +50,42 @@ public:
 
     VulkanMaterialInfo Material;
 
+    MeshHandle PoolHandle;
+
     VulkanMesh():LinkNode(),VertexCount(0),TriangleCount(0){}
     
-    void BindDraw(VkCommandBuffer cmdBuffer)
+    // 加载完、Primitive的Buffer建好之后调用，连同Primitive一起注册到句柄池；已经注册过时按当前的Primitive更新
+    // 工作线程录制时只读句柄池，注册不能拖到第一次绘制
+    void Register()
     {
-        for(auto& Primitive : m_Primitives)
+        if(!PoolHandle.IsValid())
         {
-            Primitive->BindDraw(cmdBuffer);
+            PoolHandle = VulkanResourcePool::GetInstance().RegisterMesh(this);
         }
+        else
+        {
+            VulkanResourcePool::GetInstance().UpdateMesh(PoolHandle, this);
+        }
+    }
+
+    MeshHandle GetHandle() const
+    {
+        return PoolHandle;
+    }
+
+    // 走句柄池里的紧凑数组，不再逐个访问Ref<VulkanPrimitive>
+    void BindDraw(VkCommandBuffer cmdBuffer)
+    {
+        VulkanResourcePool::GetInstance().BindDraw(cmdBuffer, PoolHandle);
     }
 
-    ~VulkanMesh(){}
+    ~VulkanMesh()
+    {
+        if(PoolHandle.IsValid())
+        {
+            VulkanResourcePool::GetInstance().ReleaseMesh(PoolHandle);
+        }
+    }
 };
 
 //会保存节点的基本信息
@@ -174,7 +199,14 @@ public:
     VkVertexInputBindingDescription GetInputBinding();
     std::vector<VkVertexInputAttributeDescription> GetInputAttributes();
 
-    static Ref<VulkanModel> LoadFromFile(const std::string& filename, Ref<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, const std::vector<VertexAttribute>& attributes);
+    // 顶点和索引的上传都已经提交，可以录制绘制
+    bool IsResident() const
+    {
+        return UploadPriority == VulkanUploadPriority::Immediate || Device->GetUploadScheduler().IsSubmitted(UploadRequest);
+    }
+
+    // priority不是Immediate时顶点和索引进传输队列排队，IsResident之前不能绘制
+    static Ref<VulkanModel> LoadFromFile(const std::string& filename, Ref<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, const std::vector<VertexAttribute>& attributes, VulkanUploadPriority priority = VulkanUploadPriority::Immediate);
     static Ref<VulkanModel> Create(std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, const std::vector<float>& vertices, const std::vector<uint16>& indices, const std::vector<VertexAttribute>& attributes);
         
     Ref<VulkanMeshNode> LoadNode(const aiNode* node, const aiScene* scene);
@@ -190,6 +222,13 @@ public:
     std::vector<VertexAttribute> Attributes;
     Ref<VulkanCommandBuffer>	CmdBuffer;
 
+    // 所有Primitive的顶点和索引在同一批上传里，可以轮询这个凭证
+    VulkanUploadTicket          UploadTicket = 0;
+
+    // 同一优先级按入队顺序提交，最后一个请求提交了，前面的也都提交了
+    VulkanUploadPriority        UploadPriority = VulkanUploadPriority::Immediate;
+    VulkanUploadRequest         UploadRequest = 0;
+
     std::vector<Ref<VulkanTexture>> AnimationTexture;
 
 public:
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Platform/Vulkan/VulkanBuffers/VulkanIndexBuffer.h"
 #include "Platform/Vulkan/VulkanBuffers/VulkanVertexBuffer.h"
+#include "Platform/Vulkan/VulkanResourcePool.h"
 
 class VulkanPrimitive
 {
@@ -15,6 +16,8 @@ public:
     int32   vertexCount = 0;
     int32   triangleNum = 0;
 
+    PrimitiveHandle PoolHandle;
+
     VulkanPrimitive()
     {
         
@@ -22,10 +25,25 @@ public:
 
     ~VulkanPrimitive()
     {
+        if(PoolHandle.IsValid())
+        {
+            VulkanResourcePool::GetInstance().ReleasePrimitive(PoolHandle);
+        }
+        
         IndexBuffer = nullptr;
         VertexBuffer = nullptr;
     }
 
+    // 录制命令时用句柄代替Ref<>，第一次调用时注册到句柄池
+    PrimitiveHandle GetHandle()
+    {
+        if(!PoolHandle.IsValid())
+        {
+            PoolHandle = VulkanResourcePool::GetInstance().RegisterPrimitive(this);
+        }
+        return PoolHandle;
+    }
+
     void BindDraw(VkCommandBuffer CmdBuffer)
     {
         VertexBuffer->Bind(CmdBuffer);
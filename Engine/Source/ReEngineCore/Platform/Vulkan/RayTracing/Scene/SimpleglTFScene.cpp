@@ -9,6 +9,32 @@
 #include "glm/gtx/quaternion.hpp"
 #include "Math/Math.h"
 #include "Resource/AssetManager/AssetManager.h"
+#include "Renderer/RHI/Renderer.h"
+#include "Platform/Vulkan/VulkanContext.h"
+#include "ImageLoader.h"
+
+namespace
+{
+    // 解析时只保留编码数据，LoadTextures里统一并行解码
+    bool KeepEncodedImage(tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn, int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+    {
+        int32 comp = 0;
+        if (!StbImage::InfoFromMemory(bytes, size, &image->width, &image->height, &comp))
+        {
+            if (err) {
+                (*err) += "Unknown image format for image[" + std::to_string(imageIndex) + "].\n";
+            }
+            return false;
+        }
+
+        image->component = 4;
+        image->bits      = 8;
+        image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        image->as_is     = true;
+        image->image.assign(bytes, bytes + size);
+        return true;
+    }
+}
 
     void glTFScene::LoadglTFModel(Ref<VulkanDevice> device,Ref<VulkanCommandPool> commandPool, std::string FilePath, bool bIsBinary)
 {
@@ -17,6 +43,7 @@
     
     tinygltf::Model gltfModel;
     tinygltf::TinyGLTF gltfContext;
+    gltfContext.SetImageLoader(KeepEncodedImage, nullptr);
     std::string error;
     std::string warning;
 
@@ -43,15 +70,19 @@
 
 void glTFScene::LoadTextures(Ref<VulkanCommandBuffer> cmdBuffer, tinygltf::Model& gltfModel)
 {
+    std::vector<VulkanTextureLoadDesc> textureDescs(gltfModel.textures.size());
     for (int32 i = 0; i < gltfModel.textures.size(); ++i)
     {
         tinygltf::Texture& tex = gltfModel.textures[i];
         tinygltf::Image& image = gltfModel.images[tex.source];
-        Ref<VulkanTexture> texture = VulkanTexture::Create2D(image.image.data(), image.width * image.height * 4, VK_FORMAT_R8G8B8A8_UNORM, image.width, image.height, Device, cmdBuffer);
-
-
-        Textures.push_back(texture);
+        textureDescs[i].Filename    = image.uri.empty() ? image.name : image.uri;
+        textureDescs[i].EncodedData = image.image.data();
+        textureDescs[i].EncodedSize = (uint32)image.image.size();
     }
+
+    auto VkContext = dynamic_cast<ReEngine::VulkanContext*>(Renderer::GetContext().get());
+    std::vector<Ref<VulkanTexture>> textures = VkContext->GetTextureLoader().LoadBatch(textureDescs);
+    Textures.insert(Textures.end(), textures.begin(), textures.end());
 }
 
 void glTFScene::LoadMaterials(Ref<VulkanCommandBuffer> cmdBuffer, tinygltf::Model& gltfModel)
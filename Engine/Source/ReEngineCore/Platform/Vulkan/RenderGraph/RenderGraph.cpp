@@ -2,6 +2,7 @@
 #include "RenderGraph.h"
 
 #include "Platform/Vulkan/VulkanContext.h"
+#include "Core/CpuProfiler.h"
 #include "Resource/AssetManager/AssetManager.h"
 
 namespace ReEngine
@@ -303,7 +304,7 @@ namespace ReEngine
         return NodeCache.Nodes[NodeHandle->second];
     }
 
-    Ref<FrameGraphNode> FrameGraphBuilder::AccessNode(FrameGraphNodeHandle Handle)
+    const Ref<FrameGraphNode>& FrameGraphBuilder::AccessNode(FrameGraphNodeHandle Handle)
     {
         return  NodeCache.Nodes[Handle.Index];
     }
@@ -315,7 +316,7 @@ namespace ReEngine
         return ResourceCache.Resources[NodeHandle->second];
     }
 
-    Ref<FrameGraphResource> FrameGraphBuilder::AccessResource(FrameGraphResourceHandle handle)
+    const Ref<FrameGraphResource>& FrameGraphBuilder::AccessResource(FrameGraphResourceHandle handle)
     {
         return  ResourceCache.Resources[handle.Index];
     }
@@ -359,6 +360,8 @@ namespace ReEngine
 
     void FrameGraph::Parse(const char* FilePath)
     {
+        RE_PROFILE_FUNCTION();
+
         using json = nlohmann::json;
         using string = std::string;
 
@@ -452,6 +455,8 @@ namespace ReEngine
 
     void FrameGraph::Compile()
     {
+        RE_PROFILE_FUNCTION();
+
         // 检查input是不是被其他的node创造了
         // 将不可达的node剔除掉
 
@@ -678,23 +683,26 @@ namespace ReEngine
     {
     }
 
-    void FrameGraph::Render(Ref<VulkanCommandBuffer> CmdBuffer, Ref<VulkanModel> RenderModel)
+    void FrameGraph::Render(const Ref<VulkanCommandBuffer>& CmdBuffer, const Ref<VulkanModel>& RenderModel)
     {
         for(uint32 n = 0 ; n < Nodes.size() ; n++)
         {
-            Ref<FrameGraphNode> Node = builder->AccessNode(Nodes[n]);
+            const Ref<FrameGraphNode>& Node = builder->AccessNode(Nodes[n]);
             if(!Node->Enabled)
             {
                 continue;
             }
 
+            // 从Barrier到EndRenderPass都算在这个节点上
+            VulkanGpuScope GpuScope(builder->mContext->GetGpuProfiler(), CmdBuffer->CmdBuffer, Node->Name);
+
             for(uint32 i = 0 ; i < Node->Inputs.size() ; i++)
             {
-                Ref<FrameGraphResource> Resource = builder->AccessResource(Node->Inputs[i]);
+                const Ref<FrameGraphResource>& Resource = builder->AccessResource(Node->Inputs[i]);
 
                 if(Resource->ResourceType == FrameGraphResourceType::FrameGraphResourceType_Texture)
                 {
-                    Ref<VulkanTexture> Texture = Resource->ResourceInfo.Texture.Texture;
+                    const Ref<VulkanTexture>& Texture = Resource->ResourceInfo.Texture.Texture;
                     bool bIsDepth = Texture->Format == VK_FORMAT_D32_SFLOAT;
                     ImageLayoutBarrier Src = bIsDepth ? ImageLayoutBarrier::DepthStencilAttachment : ImageLayoutBarrier::ColorAttachment;
                     ImageLayoutBarrier Dst = ImageLayoutBarrier::PixelShaderRead;
@@ -705,11 +713,11 @@ namespace ReEngine
 
             for(uint32 o = 0 ; o < Node->Outputs.size() ; o++)
             {
-                Ref<FrameGraphResource> Resource = builder->AccessResource(Node->Outputs[ o ]);
+                const Ref<FrameGraphResource>& Resource = builder->AccessResource(Node->Outputs[ o ]);
 
                 if(Resource->ResourceType == FrameGraphResourceType::FrameGraphResourceType_Attachment)
                 {
-                    Ref<VulkanTexture> Texture = Resource->ResourceInfo.Texture.Texture;
+                    const Ref<VulkanTexture>& Texture = Resource->ResourceInfo.Texture.Texture;
                     bool bIsDepth = Texture->Format == VK_FORMAT_D32_SFLOAT;
                     ImageLayoutBarrier Src = ImageLayoutBarrier::Undefined;
                     ImageLayoutBarrier Dst = bIsDepth ? ImageLayoutBarrier::DepthStencilAttachment : ImageLayoutBarrier::ColorAttachment;
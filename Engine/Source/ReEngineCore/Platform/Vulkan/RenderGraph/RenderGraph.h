@@ -110,8 +110,8 @@ namespace ReEngine
 
     struct FrameGraphRenderPass
     {
-        virtual void PreRender(Ref<VulkanCommandBuffer> Cmd,Ref<VulkanModel> Model){}
-        virtual void Render(Ref<VulkanCommandBuffer> Cmd,Ref<VulkanModel> Model){}
+        virtual void PreRender(const Ref<VulkanCommandBuffer>& Cmd,const Ref<VulkanModel>& Model){}
+        virtual void Render(const Ref<VulkanCommandBuffer>& Cmd,const Ref<VulkanModel>& Model){}
         virtual void OnResize(){}
 
         virtual ~FrameGraphRenderPass() = default;
@@ -208,10 +208,10 @@ namespace ReEngine
         FrameGraphNodeHandle CreateNode(const FrameGraphNodeCreation& Creation);
 
         Ref<FrameGraphNode> GetNode(std::string Name);
-        Ref<FrameGraphNode> AccessNode( FrameGraphNodeHandle Handle );
+        const Ref<FrameGraphNode>& AccessNode( FrameGraphNodeHandle Handle );
         
         Ref<FrameGraphResource> GetResource(std::string Name);
-        Ref<FrameGraphResource> AccessResource(FrameGraphResourceHandle handle);
+        const Ref<FrameGraphResource>& AccessResource(FrameGraphResourceHandle handle);
 
         FrameGraphResourceCache ResourceCache;
         FrameGraphNodeCache NodeCache;
@@ -250,7 +250,7 @@ namespace ReEngine
         Ref<FrameGraphResource> GetResource(cstring name);
         Ref<FrameGraphResource> AccessResource(FrameGraphResourceHandle handle);
 
-        void Render(Ref<VulkanCommandBuffer> CmdBuffer,Ref<VulkanModel> RenderModel);
+        void Render(const Ref<VulkanCommandBuffer>& CmdBuffer,const Ref<VulkanModel>& RenderModel);
 
         void AddNode(FrameGraphNodeCreation& node);
 
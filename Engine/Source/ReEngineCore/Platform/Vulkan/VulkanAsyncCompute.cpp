@@ -0,0 +1,205 @@
+﻿#include "VulkanAsyncCompute.h"
+
+namespace ReEngine
+{
+    void VulkanAsyncCompute::Init(Ref<VulkanDevice> device, uint32 numFramesInFlight)
+    {
+        m_Device         = device;
+        m_GraphicsQueue  = device->GetPresentQueue();
+        m_ComputeQueue   = device->GetComputeQueue();
+        m_GraphicsFamily = m_GraphicsQueue->GetFamilyIndex();
+        m_ComputeFamily  = m_ComputeQueue->GetFamilyIndex();
+        m_NumFrames      = numFramesInFlight;
+        m_FrameIndex     = 0;
+
+        m_GraphicsLists.resize(m_NumFrames);
+        m_ComputeLists.resize(m_NumFrames);
+        for (uint32 index = 0; index < m_NumFrames; ++index)
+        {
+            CreateCommandList(m_GraphicsLists[index], m_GraphicsFamily);
+            CreateCommandList(m_ComputeLists[index], m_ComputeFamily);
+        }
+    }
+
+    void VulkanAsyncCompute::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        for (uint32 index = 0; index < m_NumFrames; ++index)
+        {
+            DestroyCommandList(m_GraphicsLists[index]);
+            DestroyCommandList(m_ComputeLists[index]);
+        }
+        m_GraphicsLists.clear();
+        m_ComputeLists.clear();
+
+        m_GraphicsQueue.reset();
+        m_ComputeQueue.reset();
+        m_Device.reset();
+    }
+
+    void VulkanAsyncCompute::BeginFrame(uint32 frameIndex)
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        m_FrameIndex = frameIndex % m_NumFrames;
+
+        VkDevice device = m_Device->GetInstanceHandle();
+        CommandList& graphicsList = m_GraphicsLists[m_FrameIndex];
+        CommandList& computeList  = m_ComputeLists[m_FrameIndex];
+
+        // 帧的主提交已经等过它们，这里通常不会阻塞
+        m_GraphicsQueue->WaitFor(graphicsList.LastPoint);
+        m_ComputeQueue->WaitFor(computeList.LastPoint);
+
+        if (graphicsList.NumUsed > 0) {
+            VERIFYVULKANRESULT(vkResetCommandPool(device, graphicsList.CommandPool, 0));
+        }
+        if (computeList.NumUsed > 0) {
+            VERIFYVULKANRESULT(vkResetCommandPool(device, computeList.CommandPool, 0));
+        }
+        graphicsList.NumUsed = 0;
+        computeList.NumUsed  = 0;
+    }
+
+    VkCommandBuffer VulkanAsyncCompute::BeginGraphics()
+    {
+        return BeginCommandList(m_GraphicsLists[m_FrameIndex]);
+    }
+
+    uint64 VulkanAsyncCompute::SubmitGraphics(VkCommandBuffer cmdBuffer, VkPipelineStageFlags computeWaitStage)
+    {
+        vkEndCommandBuffer(cmdBuffer);
+
+        // 等待只作用于同一批次，前一帧主提交上的等待挡不住这里的写
+        m_GraphicsQueue->AddWait(*m_ComputeQueue, m_ComputeQueue->GetLastSubmitted(), computeWaitStage);
+
+        CommandList& list = m_GraphicsLists[m_FrameIndex];
+        list.LastPoint = m_GraphicsQueue->Submit(1, &cmdBuffer);
+        return list.LastPoint;
+    }
+
+    VkCommandBuffer VulkanAsyncCompute::BeginCompute()
+    {
+        return BeginCommandList(m_ComputeLists[m_FrameIndex]);
+    }
+
+    uint64 VulkanAsyncCompute::SubmitCompute(VkCommandBuffer cmdBuffer, uint64 waitGraphicsPoint, VkPipelineStageFlags computeWaitStage, VkPipelineStageFlags frameWaitStage)
+    {
+        vkEndCommandBuffer(cmdBuffer);
+
+        m_ComputeQueue->AddWait(*m_GraphicsQueue, waitGraphicsPoint, computeWaitStage);
+
+        CommandList& list = m_ComputeLists[m_FrameIndex];
+        list.LastPoint = m_ComputeQueue->Submit(1, &cmdBuffer);
+
+        m_GraphicsQueue->AddWait(*m_ComputeQueue, list.LastPoint, frameWaitStage);
+        return list.LastPoint;
+    }
+
+    void VulkanAsyncCompute::ReleaseBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, bool toCompute)
+    {
+        OwnershipBarrier(cmdBuffer, buffer, VK_NULL_HANDLE, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, srcStage, srcAccess, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, toCompute);
+    }
+
+    void VulkanAsyncCompute::AcquireBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute)
+    {
+        OwnershipBarrier(cmdBuffer, buffer, VK_NULL_HANDLE, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, dstStage, dstAccess, toCompute);
+    }
+
+    void VulkanAsyncCompute::ReleaseImage(VkCommandBuffer cmdBuffer, VkImage image, const VkImageSubresourceRange& range, ImageLayoutBarrier layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, bool toCompute)
+    {
+        OwnershipBarrier(cmdBuffer, VK_NULL_HANDLE, image, &range, GetImageLayout(layout), srcStage, srcAccess, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, toCompute);
+    }
+
+    void VulkanAsyncCompute::AcquireImage(VkCommandBuffer cmdBuffer, VkImage image, const VkImageSubresourceRange& range, ImageLayoutBarrier layout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute)
+    {
+        OwnershipBarrier(cmdBuffer, VK_NULL_HANDLE, image, &range, GetImageLayout(layout), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, dstStage, dstAccess, toCompute);
+    }
+
+    VkCommandBuffer VulkanAsyncCompute::BeginCommandList(CommandList& list)
+    {
+        VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+        if (list.NumUsed < list.CmdBuffers.size())
+        {
+            cmdBuffer = list.CmdBuffers[list.NumUsed];
+        }
+        else
+        {
+            VkCommandBufferAllocateInfo allocInfo;
+            ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+            allocInfo.commandPool        = list.CommandPool;
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            VERIFYVULKANRESULT(vkAllocateCommandBuffers(m_Device->GetInstanceHandle(), &allocInfo, &cmdBuffer));
+            list.CmdBuffers.push_back(cmdBuffer);
+        }
+        list.NumUsed += 1;
+
+        VkCommandBufferBeginInfo beginInfo;
+        ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+        return cmdBuffer;
+    }
+
+    void VulkanAsyncCompute::CreateCommandList(CommandList& list, uint32 familyIndex)
+    {
+        VkCommandPoolCreateInfo cmdPoolInfo;
+        ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+        cmdPoolInfo.queueFamilyIndex = familyIndex;
+        cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        VERIFYVULKANRESULT(vkCreateCommandPool(m_Device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &list.CommandPool));
+    }
+
+    void VulkanAsyncCompute::DestroyCommandList(CommandList& list)
+    {
+        vkDestroyCommandPool(m_Device->GetInstanceHandle(), list.CommandPool, VULKAN_CPU_ALLOCATOR);
+        list.CommandPool = VK_NULL_HANDLE;
+        list.CmdBuffers.clear();
+        list.NumUsed = 0;
+    }
+
+    void VulkanAsyncCompute::OwnershipBarrier(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, const VkImageSubresourceRange* range, VkImageLayout layout,
+                                              VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute)
+    {
+        if (!IsSeparateFamily()) {
+            return;
+        }
+
+        const uint32 srcFamily = toCompute ? m_GraphicsFamily : m_ComputeFamily;
+        const uint32 dstFamily = toCompute ? m_ComputeFamily : m_GraphicsFamily;
+
+        if (buffer != VK_NULL_HANDLE)
+        {
+            VkBufferMemoryBarrier bufferBarrier;
+            ZeroVulkanStruct(bufferBarrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
+            bufferBarrier.srcAccessMask       = srcAccess;
+            bufferBarrier.dstAccessMask       = dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = srcFamily;
+            bufferBarrier.dstQueueFamilyIndex = dstFamily;
+            bufferBarrier.buffer              = buffer;
+            bufferBarrier.offset              = 0;
+            bufferBarrier.size                = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(cmdBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+        }
+        else
+        {
+            VkImageMemoryBarrier imageBarrier;
+            ZeroVulkanStruct(imageBarrier, VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER);
+            imageBarrier.srcAccessMask       = srcAccess;
+            imageBarrier.dstAccessMask       = dstAccess;
+            imageBarrier.oldLayout           = layout;
+            imageBarrier.newLayout           = layout;
+            imageBarrier.srcQueueFamilyIndex = srcFamily;
+            imageBarrier.dstQueueFamilyIndex = dstFamily;
+            imageBarrier.image               = image;
+            imageBarrier.subresourceRange    = *range;
+            vkCmdPipelineBarrier(cmdBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+
+#include <vector>
+
+namespace ReEngine
+{
+    // 异步计算：计算命令录在计算队列自己的CommandBuffer里单独提交，和图形队列用Timeline值同步
+    // 需要等图形结果的计算（例如深度）先把那部分图形命令用BeginGraphics单独提交，计算在GPU上等它的值
+    // 帧的主提交再在GPU上等计算完成，CPU都不阻塞
+    // 两个队列族不同时资源要做所有权转移，Release录在源队列，Acquire录在目标队列，两边参数一致
+    class VulkanAsyncCompute
+    {
+    public:
+        void Init(Ref<VulkanDevice> device, uint32 numFramesInFlight);
+
+        void Destroy();
+
+        // Acquire之后调用，等这个槽位上一次的计算和单独提交的图形命令完成后复位CommandPool
+        void BeginFrame(uint32 frameIndex);
+
+        // 在帧的图形队列上单独提交的CommandBuffer，执行顺序在这一帧主CommandBuffer之前
+        // 提交时在computeWaitStage等上一次计算完成，避免覆盖计算还在读的资源（例如上一帧的深度）
+        VkCommandBuffer BeginGraphics();
+        uint64 SubmitGraphics(VkCommandBuffer cmdBuffer, VkPipelineStageFlags computeWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        // 计算开始前在computeWaitStage等待图形队列到达waitGraphicsPoint，为0时不等待
+        // 帧的主提交会在frameWaitStage等这次计算完成
+        VkCommandBuffer BeginCompute();
+        uint64 SubmitCompute(VkCommandBuffer cmdBuffer, uint64 waitGraphicsPoint, VkPipelineStageFlags computeWaitStage, VkPipelineStageFlags frameWaitStage);
+
+        // 同一队列族时Semaphore已经保证可见性，不录Barrier
+        void ReleaseBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, bool toCompute);
+        void AcquireBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute);
+        void ReleaseImage(VkCommandBuffer cmdBuffer, VkImage image, const VkImageSubresourceRange& range, ImageLayoutBarrier layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, bool toCompute);
+        void AcquireImage(VkCommandBuffer cmdBuffer, VkImage image, const VkImageSubresourceRange& range, ImageLayoutBarrier layout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute);
+
+        // 计算队列和帧的图形队列是不同的队列族
+        FORCE_INLINE bool IsSeparateFamily() const
+        {
+            return m_GraphicsFamily != m_ComputeFamily;
+        }
+
+        FORCE_INLINE uint32 GetGraphicsFamily() const
+        {
+            return m_GraphicsFamily;
+        }
+
+        FORCE_INLINE uint32 GetComputeFamily() const
+        {
+            return m_ComputeFamily;
+        }
+
+    private:
+        struct CommandList
+        {
+            VkCommandPool                   CommandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer>    CmdBuffers;
+            uint32                          NumUsed = 0;
+            // 这个槽位上最后一次提交的值
+            uint64                          LastPoint = 0;
+        };
+
+        VkCommandBuffer BeginCommandList(CommandList& list);
+
+        void CreateCommandList(CommandList& list, uint32 familyIndex);
+
+        void DestroyCommandList(CommandList& list);
+
+        void OwnershipBarrier(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, const VkImageSubresourceRange* range, VkImageLayout layout,
+                              VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool toCompute);
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        // 帧的主CommandBuffer提交在PresentQueue上，单独提交的图形命令也放在这里保证顺序
+        Ref<VulkanQueue>                m_GraphicsQueue;
+        Ref<VulkanQueue>                m_ComputeQueue;
+        uint32                          m_GraphicsFamily = 0;
+        uint32                          m_ComputeFamily = 0;
+
+        uint32                          m_NumFrames = 0;
+        uint32                          m_FrameIndex = 0;
+        std::vector<CommandList>        m_GraphicsLists;
+        std::vector<CommandList>        m_ComputeLists;
+    };
+}
@@ -5,17 +5,27 @@
 VulkanBuffer::~VulkanBuffer()
 {
     UnMap();
+
+    if(PoolHandle.IsValid())
+    {
+        VulkanResourcePool::GetInstance().ReleaseBuffer(PoolHandle);
+    }
     
     if(Buffer != VK_NULL_HANDLE)
     {
-        vmaDestroyBuffer(Device->vma_allocator,Buffer,VmaAllocation);
+        Device->GetStagingManager().Wait(UploadTicket);
+        // 上传还在传输队列上时，由那一批退休时再释放，不阻塞CPU
+        // 之前录制的帧可能还在用，等这一帧执行完再销毁
+        if (!Device->GetUploadScheduler().Discard(UploadRequest, Buffer, VmaAllocation)) {
+            Device->GetResourceHeapManager().DeferReleaseVmaBuffer(Buffer, VmaAllocation);
+        }
     }
 
     Device.reset();
 }
 
 Ref<VulkanBuffer> VulkanBuffer::CreateBuffer(std::shared_ptr<VulkanDevice> device, VkBufferUsageFlags usageFlags,
-                                             VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, void* data)
+                                             VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, void* data, const std::source_location& location)
 {
     Ref<VulkanBuffer> dvkBuffer = CreateRef<VulkanBuffer>();
     dvkBuffer->Device = device;
@@ -25,15 +35,22 @@ Ref<VulkanBuffer> VulkanBuffer::CreateBuffer(std::shared_ptr<VulkanDevice> devic
     bufferCreateInfo.usage = usageFlags;
     bufferCreateInfo.size  = size;
 
+    VulkanMemoryCategory MemoryCategory = GetBufferMemoryCategory(usageFlags, memoryPropertyFlags);
+    VulkanDeviceMemoryManager& MemoryManager = device->GetMemoryManager();
+    MemoryManager.RequestBudget(MemoryManager.GetHeapIndexFromProperties(memoryPropertyFlags), size, false);
+
     VmaAllocationCreateInfo MemoryInfo{};
     MemoryInfo.flags = VMA_ALLOCATION_CREATE_STRATEGY_BEST_FIT_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
     MemoryInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    MemoryInfo.pUserData = (void*)(uintptr_t)MemoryCategory;
 
     VmaAllocationInfo AllocationInfo;
     vmaCreateBuffer(device->vma_allocator,&bufferCreateInfo,&MemoryInfo,
         &dvkBuffer->Buffer,&dvkBuffer->VmaAllocation,&AllocationInfo);
+    MemoryManager.TrackResource(MemoryCategory, AllocationInfo.memoryType, AllocationInfo.size, dvkBuffer->VmaAllocation, location.file_name(), location.line());
     
     dvkBuffer->Size       = AllocationInfo.size;
+    dvkBuffer->CreateSize = size;
     dvkBuffer->UsageFlags = usageFlags;
     dvkBuffer->MemoryPropertyFlags = memoryPropertyFlags;
 
@@ -56,7 +73,12 @@ VkResult VulkanBuffer::Map(VkDeviceSize size, VkDeviceSize offset)
         return VK_SUCCESS;
     }
 
-    return vmaMapMemory(Device->vma_allocator,VmaAllocation,&Mapped);
+    VkResult result = vmaMapMemory(Device->vma_allocator,VmaAllocation,&Mapped);
+    if(PoolHandle.IsValid())
+    {
+        VulkanResourcePool::GetInstance().UpdateBuffer(PoolHandle, this);
+    }
+    return result;
 }
 
 void VulkanBuffer::UnMap()
@@ -68,6 +90,11 @@ void VulkanBuffer::UnMap()
 
     vmaUnmapMemory(Device->vma_allocator, VmaAllocation);
     Mapped = nullptr;
+
+    if(PoolHandle.IsValid())
+    {
+        VulkanResourcePool::GetInstance().UpdateBuffer(PoolHandle, this);
+    }
 }
 
 void VulkanBuffer::SetupDescriptor(VkDeviceSize size, VkDeviceSize offset)
@@ -75,6 +102,20 @@ void VulkanBuffer::SetupDescriptor(VkDeviceSize size, VkDeviceSize offset)
     Descriptor.offset = offset;
     Descriptor.buffer = Buffer;
     Descriptor.range  = size;
+
+    if(PoolHandle.IsValid())
+    {
+        VulkanResourcePool::GetInstance().UpdateBuffer(PoolHandle, this);
+    }
+}
+
+BufferHandle VulkanBuffer::GetHandle()
+{
+    if(!PoolHandle.IsValid())
+    {
+        PoolHandle = VulkanResourcePool::GetInstance().RegisterBuffer(this);
+    }
+    return PoolHandle;
 }
 
 void VulkanBuffer::CopyFrom(void* data, VkDeviceSize size)
@@ -88,6 +129,29 @@ void VulkanBuffer::CopyFrom(void* data, VkDeviceSize size)
     memcpy(Mapped, data, size);
 }
 
+VulkanUploadTicket VulkanBuffer::Upload(const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+    UploadTicket = Device->GetStagingManager().UploadBuffer(Buffer, offset, data, size);
+    return UploadTicket;
+}
+
+VulkanUploadRequest VulkanBuffer::UploadAsync(const void* data, VkDeviceSize size, VulkanUploadPriority priority, VkDeviceSize offset)
+{
+    if (priority == VulkanUploadPriority::Immediate)
+    {
+        Upload(data, size, offset);
+        return 0;
+    }
+
+    UploadRequest = Device->GetUploadScheduler().UploadBuffer(Buffer, offset, data, size, priority);
+    return UploadRequest;
+}
+
+bool VulkanBuffer::IsResident()
+{
+    return Device->GetUploadScheduler().IsSubmitted(UploadRequest);
+}
+
 void VulkanBuffer::TransferBuffer(const Ref<VulkanDevice>& Device,const VulkanCommandPool& CommandPool,VulkanBuffer* SrcBuffer, VulkanBuffer* DstBuffer, VkDeviceSize size)
 {
     auto cmdBuffer = VulkanCommandBuffer::Create(Device, CommandPool.m_CommandPool);
@@ -108,40 +172,3 @@ void VulkanBuffer::TransferBuffer(const Ref<VulkanDevice>& Device, Ref<VulkanCom
     CommandBuffer->End();
     CommandBuffer->Submit();
 }
-
-void VulkanBuffer::TransferBufferImpl(VkDevice Device,VkCommandPool CommandPool,VkQueue TransferQueue,VkBuffer SrcBuffer, VkBuffer DstBuffer, VkDeviceSize size)
-{
-    //使用命令缓冲区执行内存传输的命令,从CommandPool中申请临时CommandList
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = CommandPool;
-    allocInfo.commandBufferCount = 1;
-
-    //创建录制Command
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(Device, &allocInfo, &commandBuffer);
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; //只使用一次
-
-    //录制Transfer
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    VkBufferCopy copyRegion = {};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, SrcBuffer, DstBuffer, 1, &copyRegion);
-    vkEndCommandBuffer(commandBuffer);
-
-    //提交Transfer
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(TransferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(TransferQueue); //等待传输队列变成Idle
-        
-    vkFreeCommandBuffers(Device, CommandPool, 1, &commandBuffer);
-}
\ No newline at end of file
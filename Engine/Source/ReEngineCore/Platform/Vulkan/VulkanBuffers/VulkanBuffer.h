@@ -1,6 +1,11 @@
 ﻿#pragma once
 #include "VulkanCommandBuffer.h"
 #include "Platform/Vulkan/VulkanCommandPool.h"
+#include "Platform/Vulkan/VulkanResourcePool.h"
+#include "VulkanStagingManager.h"
+#include "VulkanUploadScheduler.h"
+
+#include <source_location>
 
 VK_DEFINE_HANDLE( VmaAllocator )
 VK_DEFINE_HANDLE( VmaAllocation )
@@ -20,14 +25,26 @@ public:
 
     VkDeviceSize			Size = 0;
 
+    //创建时请求的大小，Size是实际分配的大小
+    VkDeviceSize            CreateSize = 0;
+
     void*					Mapped = nullptr;
 
     VkBufferUsageFlags		UsageFlags;
     VkMemoryPropertyFlags	MemoryPropertyFlags;
 
+    // 句柄池里的句柄，第一次GetHandle时注册
+    BufferHandle            PoolHandle;
+
+    // 最后一次Upload的凭证，销毁前要等拷贝完成
+    VulkanUploadTicket      UploadTicket = 0;
+
+    // 最后一次UploadAsync的请求，销毁前还在排队的会被丢掉
+    VulkanUploadRequest     UploadRequest = 0;
+
 public:
-    //创建Buffer
-    static Ref<VulkanBuffer> CreateBuffer(std::shared_ptr<VulkanDevice> device, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, void *data = nullptr);
+    //创建Buffer，location默认是调用点，记进显存跟踪
+    static Ref<VulkanBuffer> CreateBuffer(std::shared_ptr<VulkanDevice> device, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, void *data = nullptr, const std::source_location& location = std::source_location::current());
     static void TransferBuffer(const Ref<VulkanDevice>& Device,const VulkanCommandPool& CommandPool,VulkanBuffer* SrcBuffer, VulkanBuffer* DstBuffer, VkDeviceSize size);
     static void TransferBuffer(const Ref<VulkanDevice>& Device, Ref<VulkanCommandBuffer> CommandBuffer,Ref<VulkanBuffer> SrcBuffer, Ref<VulkanBuffer> DstBuffer, VkDeviceSize size);
 
@@ -40,16 +57,25 @@ public:
     //设置描述符
     void SetupDescriptor(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
+    //录制命令时用句柄代替Ref<>
+    BufferHandle GetHandle();
+
     //拷贝数据到映射的区间
     void CopyFrom(void* data, VkDeviceSize size);
 
+    //通过设备的Staging环上传，不等待GPU，Flush之后才会提交
+    VulkanUploadTicket Upload(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+    //进传输队列的调度器排队，Immediate时等同于Upload
+    //IsResident之前录制的命令不能读这个Buffer
+    VulkanUploadRequest UploadAsync(const void* data, VkDeviceSize size, VulkanUploadPriority priority, VkDeviceSize offset = 0);
+
+    bool IsResident();
+
     VkDeviceAddress GetDeviceAddress() const 
     {
         VkBufferDeviceAddressInfo info = {VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
         info.buffer = Buffer;
         return vkGetBufferDeviceAddress(Device->GetInstanceHandle(), &info);
     }
-
-private:
-    static void TransferBufferImpl(VkDevice Device,VkCommandPool CommandPool,VkQueue TransferQueue,VkBuffer SrcBuffer, VkBuffer DstBuffer, VkDeviceSize size);
 };
@@ -2,7 +2,8 @@
 
 VulkanCommandBuffer::~VulkanCommandBuffer()
 {
-    vkDestroyFence(m_VulkanDevice.lock()->GetInstanceHandle(),Fence,nullptr);
+    // 不等待提交的CommandBuffer可能还在GPU上执行
+    Wait();
 }
 
 //使用的时候必须显示地进行Begin和End
@@ -34,27 +35,33 @@ void VulkanCommandBuffer::End()
 }
 
 
-void VulkanCommandBuffer::Submit(VkSemaphore* SignalSemaphore)
+uint64 VulkanCommandBuffer::Submit(VkSemaphore* SignalSemaphore, bool waitComplete)
 {
     End();
-    
-    VkSubmitInfo submitInfo;
-    ZeroVulkanStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &CmdBuffer;
-    submitInfo.signalSemaphoreCount = SignalSemaphore ? 1 : 0;
-    submitInfo.pSignalSemaphores    = SignalSemaphore;
-		
-    if (WaitFlags.size() > 0) 
+
+    SubmitPoint = queue->Submit(1, &CmdBuffer,
+                                (uint32)WaitSemaphores.size(), WaitSemaphores.data(), WaitFlags.data(),
+                                SignalSemaphore ? 1 : 0, SignalSemaphore);
+
+    if (waitComplete)
     {
-        submitInfo.waitSemaphoreCount = WaitSemaphores.size();
-        submitInfo.pWaitSemaphores    = WaitSemaphores.data();
-        submitInfo.pWaitDstStageMask  = WaitFlags.data();
+        queue->WaitFor(SubmitPoint);
     }
 
-    vkResetFences(m_VulkanDevice.lock()->GetInstanceHandle(), 1, &Fence);
-    vkQueueSubmit(queue->GetHandle(), 1, &submitInfo, Fence); //TODO 这里可以斟酌下换成多线程提交
-    vkWaitForFences(m_VulkanDevice.lock()->GetInstanceHandle(), 1, &Fence, true, ((uint64)	0xffffffffffffffff));
+    return SubmitPoint;
+}
+
+bool VulkanCommandBuffer::IsComplete()
+{
+    return queue->IsComplete(SubmitPoint);
+}
+
+void VulkanCommandBuffer::Wait()
+{
+    if (queue)
+    {
+        queue->WaitFor(SubmitPoint);
+    }
 }
 
 Ref<VulkanCommandBuffer> VulkanCommandBuffer::Create(std::shared_ptr<::VulkanDevice> vulkanDevice,VkCommandPool commandPool, VkCommandBufferLevel level,std::shared_ptr<VulkanQueue> InQueue)
@@ -83,10 +90,5 @@ Ref<VulkanCommandBuffer> VulkanCommandBuffer::Create(std::shared_ptr<::VulkanDev
     cmdBufferAllocateInfo.commandBufferCount = 1;
     vkAllocateCommandBuffers(device, &cmdBufferAllocateInfo, &(cmdBuffer->CmdBuffer));
 
-    VkFenceCreateInfo fenceCreateInfo;
-    ZeroVulkanStruct(fenceCreateInfo, VK_STRUCTURE_TYPE_FENCE_CREATE_INFO);
-    fenceCreateInfo.flags = 0;
-    vkCreateFence(device, &fenceCreateInfo, nullptr, &(cmdBuffer->Fence));
-
     return cmdBuffer;
 }
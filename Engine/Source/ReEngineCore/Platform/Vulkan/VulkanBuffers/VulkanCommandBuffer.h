@@ -11,13 +11,18 @@ public:
     void Begin();
     void End();
 
-    void Submit(VkSemaphore* SignalSemaphore = nullptr);
+    // 返回队列时间线上的值，waitComplete为false时不阻塞，之后用IsComplete/Wait查询
+    uint64 Submit(VkSemaphore* SignalSemaphore = nullptr, bool waitComplete = true);
+
+    bool IsComplete();
+
+    void Wait();
 
     //分配使用单次的
     static Ref<VulkanCommandBuffer> Create(std::shared_ptr<VulkanDevice> vulkanDevice, VkCommandPool commandPool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,std::shared_ptr<VulkanQueue> queue = nullptr);
 public:
     VkCommandBuffer						CmdBuffer = VK_NULL_HANDLE;
-    VkFence								Fence = VK_NULL_HANDLE;
+    uint64								SubmitPoint = 0;
     VkCommandPool						CommandPool = VK_NULL_HANDLE;
     std::weak_ptr<VulkanDevice>		m_VulkanDevice;
     std::vector<VkPipelineStageFlags>	WaitFlags;
@@ -2,42 +2,26 @@
 
 VkResult VulkanDynamicBufferRing::OnCreate(Ref<VulkanDevice> Device, uint32_t NUmberOfBackBuffers,uint32_t MemTotalSize, char* name)
 {
-    m_Device = Device;
-
-    m_MemTotalSize = AlignUp(MemTotalSize,256u);
-
-    m_Mem.OnCreate(NUmberOfBackBuffers,m_MemTotalSize);
-
-    m_Buffer = VulkanBuffer::CreateBuffer(
+    return OnCreate(
         Device,
+        NUmberOfBackBuffers,
+        MemTotalSize,
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        m_MemTotalSize
+        (VkMemoryPropertyFlagBits)(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+        name
     );
-    
-    m_Buffer->Map();
-    m_pData = (char*)m_Buffer->Mapped;
-
-    return VK_SUCCESS;
 }
 
 VkResult VulkanDynamicBufferRing::OnCreate(Ref<VulkanDevice> Device, uint32_t NUmberOfBackBuffers,uint32_t MemTotalSize, VkBufferUsageFlagBits UsageFlagBit, VkMemoryPropertyFlagBits PropertyFlagBits, char* name)
 {
     m_Device = Device;
+    m_MemTotalSize = MemTotalSize;
 
-    m_MemTotalSize = AlignUp(MemTotalSize,256u);
-
-    m_Mem.OnCreate(NUmberOfBackBuffers,m_MemTotalSize);
-
-    m_Buffer = VulkanBuffer::CreateBuffer(
-        Device,
-        UsageFlagBit,
-        PropertyFlagBits,
-        m_MemTotalSize
-    );
-    
-    m_Buffer->Map();
-    m_pData = (char*)m_Buffer->Mapped;
+    // 每帧按需从空闲Chunk里取，不再按帧数平均切分，帧数也不再限制为4
+    // 动态描述符只能绑定一个VkBuffer，所有分配都在这一个Block里
+    uint32 ChunkSize = glm::min((uint32)DEFAULT_CHUNK_SIZE, MemTotalSize / glm::max(NUmberOfBackBuffers, 1u));
+    m_Mem.Create(Device, NUmberOfBackBuffers, MemTotalSize, ChunkSize, UsageFlagBit, PropertyFlagBits);
+    m_MemTotalSize = (uint32)m_Mem.GetStats().Capacity;
 
     return VK_SUCCESS;
 }
@@ -45,25 +29,24 @@ VkResult VulkanDynamicBufferRing::OnCreate(Ref<VulkanDevice> Device, uint32_t NU
 void VulkanDynamicBufferRing::OnDestroy()
 {
     BufferInfos.clear();
-    m_Mem.OnDestroy();
+    m_Mem.Destroy();
+    m_Device.reset();
 }
 
 bool VulkanDynamicBufferRing::AllocConstantBuffer(uint32_t size, void** pData, VkDescriptorBufferInfo* pOut)
 {
-    size = AlignUp(size, 256u);
-
-    uint32_t MemOffset;
-    if(m_Mem.Alloc(size,&MemOffset) == false)
+    VulkanTransientAllocation Allocation;
+    if(m_Mem.Allocate(size,Allocation) == false)
     {
         RE_CORE_ERROR("Ran out of mem for 'dynamic' buffers, please increase the allocated size");
         return false;
     }
 
-    *pData = (void*)(m_pData + MemOffset);
+    *pData = Allocation.MappedData;
 
-    pOut->buffer = m_Buffer->Buffer;
-    pOut->offset = MemOffset;
-    pOut->range = size;
+    pOut->buffer = Allocation.Buffer;
+    pOut->offset = Allocation.Offset;
+    pOut->range = AlignUp(size, m_Mem.GetAlignment());
 
     return true;
 }
@@ -71,7 +54,7 @@ bool VulkanDynamicBufferRing::AllocConstantBuffer(uint32_t size, void** pData, V
 VkDescriptorBufferInfo VulkanDynamicBufferRing::AllocConstantBuffer(uint32_t size, void* pData)
 {
     void *pBuffer;
-    VkDescriptorBufferInfo out;
+    VkDescriptorBufferInfo out = {};
     if (AllocConstantBuffer(size, &pBuffer, &out))
     {
         memcpy(pBuffer, pData, size);
@@ -82,13 +65,13 @@ VkDescriptorBufferInfo VulkanDynamicBufferRing::AllocConstantBuffer(uint32_t siz
 
 void VulkanDynamicBufferRing::OnBeginFrame()
 {
-    m_Mem.OnBeginFrame();
+    m_Mem.BeginFrame();
 }
 
 void VulkanDynamicBufferRing::SetDescriptorSet(int BindingIndex, uint32_t size, VkDescriptorSet descriptorSet)
 {
     VkDescriptorBufferInfo out = {};
-    out.buffer = m_Buffer->Buffer;
+    out.buffer = m_Mem.GetBuffer();
     out.offset = 0;
     out.range = size;
 
@@ -109,7 +92,7 @@ void VulkanDynamicBufferRing::SetDescriptorSet(int BindingIndex, uint32_t size,
 VkDescriptorBufferInfo* VulkanDynamicBufferRing::GetSetDescriptor(uint32_t size)
 {
     VkDescriptorBufferInfo out = {};
-    out.buffer = m_Buffer->Buffer;
+    out.buffer = m_Mem.GetBuffer();
     out.offset = 0;
     out.range = size;
 
@@ -1,6 +1,6 @@
 ﻿#pragma once
 #include "VulkanBuffer.h"
-#include "Core/Ring.h"
+#include "VulkanTransientAllocator.h"
 #include "Platform/Vulkan/VulkanCommonDefine.h"
 #include "Platform/Vulkan/VulkanDevice.h"
 
@@ -10,25 +10,60 @@ class VulkanDynamicBufferRing
 public:
     ~VulkanDynamicBufferRing()
     {
-        m_Buffer.reset();
         OnDestroy();
     }
     
     VkResult OnCreate(Ref<VulkanDevice> Device , uint32_t NUmberOfBackBuffers,uint32_t MemTotalSize,char *name = NULL);
     VkResult OnCreate(Ref<VulkanDevice> Device , uint32_t NUmberOfBackBuffers,uint32_t MemTotalSize,VkBufferUsageFlagBits UsageFlagBit,VkMemoryPropertyFlagBits PropertyFlagBits,char *name = NULL);
     void OnDestroy();
+    // 动态描述符绑定的是唯一的Block，空间不够或size超过GetMaxAllocSize时返回false，不会扩容
     bool AllocConstantBuffer(uint32_t size,void **pData,VkDescriptorBufferInfo *pOut);
     VkDescriptorBufferInfo AllocConstantBuffer(uint32_t size, void *pData);
     void OnBeginFrame();
+
+    // 见VulkanTransientAllocator::BeginRetain，期间的AllocConstantBuffer跨帧有效
+    FORCE_INLINE uint32 BeginRetain()
+    {
+        return m_Mem.BeginRetain();
+    }
+
+    FORCE_INLINE void EndRetain()
+    {
+        m_Mem.EndRetain();
+    }
+
+    FORCE_INLINE void ReleaseRetained(uint32 retainId)
+    {
+        m_Mem.ReleaseRetained(retainId);
+    }
     void SetDescriptorSet(int i, uint32_t size, VkDescriptorSet descriptorSet);
     VkDescriptorBufferInfo* GetSetDescriptor(uint32_t size);
 
+    FORCE_INLINE uint32 GetAlignment() const
+    {
+        return m_Mem.GetAlignment();
+    }
+
+    // 单次分配的上限，就是一个Chunk的大小
+    FORCE_INLINE uint32 GetMaxAllocSize() const
+    {
+        return m_Mem.GetChunkSize();
+    }
+
+    FORCE_INLINE VulkanTransientAllocatorStats GetStats() const
+    {
+        return m_Mem.GetStats();
+    }
+
 private:
+    enum
+    {
+        DEFAULT_CHUNK_SIZE = 1024 * 1024,
+    };
+
     Ref<VulkanDevice> m_Device = nullptr;
-    Ref<VulkanBuffer> m_Buffer = nullptr;
     uint32_t m_MemTotalSize;
-    RingWithTab m_Mem;
-    char *m_pData = nullptr;
+    VulkanTransientAllocator m_Mem;
 
     std::vector<VkDescriptorBufferInfo> BufferInfos;
 
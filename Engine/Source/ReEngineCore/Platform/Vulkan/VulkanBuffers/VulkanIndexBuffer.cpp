@@ -1,6 +1,6 @@
 ﻿#include "VulkanIndexBuffer.h"
 
-Ref<VulkanIndexBuffer> VulkanIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer,std::vector<uint16> indices, VkIndexType type)
+Ref<VulkanIndexBuffer> VulkanIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer,std::vector<uint16> indices, VkIndexType type, VulkanUploadPriority priority)
 {
     Ref<VulkanIndexBuffer> IndexBuffer = CreateRef<VulkanIndexBuffer>();
 
@@ -9,20 +9,15 @@ Ref<VulkanIndexBuffer> VulkanIndexBuffer::Create(std::shared_ptr<VulkanDevice> v
     
     VkDeviceSize IndexbufferSize = sizeof(indices[0]) * indices.size();
 
-    auto stagingIndexBuffer = VulkanBuffer::CreateBuffer(
-            vulkanDevice,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            IndexbufferSize,(void*)indices.data());
-    
+    //TRANSFER_SRC给碎片整理搬家用
    IndexBuffer->Buffer = VulkanBuffer::CreateBuffer(
             vulkanDevice,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ,
             IndexbufferSize);
 
-    VulkanBuffer::TransferBuffer(vulkanDevice,cmdBuffer,stagingIndexBuffer,IndexBuffer->Buffer,IndexbufferSize);
-
+    //Immediate拷贝进Staging环，和其它上传一起在Flush时提交；否则进传输队列排队
+    IndexBuffer->Buffer->UploadAsync(indices.data(), IndexbufferSize, priority);
     
     return IndexBuffer;
 }
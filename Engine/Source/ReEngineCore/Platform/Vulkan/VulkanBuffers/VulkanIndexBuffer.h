@@ -19,7 +19,7 @@ public:
         vkCmdDrawIndexed(CmdBuffer, IndexCount, 1, 0, 0, 0);
     }
 
-    static Ref<VulkanIndexBuffer> Create(std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, std::vector<uint16> indices, VkIndexType type = VK_INDEX_TYPE_UINT16);
+    static Ref<VulkanIndexBuffer> Create(std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, std::vector<uint16> indices, VkIndexType type = VK_INDEX_TYPE_UINT16, VulkanUploadPriority priority = VulkanUploadPriority::Immediate);
     
 public:
     VkDevice Device = VK_NULL_HANDLE;
@@ -0,0 +1,383 @@
+﻿#include "VulkanStagingManager.h"
+#include "Platform/Vulkan/VulkanDevice.h"
+#include "vk_mem_alloc.h"
+
+void VulkanStagingManager::Init(VulkanDevice* device, uint32 ringSize)
+{
+    m_Device = device;
+    m_Queue  = device->GetGraphicsQueue().get();
+
+    // 拷贝和绘制在同一个队列族，Buffer不需要做所有权转移
+    VkCommandPoolCreateInfo cmdPoolInfo;
+    ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+    cmdPoolInfo.queueFamilyIndex = device->GetGraphicsQueue()->GetFamilyIndex();
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_CommandPool));
+
+    DedicatedBuffer ring;
+    if (!CreateDedicatedBuffer(ringSize, ring))
+    {
+        RE_CORE_ERROR("Failed to create staging ring, size {0}", ringSize);
+        return;
+    }
+
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(device->vma_allocator, ring.Allocation, &allocationInfo);
+
+    m_RingBuffer     = ring.Buffer;
+    m_RingAllocation = ring.Allocation;
+    m_RingMemoryType = ring.MemoryType;
+    m_RingMapped     = (uint8*)allocationInfo.pMappedData;
+    m_RingSize       = ring.Size;
+    m_RingHead       = 0;
+    m_RingTail       = 0;
+    m_RingUsed       = 0;
+}
+
+void VulkanStagingManager::Destroy()
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Device) {
+        return;
+    }
+
+    FlushLocked();
+    while (RetireOldest(true)) {
+    }
+
+    VkDevice device = m_Device->GetInstanceHandle();
+    if (m_FreeCmdBuffers.size() > 0) {
+        vkFreeCommandBuffers(device, m_CommandPool, (uint32)m_FreeCmdBuffers.size(), m_FreeCmdBuffers.data());
+    }
+    m_FreeCmdBuffers.clear();
+    vkDestroyCommandPool(device, m_CommandPool, VULKAN_CPU_ALLOCATOR);
+    m_CommandPool = VK_NULL_HANDLE;
+
+    if (m_RingBuffer != VK_NULL_HANDLE) {
+        DestroyDedicatedBuffer({ m_RingBuffer, m_RingAllocation, m_RingMemoryType, m_RingSize });
+    }
+    m_RingBuffer     = VK_NULL_HANDLE;
+    m_RingAllocation = VK_NULL_HANDLE;
+    m_RingMapped     = nullptr;
+    m_RingSize       = 0;
+    m_Device         = nullptr;
+}
+
+VulkanUploadTicket VulkanStagingManager::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    PendingCopy copy;
+    copy.Region.dstOffset = dstOffset;
+    copy.Region.size      = size;
+
+    VkDeviceSize ringOffset = 0;
+    bool allocated = AllocateRing(size, ringOffset);
+    // 环满了就先提交当前批次，再按顺序等最早的批次退休
+    while (!allocated && size <= m_RingSize)
+    {
+        FlushLocked();
+        if (!RetireOldest(true)) {
+            break;
+        }
+        allocated = AllocateRing(size, ringOffset);
+    }
+
+    if (allocated)
+    {
+        memcpy(m_RingMapped + ringOffset, data, size);
+        vmaFlushAllocation(m_Device->vma_allocator, m_RingAllocation, ringOffset, size);
+
+        copy.SrcBuffer        = m_RingBuffer;
+        copy.Region.srcOffset = ringOffset;
+    }
+    else
+    {
+        // 比整个环还大，单独建一个Staging，批次退休时释放
+        DedicatedBuffer dedicated;
+        if (!CreateDedicatedBuffer(size, dedicated))
+        {
+            RE_CORE_ERROR("Failed to create staging buffer, size {0}", size);
+            return 0;
+        }
+
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(m_Device->vma_allocator, dedicated.Allocation, &allocationInfo);
+        memcpy(allocationInfo.pMappedData, data, size);
+        vmaFlushAllocation(m_Device->vma_allocator, dedicated.Allocation, 0, size);
+
+        m_PendingDedicated.push_back(dedicated);
+        m_NumDedicated += 1;
+
+        copy.SrcBuffer        = dedicated.Buffer;
+        copy.Region.srcOffset = 0;
+    }
+
+    m_PendingCopies[dstBuffer].push_back(copy);
+    m_PendingBytes += size;
+    m_NumUploads   += 1;
+
+    return m_NextTicket;
+}
+
+VulkanUploadTicket VulkanStagingManager::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return FlushLocked();
+}
+
+bool VulkanStagingManager::IsComplete(VulkanUploadTicket ticket)
+{
+    if (ticket == 0) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    RetireCompleted();
+    return ticket <= m_CompletedTicket;
+}
+
+void VulkanStagingManager::Wait(VulkanUploadTicket ticket)
+{
+    if (ticket == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (ticket >= m_NextTicket) {
+        FlushLocked();
+    }
+
+    while (m_CompletedTicket < ticket && RetireOldest(true)) {
+    }
+}
+
+void VulkanStagingManager::Tick()
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    RetireCompleted();
+}
+
+VulkanStagingStats VulkanStagingManager::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    VulkanStagingStats stats;
+    stats.RingSize     = m_RingSize;
+    stats.RingUsed     = m_RingUsed;
+    stats.PendingBytes = m_PendingBytes;
+    stats.NumInFlight  = (uint32)m_InFlight.size();
+    stats.NumSubmits   = m_NumSubmits;
+    stats.NumUploads   = m_NumUploads;
+    stats.NumDedicated = m_NumDedicated;
+    return stats;
+}
+
+bool VulkanStagingManager::AllocateRing(VkDeviceSize size, VkDeviceSize& outOffset)
+{
+    if (size > m_RingSize) {
+        return false;
+    }
+
+    if (m_RingUsed == 0)
+    {
+        m_RingHead = 0;
+        m_RingTail = 0;
+    }
+    else if (m_RingHead == m_RingTail)
+    {
+        // 绕回来追上了Tail，整个环都在用
+        return false;
+    }
+
+    const VkDeviceSize alignedHead = AlignUp(m_RingHead, (VkDeviceSize)COPY_OFFSET_ALIGNMENT);
+    VkDeviceSize consumed = 0;
+
+    if (m_RingHead >= m_RingTail)
+    {
+        if (alignedHead + size <= m_RingSize)
+        {
+            outOffset = alignedHead;
+            consumed  = alignedHead + size - m_RingHead;
+        }
+        else if (size <= m_RingTail)
+        {
+            // 尾部放不下，跳过剩下的部分从头开始，跳过的部分算在这一批里
+            outOffset = 0;
+            consumed  = m_RingSize - m_RingHead + size;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (alignedHead + size > m_RingTail) {
+            return false;
+        }
+        outOffset = alignedHead;
+        consumed  = alignedHead + size - m_RingHead;
+    }
+
+    m_RingHead         = outOffset + size;
+    m_RingUsed        += consumed;
+    m_PendingRingUsed += consumed;
+    return true;
+}
+
+bool VulkanStagingManager::CreateDedicatedBuffer(VkDeviceSize size, DedicatedBuffer& outBuffer)
+{
+    VkBufferCreateInfo bufferCreateInfo;
+    ZeroVulkanStruct(bufferCreateInfo, VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO);
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.size  = size;
+
+    const VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VulkanDeviceMemoryManager& memoryManager = m_Device->GetMemoryManager();
+    memoryManager.RequestBudget(memoryManager.GetHeapIndexFromProperties(memoryPropertyFlags), size, false);
+
+    // 常驻映射，不再每次上传Map/UnMap
+    VmaAllocationCreateInfo memoryInfo{};
+    memoryInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    memoryInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    memoryInfo.pUserData = (void*)(uintptr_t)VulkanMemoryCategory::Staging;
+
+    VmaAllocationInfo allocationInfo;
+    VkResult result = vmaCreateBuffer(m_Device->vma_allocator, &bufferCreateInfo, &memoryInfo, &outBuffer.Buffer, &outBuffer.Allocation, &allocationInfo);
+    if (result != VK_SUCCESS) {
+        return false;
+    }
+
+    outBuffer.MemoryType = allocationInfo.memoryType;
+    outBuffer.Size       = allocationInfo.size;
+    memoryManager.TrackResource(VulkanMemoryCategory::Staging, allocationInfo.memoryType, allocationInfo.size, outBuffer.Allocation, __FILE__, __LINE__);
+    return true;
+}
+
+void VulkanStagingManager::DestroyDedicatedBuffer(const DedicatedBuffer& buffer)
+{
+    m_Device->GetMemoryManager().UntrackResource(VulkanMemoryCategory::Staging, buffer.MemoryType, buffer.Size, buffer.Allocation);
+    vmaDestroyBuffer(m_Device->vma_allocator, buffer.Buffer, buffer.Allocation);
+}
+
+VulkanUploadTicket VulkanStagingManager::FlushLocked()
+{
+    if (m_PendingCopies.empty()) {
+        return m_NextTicket - 1;
+    }
+
+    Batch batch;
+    batch.Ticket    = m_NextTicket++;
+    batch.CmdBuffer = AcquireCommandBuffer();
+
+    VkCommandBufferBeginInfo beginInfo;
+    ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch.CmdBuffer, &beginInfo);
+
+    // 同一个目标Buffer、同一个来源的区间合并成一次vkCmdCopyBuffer
+    std::vector<VkBufferCopy> regions;
+    for (auto it = m_PendingCopies.begin(); it != m_PendingCopies.end(); ++it)
+    {
+        const std::vector<PendingCopy>& copies = it->second;
+        int32 first = 0;
+        while (first < copies.size())
+        {
+            regions.clear();
+            int32 last = first;
+            while (last < copies.size() && copies[last].SrcBuffer == copies[first].SrcBuffer)
+            {
+                regions.push_back(copies[last].Region);
+                last += 1;
+            }
+            vkCmdCopyBuffer(batch.CmdBuffer, copies[first].SrcBuffer, it->first, (uint32)regions.size(), regions.data());
+            first = last;
+        }
+    }
+
+    // 同一队列上后面提交的命令都在这个Barrier的第二个同步范围里
+    VkMemoryBarrier barrier;
+    ZeroVulkanStruct(barrier, VK_STRUCTURE_TYPE_MEMORY_BARRIER);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(batch.CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkEndCommandBuffer(batch.CmdBuffer);
+
+    batch.SubmitPoint = m_Queue->Submit(1, &batch.CmdBuffer);
+
+    batch.RingEnd   = m_RingHead;
+    batch.RingUsed  = m_PendingRingUsed;
+    batch.Dedicated = std::move(m_PendingDedicated);
+
+    m_PendingCopies.clear();
+    m_PendingDedicated.clear();
+    m_PendingRingUsed = 0;
+    m_PendingBytes    = 0;
+    m_NumSubmits     += 1;
+
+    m_InFlight.push_back(std::move(batch));
+    return m_NextTicket - 1;
+}
+
+bool VulkanStagingManager::RetireOldest(bool wait)
+{
+    if (m_InFlight.empty()) {
+        return false;
+    }
+
+    Batch& batch = m_InFlight.front();
+    if (wait)
+    {
+        m_Queue->WaitFor(batch.SubmitPoint);
+    }
+    else if (!m_Queue->IsComplete(batch.SubmitPoint))
+    {
+        return false;
+    }
+
+    m_RingTail  = batch.RingEnd;
+    m_RingUsed -= batch.RingUsed;
+
+    for (int32 index = 0; index < batch.Dedicated.size(); ++index) {
+        DestroyDedicatedBuffer(batch.Dedicated[index]);
+    }
+
+    m_FreeCmdBuffers.push_back(batch.CmdBuffer);
+    m_CompletedTicket = batch.Ticket;
+
+    m_InFlight.pop_front();
+    return true;
+}
+
+void VulkanStagingManager::RetireCompleted()
+{
+    while (RetireOldest(false)) {
+    }
+}
+
+VkCommandBuffer VulkanStagingManager::AcquireCommandBuffer()
+{
+    if (m_FreeCmdBuffers.size() > 0)
+    {
+        VkCommandBuffer cmdBuffer = m_FreeCmdBuffers.back();
+        m_FreeCmdBuffers.pop_back();
+        return cmdBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo;
+    ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+    allocInfo.commandPool        = m_CommandPool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+    vkAllocateCommandBuffers(m_Device->GetInstanceHandle(), &allocInfo, &cmdBuffer);
+    return cmdBuffer;
+}
@@ -0,0 +1,135 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Platform/Vulkan/VulkanCommonDefine.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+VK_DEFINE_HANDLE( VmaAllocation )
+
+class VulkanDevice;
+class VulkanQueue;
+
+// 上传完成的凭证，按提交顺序递增，0表示不需要等待
+typedef uint64 VulkanUploadTicket;
+
+struct VulkanStagingStats
+{
+    uint64 RingSize         = 0;
+    uint64 RingUsed         = 0;    // 还没退休的批次占用的字节数，包含环尾浪费的部分
+    uint64 PendingBytes     = 0;    // 还没提交的上传字节数
+    uint32 NumInFlight      = 0;    // 已提交但GPU还没完成的批次
+    uint64 NumSubmits       = 0;
+    uint64 NumUploads       = 0;
+    uint64 NumDedicated     = 0;    // 比环还大、单独创建Staging的上传
+};
+
+// 常驻映射的Staging环，上传只做一次memcpy并记录拷贝区间，Flush时把一批拷贝录进同一个CommandBuffer提交
+// 每批记录图形队列时间线上的提交值，完成后回收环上的空间；拷贝和之后的绘制在同一个队列上，批尾的Barrier保证可见性
+class VulkanStagingManager
+{
+public:
+    enum
+    {
+        DEFAULT_RING_SIZE = 32 * 1024 * 1024,
+    };
+
+    void Init(VulkanDevice* device, uint32 ringSize);
+
+    void Destroy();
+
+    // 拷贝到环上，返回所在批次的凭证，不会等待GPU
+    VulkanUploadTicket UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+    // 提交当前批次，没有待提交的上传时返回上一次提交的凭证
+    VulkanUploadTicket Flush();
+
+    // 轮询，不会阻塞
+    bool IsComplete(VulkanUploadTicket ticket);
+
+    // 凭证还在待提交的批次里时会先提交
+    void Wait(VulkanUploadTicket ticket);
+
+    // 每帧调用，回收已经完成的批次
+    void Tick();
+
+    VulkanStagingStats GetStats() const;
+
+private:
+    struct DedicatedBuffer
+    {
+        VkBuffer        Buffer;
+        VmaAllocation   Allocation;
+        uint32          MemoryType;
+        VkDeviceSize    Size;
+    };
+
+    struct Batch
+    {
+        VulkanUploadTicket              Ticket = 0;
+        VkCommandBuffer                 CmdBuffer = VK_NULL_HANDLE;
+        uint64                          SubmitPoint = 0;
+        VkDeviceSize                    RingEnd = 0;
+        VkDeviceSize                    RingUsed = 0;
+        std::vector<DedicatedBuffer>    Dedicated;
+    };
+
+    struct PendingCopy
+    {
+        VkBuffer        SrcBuffer;
+        VkBufferCopy    Region;
+    };
+
+    bool AllocateRing(VkDeviceSize size, VkDeviceSize& outOffset);
+
+    bool CreateDedicatedBuffer(VkDeviceSize size, DedicatedBuffer& outBuffer);
+
+    void DestroyDedicatedBuffer(const DedicatedBuffer& buffer);
+
+    VulkanUploadTicket FlushLocked();
+
+    // 按提交顺序回收，wait为true时阻塞等待最早的一批
+    bool RetireOldest(bool wait);
+
+    void RetireCompleted();
+
+    VkCommandBuffer AcquireCommandBuffer();
+
+private:
+    enum
+    {
+        COPY_OFFSET_ALIGNMENT = 16,
+    };
+
+    VulkanDevice*                   m_Device = nullptr;
+    VulkanQueue*                    m_Queue = nullptr;
+    VkCommandPool                   m_CommandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer>    m_FreeCmdBuffers;
+
+    VkBuffer                        m_RingBuffer = VK_NULL_HANDLE;
+    VmaAllocation                   m_RingAllocation = VK_NULL_HANDLE;
+    uint32                          m_RingMemoryType = 0;
+    uint8*                          m_RingMapped = nullptr;
+    VkDeviceSize                    m_RingSize = 0;
+    VkDeviceSize                    m_RingHead = 0;
+    VkDeviceSize                    m_RingTail = 0;
+    VkDeviceSize                    m_RingUsed = 0;
+
+    // 当前还没提交的批次，按目标Buffer分组录制
+    std::unordered_map<VkBuffer, std::vector<PendingCopy>> m_PendingCopies;
+    std::vector<DedicatedBuffer>    m_PendingDedicated;
+    VkDeviceSize                    m_PendingRingUsed = 0;
+    VkDeviceSize                    m_PendingBytes = 0;
+
+    std::deque<Batch>               m_InFlight;
+    VulkanUploadTicket              m_NextTicket = 1;
+    VulkanUploadTicket              m_CompletedTicket = 0;
+
+    uint64                          m_NumSubmits = 0;
+    uint64                          m_NumUploads = 0;
+    uint64                          m_NumDedicated = 0;
+
+    mutable std::mutex              m_Lock;
+};
@@ -4,11 +4,63 @@
 #include "Platform/Vulkan/VulkanInstance.h"
 #include "Resource/AssetManager/AssetManager.h"
 #include "Platform/Vulkan/VulkanBuffers/VulkanBuffer.h"
+#include "Resource/Texture/TextureFile.h"
 
 #include "vk_mem_alloc.h"
 
+// 先拿到Image的显存需求申请预算，超出软上限时由回收回调先降级流式资源，再分配显存
+// 预算分类存在VmaAllocation的UserData里，析构时据此扣除
+VkResult VulkanTexture::CreateBudgetedImage(VulkanDevice* vulkanDevice, const VkImageCreateInfo& imageCreateInfo, VulkanMemoryCategory category, VkImage* outImage, VmaAllocation* outAllocation, bool canFail, const std::source_location& location)
+{
+    *outAllocation = VK_NULL_HANDLE;
+    
+    VkResult result = vkCreateImage(vulkanDevice->GetInstanceHandle(), &imageCreateInfo, VULKAN_CPU_ALLOCATOR, outImage);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(vulkanDevice->GetInstanceHandle(), *outImage, &memReqs);
+    
+    VulkanDeviceMemoryManager& memoryManager = vulkanDevice->GetMemoryManager();
+    if (!memoryManager.RequestBudget(memoryManager.GetHeapIndexFromProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), memReqs.size, canFail))
+    {
+        vkDestroyImage(vulkanDevice->GetInstanceHandle(), *outImage, VULKAN_CPU_ALLOCATOR);
+        *outImage = VK_NULL_HANDLE;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    
+    VmaAllocationCreateInfo memoryInfo{};
+    memoryInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    memoryInfo.pUserData     = (void*)(uintptr_t)category;
+    
+    VmaAllocationInfo allocationInfo;
+    result = vmaAllocateMemoryForImage(vulkanDevice->vma_allocator, *outImage, &memoryInfo, outAllocation, &allocationInfo);
+    if (result == VK_SUCCESS) {
+        result = vmaBindImageMemory(vulkanDevice->vma_allocator, *outAllocation, *outImage);
+    }
+    
+    if (result != VK_SUCCESS)
+    {
+        if (*outAllocation != VK_NULL_HANDLE) {
+            vmaFreeMemory(vulkanDevice->vma_allocator, *outAllocation);
+        }
+        vkDestroyImage(vulkanDevice->GetInstanceHandle(), *outImage, VULKAN_CPU_ALLOCATOR);
+        *outImage      = VK_NULL_HANDLE;
+        *outAllocation = VK_NULL_HANDLE;
+        return result;
+    }
+    
+    memoryManager.TrackResource(category, allocationInfo.memoryType, allocationInfo.size, *outAllocation, location.file_name(), location.line());
+    return VK_SUCCESS;
+}
+
 VulkanTexture::~VulkanTexture()
 {
+    if (PoolHandle.IsValid()) {
+        VulkanResourcePool::GetInstance().ReleaseTexture(PoolHandle);
+    }
+    
     if (ImageView != VK_NULL_HANDLE)
     {
         vkDestroyImageView(Device->GetInstanceHandle(), ImageView, VULKAN_CPU_ALLOCATOR);
@@ -20,14 +72,19 @@ VulkanTexture::~VulkanTexture()
         ImageSampler = VK_NULL_HANDLE;
     }
     
-    if (Image != VK_NULL_HANDLE)
-    {
-        vmaDestroyImage(Device->vma_allocator,Image,mVmaAllocation);
+    if (Image != VK_NULL_HANDLE) {
+        DestroyBudgetedImage(Device.get(), Image, mVmaAllocation);
     }
 
     Device.reset();
 }
 
+void VulkanTexture::DestroyBudgetedImage(VulkanDevice* vulkanDevice, VkImage image, VmaAllocation allocation)
+{
+    // 之前录制的帧可能还在用，等这一帧执行完再销毁并扣除预算
+    vulkanDevice->GetResourceHeapManager().DeferReleaseVmaImage(image, allocation);
+}
+
 
 void VulkanTexture::UpdateSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerMipmapMode mipmapMode,VkSamplerAddressMode addressModeU, VkSamplerAddressMode addressModeV, VkSamplerAddressMode addressModeW)
 {
@@ -52,10 +109,88 @@ void VulkanTexture::UpdateSampler(VkFilter magFilter, VkFilter minFilter, VkSamp
     }
     
     DescriptorInfo.sampler = ImageSampler;
+    SyncHandle();
+}
+
+TextureHandle VulkanTexture::GetHandle()
+{
+    if (!PoolHandle.IsValid()) {
+        PoolHandle = VulkanResourcePool::GetInstance().RegisterTexture(this);
+    }
+    return PoolHandle;
+}
+
+void VulkanTexture::SyncHandle()
+{
+    if (PoolHandle.IsValid()) {
+        VulkanResourcePool::GetInstance().UpdateTexture(PoolHandle, this);
+    }
+}
+
+void VulkanTexture::AddDescriptorBinding(VkDescriptorSet set, uint32 binding, uint32 arrayElement, VkDescriptorType type)
+{
+    RemoveDescriptorBinding(set, binding, arrayElement);
+    DescriptorBindings.push_back({ set, binding, arrayElement, type });
+}
+
+void VulkanTexture::RemoveDescriptorBinding(VkDescriptorSet set, uint32 binding, uint32 arrayElement)
+{
+    for (size_t index = 0; index < DescriptorBindings.size(); ++index)
+    {
+        const DescriptorBinding& descriptorBinding = DescriptorBindings[index];
+        if (descriptorBinding.Set == set && descriptorBinding.Binding == binding && descriptorBinding.ArrayElement == arrayElement)
+        {
+            DescriptorBindings[index] = DescriptorBindings.back();
+            DescriptorBindings.pop_back();
+            return;
+        }
+    }
+}
+
+void VulkanTexture::RewriteDescriptors()
+{
+    if (DescriptorBindings.empty()) {
+        return;
+    }
+    
+    std::vector<VkWriteDescriptorSet> writes(DescriptorBindings.size());
+    for (size_t index = 0; index < DescriptorBindings.size(); ++index)
+    {
+        const DescriptorBinding& descriptorBinding = DescriptorBindings[index];
+        
+        VkWriteDescriptorSet& write = writes[index];
+        ZeroVulkanStruct(write, VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET);
+        write.dstSet          = descriptorBinding.Set;
+        write.dstBinding      = descriptorBinding.Binding;
+        write.dstArrayElement = descriptorBinding.ArrayElement;
+        write.descriptorType  = descriptorBinding.Type;
+        write.descriptorCount = 1;
+        write.pImageInfo      = &DescriptorInfo;
+    }
+    vkUpdateDescriptorSets(Device->GetInstanceHandle(), (uint32)writes.size(), writes.data(), 0, nullptr);
 }
 
 Ref<VulkanTexture> VulkanTexture::Create2D(const std::string& filename, std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, VkImageUsageFlags imageUsageFlags, ImageLayoutBarrier imageLayout)
 {
+    const bool isCooked = std::filesystem::path(filename).extension() == ".rtex";
+    const std::string cookedPath = isCooked ? filename : TextureFile::GetCookedPath(filename);
+    
+    if (isCooked || std::filesystem::exists(AssetManager::GetFullPath(cookedPath)))
+    {
+        TextureFile textureFile;
+        if (TextureFile::Load(cookedPath, textureFile))
+        {
+            if (G_PixelFormats[textureFile.Format].supported) {
+                return Create2D(textureFile, vulkanDevice, cmdBuffer, imageUsageFlags, imageLayout);
+            }
+            RE_CORE_WARN("Cooked texture format {0} is not supported, decoding {1} instead.", G_PixelFormats[textureFile.Format].name, filename);
+        }
+        
+        if (isCooked) {
+            return nullptr;
+        }
+    }
+    
     uint32 DataSize = 0;
     uint8* DataPtr = nullptr;
 
@@ -85,6 +220,136 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const std::string& filename, std::sha
     return texture;
 }
 
+Ref<VulkanTexture> VulkanTexture::Create2D(const TextureFile& textureFile, std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, VkImageUsageFlags imageUsageFlags, ImageLayoutBarrier imageLayout, uint32 firstMip)
+{
+    VkDevice device = vulkanDevice->GetInstanceHandle();
+    
+    firstMip = glm::min(firstMip, (uint32)textureFile.Mips.size() - 1);
+    
+    const TextureFile::Mip& baseMip = textureFile.Mips[firstMip];
+    const VkFormat format   = PixelFormatToVkFormat(textureFile.Format, textureFile.IsSRGB());
+    const int32 width       = (int32)baseMip.Width;
+    const int32 height      = (int32)baseMip.Height;
+    const int32 mipLevels   = (int32)textureFile.Mips.size() - (int32)firstMip;
+    
+    // Mip按从大到小连续存放，只拷贝firstMip开始的尾部
+    const uint64 dataOffset = baseMip.Offset;
+    const uint64 dataSize   = textureFile.Data.size() - dataOffset;
+    
+    auto StagingBuffer = VulkanBuffer::CreateBuffer(
+        vulkanDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        dataSize);
+    
+    StagingBuffer->Map();
+    StagingBuffer->CopyFrom((void*)(textureFile.Data.data() + dataOffset), dataSize);
+    StagingBuffer->UnMap();
+    
+    // 块压缩格式不能做Attachment和Storage
+    imageUsageFlags &= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    
+    VkImage                         image = VK_NULL_HANDLE;
+    VkImageView                     imageView = VK_NULL_HANDLE;
+    VmaAllocation                   imageVmaAllocation;
+    VkSampler                       imageSampler = VK_NULL_HANDLE;
+    VkDescriptorImageInfo           descriptorInfo = {};
+    
+    VkImageCreateInfo ImageCreateInfo;
+    ZeroVulkanStruct(ImageCreateInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+    ImageCreateInfo.imageType       = VK_IMAGE_TYPE_2D;
+    ImageCreateInfo.format          = format;
+    ImageCreateInfo.mipLevels       = mipLevels;
+    ImageCreateInfo.arrayLayers     = 1;
+    ImageCreateInfo.samples         = VK_SAMPLE_COUNT_1_BIT;
+    ImageCreateInfo.tiling          = VK_IMAGE_TILING_OPTIMAL;
+    ImageCreateInfo.extent          = { (uint32_t)width, (uint32_t)height, 1 };
+    ImageCreateInfo.sharingMode     = VK_SHARING_MODE_EXCLUSIVE;
+    ImageCreateInfo.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    ImageCreateInfo.usage           = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | imageUsageFlags;
+    
+    VERIFYVULKANRESULT(CreateBudgetedImage(vulkanDevice.get(), ImageCreateInfo, VulkanMemoryCategory::Texture, &image, &imageVmaAllocation));
+    
+    // 每级Mip一个拷贝区域，一次提交
+    std::vector<VkBufferImageCopy> copyRegions(mipLevels);
+    for (int32 level = 0; level < mipLevels; ++level)
+    {
+        const TextureFile::Mip& mip = textureFile.Mips[firstMip + level];
+        
+        VkBufferImageCopy& region = copyRegions[level];
+        region = {};
+        region.bufferOffset                    = mip.Offset - dataOffset;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageExtent.width               = mip.Width;
+        region.imageExtent.height              = mip.Height;
+        region.imageExtent.depth               = 1;
+    }
+    
+    VkImageSubresourceRange subresourceRange = {};
+    subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresourceRange.levelCount     = mipLevels;
+    subresourceRange.layerCount     = 1;
+    subresourceRange.baseArrayLayer = 0;
+    subresourceRange.baseMipLevel   = 0;
+    
+    cmdBuffer->Begin();
+    ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+    vkCmdCopyBufferToImage(cmdBuffer->CmdBuffer, StagingBuffer->Buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32)copyRegions.size(), copyRegions.data());
+    ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferDest, imageLayout, subresourceRange);
+    cmdBuffer->End();
+    cmdBuffer->Submit();
+    
+    VkSamplerCreateInfo samplerInfo;
+    ZeroVulkanStruct(samplerInfo, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
+    samplerInfo.magFilter        = VK_FILTER_LINEAR;
+    samplerInfo.minFilter        = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.compareOp        = VK_COMPARE_OP_NEVER;
+    samplerInfo.borderColor      = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.maxAnisotropy    = 1.0;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    // 按完整的Mip数设置，流式补上精细的Mip之后Sampler不用重建
+    samplerInfo.maxLod           = (float)textureFile.Mips.size();
+    samplerInfo.minLod           = 0.0f;
+    VERIFYVULKANRESULT(vkCreateSampler(device, &samplerInfo, VULKAN_CPU_ALLOCATOR, &imageSampler));
+    
+    VkImageViewCreateInfo viewInfo;
+    ZeroVulkanStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+    viewInfo.image      = image;
+    viewInfo.viewType   = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format     = format;
+    viewInfo.components = vulkanDevice->GetFormatComponentMapping(textureFile.Format);
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.layerCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    VERIFYVULKANRESULT(vkCreateImageView(device, &viewInfo, VULKAN_CPU_ALLOCATOR, &imageView));
+    
+    descriptorInfo.sampler     = imageSampler;
+    descriptorInfo.imageView   = imageView;
+    descriptorInfo.imageLayout = GetImageLayout(imageLayout);
+    
+    Ref<VulkanTexture> texture   = CreateRef<VulkanTexture>();
+    texture->Device         = vulkanDevice;
+    texture->DescriptorInfo = descriptorInfo;
+    texture->Format         = format;
+    texture->Height         = height;
+    texture->Image          = image;
+    texture->ImageLayout    = GetImageLayout(imageLayout);
+    texture->ImageSampler   = imageSampler;
+    texture->mVmaAllocation = imageVmaAllocation;
+    texture->ImageView      = imageView;
+    texture->Width          = width;
+    texture->MipLevels      = mipLevels;
+    texture->LayerCount     = 1;
+    
+    return texture;
+}
+
 Ref<VulkanTexture> VulkanTexture::CreateDepthStencil(int32 width, int32 height,std::shared_ptr<VulkanDevice> vulkanDevice,PixelFormat DepthFormat, VkSampleCountFlagBits NumSamples,VkImageUsageFlags imageUsageFlags,ImageLayoutBarrier imageLayout)
 {
     int32 fwidth    = width;
@@ -111,9 +376,7 @@ Ref<VulkanTexture> VulkanTexture::CreateDepthStencil(int32 width, int32 height,s
     imageCreateInfo.flags       = 0;
     imageCreateInfo.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
 
-    VmaAllocationCreateInfo MemoryInfo{};
-    MemoryInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    VERIFYVULKANRESULT(vmaCreateImage(vulkanDevice->vma_allocator,&imageCreateInfo,&MemoryInfo,&texture->Image,&texture->mVmaAllocation,nullptr));
+    VERIFYVULKANRESULT(CreateBudgetedImage(vulkanDevice.get(), imageCreateInfo, VulkanMemoryCategory::RenderTarget, &texture->Image, &texture->mVmaAllocation));
     
     VkImageViewCreateInfo imageViewCreateInfo;
     ZeroVulkanStruct(imageViewCreateInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
@@ -160,9 +423,7 @@ Ref<VulkanTexture> VulkanTexture::Create2D(Ref<VulkanDevice> vulkanDevice,Ref<Vu
     imageCreateInfo.usage           = usage;
 
     // bind image buffer
-    VmaAllocationCreateInfo MemoryInfo{};
-    MemoryInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    VERIFYVULKANRESULT(vmaCreateImage(vulkanDevice->vma_allocator,&imageCreateInfo,&MemoryInfo,&image,&imageAllocation,nullptr));
+    VERIFYVULKANRESULT(CreateBudgetedImage(vulkanDevice.get(), imageCreateInfo, GetImageMemoryCategory(usage), &image, &imageAllocation));
 
     VkSamplerCreateInfo samplerInfo;
     ZeroVulkanStruct(samplerInfo, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
@@ -254,9 +515,6 @@ Ref<VulkanTexture> VulkanTexture::CreateAttachment(Ref<VulkanDevice> vulkanDevic
 
 Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkFormat format,int32 width,int32 height,std::shared_ptr<VulkanDevice> vulkanDevice,Ref<VulkanCommandBuffer> cmdBuffer,VkImageUsageFlags imageUsageFlags,ImageLayoutBarrier imageLayout)
 {
-    int32 MipLevels = Math::FloorToInt(Math::Log2(Math::Max(width,height))) + 1;
-    VkDevice device = vulkanDevice->GetInstanceHandle();
-    
     const uint32 ImageSize = width * height *  G_PixelFormats[format].blockBytes;
     const uint32 Size =  ImageSize > size ? ImageSize : size;
     
@@ -269,6 +527,20 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkF
     StagingBuffer->CopyFrom((void*)rgbaData,size);
     StagingBuffer->UnMap();
 
+    // start record
+    cmdBuffer->Begin();
+    Ref<VulkanTexture> texture = Create2DFromStaging(cmdBuffer->CmdBuffer, StagingBuffer->Buffer, 0, format, width, height, vulkanDevice, imageUsageFlags, imageLayout);
+    cmdBuffer->End();
+    cmdBuffer->Submit();
+
+    return texture;
+}
+
+Ref<VulkanTexture> VulkanTexture::Create2DFromStaging(VkCommandBuffer cmdBuffer,VkBuffer stagingBuffer,VkDeviceSize stagingOffset,VkFormat format,int32 width,int32 height,std::shared_ptr<VulkanDevice> vulkanDevice,VkImageUsageFlags imageUsageFlags,ImageLayoutBarrier imageLayout)
+{
+    int32 MipLevels = Math::FloorToInt(Math::Log2(Math::Max(width,height))) + 1;
+    VkDevice device = vulkanDevice->GetInstanceHandle();
+
     uint32 MemoryTypeIndex = 0;
     VkMemoryRequirements MemReqs = {};
     VkMemoryAllocateInfo memAllocInfo;
@@ -304,13 +576,8 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkF
     ImageCreateInfo.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
     ImageCreateInfo.usage           = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | imageUsageFlags;
     
-    VmaAllocationCreateInfo MemoryInfo{};
-    MemoryInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    VERIFYVULKANRESULT(vmaCreateImage(vulkanDevice->vma_allocator,&ImageCreateInfo,&MemoryInfo,&image,&imageVmaAllocation,nullptr));
+    VERIFYVULKANRESULT(CreateBudgetedImage(vulkanDevice.get(), ImageCreateInfo, VulkanMemoryCategory::Texture, &image, &imageVmaAllocation));
     
-    // start record
-    cmdBuffer->Begin();
-
     VkImageSubresourceRange subresourceRange = {};
     subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     subresourceRange.levelCount     = 1;
@@ -319,8 +586,9 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkF
     subresourceRange.baseMipLevel   = 0;
 
     // undefined to TransferDest
-    ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+    ImagePipelineBarrier(cmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
     VkBufferImageCopy bufferCopyRegion = {};
+    bufferCopyRegion.bufferOffset = stagingOffset;
     bufferCopyRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     bufferCopyRegion.imageSubresource.mipLevel       = 0;
     bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
@@ -329,8 +597,8 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkF
     bufferCopyRegion.imageExtent.height = height;
     bufferCopyRegion.imageExtent.depth  = 1;
     
-    vkCmdCopyBufferToImage(cmdBuffer->CmdBuffer, StagingBuffer->Buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-    ImagePipelineBarrier(cmdBuffer->CmdBuffer,image,ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource,subresourceRange);
+    vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+    ImagePipelineBarrier(cmdBuffer,image,ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource,subresourceRange);
     
     for(uint32_t i = 1 ; i <(uint32_t) MipLevels ; i++)
     {
@@ -363,20 +631,17 @@ Ref<VulkanTexture> VulkanTexture::Create2D(const uint8* rgbaData,uint32 size,VkF
         mipSubRange.baseArrayLayer = 0;
 
         // undefined to dst
-        ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, mipSubRange);
+        ImagePipelineBarrier(cmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, mipSubRange);
 
         // blit image
-        vkCmdBlitImage(cmdBuffer->CmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+        vkCmdBlitImage(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
 
         // dst to src
-        ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource, mipSubRange);
+        ImagePipelineBarrier(cmdBuffer, image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource, mipSubRange);
     }
 
     subresourceRange.levelCount = MipLevels;
-    ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferSource, imageLayout, subresourceRange);
-
-    cmdBuffer->End();
-    cmdBuffer->Submit();
+    ImagePipelineBarrier(cmdBuffer, image, ImageLayoutBarrier::TransferSource, imageLayout, subresourceRange);
 
     VkSamplerCreateInfo samplerInfo;
     ZeroVulkanStruct(samplerInfo, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
@@ -529,17 +794,7 @@ Ref<VulkanTexture> VulkanTexture::CreateFrameGraphTexture(Ref<VulkanDevice> vulk
     ImageCreateInfo.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
     ImageCreateInfo.usage           =  VK_IMAGE_USAGE_SAMPLED_BIT | usage;
 
-    VmaAllocationCreateInfo memory_info{};
-    memory_info.usage = VMA_MEMORY_USAGE_AUTO;
-    
-    VkResult vkResult = vmaCreateImage(
-        vulkanDevice->vma_allocator,
-        &ImageCreateInfo,
-        &memory_info,
-        &image,
-        &imageAllocation,
-        nullptr
-    );
+    VkResult vkResult = CreateBudgetedImage(vulkanDevice.get(), ImageCreateInfo, GetImageMemoryCategory(ImageCreateInfo.usage), &image, &imageAllocation);
     
     if(vkResult != VK_SUCCESS)
     {
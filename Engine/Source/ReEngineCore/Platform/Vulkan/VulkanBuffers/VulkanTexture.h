@@ -2,6 +2,9 @@
 #include "Platform/Vulkan/VulkanCommonDefine.h"
 #include "Platform/Vulkan/VulkanDevice.h"
 #include "Platform/Vulkan/VulkanBuffers/VulkanCommandBuffer.h"
+#include "Platform/Vulkan/VulkanResourcePool.h"
+
+#include <source_location>
 
 FORCE_INLINE void SetImageBarrierInfo(ImageLayoutBarrier source, ImageLayoutBarrier dest, VkImageMemoryBarrier& inOutBarrier, VkPipelineStageFlags& inOutSourceStage, VkPipelineStageFlags& inOutDestStage)
 {
@@ -70,6 +73,11 @@ FORCE_INLINE void ImagePipelineBarrier(VkCommandBuffer CommandBuffer,VkImage Ima
 VK_DEFINE_HANDLE( VmaAllocator )
 VK_DEFINE_HANDLE( VmaAllocation )
 
+namespace ReEngine
+{
+    class TextureFile;
+}
+
 class VulkanTexture
 {
 public:
@@ -88,6 +96,26 @@ public:
         VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT
         );
     
+    // 录制命令时用句柄代替Ref<>，第一次调用时注册到句柄池
+    TextureHandle GetHandle();
+
+    // 修改了Image或DescriptorInfo之后同步到句柄池
+    void SyncHandle();
+    
+    // 流式贴图记录写过它的描述符，换Image之后按记录重写
+    void AddDescriptorBinding(VkDescriptorSet set, uint32 binding, uint32 arrayElement, VkDescriptorType type);
+    
+    void RemoveDescriptorBinding(VkDescriptorSet set, uint32 binding, uint32 arrayElement);
+    
+    // 调用时用到这些描述符集的CommandBuffer必须都已经执行完
+    void RewriteDescriptors();
+    
+    // 先申请预算再分配显存，预算分类存在VmaAllocation的UserData里，location记进显存跟踪
+    // canFail时超出硬上限直接返回VK_ERROR_OUT_OF_DEVICE_MEMORY，调用方自己退让
+    static VkResult CreateBudgetedImage(VulkanDevice* vulkanDevice, const VkImageCreateInfo& imageCreateInfo, VulkanMemoryCategory category, VkImage* outImage, VmaAllocation* outAllocation, bool canFail = false, const std::source_location& location = std::source_location::current());
+    
+    static void DestroyBudgetedImage(VulkanDevice* vulkanDevice, VkImage image, VmaAllocation allocation);
+    
     // static Ref<VulkanTexture> Create2DArray(const std::vector<std::string> filenames, std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer);
     // static Ref<VulkanTexture> Create3D(VkFormat format, const uint8* rgbaData, int32 size, int32 width, int32 height, int32 depth, std::shared_ptr<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer);
 
@@ -107,8 +135,23 @@ public:
     ImageLayoutBarrier imageLayout = ImageLayoutBarrier::PixelShaderRead
 );
 
+    /*从Staging创建贴图*/
+    //RGBA数据已经在stagingBuffer的stagingOffset处，只录制拷贝和Blit生成Mip的命令
+    //调用方负责提交，命令执行完之前Staging不能覆盖
+    static Ref<VulkanTexture> Create2DFromStaging(
+        VkCommandBuffer cmdBuffer,
+        VkBuffer stagingBuffer,
+        VkDeviceSize stagingOffset,
+        VkFormat format,
+        int32 width,
+        int32 height,
+        std::shared_ptr<VulkanDevice> vulkanDevice,
+        VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        ImageLayoutBarrier imageLayout = ImageLayoutBarrier::PixelShaderRead
+    );
+
     /*读取一张贴图*/
-    //创建的时候带有数据的
+    //同目录下有烘焙好的.rtex并且设备支持它的格式时优先用它，否则解码原图
     static  Ref<VulkanTexture> Create2D(
         const std::string& filename,
         std::shared_ptr<VulkanDevice> vulkanDevice,
@@ -117,6 +160,18 @@ public:
         ImageLayoutBarrier imageLayout = ImageLayoutBarrier::PixelShaderRead
     );
     
+    /*读取烘焙好的贴图*/
+    //数据已经是GPU格式，带全部Mip，不再解码也不再Blit生成Mip
+    //firstMip大于0时只上传firstMip之后的低精度Mip，Image的第0级就是文件的firstMip级
+    static Ref<VulkanTexture> Create2D(
+        const ReEngine::TextureFile& textureFile,
+        std::shared_ptr<VulkanDevice> vulkanDevice,
+        Ref<VulkanCommandBuffer> cmdBuffer,
+        VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        ImageLayoutBarrier imageLayout = ImageLayoutBarrier::PixelShaderRead,
+        uint32 firstMip = 0
+    );
+    
     /*创建StorageBuffer*/
     //创建的时候没有数据
     static  Ref<VulkanTexture> Create2D(
@@ -193,7 +248,7 @@ public:
     Ref<VulkanDevice> Device = nullptr;
     
     VkImage Image = VK_NULL_HANDLE;
-    VmaAllocation   mVmaAllocation;
+    VmaAllocation   mVmaAllocation = VK_NULL_HANDLE;
     
     VkImageView ImageView = VK_NULL_HANDLE;
     VkImageLayout ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -212,4 +267,20 @@ public:
 
     // 标识此Texture在全局Texture中的序号
     int32 BindlessIndex;
+
+    TextureHandle PoolHandle;
+    
+    struct DescriptorBinding
+    {
+        VkDescriptorSet     Set;
+        uint32              Binding;
+        uint32              ArrayElement;
+        VkDescriptorType    Type;
+    };
+    
+    // 由VulkanTextureStreamer管理Mip常驻
+    bool IsStreamed = false;
+    // 流式Mip每换一次Image加一，缓存录制的Pass要把它算进Key
+    uint32 ResidencyVersion = 0;
+    std::vector<DescriptorBinding> DescriptorBindings;
 };
@@ -0,0 +1,212 @@
+﻿#include "VulkanTransientAllocator.h"
+
+void VulkanTransientAllocator::Create(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 initialSize, uint32 chunkSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags)
+{
+    m_Device              = device;
+    m_UsageFlags          = usageFlags;
+    m_MemoryPropertyFlags = memoryPropertyFlags;
+    m_FrameIndex          = 0;
+    m_LastFrameUsed       = 0;
+    m_HighWater           = 0;
+
+    // 对齐使用设备查询到的值，而不是固定的256
+    const VkPhysicalDeviceLimits& limits = device->GetLimits();
+    VkDeviceSize alignment = 16;
+    if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        alignment = glm::max(alignment, limits.minUniformBufferOffsetAlignment);
+    }
+    if (usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+        alignment = glm::max(alignment, limits.minStorageBufferOffsetAlignment);
+    }
+    if (!(memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        alignment = glm::max(alignment, limits.nonCoherentAtomSize);
+    }
+    m_Alignment = (uint32)alignment;
+    m_ChunkSize = AlignUp(glm::max(chunkSize, m_Alignment), m_Alignment);
+
+    m_FrameChunks.resize(glm::max(numFramesInFlight, 1u));
+    m_FrameUsed.store(0);
+    m_CurrentChunk.store(nullptr);
+
+    CreateBlock(AlignUp(glm::max(initialSize, m_ChunkSize), m_ChunkSize), m_ChunkSize);
+}
+
+void VulkanTransientAllocator::Destroy()
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    m_CurrentChunk.store(nullptr);
+    for (int32 index = 0; index < m_Chunks.size(); ++index) {
+        delete m_Chunks[index];
+    }
+    m_Chunks.clear();
+    m_FreeChunks.clear();
+    m_FrameChunks.clear();
+    m_RetainedChunks.clear();
+    m_ActiveRetain = 0;
+    m_SavedChunk   = nullptr;
+
+    for (int32 index = 0; index < m_Blocks.size(); ++index) {
+        m_Blocks[index].Buffer->UnMap();
+    }
+    m_Blocks.clear();
+    m_Device.reset();
+}
+
+bool VulkanTransientAllocator::Allocate(uint32 size, VulkanTransientAllocation& outAllocation)
+{
+    const uint32 alignedSize = AlignUp(glm::max(size, 1u), m_Alignment);
+
+    while (true)
+    {
+        Chunk* chunk = m_CurrentChunk.load(std::memory_order_acquire);
+        if (chunk)
+        {
+            // 越界的线程只会把Head推过Size，不会影响已经分配出去的区间
+            uint32 head = chunk->Head.fetch_add(alignedSize, std::memory_order_relaxed);
+            if ((uint64)head + alignedSize <= chunk->Size)
+            {
+                outAllocation.Buffer     = chunk->Buffer;
+                outAllocation.Offset     = chunk->Offset + head;
+                outAllocation.Size       = size;
+                outAllocation.MappedData = chunk->MappedData + chunk->Offset + head;
+                outAllocation.BlockIndex = chunk->BlockIndex;
+                m_FrameUsed.fetch_add(alignedSize, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_ChunkLock);
+        // 其它线程可能已经换好了新的Chunk
+        if (m_CurrentChunk.load(std::memory_order_acquire) != chunk) {
+            continue;
+        }
+
+        Chunk* newChunk = AcquireChunk(alignedSize);
+        if (!newChunk)
+        {
+            RE_CORE_ERROR("Ran out of mem for transient buffers, requested {0} bytes", size);
+            return false;
+        }
+
+        if (m_ActiveRetain != 0) {
+            m_RetainedChunks[m_ActiveRetain].push_back(newChunk);
+        }
+        else {
+            m_FrameChunks[m_FrameIndex].push_back(newChunk);
+        }
+        m_CurrentChunk.store(newChunk, std::memory_order_release);
+    }
+}
+
+void VulkanTransientAllocator::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    m_LastFrameUsed = m_FrameUsed.exchange(0);
+    m_HighWater     = glm::max(m_HighWater, m_LastFrameUsed);
+
+    m_FrameIndex = (m_FrameIndex + 1) % m_FrameChunks.size();
+
+    // 这一帧的槽位上一次使用已经是numFramesInFlight帧之前，GPU已经用完
+    std::vector<Chunk*>& retiredChunks = m_FrameChunks[m_FrameIndex];
+    for (int32 index = 0; index < retiredChunks.size(); ++index)
+    {
+        retiredChunks[index]->Head.store(0, std::memory_order_relaxed);
+        m_FreeChunks.push_back(retiredChunks[index]);
+    }
+    retiredChunks.clear();
+
+    m_CurrentChunk.store(nullptr, std::memory_order_release);
+}
+
+uint32 VulkanTransientAllocator::BeginRetain()
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    // 这一帧的Chunk先放一边，保留区从新的Chunk开始，EndRetain之后接着用
+    m_ActiveRetain = m_NextRetain++;
+    m_RetainedChunks[m_ActiveRetain];
+    m_SavedChunk = m_CurrentChunk.exchange(nullptr);
+    return m_ActiveRetain;
+}
+
+void VulkanTransientAllocator::EndRetain()
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    m_ActiveRetain = 0;
+    m_CurrentChunk.store(m_SavedChunk, std::memory_order_release);
+    m_SavedChunk = nullptr;
+}
+
+void VulkanTransientAllocator::ReleaseRetained(uint32 retainId)
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    auto it = m_RetainedChunks.find(retainId);
+    if (it == m_RetainedChunks.end()) {
+        return;
+    }
+
+    // 挂到这一帧上，和这一帧的分配一起在numFramesInFlight帧之后回收
+    std::vector<Chunk*>& frameChunks = m_FrameChunks[m_FrameIndex];
+    frameChunks.insert(frameChunks.end(), it->second.begin(), it->second.end());
+    m_RetainedChunks.erase(it);
+}
+
+VulkanTransientAllocatorStats VulkanTransientAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_ChunkLock);
+
+    VulkanTransientAllocatorStats stats;
+    for (int32 index = 0; index < m_Blocks.size(); ++index) {
+        stats.Capacity += m_Blocks[index].Size;
+    }
+    stats.LastFrameUsed = m_LastFrameUsed;
+    stats.HighWater     = m_HighWater;
+    stats.NumBlocks     = (uint32)m_Blocks.size();
+    stats.NumChunks     = (uint32)m_Chunks.size();
+    stats.NumFreeChunks = (uint32)m_FreeChunks.size();
+    return stats;
+}
+
+VulkanTransientAllocator::Chunk* VulkanTransientAllocator::AcquireChunk(uint32 minSize)
+{
+    for (int32 index = (int32)m_FreeChunks.size() - 1; index >= 0; --index)
+    {
+        Chunk* chunk = m_FreeChunks[index];
+        if (chunk->Size >= minSize)
+        {
+            m_FreeChunks.erase(m_FreeChunks.begin() + index);
+            return chunk;
+        }
+    }
+    return nullptr;
+}
+
+void VulkanTransientAllocator::CreateBlock(uint32 size, uint32 chunkSize)
+{
+    Block block;
+    block.Size   = size;
+    block.Buffer = VulkanBuffer::CreateBuffer(m_Device, m_UsageFlags, m_MemoryPropertyFlags, size);
+    block.Buffer->Map();
+    block.MappedData = (uint8*)block.Buffer->Mapped;
+
+    const uint32 blockIndex = (uint32)m_Blocks.size();
+    m_Blocks.push_back(block);
+
+    for (uint32 offset = 0; offset + chunkSize <= size; offset += chunkSize)
+    {
+        Chunk* chunk = new Chunk();
+        chunk->Buffer     = block.Buffer->Buffer;
+        chunk->MappedData = block.MappedData;
+        chunk->BlockIndex = blockIndex;
+        chunk->Offset     = offset;
+        chunk->Size       = chunkSize;
+        chunk->Head.store(0, std::memory_order_relaxed);
+
+        m_Chunks.push_back(chunk);
+        m_FreeChunks.push_back(chunk);
+    }
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+#include "VulkanBuffer.h"
+#include "Platform/Vulkan/VulkanCommonDefine.h"
+#include "Platform/Vulkan/VulkanDevice.h"
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct VulkanTransientAllocation
+{
+    VkBuffer    Buffer      = VK_NULL_HANDLE;
+    uint32      Offset      = 0;
+    uint32      Size        = 0;
+    void*       MappedData  = nullptr;
+    uint32      BlockIndex  = 0;
+};
+
+struct VulkanTransientAllocatorStats
+{
+    uint64 Capacity         = 0;    // 所有Block的总大小
+    uint64 LastFrameUsed    = 0;    // 上一帧实际分配的字节数
+    uint64 HighWater        = 0;    // 历史单帧分配的最大值
+    uint32 NumBlocks        = 0;
+    uint32 NumChunks        = 0;
+    uint32 NumFreeChunks    = 0;
+};
+
+// 按帧回收的线性分配器，每帧从空闲Chunk里取块顺序分配，N帧之后整块回收
+// 分配走原子递增，多个录制线程可以同时分配；当前Chunk用完时才加锁换块
+// 只有创建时的一个Block，动态描述符直接绑定它；空闲Chunk用完或者单次分配超过ChunkSize时失败
+class VulkanTransientAllocator
+{
+public:
+    ~VulkanTransientAllocator()
+    {
+        Destroy();
+    }
+
+    void Create(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 initialSize, uint32 chunkSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags);
+
+    void Destroy();
+
+    bool Allocate(uint32 size, VulkanTransientAllocation& outAllocation);
+
+    // 只能在没有线程分配的时候调用，回收numFramesInFlight帧之前的Chunk
+    void BeginFrame();
+
+    // BeginRetain到EndRetain之间的分配放进单独的Chunk，不参与按帧回收，直到ReleaseRetained
+    // 用于跨帧复用的CommandBuffer引用的数据；期间不能有别的线程分配，也不能跨过BeginFrame
+    uint32 BeginRetain();
+
+    void EndRetain();
+
+    // 这一帧之后还要等numFramesInFlight帧才会真正回收
+    void ReleaseRetained(uint32 retainId);
+
+    VulkanTransientAllocatorStats GetStats() const;
+
+    FORCE_INLINE uint32 GetAlignment() const
+    {
+        return m_Alignment;
+    }
+
+    FORCE_INLINE uint32 GetChunkSize() const
+    {
+        return m_ChunkSize;
+    }
+
+    FORCE_INLINE VkBuffer GetBuffer(uint32 blockIndex = 0) const
+    {
+        return m_Blocks[blockIndex].Buffer->Buffer;
+    }
+
+private:
+    struct Block
+    {
+        Ref<VulkanBuffer>   Buffer;
+        uint8*              MappedData;
+        uint32              Size;
+    };
+
+    // 无锁分配路径只读Chunk，不访问m_Blocks
+    struct Chunk
+    {
+        VkBuffer            Buffer;
+        uint8*              MappedData;
+        uint32              BlockIndex;
+        uint32              Offset;
+        uint32              Size;
+        std::atomic<uint32> Head;
+    };
+
+    Chunk* AcquireChunk(uint32 minSize);
+
+    void CreateBlock(uint32 size, uint32 chunkSize);
+
+private:
+    Ref<VulkanDevice>                   m_Device = nullptr;
+    VkBufferUsageFlags                  m_UsageFlags = 0;
+    VkMemoryPropertyFlags               m_MemoryPropertyFlags = 0;
+    uint32                              m_Alignment = 256;
+    uint32                              m_ChunkSize = 0;
+    uint32                              m_FrameIndex = 0;
+
+    std::atomic<Chunk*>                 m_CurrentChunk { nullptr };
+    std::atomic<uint64>                 m_FrameUsed { 0 };
+
+    mutable std::mutex                  m_ChunkLock;
+    std::vector<Block>                  m_Blocks;
+    std::vector<Chunk*>                 m_Chunks;
+    std::vector<Chunk*>                 m_FreeChunks;
+    std::vector<std::vector<Chunk*>>    m_FrameChunks;
+
+    uint64                              m_LastFrameUsed = 0;
+    uint64                              m_HighWater = 0;
+
+    // 0表示当前不在保留区里分配
+    uint32                              m_ActiveRetain = 0;
+    uint32                              m_NextRetain = 1;
+    Chunk*                              m_SavedChunk = nullptr;
+    std::unordered_map<uint32, std::vector<Chunk*>> m_RetainedChunks;
+};
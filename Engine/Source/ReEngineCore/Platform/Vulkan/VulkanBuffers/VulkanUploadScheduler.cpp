@@ -0,0 +1,503 @@
+﻿#include "VulkanUploadScheduler.h"
+#include "Platform/Vulkan/VulkanDevice.h"
+#include "vk_mem_alloc.h"
+
+#include <algorithm>
+
+void VulkanUploadScheduler::Init(VulkanDevice* device, uint64 frameBudget)
+{
+    m_Device        = device;
+    m_TransferQueue = device->GetTransferQueue().get();
+    m_FrameQueue    = device->GetPresentQueue().get();
+    m_SlotCapacity  = frameBudget;
+    m_FrameBudget   = frameBudget;
+    m_NextSlot      = 0;
+
+    VkCommandPoolCreateInfo cmdPoolInfo;
+    ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    cmdPoolInfo.queueFamilyIndex = m_TransferQueue->GetFamilyIndex();
+    VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_TransferPool));
+    cmdPoolInfo.queueFamilyIndex = m_FrameQueue->GetFamilyIndex();
+    VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_FramePool));
+
+    void* mapped = nullptr;
+    if (!CreateStaging(m_SlotCapacity * MAX_BATCHES_IN_FLIGHT, m_StagingBuffer, m_StagingAllocation, m_StagingMemoryType, m_StagingSize, &mapped, false))
+    {
+        RE_CORE_ERROR("Failed to create upload staging, size {0}", m_SlotCapacity * MAX_BATCHES_IN_FLIGHT);
+        m_SlotCapacity = 0;
+        return;
+    }
+    m_StagingMapped = (uint8*)mapped;
+
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index)
+    {
+        Slot& slot = m_Slots[index];
+        slot.TransferCmdBuffer = AllocateCommandBuffer(m_TransferPool);
+        slot.AcquireCmdBuffer  = AllocateCommandBuffer(m_FramePool);
+        slot.StagingOffset     = index * m_SlotCapacity;
+    }
+}
+
+void VulkanUploadScheduler::Destroy()
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Device) {
+        return;
+    }
+
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index) {
+        RetireSlot(m_Slots[index], true);
+    }
+
+    // 还没提交的直接丢掉，目标Buffer也在销毁
+    m_Pending.clear();
+    m_Queue = {};
+    m_QueuedBytes = 0;
+
+    // 销毁Pool时一起释放其中的CommandBuffer
+    VkDevice device = m_Device->GetInstanceHandle();
+    vkDestroyCommandPool(device, m_TransferPool, VULKAN_CPU_ALLOCATOR);
+    vkDestroyCommandPool(device, m_FramePool, VULKAN_CPU_ALLOCATOR);
+    m_TransferPool = VK_NULL_HANDLE;
+    m_FramePool    = VK_NULL_HANDLE;
+
+    if (m_StagingBuffer != VK_NULL_HANDLE) {
+        DestroyStaging(m_StagingBuffer, m_StagingAllocation, m_StagingMemoryType, m_StagingSize);
+    }
+    m_StagingBuffer = VK_NULL_HANDLE;
+    m_StagingMapped = nullptr;
+    m_Device        = nullptr;
+}
+
+VulkanUploadRequest VulkanUploadScheduler::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VulkanUploadPriority priority)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    const VulkanUploadRequest id = m_NextRequest++;
+
+    Request& request = m_Pending[id];
+    request.DstBuffer   = dstBuffer;
+    request.DstOffset   = dstOffset;
+    request.Data.assign((const uint8*)data, (const uint8*)data + size);
+    request.EnqueueTime = Clock::now();
+
+    m_Queue.push({ priority, id });
+    m_QueuedBytes += size;
+    return id;
+}
+
+void VulkanUploadScheduler::Tick()
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Device) {
+        return;
+    }
+
+    RetireCompleted();
+
+    m_TickCount        += 1;
+    m_RequestsLastFrame = 0;
+    m_BytesLastFrame    = 0;
+
+    if (m_Pending.empty())
+    {
+        // 剩下的都是丢弃过的
+        m_Queue = {};
+        return;
+    }
+
+    Slot& slot = m_Slots[m_NextSlot];
+    if (slot.FinalPoint != 0 || m_StagingMapped == nullptr) {
+        return;
+    }
+
+    VkBuffer srcBuffer = m_StagingBuffer;
+    std::vector<VkBuffer> dstBuffers;
+    std::vector<VkBufferCopy> regions;
+    std::vector<QueueEntry> deferred;
+    VkDeviceSize used = 0;
+
+    while (!m_Queue.empty())
+    {
+        const QueueEntry entry = m_Queue.top();
+        auto it = m_Pending.find(entry.Request);
+        if (it == m_Pending.end())
+        {
+            m_Queue.pop();
+            continue;
+        }
+
+        Request& request = it->second;
+        const VkDeviceSize size   = request.Data.size();
+        const VkDeviceSize offset = AlignUp(used, (VkDeviceSize)COPY_OFFSET_ALIGNMENT);
+        const bool oversized      = size > m_SlotCapacity;
+
+        // 还在退避的推迟请求先放一边，不占这一批
+        if (request.RetryTick > m_TickCount)
+        {
+            m_Queue.pop();
+            deferred.push_back(entry);
+            continue;
+        }
+
+        // 超出预算的留到下一帧；比预算大的请求单独成一批，不会一直排不上
+        if (regions.size() > 0 && (oversized || offset + size > m_FrameBudget)) {
+            break;
+        }
+        m_Queue.pop();
+
+        VkBufferCopy region;
+        region.dstOffset = request.DstOffset;
+        region.size      = size;
+
+        if (oversized)
+        {
+            void* mapped = nullptr;
+            if (!CreateStaging(size, slot.DedicatedBuffer, slot.DedicatedAllocation, slot.DedicatedMemoryType, slot.DedicatedSize, &mapped, true))
+            {
+                // 超预算时推迟，间隔翻倍再试，后面的请求照常上传
+                if (request.DeferCount == 0) {
+                    RE_CORE_WARN("Deferred upload staging, size {0}", size);
+                }
+                request.RetryTick   = m_TickCount + std::min<uint64>((uint64)1 << std::min<uint32>(request.DeferCount, 31), MAX_DEFER_BACKOFF);
+                request.DeferCount += 1;
+                deferred.push_back(entry);
+                continue;
+            }
+            memcpy(mapped, request.Data.data(), size);
+            vmaFlushAllocation(m_Device->vma_allocator, slot.DedicatedAllocation, 0, size);
+
+            srcBuffer        = slot.DedicatedBuffer;
+            region.srcOffset = 0;
+        }
+        else
+        {
+            memcpy(m_StagingMapped + slot.StagingOffset + offset, request.Data.data(), size);
+            vmaFlushAllocation(m_Device->vma_allocator, m_StagingAllocation, slot.StagingOffset + offset, size);
+
+            region.srcOffset = slot.StagingOffset + offset;
+            used = offset + size;
+        }
+
+        regions.push_back(region);
+        dstBuffers.push_back(request.DstBuffer);
+        slot.Requests.push_back(entry.Request);
+        slot.EnqueueTimes.push_back(request.EnqueueTime);
+
+        m_QueuedBytes       -= size;
+        m_BytesLastFrame    += size;
+        m_RequestsLastFrame += 1;
+        m_Pending.erase(it);
+
+        if (oversized || used >= m_FrameBudget) {
+            break;
+        }
+    }
+
+    for (const QueueEntry& entry : deferred) {
+        m_Queue.push(entry);
+    }
+
+    if (regions.empty()) {
+        return;
+    }
+
+    SubmitBatch(slot, srcBuffer, dstBuffers, regions);
+    m_TotalBytes += m_BytesLastFrame;
+    m_NextSlot    = (m_NextSlot + 1) % MAX_BATCHES_IN_FLIGHT;
+}
+
+bool VulkanUploadScheduler::IsSubmitted(VulkanUploadRequest request)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Pending.find(request) == m_Pending.end();
+}
+
+bool VulkanUploadScheduler::IsComplete(VulkanUploadRequest request)
+{
+    if (request == 0) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (m_Pending.find(request) != m_Pending.end()) {
+        return false;
+    }
+
+    RetireCompleted();
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index)
+    {
+        const std::vector<VulkanUploadRequest>& requests = m_Slots[index].Requests;
+        if (std::find(requests.begin(), requests.end(), request) != requests.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VulkanUploadScheduler::Discard(VulkanUploadRequest request, VkBuffer dstBuffer, VmaAllocation dstAllocation)
+{
+    if (request == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    auto it = m_Pending.find(request);
+    if (it != m_Pending.end())
+    {
+        m_QueuedBytes -= it->second.Data.size();
+        m_Pending.erase(it);
+        return false;
+    }
+
+    // 已经完成的批次顺便退休，目标可以直接释放
+    RetireCompleted();
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index)
+    {
+        Slot& slot = m_Slots[index];
+        if (std::find(slot.Requests.begin(), slot.Requests.end(), request) != slot.Requests.end())
+        {
+            slot.DiscardedBuffers.push_back(dstBuffer);
+            slot.DiscardedAllocations.push_back(dstAllocation);
+            return true;
+        }
+    }
+    return false;
+}
+
+void VulkanUploadScheduler::SetFrameBudget(uint64 frameBudget)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_FrameBudget = Clamp<uint64>(frameBudget, COPY_OFFSET_ALIGNMENT, m_SlotCapacity);
+}
+
+uint64 VulkanUploadScheduler::GetFrameBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_FrameBudget;
+}
+
+VulkanUploadStats VulkanUploadScheduler::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    VulkanUploadStats stats;
+    stats.FrameBudget       = m_FrameBudget;
+    stats.QueueDepth        = (uint32)m_Pending.size();
+    stats.QueuedBytes       = m_QueuedBytes;
+    stats.RequestsLastFrame = m_RequestsLastFrame;
+    stats.BytesLastFrame    = m_BytesLastFrame;
+    stats.AvgLatencyMs      = m_AvgLatencyMs;
+    stats.MaxLatencyMs      = m_MaxLatencyMs;
+    stats.NumCompleted      = m_NumCompleted;
+    stats.TotalBytes        = m_TotalBytes;
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index)
+    {
+        if (m_Slots[index].FinalPoint != 0) {
+            stats.NumInFlight += 1;
+        }
+    }
+    return stats;
+}
+
+bool VulkanUploadScheduler::CreateStaging(VkDeviceSize size, VkBuffer& outBuffer, VmaAllocation& outAllocation, uint32& outMemoryType, VkDeviceSize& outSize, void** outMapped, bool canFail)
+{
+    VkBufferCreateInfo bufferCreateInfo;
+    ZeroVulkanStruct(bufferCreateInfo, VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO);
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.size  = size;
+
+    const VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VulkanDeviceMemoryManager& memoryManager = m_Device->GetMemoryManager();
+    if (!memoryManager.RequestBudget(memoryManager.GetHeapIndexFromProperties(memoryPropertyFlags), size, canFail))
+    {
+        outBuffer     = VK_NULL_HANDLE;
+        outAllocation = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VmaAllocationCreateInfo memoryInfo{};
+    memoryInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    memoryInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    memoryInfo.pUserData = (void*)(uintptr_t)VulkanMemoryCategory::Staging;
+
+    VmaAllocationInfo allocationInfo;
+    VkResult result = vmaCreateBuffer(m_Device->vma_allocator, &bufferCreateInfo, &memoryInfo, &outBuffer, &outAllocation, &allocationInfo);
+    if (result != VK_SUCCESS)
+    {
+        outBuffer     = VK_NULL_HANDLE;
+        outAllocation = VK_NULL_HANDLE;
+        return false;
+    }
+
+    outMemoryType = allocationInfo.memoryType;
+    outSize       = allocationInfo.size;
+    *outMapped    = allocationInfo.pMappedData;
+    memoryManager.TrackResource(VulkanMemoryCategory::Staging, allocationInfo.memoryType, allocationInfo.size, outAllocation, __FILE__, __LINE__);
+    return true;
+}
+
+void VulkanUploadScheduler::DestroyStaging(VkBuffer buffer, VmaAllocation allocation, uint32 memoryType, VkDeviceSize size)
+{
+    m_Device->GetMemoryManager().UntrackResource(VulkanMemoryCategory::Staging, memoryType, size, allocation);
+    vmaDestroyBuffer(m_Device->vma_allocator, buffer, allocation);
+}
+
+void VulkanUploadScheduler::SubmitBatch(Slot& slot, VkBuffer srcBuffer, const std::vector<VkBuffer>& dstBuffers, const std::vector<VkBufferCopy>& regions)
+{
+    const bool separateFamily = m_TransferQueue->GetFamilyIndex() != m_FrameQueue->GetFamilyIndex();
+    const VkAccessFlags readAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    std::vector<VkBufferMemoryBarrier> barriers;
+    if (separateFamily)
+    {
+        barriers.resize(regions.size());
+        for (int32 index = 0; index < regions.size(); ++index)
+        {
+            VkBufferMemoryBarrier& barrier = barriers[index];
+            ZeroVulkanStruct(barrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
+            barrier.srcQueueFamilyIndex = m_TransferQueue->GetFamilyIndex();
+            barrier.dstQueueFamilyIndex = m_FrameQueue->GetFamilyIndex();
+            barrier.buffer              = dstBuffers[index];
+            barrier.offset              = regions[index].dstOffset;
+            barrier.size                = regions[index].size;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo;
+    ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkCommandBuffer cmdBuffer = slot.TransferCmdBuffer;
+    vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+
+    for (int32 index = 0; index < regions.size(); ++index) {
+        vkCmdCopyBuffer(cmdBuffer, srcBuffer, dstBuffers[index], 1, &regions[index]);
+    }
+
+    if (separateFamily)
+    {
+        // Release，Acquire录在帧队列上
+        for (int32 index = 0; index < barriers.size(); ++index)
+        {
+            barriers[index].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barriers[index].dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, (uint32)barriers.size(), barriers.data(), 0, nullptr);
+    }
+    else
+    {
+        // 传输队列和帧队列可能是同一个，这时只靠提交顺序和这个Barrier
+        VkMemoryBarrier barrier;
+        ZeroVulkanStruct(barrier, VK_STRUCTURE_TYPE_MEMORY_BARRIER);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = readAccess;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    vkEndCommandBuffer(cmdBuffer);
+
+    const uint64 transferPoint = m_TransferQueue->Submit(1, &cmdBuffer);
+
+    // 帧队列后面的提交在GPU上等这批拷贝，CPU不等
+    m_FrameQueue->AddWait(*m_TransferQueue, transferPoint, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    if (separateFamily)
+    {
+        for (int32 index = 0; index < barriers.size(); ++index)
+        {
+            barriers[index].srcAccessMask = 0;
+            barriers[index].dstAccessMask = readAccess;
+        }
+
+        cmdBuffer = slot.AcquireCmdBuffer;
+        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, (uint32)barriers.size(), barriers.data(), 0, nullptr);
+        vkEndCommandBuffer(cmdBuffer);
+
+        slot.FinalQueue = m_FrameQueue;
+        slot.FinalPoint = m_FrameQueue->Submit(1, &cmdBuffer);
+    }
+    else
+    {
+        slot.FinalQueue = m_TransferQueue;
+        slot.FinalPoint = transferPoint;
+    }
+}
+
+bool VulkanUploadScheduler::RetireSlot(Slot& slot, bool wait)
+{
+    if (slot.FinalPoint == 0) {
+        return false;
+    }
+
+    if (wait)
+    {
+        slot.FinalQueue->WaitFor(slot.FinalPoint);
+    }
+    else if (!slot.FinalQueue->IsComplete(slot.FinalPoint))
+    {
+        return false;
+    }
+
+    const Clock::time_point now = Clock::now();
+    float maxLatency = 0.0f;
+    for (int32 index = 0; index < slot.EnqueueTimes.size(); ++index)
+    {
+        const float latency = std::chrono::duration<float, std::milli>(now - slot.EnqueueTimes[index]).count();
+        maxLatency = latency > maxLatency ? latency : maxLatency;
+        // 滑动平均，第一个样本直接用
+        m_AvgLatencyMs = m_NumCompleted == 0 ? latency : m_AvgLatencyMs * 0.9f + latency * 0.1f;
+        m_NumCompleted += 1;
+    }
+    m_MaxLatencyMs = maxLatency;
+
+    if (slot.DedicatedBuffer != VK_NULL_HANDLE)
+    {
+        DestroyStaging(slot.DedicatedBuffer, slot.DedicatedAllocation, slot.DedicatedMemoryType, slot.DedicatedSize);
+        slot.DedicatedBuffer     = VK_NULL_HANDLE;
+        slot.DedicatedAllocation = VK_NULL_HANDLE;
+    }
+
+    // 拷贝已经完成，之前录制的帧可能还在读，照常按帧延迟释放
+    VulkanResourceHeapManager& heapManager = m_Device->GetResourceHeapManager();
+    for (int32 index = 0; index < slot.DiscardedBuffers.size(); ++index) {
+        heapManager.DeferReleaseVmaBuffer(slot.DiscardedBuffers[index], slot.DiscardedAllocations[index]);
+    }
+    slot.DiscardedBuffers.clear();
+    slot.DiscardedAllocations.clear();
+
+    slot.Requests.clear();
+    slot.EnqueueTimes.clear();
+    slot.FinalQueue = nullptr;
+    slot.FinalPoint = 0;
+    return true;
+}
+
+void VulkanUploadScheduler::RetireCompleted()
+{
+    for (uint32 index = 0; index < MAX_BATCHES_IN_FLIGHT; ++index) {
+        RetireSlot(m_Slots[index], false);
+    }
+}
+
+VkCommandBuffer VulkanUploadScheduler::AllocateCommandBuffer(VkCommandPool pool)
+{
+    VkCommandBufferAllocateInfo allocInfo;
+    ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+    allocInfo.commandPool        = pool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+    VERIFYVULKANRESULT(vkAllocateCommandBuffers(m_Device->GetInstanceHandle(), &allocInfo, &cmdBuffer));
+    return cmdBuffer;
+}
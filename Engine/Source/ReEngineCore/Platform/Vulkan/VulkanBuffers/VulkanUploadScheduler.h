@@ -0,0 +1,191 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Platform/Vulkan/VulkanCommonDefine.h"
+
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+VK_DEFINE_HANDLE( VmaAllocation )
+
+class VulkanDevice;
+class VulkanQueue;
+
+// 上传请求的编号，按入队顺序递增，0表示没有请求
+typedef uint64 VulkanUploadRequest;
+
+// Immediate走Staging环，和现在一样在这一帧提交；其它的进传输队列的调度器，按优先级排队
+enum class VulkanUploadPriority : uint8
+{
+    Immediate = 0,
+    High,
+    Normal,
+    Low,
+};
+
+struct VulkanUploadStats
+{
+    uint64 FrameBudget          = 0;
+    uint32 QueueDepth           = 0;    // 还在排队的请求
+    uint64 QueuedBytes          = 0;
+    uint32 NumInFlight          = 0;    // 已提交但GPU还没完成的批次
+    uint32 RequestsLastFrame    = 0;    // 上一次Tick提交的请求数
+    uint64 BytesLastFrame       = 0;    // 上一次Tick提交的字节数
+    float  AvgLatencyMs         = 0.0f; // 入队到GPU完成，按帧轮询，精度是一帧
+    float  MaxLatencyMs         = 0.0f; // 最近退休的一批里最长的
+    uint64 NumCompleted         = 0;
+    uint64 TotalBytes           = 0;
+};
+
+// 传输队列上的上传调度：请求入队时只拷贝一份CPU数据，每帧Tick按优先级取出不超过预算的一批
+// 拷贝到常驻映射的Staging槽位后在传输队列提交，不同队列族时做所有权转移，帧的图形队列在GPU上等它
+// 同一优先级按入队顺序提交；Tick之后IsSubmitted的请求，后面录制的命令就可以读
+class VulkanUploadScheduler
+{
+public:
+    enum
+    {
+        DEFAULT_FRAME_BUDGET  = 8 * 1024 * 1024,
+        MAX_BATCHES_IN_FLIGHT = 3,
+    };
+
+    // frameBudget同时是每个Staging槽位的大小，之后SetFrameBudget不能超过它
+    void Init(VulkanDevice* device, uint64 frameBudget);
+
+    void Destroy();
+
+    VulkanUploadRequest UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VulkanUploadPriority priority);
+
+    // 每帧调用一次：回收完成的批次，再提交一批；槽位都在用时不阻塞，留到下一帧
+    void Tick();
+
+    // 已经提交到GPU，之后提交的命令可以读
+    bool IsSubmitted(VulkanUploadRequest request);
+
+    // GPU已经拷贝完成
+    bool IsComplete(VulkanUploadRequest request);
+
+    // 目标销毁时调用，还在排队的直接丢掉，返回false，由调用方自己释放目标
+    // 已提交的不等GPU，目标交给这一批，退休时再走ResourceHeapManager的延迟释放，返回true
+    bool Discard(VulkanUploadRequest request, VkBuffer dstBuffer, VmaAllocation dstAllocation);
+
+    void SetFrameBudget(uint64 frameBudget);
+
+    uint64 GetFrameBudget() const;
+
+    VulkanUploadStats GetStats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request
+    {
+        VkBuffer                DstBuffer = VK_NULL_HANDLE;
+        VkDeviceSize            DstOffset = 0;
+        std::vector<uint8>      Data;
+        Clock::time_point       EnqueueTime;
+
+        // 独立Staging超预算时推迟的次数，只在第一次时警告；RetryTick之前不再尝试
+        uint32                  DeferCount = 0;
+        uint64                  RetryTick = 0;
+    };
+
+    struct QueueEntry
+    {
+        VulkanUploadPriority    Priority;
+        VulkanUploadRequest     Request;
+    };
+
+    // 优先级高的先出，同一优先级编号小的先出
+    struct QueueOrder
+    {
+        bool operator()(const QueueEntry& a, const QueueEntry& b) const
+        {
+            if (a.Priority != b.Priority) {
+                return a.Priority > b.Priority;
+            }
+            return a.Request > b.Request;
+        }
+    };
+
+    struct Slot
+    {
+        VkCommandBuffer                     TransferCmdBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer                     AcquireCmdBuffer = VK_NULL_HANDLE;
+        VkDeviceSize                        StagingOffset = 0;
+
+        // 不在飞行中时为0；不同队列族时是帧队列上Acquire的值，否则是传输队列的值
+        VulkanQueue*                        FinalQueue = nullptr;
+        uint64                              FinalPoint = 0;
+
+        std::vector<VulkanUploadRequest>    Requests;
+        std::vector<Clock::time_point>      EnqueueTimes;
+
+        // 批次飞行中被丢弃的目标，退休时交给ResourceHeapManager
+        std::vector<VkBuffer>               DiscardedBuffers;
+        std::vector<VmaAllocation>          DiscardedAllocations;
+
+        // 比预算还大的请求单独建Staging，批次退休时释放
+        VkBuffer                            DedicatedBuffer = VK_NULL_HANDLE;
+        VmaAllocation                       DedicatedAllocation = VK_NULL_HANDLE;
+        uint32                              DedicatedMemoryType = 0;
+        VkDeviceSize                        DedicatedSize = 0;
+    };
+
+    // canFail时超出预算硬上限返回false
+    bool CreateStaging(VkDeviceSize size, VkBuffer& outBuffer, VmaAllocation& outAllocation, uint32& outMemoryType, VkDeviceSize& outSize, void** outMapped, bool canFail);
+
+    void DestroyStaging(VkBuffer buffer, VmaAllocation allocation, uint32 memoryType, VkDeviceSize size);
+
+    void SubmitBatch(Slot& slot, VkBuffer srcBuffer, const std::vector<VkBuffer>& dstBuffers, const std::vector<VkBufferCopy>& regions);
+
+    bool RetireSlot(Slot& slot, bool wait);
+
+    void RetireCompleted();
+
+    VkCommandBuffer AllocateCommandBuffer(VkCommandPool pool);
+
+private:
+    enum
+    {
+        COPY_OFFSET_ALIGNMENT = 16,
+        // 推迟的请求重试间隔按次数翻倍，最多隔这么多次Tick
+        MAX_DEFER_BACKOFF = 64,
+    };
+
+    VulkanDevice*                   m_Device = nullptr;
+    VulkanQueue*                    m_TransferQueue = nullptr;
+    // 帧的CommandBuffer提交在PresentQueue上，资源最后归它的队列族
+    VulkanQueue*                    m_FrameQueue = nullptr;
+    VkCommandPool                   m_TransferPool = VK_NULL_HANDLE;
+    VkCommandPool                   m_FramePool = VK_NULL_HANDLE;
+
+    VkBuffer                        m_StagingBuffer = VK_NULL_HANDLE;
+    VmaAllocation                   m_StagingAllocation = VK_NULL_HANDLE;
+    uint32                          m_StagingMemoryType = 0;
+    VkDeviceSize                    m_StagingSize = 0;
+    uint8*                          m_StagingMapped = nullptr;
+
+    VkDeviceSize                    m_SlotCapacity = 0;
+    uint64                          m_FrameBudget = 0;
+    Slot                            m_Slots[MAX_BATCHES_IN_FLIGHT];
+    uint32                          m_NextSlot = 0;
+    uint64                          m_TickCount = 0;
+
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, QueueOrder> m_Queue;
+    // 丢弃的请求只从这里删掉，出队时跳过
+    std::unordered_map<VulkanUploadRequest, Request> m_Pending;
+    VulkanUploadRequest             m_NextRequest = 1;
+    uint64                          m_QueuedBytes = 0;
+
+    uint32                          m_RequestsLastFrame = 0;
+    uint64                          m_BytesLastFrame = 0;
+    float                           m_AvgLatencyMs = 0.0f;
+    float                           m_MaxLatencyMs = 0.0f;
+    uint64                          m_NumCompleted = 0;
+    uint64                          m_TotalBytes = 0;
+
+    mutable std::mutex              m_Lock;
+};
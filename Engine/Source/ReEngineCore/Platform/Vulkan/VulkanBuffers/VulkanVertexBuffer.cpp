@@ -59,7 +59,7 @@ std::vector<VkVertexInputAttributeDescription> VulkanVertexBuffer::GetInputAttri
     return vertexInputAttributs;
 }
 
-Ref<VulkanVertexBuffer> VulkanVertexBuffer::Create(std::shared_ptr<VulkanDevice> device, Ref<VulkanCommandBuffer> cmdBuffer,std::vector<float> vertices, const std::vector<VertexAttribute>& attributes)
+Ref<VulkanVertexBuffer> VulkanVertexBuffer::Create(std::shared_ptr<VulkanDevice> device, Ref<VulkanCommandBuffer> cmdBuffer,std::vector<float> vertices, const std::vector<VertexAttribute>& attributes, VulkanUploadPriority priority)
 {
     Ref<VulkanVertexBuffer> VertexBuffer = CreateRef<VulkanVertexBuffer>();
 
@@ -68,19 +68,15 @@ Ref<VulkanVertexBuffer> VulkanVertexBuffer::Create(std::shared_ptr<VulkanDevice>
     
     VkDeviceSize VertexbufferSize = vertices.size() * sizeof(float);
 
-   auto stagingIndexBuffer = VulkanBuffer::CreateBuffer(
-            device,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            VertexbufferSize,(void*)vertices.data());
-    
+    //TRANSFER_SRC给碎片整理搬家用
     VertexBuffer->Buffer = VulkanBuffer::CreateBuffer(
              device,
-             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ,
              VertexbufferSize);
 
-    VulkanBuffer::TransferBuffer(device,cmdBuffer,stagingIndexBuffer,VertexBuffer->Buffer,VertexbufferSize);
+    //Immediate拷贝进Staging环，和其它上传一起在Flush时提交；否则进传输队列排队
+    VertexBuffer->Buffer->UploadAsync(vertices.data(), VertexbufferSize, priority);
     
     return VertexBuffer;
 }
@@ -23,7 +23,7 @@ public:
 
     std::vector<VkVertexInputAttributeDescription> GetInputAttributes(const std::vector<VertexAttribute>& shaderInputs = std::vector<VertexAttribute>());
 
-    static Ref<VulkanVertexBuffer> Create(std::shared_ptr<VulkanDevice> device, Ref<VulkanCommandBuffer> cmdBuffer, std::vector<float> vertices, const std::vector<VertexAttribute>& attributes);
+    static Ref<VulkanVertexBuffer> Create(std::shared_ptr<VulkanDevice> device, Ref<VulkanCommandBuffer> cmdBuffer, std::vector<float> vertices, const std::vector<VertexAttribute>& attributes, VulkanUploadPriority priority = VulkanUploadPriority::Immediate);
     
     VkDevice                        Device = VK_NULL_HANDLE;
     VkDeviceSize                    Offset = 0;
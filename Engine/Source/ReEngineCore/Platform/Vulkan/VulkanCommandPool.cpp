@@ -1,6 +1,8 @@
 ﻿#include "VulkanCommandPool.h"
 #include "Core/Application.h"
 #include "VulkanContext.h"
+#include "VulkanBuffers/VulkanStagingManager.h"
+#include "VulkanBuffers/VulkanUploadScheduler.h"
 #include "Renderer/RHI/Renderer.h"
 
 namespace ReEngine
@@ -17,6 +19,8 @@ void VulkanCommandPool::Init(VulkanContext* Context)
     m_PresentQueue  = vulkanDevice->GetPresentQueue()->GetHandle();
     m_FrameWidth    = Instance->GetWidth();
     m_FrameHeight   = Instance->GetHeight();
+    m_FrameIndex    = 0;
+    m_ImageIndex    = 0;
         
     CreateFences();
     CreateCommandBuffers();
@@ -27,44 +31,77 @@ void VulkanCommandPool::Init(VulkanContext* Context)
 void VulkanCommandPool::Present(int backBufferIndex)
 {
     if(backBufferIndex < 0) backBufferIndex = 0;
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pWaitDstStageMask    = &m_WaitStageMask;
-    submitInfo.pWaitSemaphores      = &m_PresentComplete;
-    submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.pSignalSemaphores    = &m_RenderComplete;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pCommandBuffers      = &(m_CommandBuffers[backBufferIndex]);
-    submitInfo.commandBufferCount   = 1;
-
-    //Fence保证在队列没有提交完成之前，cpu不会执行下面的代码，挡住的是CPU，不是GPU，Semaphore才是挡住GPU
-    vkResetFences(m_Device, 1, &(m_Fences[m_FrameIndex]));
-    VERIFYVULKANRESULT(vkQueueSubmit(m_PresentQueue, 1, &submitInfo, m_Fences[backBufferIndex]));
-    vkWaitForFences(m_Device, 1, &(m_Fences[m_FrameIndex]), true, ((uint64)	0xffffffffffffffff));
+
+    // 先把这一帧之前的上传提交掉，同一队列上按提交顺序执行
+    VulkanStagingManager& StagingManager = m_VulkanDevice->GetStagingManager();
+    StagingManager.Flush();
+
+    VulkanQueue& GfxQueue     = *m_VulkanDevice->GetGraphicsQueue();
+    VulkanQueue& PresentQueue = *m_VulkanDevice->GetPresentQueue();
+    // 在别的队列上提交时，让GPU等图形队列上的上传，不再阻塞CPU
+    PresentQueue.AddWait(GfxQueue, GfxQueue.GetLastSubmitted(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    //这里不再等待，下次复用这个槽位时才会在Acquire里等它的时间线值
+    //离屏时没有Acquire和Present，图像的复用只靠时间线
+    const uint32 numSwapSemaphores = m_SwapChain->IsHeadless() ? 0 : 1;
+    m_FramePoints[m_FrameIndex] = PresentQueue.Submit(1, &(m_CommandBuffers[m_FrameIndex]),
+                                                      numSwapSemaphores, &m_PresentComplete, &m_WaitStageMask,
+                                                      numSwapSemaphores, &(m_RenderComplete[backBufferIndex]));
+    m_ImagePoints[backBufferIndex] = m_FramePoints[m_FrameIndex];
     
     // present会等待RenderComplete Semaphore
-    m_SwapChain->Present(*m_VulkanDevice->GetGraphicsQueue(),*m_VulkanDevice->GetPresentQueue() , &m_RenderComplete);
+    m_SwapChain->Present(GfxQueue, PresentQueue, &(m_RenderComplete[backBufferIndex]));
+
+    StagingManager.Tick();
+
+    // 帧已经提交，传输队列上的这一批和它并行，下一帧的提交在GPU上等
+    m_VulkanDevice->GetUploadScheduler().Tick();
+
+    m_FrameNumber += 1;
+    m_FrameIndex   = (m_FrameIndex + 1) % m_NumFramesInFlight;
 }
 
 int32 VulkanCommandPool::AcquireBackbufferIndex()
 {
-    //当前帧的序号
-    //这一帧提交等待的semaphore
-    //渲染指令提交会固定signal RenderComplete
+    //等这个槽位上一次提交的帧，保证它的CommandBuffer和Semaphore可以复用
+    //其它槽位的帧还可以在GPU上跑，CPU同时录制这一帧
+    VulkanQueue& PresentQueue = *m_VulkanDevice->GetPresentQueue();
+    PresentQueue.WaitFor(m_FramePoints[m_FrameIndex]);
+
+    //等到了这个槽位的时间线值，m_NumFramesInFlight帧之前及更早的帧都已执行完，归还它们延迟释放的内存
+    VulkanResourceHeapManager& HeapManager = m_VulkanDevice->GetResourceHeapManager();
+    if (m_FrameNumber >= m_NumFramesInFlight) {
+        HeapManager.ProcessPendingReleases(m_FrameNumber - m_NumFramesInFlight);
+    }
+    HeapManager.BeginFrame(m_FrameNumber);
+
     //这一帧需要等待这个PresentCompelete才可以渲染
-    int32 backBufferIndex = m_SwapChain->AcquireImageIndex(&m_PresentComplete);
+    //渲染指令提交会Signal这张图像的RenderComplete
+    m_PresentComplete = m_ImageAcquired[m_FrameIndex];
+    int32 backBufferIndex = m_SwapChain->AcquireImageIndex(m_PresentComplete);
 
     if(backBufferIndex < 0 )
     {
-        m_FrameIndex = 0;
         auto Context = Renderer::GetContext().get();
         auto VulkanContext = dynamic_cast<ReEngine::VulkanContext*>(Context);
         VulkanContext-> RecreateSwapChain();
+
+        //重建之后槽位和Semaphore都是新的，再Acquire一次
+        m_PresentComplete = m_ImageAcquired[m_FrameIndex];
+        backBufferIndex = m_SwapChain->AcquireImageIndex(m_PresentComplete);
+        if (backBufferIndex < 0)
+        {
+            m_ImageIndex = 0;
+            return backBufferIndex;
+        }
     }
 
-    m_FrameIndex =  backBufferIndex;
+    m_ImageIndex = backBufferIndex;
+
+    //交换链图像数和帧数不一致时，这张图像可能还被另一个槽位的帧使用
+    PresentQueue.WaitFor(m_ImagePoints[m_ImageIndex]);
     
-    return m_FrameIndex;
+    return m_ImageIndex;
 }
 
 uint32 VulkanCommandPool::GetMemoryTypeFromProperties(uint32 typeBits, VkMemoryPropertyFlags properties)
@@ -104,7 +141,8 @@ void VulkanCommandPool::CreateCommandBuffers()
     cmdBufferInfo.commandBufferCount = 1;
     cmdBufferInfo.commandPool        = m_CommandPool;
 
-    m_CommandBuffers.resize(m_SwapChain->GetBackBufferCount());
+    //每个帧槽位一个，vkBeginCommandBuffer时隐式Reset
+    m_CommandBuffers.resize(m_NumFramesInFlight);
     for (int32 i = 0; i < m_CommandBuffers.size(); ++i)
     {
         vkAllocateCommandBuffers(device, &cmdBufferInfo, &(m_CommandBuffers[i]));
@@ -118,6 +156,7 @@ void VulkanCommandPool::DestroyCommandBuffers()
     {
         vkFreeCommandBuffers(device, m_CommandPool, 1, &(m_CommandBuffers[i]));
     }
+    m_CommandBuffers.clear();
 
     vkDestroyCommandPool(device, m_CommandPool, VULKAN_CPU_ALLOCATOR);
     vkDestroyCommandPool(device, m_ComputeCommandPool, VULKAN_CPU_ALLOCATOR);
@@ -126,35 +165,44 @@ void VulkanCommandPool::DestroyCommandBuffers()
 void VulkanCommandPool::CreateFences()
 {
     VkDevice device  = m_Device;
-    int32 frameCount = m_SwapChain->GetBackBufferCount();
+    int32 imageCount = m_SwapChain->GetBackBufferCount();
 
-    VkFenceCreateInfo fenceCreateInfo;
-    ZeroVulkanStruct(fenceCreateInfo, VK_STRUCTURE_TYPE_FENCE_CREATE_INFO);
-    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreCreateInfo createInfo;
+    ZeroVulkanStruct(createInfo, VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO);
 
-    m_Fences.resize(frameCount);
-    for (int32 i = 0; i < m_Fences.size(); ++i)
+    m_FramePoints.assign(m_NumFramesInFlight, 0);
+    m_ImageAcquired.resize(m_NumFramesInFlight);
+    for (int32 i = 0; i < m_ImageAcquired.size(); ++i)
     {
-        VERIFYVULKANRESULT(vkCreateFence(device, &fenceCreateInfo, VULKAN_CPU_ALLOCATOR, &m_Fences[i]));
+        VERIFYVULKANRESULT(vkCreateSemaphore(device, &createInfo, VULKAN_CPU_ALLOCATOR, &m_ImageAcquired[i]));
     }
 
-
-    VkSemaphoreCreateInfo createInfo;
-    ZeroVulkanStruct(createInfo, VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO);
-    vkCreateSemaphore(device, &createInfo, VULKAN_CPU_ALLOCATOR, &m_RenderComplete);
-    
+    m_ImagePoints.assign(imageCount, 0);
+    m_RenderComplete.resize(imageCount);
+    for (int32 i = 0; i < m_RenderComplete.size(); ++i)
+    {
+        VERIFYVULKANRESULT(vkCreateSemaphore(device, &createInfo, VULKAN_CPU_ALLOCATOR, &m_RenderComplete[i]));
+    }
 }
 
 void VulkanCommandPool::DestroyFences()
 {
     VkDevice device = m_Device;
 
-    for (int32 i = 0; i < m_Fences.size(); ++i)
+    for (int32 i = 0; i < m_ImageAcquired.size(); ++i)
     {
-        vkDestroyFence(device, m_Fences[i], VULKAN_CPU_ALLOCATOR);
+        vkDestroySemaphore(device, m_ImageAcquired[i], VULKAN_CPU_ALLOCATOR);
     }
+    m_FramePoints.clear();
+    m_ImageAcquired.clear();
+    m_ImagePoints.clear();
     
-    vkDestroySemaphore(device, m_RenderComplete, VULKAN_CPU_ALLOCATOR);
+    for (int32 i = 0; i < m_RenderComplete.size(); ++i)
+    {
+        vkDestroySemaphore(device, m_RenderComplete[i], VULKAN_CPU_ALLOCATOR);
+    }
+    m_RenderComplete.clear();
+    m_PresentComplete = VK_NULL_HANDLE;
 }
 
 void VulkanCommandPool::DestroyPipelineCache()
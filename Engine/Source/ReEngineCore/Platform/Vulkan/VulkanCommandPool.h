@@ -23,6 +23,7 @@ public:
         , m_PipelineCache(VK_NULL_HANDLE)
         , m_PresentComplete(VK_NULL_HANDLE)
         , m_CommandPool(VK_NULL_HANDLE)
+        , m_NumFramesInFlight(DEFAULT_FRAMES_IN_FLIGHT)
         , m_WaitStageMask(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT)
         , m_SwapChain(VK_NULL_HANDLE)
     {
@@ -49,6 +50,17 @@ public:
     }
 
     void Init(VulkanContext* Context);
+
+    // 只能在Init之前设置，限制在2到3帧
+    void SetFramesInFlight(uint32 numFramesInFlight)
+    {
+        m_NumFramesInFlight = Clamp<uint32>(numFramesInFlight, MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    FORCE_INLINE uint32 GetFramesInFlight() const
+    {
+        return m_NumFramesInFlight;
+    }
     
     void ShutDown()
     {
@@ -85,6 +97,12 @@ private:
     void CreatePipelineCache();
 
 public:
+    enum
+    {
+        MIN_FRAMES_IN_FLIGHT = 2,
+        MAX_FRAMES_IN_FLIGHT = 3,
+        DEFAULT_FRAMES_IN_FLIGHT = 2,
+    };
 
     typedef std::shared_ptr<VulkanSwapChain> VulkanSwapChainRef;
     VkDevice                        m_Device;
@@ -97,12 +115,20 @@ public:
 
     VkPipelineCache                 m_PipelineCache;
 
-    std::vector<VkFence>            m_Fences;
-    VkSemaphore                     m_RenderComplete;
+    // 按帧槽位，PresentQueue时间线上的提交值，CPU只在要复用某个槽位时等它
+    std::vector<uint64>             m_FramePoints;
+    // 按交换链图像，最后一次渲染这张图像的提交值
+    std::vector<uint64>             m_ImagePoints;
+    // 按交换链图像，Present等待完成后这张图像才会被再次Acquire
+    std::vector<VkSemaphore>        m_RenderComplete;
+    // 按帧槽位，Acquire时由交换链Signal
+    std::vector<VkSemaphore>        m_ImageAcquired;
+    // 当前帧提交要等待的Acquire Semaphore
     VkSemaphore                     m_PresentComplete;
 
     VkCommandPool                   m_CommandPool;
     VkCommandPool                   m_ComputeCommandPool;
+    // 按帧槽位
     std::vector<VkCommandBuffer>    m_CommandBuffers;
 
     VkPipelineStageFlags            m_WaitStageMask;
@@ -113,7 +139,13 @@ public:
     float                           m_LastFrameTime = 0.0f;
     int32                           m_LastFPS = 0;
     
-    uint32_t m_FrameIndex;
+    uint32                          m_NumFramesInFlight;
+    // 当前帧槽位，每次Present后前进
+    uint32                          m_FrameIndex = 0;
+    // 当前Acquire到的交换链图像
+    uint32                          m_ImageIndex = 0;
+    // 已经提交的总帧数
+    uint64                          m_FrameNumber = 0;
 };
 }
 
@@ -12,6 +12,7 @@
 #include "Core/Timestep.h"
 #include "Resource/AssetManager/AssetManager.h"
 #include "VulkanShader/VulkanShader.h"
+#include "Core/WorkerPool.h"
 
 
 namespace ReEngine
@@ -20,14 +21,22 @@ namespace ReEngine
     {
     	Instance = CreateRef<VulkanInstance>(windowHandle,InWindowProperty);
     	CommandPool = CreateRef<VulkanCommandPool>();
+    	CommandPool->SetFramesInFlight(InWindowProperty->FramesInFlight);
     }
 
     void VulkanContext::Init()
     {
         Instance->Init();
     	CommandPool->Init(this);
-    	CreateCommandBuffers();
     	CreateGUI();
+
+    	WorkerPool::GetInstance().Init();
+    	m_ParallelRecorder.Init(Instance->GetDevice(), CommandPool->GetFramesInFlight(), WorkerPool::GetInstance().GetNumThreads());
+    	m_AsyncCompute.Init(Instance->GetDevice(), CommandPool->GetFramesInFlight());
+    	m_GpuProfiler.Init(Instance->GetDevice(), CommandPool->GetFramesInFlight());
+    	m_TextureStreamer.Init(Instance->GetDevice());
+    	m_TextureLoader.Init(Instance->GetDevice());
+    	m_VirtualTextures.Init(Instance->GetDevice(), CommandPool->GetFramesInFlight());
     }
 
     void VulkanContext::Close()
@@ -37,30 +46,44 @@ namespace ReEngine
 
     	m_GUI->Destroy();
 
+    	m_VirtualTextures.Destroy();
+    	m_TextureLoader.Destroy();
+    	m_TextureStreamer.Destroy();
+    	m_GpuProfiler.Destroy();
+    	m_AsyncCompute.Destroy();
+    	m_ParallelRecorder.Destroy();
+    	WorkerPool::GetInstance().Shutdown();
+
     	CommandPool->ShutDown();
         Instance->Shutdown();
     }
 
     void VulkanContext::Acquire()
     {
-    	const int32 bufferIndex = CommandPool->AcquireBackbufferIndex();
-    	if (bufferIndex < 0 ) return;
-
-    	//分配当前帧的CmdList
-    	VkCommandBufferAllocateInfo allocInfo = {};
-    	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    	allocInfo.commandPool = CommandPool->m_CommandPool;
-    	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    	allocInfo.commandBufferCount = 1;
-    
-    	if (vkAllocateCommandBuffers(Instance->GetDevice()->GetInstanceHandle(), &allocInfo, &CommandPool->m_CommandBuffers[GetCurrtIndex()]) != VK_SUCCESS)
-    	{
-    		RE_CORE_ERROR("Failed to allocate command buffers!");
-    	}
+    	//CommandBuffer按帧槽位预先分配，这里只等槽位空闲并拿到交换链图像
+    	CommandPool->AcquireBackbufferIndex();
+    	m_ParallelRecorder.BeginFrame(GetFrameIndex());
+    	m_AsyncCompute.BeginFrame(GetFrameIndex());
+    }
+
+    void VulkanContext::BeginFrame()
+    {
+    	//描述符在这里重写，要早于这一帧的录制
+    	m_TextureStreamer.Tick();
+
+    	VkCommandBufferBeginInfo cmdBeginInfo;
+    	ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+    	VERIFYVULKANRESULT(vkBeginCommandBuffer(GetCommandList(), &cmdBeginInfo));
+
+    	m_GpuProfiler.BeginFrame(GetCommandList(), GetFrameIndex());
+    	m_VirtualTextures.BeginFrame(GetCommandList(), GetFrameIndex());
     }
 
     void VulkanContext::SwapBuffers(Timestep ts)
     {
+    	m_VirtualTextures.EndFrame(GetCommandList());
+    	m_GpuProfiler.EndFrame(GetCommandList());
+
     	if (vkEndCommandBuffer(GetCommandList()) != VK_SUCCESS)
     	{
     		throw std::runtime_error("failed to record command buffer!");
@@ -71,20 +94,26 @@ namespace ReEngine
 
     void VulkanContext::RecreateSwapChain()
     {
+    	//其它槽位的帧可能还在GPU上
+    	vkDeviceWaitIdle(Instance->GetDevice()->GetInstanceHandle());
+
     	CommandPool->ShutDown();
     	
     	Instance->RecreateSwapChain();
     	CommandPool->Init(this);
-    	
-    	CreateCommandBuffers();
     }
 
     VkCommandBuffer& VulkanContext::GetCommandList()
     {
-    	return CommandPool->m_CommandBuffers[GetCurrtIndex()];
+    	return CommandPool->m_CommandBuffers[GetFrameIndex()];
     }
 
     int32 VulkanContext::GetCurrtIndex()
+    {
+    	return CommandPool->m_ImageIndex;
+    }
+
+    int32 VulkanContext::GetFrameIndex()
     {
     	return CommandPool->m_FrameIndex;
     }
@@ -98,12 +127,14 @@ namespace ReEngine
     {
     	m_GUI->EndFrame();
 
-    	//获取渲染数据
-    	m_GUI->Update();
+    	//获取渲染数据，写到当前帧槽位的顶点和索引Buffer
+    	m_GUI->Update(GetFrameIndex());
     }
 
     void VulkanContext::DrawUI()
     {
+    	VulkanGpuScope gpuScope(m_GpuProfiler, GetCommandList(), "UI");
+
     	VkRenderPassBeginInfo UIrenderPassInfo = {};
     	UIrenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     	UIrenderPassInfo.renderPass = m_GUI->m_UIRenderPass;
@@ -118,22 +149,6 @@ namespace ReEngine
     	vkCmdEndRenderPass(GetCommandList());
     }
 
-    void VulkanContext::CreateCommandBuffers()
-    {
-        CommandPool->m_CommandBuffers.resize(CommandPool->m_SwapChain->GetBackBufferCount());
-
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = CommandPool->m_CommandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)CommandPool->m_CommandBuffers.size();
-
-        if (vkAllocateCommandBuffers(Instance->GetDevice()->GetInstanceHandle(), &allocInfo, CommandPool->m_CommandBuffers.data()) != VK_SUCCESS)
-        {
-            RE_CORE_ERROR("Failed to allocate command buffers!");
-        }
-    }
-	
     void VulkanContext::CreateGUI()
     {
     	m_GUI = new VulkanImGui();
@@ -5,6 +5,12 @@
 
 #include "VulkanCommandPool.h"
 #include "VulkanInstance.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanAsyncCompute.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanTextureLoader.h"
+#include "VulkanVirtualTexture.h"
 #include "GLFW/glfw3.h"
 #include "VulkanUI/VulkanImGui.h"
 
@@ -20,15 +26,26 @@ namespace ReEngine
         virtual void Init() override; 
         virtual void Close() override;
         virtual void Acquire();
+        // 开始录制这一帧的主CommandBuffer，放在输入和更新之后，中途窗口变化不会丢掉录了一半的命令
+        virtual void BeginFrame();
         virtual void SwapBuffers(Timestep ts) override;
         virtual void RecreateSwapChain();
         virtual VkCommandBuffer& GetCommandList();
+        // 交换链图像序号，用来选FrameBuffer
         virtual int32 GetCurrtIndex();
+        // 帧槽位序号，0到FramesInFlight-1，用来选每帧的资源
+        virtual int32 GetFrameIndex();
         virtual void BeginUI();
         virtual void EndUI();
         virtual void DrawUI();
         [[nodiscard]]Ref<VulkanInstance> GetVulkanInstance(){ return Instance;}
         [[nodiscard]]GLFWwindow* GetGLFWwindow(){return m_WindowHandle;}
+        [[nodiscard]]VulkanParallelRecorder& GetParallelRecorder(){ return m_ParallelRecorder;}
+        [[nodiscard]]VulkanAsyncCompute& GetAsyncCompute(){ return m_AsyncCompute;}
+        [[nodiscard]]VulkanGpuProfiler& GetGpuProfiler(){ return m_GpuProfiler;}
+        [[nodiscard]]VulkanTextureStreamer& GetTextureStreamer(){ return m_TextureStreamer;}
+        [[nodiscard]]VulkanTextureLoader& GetTextureLoader(){ return m_TextureLoader;}
+        [[nodiscard]]VulkanVirtualTextureSystem& GetVirtualTextures(){ return m_VirtualTextures;}
         
     public:
         Ref<VulkanInstance> Instance;
@@ -38,8 +55,18 @@ namespace ReEngine
         const WindowProperty* WinProperty;
 
         VulkanImGui* m_GUI;
-        
-        void CreateCommandBuffers();
+
+        // 多线程录制Secondary CommandBuffer，按帧槽位复用
+        VulkanParallelRecorder m_ParallelRecorder;
+        // 计算队列上的异步计算，和帧的图形队列用Timeline同步
+        VulkanAsyncCompute m_AsyncCompute;
+        // 帧CommandBuffer上的时间戳，晚几帧读回
+        VulkanGpuProfiler m_GpuProfiler;
+        // 烘焙贴图的流式Mip，帧开始录制前换进上一批的Image
+        VulkanTextureStreamer m_TextureStreamer;
+        VulkanTextureLoader m_TextureLoader;
+        // 虚拟贴图的物理缓存和反馈，帧开始时录制页上传，帧结束前拷贝反馈
+        VulkanVirtualTextureSystem m_VirtualTextures;
         
         void CreateGUI();
         void DestroyGUI();
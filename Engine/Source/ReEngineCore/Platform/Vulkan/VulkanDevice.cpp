@@ -1,6 +1,8 @@
 ﻿#include "VulkanDevice.h"
 #include "VulkanCommonDefine.h"
 #include "VulkanFence.h"
+#include "VulkanBuffers/VulkanStagingManager.h"
+#include "VulkanBuffers/VulkanUploadScheduler.h"
 #include "vk_mem_alloc.h"
 
 VulkanDevice::VulkanDevice(VkPhysicalDevice physicalDevice)
@@ -12,6 +14,9 @@ VulkanDevice::VulkanDevice(VkPhysicalDevice physicalDevice)
     , m_PresentQueue()
     , m_FenceManager(nullptr)
     , m_MemoryManager(nullptr)
+    , m_ResourceHeapManager(nullptr)
+    , m_StagingManager(nullptr)
+    , m_UploadScheduler(nullptr)
 
 {
 }
@@ -93,6 +98,7 @@ void VulkanDevice::CreateDevice()
 	deviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
 	deviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
 	deviceVulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	deviceVulkan12Features.timelineSemaphore = VK_TRUE;
 	
 	accelFeature.pNext = &rtPipelineFeature;
 	deviceVulkan12Features.pNext = &accelFeature;
@@ -114,37 +120,63 @@ void VulkanDevice::CreateDevice()
 	int32 gfxQueueFamilyIndex 	   = -1;
 	int32 computeQueueFamilyIndex  = -1;
 	int32 transferQueueFamilyIndex = -1;
-	
-	for (int32 familyIndex = 0; familyIndex < m_QueueFamilyProps.size(); ++familyIndex)
-	{
-		const VkQueueFamilyProperties& currProps = m_QueueFamilyProps[familyIndex];
-		bool isValidQueue = false;
+	uint32 computeQueueIndex       = 0;
+	uint32 transferQueueIndex      = 0;
 
-		if ((currProps.queueFlags & VK_QUEUE_GRAPHICS_BIT) == VK_QUEUE_GRAPHICS_BIT)
-		{
-			if (gfxQueueFamilyIndex == -1) {
-				gfxQueueFamilyIndex = familyIndex;
-				isValidQueue = true;
-			}
-		}
+	// 每个队列族已经分出去的队列数
+	std::vector<uint32> numUsedQueues(m_QueueFamilyProps.size(), 0);
 
-		if ((currProps.queueFlags & VK_QUEUE_COMPUTE_BIT) == VK_QUEUE_COMPUTE_BIT)
+	const auto FindFamily = [this](VkQueueFlags requiredFlags, VkQueueFlags excludedFlags) -> int32
+	{
+		for (int32 familyIndex = 0; familyIndex < m_QueueFamilyProps.size(); ++familyIndex)
 		{
-			if (computeQueueFamilyIndex == -1)
-			{
-				computeQueueFamilyIndex = familyIndex;
-				isValidQueue = true;
+			const VkQueueFlags flags = m_QueueFamilyProps[familyIndex].queueFlags;
+			if ((flags & requiredFlags) == requiredFlags && (flags & excludedFlags) == 0) {
+				return familyIndex;
 			}
 		}
+		return -1;
+	};
 
-		if ((currProps.queueFlags & VK_QUEUE_TRANSFER_BIT) == VK_QUEUE_TRANSFER_BIT)
-		{
-			if (transferQueueFamilyIndex == -1)
-			{
-				transferQueueFamilyIndex = familyIndex;
-				isValidQueue = true;
-			}
+	// 族里还有没分出去的队列就占一个，返回队列序号
+	const auto TakeQueue = [this, &numUsedQueues](int32 familyIndex, uint32& outQueueIndex) -> bool
+	{
+		if (familyIndex == -1 || numUsedQueues[familyIndex] >= m_QueueFamilyProps[familyIndex].queueCount) {
+			return false;
 		}
+		outQueueIndex = numUsedQueues[familyIndex]++;
+		return true;
+	};
+
+	uint32 gfxQueueIndex = 0;
+	gfxQueueFamilyIndex = FindFamily(VK_QUEUE_GRAPHICS_BIT, 0);
+	TakeQueue(gfxQueueFamilyIndex, gfxQueueIndex);
+
+	// 计算队列优先用不带图形的独立队列族，其次是图形族里的第二个队列，都没有时和图形共用一个VulkanQueue
+	const int32 asyncComputeFamilyIndex = FindFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+	if (TakeQueue(asyncComputeFamilyIndex, computeQueueIndex)) {
+		computeQueueFamilyIndex = asyncComputeFamilyIndex;
+	}
+	else if (TakeQueue(gfxQueueFamilyIndex, computeQueueIndex)) {
+		computeQueueFamilyIndex = gfxQueueFamilyIndex;
+	}
+
+	// 传输队列优先用只有传输的DMA队列族，其次是独立计算族或图形族里剩下的队列，都没有时和计算队列共用
+	const int32 dmaFamilyIndex = FindFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	if (TakeQueue(dmaFamilyIndex, transferQueueIndex)) {
+		transferQueueFamilyIndex = dmaFamilyIndex;
+	}
+	else if (TakeQueue(asyncComputeFamilyIndex, transferQueueIndex)) {
+		transferQueueFamilyIndex = asyncComputeFamilyIndex;
+	}
+	else if (TakeQueue(gfxQueueFamilyIndex, transferQueueIndex)) {
+		transferQueueFamilyIndex = gfxQueueFamilyIndex;
+	}
+	
+	for (int32 familyIndex = 0; familyIndex < m_QueueFamilyProps.size(); ++familyIndex)
+	{
+		const VkQueueFamilyProperties& currProps = m_QueueFamilyProps[familyIndex];
+		bool isValidQueue = numUsedQueues[familyIndex] > 0;
 
 		auto GetQueueInfoString = [](const VkQueueFamilyProperties& Props) -> std::string
 		{
@@ -174,11 +206,11 @@ void VulkanDevice::CreateDevice()
 		VkDeviceQueueCreateInfo currQueue;
         ZeroVulkanStruct(currQueue, VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO);
 		currQueue.queueFamilyIndex = familyIndex;
-		currQueue.queueCount       = currProps.queueCount;
-		numPriorities             += currProps.queueCount;
+		currQueue.queueCount       = numUsedQueues[familyIndex];
+		numPriorities             += numUsedQueues[familyIndex];
 		queueFamilyInfos.push_back(currQueue);
         
-		RE_CORE_INFO("Initializing Queue Family {0}: {1}queues{2}", familyIndex,  currProps.queueCount, GetQueueInfoString(currProps).c_str());
+		RE_CORE_INFO("Initializing Queue Family {0}: {1}/{2} queues{3}", familyIndex, numUsedQueues[familyIndex], currProps.queueCount, GetQueueInfoString(currProps).c_str());
 	}
     
 	std::vector<float> queuePriorities(numPriorities);
@@ -187,8 +219,7 @@ void VulkanDevice::CreateDevice()
 	{
 		VkDeviceQueueCreateInfo& currQueue = queueFamilyInfos[index];
 		currQueue.pQueuePriorities = CurrentPriority;
-		const VkQueueFamilyProperties& currProps = m_QueueFamilyProps[currQueue.queueFamilyIndex];
-		for (int32 queueIndex = 0; queueIndex < (int32)currProps.queueCount; ++queueIndex) {
+		for (int32 queueIndex = 0; queueIndex < (int32)currQueue.queueCount; ++queueIndex) {
 			*CurrentPriority++ = 1.0f;
 		}
 	}
@@ -213,21 +244,24 @@ void VulkanDevice::CreateDevice()
 		return;
 	}
 
-	m_GfxQueue = CreateRef<VulkanQueue>(this, gfxQueueFamilyIndex);
+	m_GfxQueue = CreateRef<VulkanQueue>(this, gfxQueueFamilyIndex, gfxQueueIndex);
 
-	if (computeQueueFamilyIndex == -1)
-	{
-		computeQueueFamilyIndex = gfxQueueFamilyIndex;
+	// 同一个VkQueue只包一个VulkanQueue，提交锁和时间线才能保证外部同步
+	if (computeQueueFamilyIndex == -1) {
+		m_ComputeQueue = m_GfxQueue;
+	}
+	else {
+		m_ComputeQueue = CreateRef<VulkanQueue>(this, computeQueueFamilyIndex, computeQueueIndex);
 	}
-	
-	m_ComputeQueue = CreateRef<VulkanQueue>(this, computeQueueFamilyIndex);
 
-	if (transferQueueFamilyIndex == -1)
-	{
-		transferQueueFamilyIndex = computeQueueFamilyIndex;
+	if (transferQueueFamilyIndex == -1) {
+		m_TransferQueue = m_ComputeQueue;
 	}
-	
-	m_TransferQueue = CreateRef<VulkanQueue>(this, transferQueueFamilyIndex);
+	else {
+		m_TransferQueue = CreateRef<VulkanQueue>(this, transferQueueFamilyIndex, transferQueueIndex);
+	}
+
+	RE_CORE_INFO("Queue Family Gfx {0} Compute {1}{2} Transfer {3}{4}", gfxQueueFamilyIndex, m_ComputeQueue->GetFamilyIndex(), m_ComputeQueue == m_GfxQueue ? " (shared)" : "", m_TransferQueue->GetFamilyIndex(), transferQueueFamilyIndex == -1 ? " (shared)" : "");
 }
 
 void VulkanDevice::SetupFormats()
@@ -391,6 +425,22 @@ void VulkanDevice::SetupFormats()
 
 	MapFormatSupport(PF_R32_FLOAT, VK_FORMAT_R32_SFLOAT);
 	SetComponentMapping(PF_R32_FLOAT, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_ZERO);
+
+	// 烘焙贴图用的BC格式，不支持时加载会退回原图
+	MapFormatSupport(PF_DXT1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK);
+	SetComponentMapping(PF_DXT1, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A);
+
+	MapFormatSupport(PF_DXT5, VK_FORMAT_BC3_UNORM_BLOCK);
+	SetComponentMapping(PF_DXT5, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A);
+
+	MapFormatSupport(PF_BC4, VK_FORMAT_BC4_UNORM_BLOCK);
+	SetComponentMapping(PF_BC4, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_ONE);
+
+	MapFormatSupport(PF_BC5, VK_FORMAT_BC5_UNORM_BLOCK);
+	SetComponentMapping(PF_BC5, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_ONE);
+
+	MapFormatSupport(PF_BC7, VK_FORMAT_BC7_UNORM_BLOCK);
+	SetComponentMapping(PF_BC7, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A);
 }
 
 void VulkanDevice::MapFormatSupport(PixelFormat format, VkFormat vkFormat)
@@ -482,18 +532,41 @@ void VulkanDevice::InitGPU(int32 deviceIndex)
     m_MemoryManager = new VulkanDeviceMemoryManager();
     m_MemoryManager->Init(this);
     
+    m_ResourceHeapManager = new VulkanResourceHeapManager(this);
+    m_ResourceHeapManager->Init();
+    
     m_FenceManager = new VulkanFenceManager();
 	m_FenceManager->Init(this);
+
+    m_StagingManager = new VulkanStagingManager();
+    m_StagingManager->Init(this, VulkanStagingManager::DEFAULT_RING_SIZE);
+
+    m_UploadScheduler = new VulkanUploadScheduler();
+    m_UploadScheduler->Init(this, VulkanUploadScheduler::DEFAULT_FRAME_BUDGET);
 }
 
 void VulkanDevice::Destroy()
 {
+    m_UploadScheduler->Destroy();
+    delete m_UploadScheduler;
+
+    m_StagingManager->Destroy();
+    delete m_StagingManager;
+
 	m_FenceManager->Destory();
 	delete m_FenceManager;
 
+	m_ResourceHeapManager->Destory();
+	delete m_ResourceHeapManager;
+
 	m_MemoryManager->Destory();
 	delete m_MemoryManager;
 
+	// PresentQueue只是其中一个的引用，没有独立队列时Compute和Transfer也是，Destroy可以重复调用
+	m_GfxQueue->Destroy();
+	m_ComputeQueue->Destroy();
+	m_TransferQueue->Destroy();
+
 	vmaDestroyAllocator( vma_allocator );
 	vkDestroyDevice(m_Device, VULKAN_CPU_ALLOCATOR);
 	m_Device = VK_NULL_HANDLE;
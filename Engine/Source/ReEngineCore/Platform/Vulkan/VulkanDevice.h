@@ -13,6 +13,8 @@
 VK_DEFINE_HANDLE( VmaAllocator )
 class VulkanFenceManager;
 class VulkanDeviceMemoryManager;
+class VulkanStagingManager;
+class VulkanUploadScheduler;
 
 class VulkanDevice
 {
@@ -70,6 +72,11 @@ public:
         return m_PhysicalDeviceProperties.properties.limits;
     }
     
+    FORCE_INLINE const std::vector<VkQueueFamilyProperties>& GetQueueFamilyProperties() const
+    {
+        return m_QueueFamilyProps;
+    }
+    
     FORCE_INLINE const VkPhysicalDeviceFeatures& GetPhysicalFeatures() const
     {
         return m_PhysicalDeviceFeatures;
@@ -95,6 +102,21 @@ public:
         return *m_MemoryManager;
     }
     
+    FORCE_INLINE VulkanResourceHeapManager& GetResourceHeapManager()
+    {
+        return *m_ResourceHeapManager;
+    }
+    
+    FORCE_INLINE VulkanStagingManager& GetStagingManager()
+    {
+        return *m_StagingManager;
+    }
+    
+    FORCE_INLINE VulkanUploadScheduler& GetUploadScheduler()
+    {
+        return *m_UploadScheduler;
+    }
+    
 	FORCE_INLINE void AddAppDeviceExtensions(const char* name)
 	{
 		m_AppDeviceExtensions.push_back(name);
@@ -134,6 +156,9 @@ private:
 
     VulkanFenceManager*                     m_FenceManager;
     VulkanDeviceMemoryManager*              m_MemoryManager;
+    VulkanResourceHeapManager*              m_ResourceHeapManager;
+    VulkanStagingManager*                   m_StagingManager;
+    VulkanUploadScheduler*                  m_UploadScheduler;
 
 	std::vector<const char*>				m_AppDeviceExtensions;
 
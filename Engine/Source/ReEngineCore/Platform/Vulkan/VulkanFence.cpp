@@ -134,7 +134,7 @@ bool VulkanFenceManager::CheckFenceState(VulkanFence* fence)
 	{
 	case VK_SUCCESS:
 		fence->m_State = VulkanFence::State::Signaled;
-		break;
+		return true;
 	case VK_NOT_READY:
 		break;
 	default:
@@ -0,0 +1,221 @@
+﻿#include "VulkanGpuProfiler.h"
+
+#include <fstream>
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace ReEngine
+{
+    void VulkanGpuProfiler::Init(Ref<VulkanDevice> device, uint32 numFramesInFlight)
+    {
+        m_Device = device;
+
+        // 帧的CommandBuffer提交在PresentQueue上，看它的队列族支不支持时间戳
+        const uint32 familyIndex = device->GetPresentQueue()->GetFamilyIndex();
+        const uint32 validBits   = device->GetQueueFamilyProperties()[familyIndex].timestampValidBits;
+        if (validBits == 0)
+        {
+            RE_CORE_WARN("Queue family {0} does not support timestamps, gpu profiler disabled.", familyIndex);
+            m_TimestampPeriod = 0.0;
+            return;
+        }
+
+        m_TimestampPeriod = device->GetLimits().timestampPeriod;
+        m_TimestampMask   = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo;
+        ZeroVulkanStruct(queryPoolInfo, VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO);
+        queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+        m_Slots.resize(numFramesInFlight);
+        for (FrameSlot& slot : m_Slots)
+        {
+            VERIFYVULKANRESULT(vkCreateQueryPool(device->GetInstanceHandle(), &queryPoolInfo, VULKAN_CPU_ALLOCATOR, &slot.QueryPool));
+            slot.Scopes.reserve(MAX_SCOPES_PER_FRAME);
+        }
+        m_Timestamps.resize(MAX_SCOPES_PER_FRAME * 2);
+    }
+
+    void VulkanGpuProfiler::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        for (FrameSlot& slot : m_Slots)
+        {
+            vkDestroyQueryPool(m_Device->GetInstanceHandle(), slot.QueryPool, VULKAN_CPU_ALLOCATOR);
+        }
+        m_Slots.clear();
+        m_Current = nullptr;
+        m_OpenScopes.clear();
+        m_History.clear();
+        m_Device.reset();
+    }
+
+    void VulkanGpuProfiler::BeginFrame(VkCommandBuffer cmdBuffer, uint32 frameIndex)
+    {
+        m_Current = nullptr;
+        m_OpenScopes.clear();
+        if (!IsSupported() || m_Slots.empty()) {
+            return;
+        }
+
+        // Acquire已经等过这个槽位的Fence，上一次的时间戳都写完了
+        FrameSlot& slot = m_Slots[frameIndex % m_Slots.size()];
+        Resolve(slot);
+        slot.Scopes.clear();
+        slot.NumQueries = 0;
+
+        if (!m_Enabled) {
+            return;
+        }
+
+        vkCmdResetQueryPool(cmdBuffer, slot.QueryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+        slot.FrameNumber = m_FrameNumber++;
+        m_Current = &slot;
+
+        BeginScope(cmdBuffer, "Frame");
+    }
+
+    void VulkanGpuProfiler::EndFrame(VkCommandBuffer cmdBuffer)
+    {
+        // 没有配对的Scope在这里补上结束，保证写过的查询都有结果
+        while (!m_OpenScopes.empty()) {
+            EndScope(cmdBuffer);
+        }
+        m_Current = nullptr;
+    }
+
+    void VulkanGpuProfiler::BeginScope(VkCommandBuffer cmdBuffer, const std::string& name)
+    {
+        if (!m_Current) {
+            return;
+        }
+
+        // 查询用完时只记一个空位，EndScope照样出栈
+        if (m_Current->Scopes.size() >= MAX_SCOPES_PER_FRAME)
+        {
+            m_OpenScopes.push_back(MAX_SCOPES_PER_FRAME);
+            return;
+        }
+
+        Scope scope;
+        scope.Name       = name;
+        scope.Depth      = (uint32)m_OpenScopes.size();
+        scope.BeginQuery = m_Current->NumQueries++;
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_Current->QueryPool, scope.BeginQuery);
+
+        m_OpenScopes.push_back((uint32)m_Current->Scopes.size());
+        m_Current->Scopes.push_back(scope);
+    }
+
+    void VulkanGpuProfiler::EndScope(VkCommandBuffer cmdBuffer)
+    {
+        if (!m_Current || m_OpenScopes.empty()) {
+            return;
+        }
+
+        const uint32 index = m_OpenScopes.back();
+        m_OpenScopes.pop_back();
+        if (index >= m_Current->Scopes.size()) {
+            return;
+        }
+
+        Scope& scope = m_Current->Scopes[index];
+        scope.EndQuery = m_Current->NumQueries++;
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Current->QueryPool, scope.EndQuery);
+    }
+
+    void VulkanGpuProfiler::Resolve(FrameSlot& slot)
+    {
+        if (slot.NumQueries == 0) {
+            return;
+        }
+
+        // 不带WAIT，没就绪时这一帧的结果直接丢掉，不让CPU等GPU
+        VkResult result = vkGetQueryPoolResults(m_Device->GetInstanceHandle(), slot.QueryPool, 0, slot.NumQueries,
+                                                slot.NumQueries * sizeof(uint64), m_Timestamps.data(), sizeof(uint64), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return;
+        }
+
+        const uint64 base = m_Timestamps[slot.Scopes[0].BeginQuery] & m_TimestampMask;
+        auto ToMs = [&](uint32 query) -> double
+        {
+            const uint64 ticks = ((m_Timestamps[query] & m_TimestampMask) - base) & m_TimestampMask;
+            return ticks * m_TimestampPeriod / 1000000.0;
+        };
+
+        VulkanGpuFrameResult frame;
+        frame.FrameNumber = slot.FrameNumber;
+        frame.StartUs     = base * m_TimestampPeriod / 1000.0;
+        frame.Scopes.reserve(slot.Scopes.size());
+        for (const Scope& scope : slot.Scopes)
+        {
+            if (scope.EndQuery == 0) {
+                continue;
+            }
+
+            VulkanGpuScopeResult scopeResult;
+            scopeResult.Name    = scope.Name;
+            scopeResult.Depth   = scope.Depth;
+            scopeResult.BeginMs = ToMs(scope.BeginQuery);
+            scopeResult.EndMs   = ToMs(scope.EndQuery);
+            frame.Scopes.push_back(scopeResult);
+        }
+        frame.DurationMs = frame.Scopes.empty() ? 0.0 : frame.Scopes[0].EndMs;
+
+        m_LastFrame = frame;
+        m_History.push_back(std::move(frame));
+        while (m_History.size() > MAX_HISTORY_FRAMES) {
+            m_History.pop_front();
+        }
+    }
+
+    bool VulkanGpuProfiler::SaveChromeTrace(const std::string& filename) const
+    {
+        json events = json::array();
+
+        json threadName;
+        threadName["name"] = "thread_name";
+        threadName["ph"]   = "M";
+        threadName["pid"]  = 0;
+        threadName["tid"]  = 0;
+        threadName["args"]["name"] = "GPU";
+        events.push_back(threadName);
+
+        // 同一个tid上按时间包含关系显示嵌套
+        for (const VulkanGpuFrameResult& frame : m_History)
+        {
+            for (const VulkanGpuScopeResult& scope : frame.Scopes)
+            {
+                json event;
+                event["name"] = scope.Name;
+                event["cat"]  = "gpu";
+                event["ph"]   = "X";
+                event["ts"]   = frame.StartUs + scope.BeginMs * 1000.0;
+                event["dur"]  = (scope.EndMs - scope.BeginMs) * 1000.0;
+                event["pid"]  = 0;
+                event["tid"]  = 0;
+                event["args"]["frame"] = frame.FrameNumber;
+                events.push_back(event);
+            }
+        }
+
+        json root;
+        root["traceEvents"]     = events;
+        root["displayTimeUnit"] = "ms";
+
+        std::ofstream file(filename);
+        if (!file.is_open())
+        {
+            RE_CORE_ERROR("Failed to open {0} for writing.", filename);
+            return false;
+        }
+        file << root.dump();
+        return true;
+    }
+}
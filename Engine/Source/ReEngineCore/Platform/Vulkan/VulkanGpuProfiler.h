@@ -0,0 +1,142 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    struct VulkanGpuScopeResult
+    {
+        std::string     Name;
+        uint32          Depth = 0;
+        // 相对这一帧第一个时间戳
+        double          BeginMs = 0.0;
+        double          EndMs = 0.0;
+    };
+
+    struct VulkanGpuFrameResult
+    {
+        uint64          FrameNumber = 0;
+        // GPU时钟上的绝对时间，导出Trace时用
+        double          StartUs = 0.0;
+        double          DurationMs = 0.0;
+        std::vector<VulkanGpuScopeResult> Scopes;
+    };
+
+    // 帧CommandBuffer上的时间戳查询：每个帧槽位一个QueryPool，Scope的开始和结束各写一个时间戳
+    // 槽位下一次BeginFrame时上一次的帧已经执行完，结果晚N帧读回，CPU不等待
+    // Scope可以嵌套，录在帧的主CommandBuffer上，Secondary里的命令算在包住它的Scope里
+    class VulkanGpuProfiler
+    {
+    public:
+        enum
+        {
+            MAX_SCOPES_PER_FRAME = 256,
+            MAX_HISTORY_FRAMES   = 240,
+        };
+
+        void Init(Ref<VulkanDevice> device, uint32 numFramesInFlight);
+
+        void Destroy();
+
+        // 帧CommandBuffer Begin之后调用：读回这个槽位上一次的结果，复位QueryPool并开始整帧的Scope
+        void BeginFrame(VkCommandBuffer cmdBuffer, uint32 frameIndex);
+
+        // 帧CommandBuffer End之前调用
+        void EndFrame(VkCommandBuffer cmdBuffer);
+
+        void BeginScope(VkCommandBuffer cmdBuffer, const std::string& name);
+
+        void EndScope(VkCommandBuffer cmdBuffer);
+
+        // Chrome trace格式，chrome://tracing或Perfetto可以直接打开
+        bool SaveChromeTrace(const std::string& filename) const;
+
+        FORCE_INLINE bool IsSupported() const
+        {
+            return m_TimestampPeriod > 0.0;
+        }
+
+        FORCE_INLINE void SetEnabled(bool enabled)
+        {
+            m_Enabled = enabled;
+        }
+
+        FORCE_INLINE bool IsEnabled() const
+        {
+            return m_Enabled;
+        }
+
+        // 最近一次读回的帧，还没有结果时Scopes为空
+        FORCE_INLINE const VulkanGpuFrameResult& GetLastFrame() const
+        {
+            return m_LastFrame;
+        }
+
+        FORCE_INLINE const std::deque<VulkanGpuFrameResult>& GetHistory() const
+        {
+            return m_History;
+        }
+
+    private:
+        struct Scope
+        {
+            std::string     Name;
+            uint32          Depth = 0;
+            uint32          BeginQuery = 0;
+            // 没有EndScope时为0，读回时丢掉
+            uint32          EndQuery = 0;
+        };
+
+        struct FrameSlot
+        {
+            VkQueryPool         QueryPool = VK_NULL_HANDLE;
+            std::vector<Scope>  Scopes;
+            uint32              NumQueries = 0;
+            uint64              FrameNumber = 0;
+        };
+
+        void Resolve(FrameSlot& slot);
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        // 一个tick是多少纳秒，0表示队列不支持时间戳
+        double                          m_TimestampPeriod = 0.0;
+        uint64                          m_TimestampMask = ~0ULL;
+        bool                            m_Enabled = true;
+
+        std::vector<FrameSlot>          m_Slots;
+        FrameSlot*                      m_Current = nullptr;
+        std::vector<uint32>             m_OpenScopes;
+        uint64                          m_FrameNumber = 0;
+
+        std::vector<uint64>             m_Timestamps;
+        VulkanGpuFrameResult            m_LastFrame;
+        std::deque<VulkanGpuFrameResult> m_History;
+    };
+
+    // 作用域结束时EndScope
+    class VulkanGpuScope
+    {
+    public:
+        VulkanGpuScope(VulkanGpuProfiler& profiler, VkCommandBuffer cmdBuffer, const std::string& name)
+            : m_Profiler(profiler)
+            , m_CmdBuffer(cmdBuffer)
+        {
+            m_Profiler.BeginScope(m_CmdBuffer, name);
+        }
+
+        ~VulkanGpuScope()
+        {
+            m_Profiler.EndScope(m_CmdBuffer);
+        }
+
+    private:
+        VulkanGpuProfiler&  m_Profiler;
+        VkCommandBuffer     m_CmdBuffer;
+    };
+}
@@ -11,6 +11,7 @@ VulkanInstance::VulkanInstance(GLFWwindow* InWindowHandle, const WindowProperty*
 , m_Device(nullptr)
 , m_SwapChain(nullptr)
 , m_PixelFormat(PF_B8G8R8A8)
+, m_Surface(VK_NULL_HANDLE)
 {
     
 }
@@ -25,7 +26,10 @@ void VulkanInstance::Init()
     InitInstance();
     SetupDebugCallBack();
     SelectAndInitDevice();
-    CreateSurface();
+    //离屏模式没有窗口，不需要Surface
+    if (!m_WindowInfo->Headless) {
+        CreateSurface();
+    }
     RecreateSwapChain();
 }
 
@@ -37,7 +41,9 @@ void VulkanInstance::Shutdown()
 {
     DestorySwapChain();
 
-    vkDestroySurfaceKHR(m_Instance, m_Surface, VULKAN_CPU_ALLOCATOR);
+    if (m_Surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(m_Instance, m_Surface, VULKAN_CPU_ALLOCATOR);
+    }
 
 #ifndef NDEBUG
     DestroyDebugCallBack();
@@ -221,6 +227,19 @@ void VulkanInstance::InitInstance()
     volkLoadInstance(m_Instance);
 }
 
+VkPresentModeKHR VulkanInstance::ToVkPresentMode(PresentMode presentMode)
+{
+    switch (presentMode)
+    {
+        case PresentMode::Immediate:
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        case PresentMode::Mailbox:
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        default:
+            return VK_PRESENT_MODE_FIFO_KHR;
+    }
+}
+
 void VulkanInstance::RecreateSwapChain()
 {
     DestorySwapChain();
@@ -229,7 +248,12 @@ void VulkanInstance::RecreateSwapChain()
     int32 width  = m_WindowInfo->Width;
     int32 height = m_WindowInfo->Height;
     
-    m_SwapChain  = std::shared_ptr<VulkanSwapChain>(new VulkanSwapChain(m_Instance, m_Device, m_Surface, m_PixelFormat, width, height, &desiredNumBackBuffers, m_BackbufferImages, 1));
+    if (m_Surface == VK_NULL_HANDLE) {
+        m_SwapChain = std::shared_ptr<VulkanSwapChain>(new VulkanSwapChain(m_Device, m_PixelFormat, width, height, &desiredNumBackBuffers, m_BackbufferImages));
+    }
+    else {
+        m_SwapChain = std::shared_ptr<VulkanSwapChain>(new VulkanSwapChain(m_Instance, m_Device, m_Surface, m_PixelFormat, width, height, &desiredNumBackBuffers, m_BackbufferImages, ToVkPresentMode(m_WindowInfo->PresentType)));
+    }
 	
     m_BackbufferViews.resize(m_BackbufferImages.size());
     for (int32 i = 0; i < m_BackbufferViews.size(); ++i)
@@ -86,6 +86,8 @@ public:
     	return m_WindowInfo->Height;
     }
 
+	static VkPresentModeKHR ToVkPresentMode(PresentMode presentMode);
+
 protected:
 
 	void CreateInstance();
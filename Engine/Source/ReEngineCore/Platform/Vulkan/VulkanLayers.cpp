@@ -219,8 +219,11 @@ void VulkanInstance::GetInstanceLayersAndExtensions(std::vector<const char*>& ou
 	const char** glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 	
+	//GLFW没有初始化时（离屏模式）返回空，不需要Surface扩展
 	std::vector<const char*> platformExtensions;
-	platformExtensions.push_back(*glfwExtensions);
+	if (glfwExtensions != nullptr) {
+		platformExtensions.push_back(*glfwExtensions);
+	}
 	
 	for (const char* extension : platformExtensions)
 	{
@@ -118,6 +118,17 @@ void VulkanMaterial::Prepare()
     }
 
     DynamicOffsets.resize(DynamicOffsetCount);
+
+    // 给每个Uniform分配句柄
+    uniformSlots.clear();
+    for(auto it = uniformBuffers.begin(); it != uniformBuffers.end(); it++)
+    {
+        VulkanUniformSlot Slot;
+        Slot.DynamicIndex = it->second.DynamicIndex;
+        Slot.DataSize     = it->second.DataSize;
+        it->second.Slot   = (int32)uniformSlots.size();
+        uniformSlots.push_back(Slot);
+    }
     
     // 从Shader中获取Texture信息，包含attachment信息
     for (auto it = mShader->imageParams.begin(); it != mShader->imageParams.end(); ++it)
@@ -147,7 +158,7 @@ void VulkanMaterial::BindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelin
     );
 }
 
-void VulkanMaterial::SetTexture(const std::string& name, Ref<VulkanTexture> texture)
+void VulkanMaterial::SetTexture(const std::string& name, const Ref<VulkanTexture>& texture)
 {
     auto it = textures.find(name);
     if(it == textures.end())
@@ -168,12 +179,12 @@ void VulkanMaterial::SetTexture(const std::string& name, Ref<VulkanTexture> text
     }
 }
 
-void VulkanMaterial::SetInputAttachment(const std::string& name, Ref<VulkanTexture> texture)
+void VulkanMaterial::SetInputAttachment(const std::string& name, const Ref<VulkanTexture>& texture)
 {
     SetTexture(name,texture);
 }
 
-void VulkanMaterial::SetStorageBuffer(const std::string& name, Ref<VulkanBuffer> buffer)
+void VulkanMaterial::SetStorageBuffer(const std::string& name, const Ref<VulkanBuffer>& buffer)
 {
     auto it = storageBuffers.find(name);
     if (it == storageBuffers.end())
@@ -232,6 +243,162 @@ void VulkanMaterial::SetLocalUniform(const std::string& name, VkDescriptorBuffer
     dynOffsets[it->second.DynamicIndex] = (uint32)BufferView.offset;
 }
 
+int32 VulkanMaterial::GetUniformSlot(const std::string& name) const
+{
+    auto it = uniformBuffers.find(name);
+    if(it == uniformBuffers.end())
+    {
+        RE_CORE_ERROR("Uniform {0} not found.", name.c_str());
+        return INVALID_UNIFORM_SLOT;
+    }
+    return it->second.Slot;
+}
+
+void VulkanMaterial::SetLocalUniform(int32 slot, void* dataPtr, uint32 size)
+{
+    if(slot < 0 || slot >= (int32)uniformSlots.size())
+    {
+        RE_CORE_ERROR("Uniform slot {0} is invalid.", slot);
+        return;
+    }
+
+    const VulkanUniformSlot& Slot = uniformSlots[slot];
+    const auto BufferView = RingBuffer->AllocConstantBuffer(Slot.DataSize, dataPtr);
+    DynamicOffsets[Slot.DynamicIndex] = (uint32)BufferView.offset;
+}
+
+void VulkanMaterial::SetLocalUniform(int32 slot, VkDescriptorBufferInfo BufferView)
+{
+    if(slot < 0 || slot >= (int32)uniformSlots.size())
+    {
+        RE_CORE_ERROR("Uniform slot {0} is invalid.", slot);
+        return;
+    }
+
+    DynamicOffsets[uniformSlots[slot].DynamicIndex] = (uint32)BufferView.offset;
+}
+
+bool VulkanMaterial::BeginUniformBatch(const std::vector<int32>& slots, uint32 drawCount)
+{
+    batchSlots = slots;
+    batchDrawCount = 0;
+    batchSlotOffsets.resize(slots.size());
+
+    // 每个物体占一个Stride，物体内部每个Uniform块按Ring的对齐排列
+    const uint32 Alignment = RingBuffer->GetAlignment();
+    batchStride = 0;
+    for(int32 i = 0; i < slots.size(); ++i)
+    {
+        if(slots[i] < 0 || slots[i] >= (int32)uniformSlots.size())
+        {
+            RE_CORE_ERROR("Uniform slot {0} is invalid.", slots[i]);
+            return false;
+        }
+        batchSlotOffsets[i] = batchStride;
+        batchStride += AlignUp(uniformSlots[slots[i]].DataSize, Alignment);
+    }
+
+    if(batchStride == 0 || drawCount == 0)
+    {
+        return false;
+    }
+
+    // Ring单次分配不能超过一个Chunk，DrawList按Chunk能放下的物体数切成几段，每段单独分配
+    batchDrawsPerAlloc = RingBuffer->GetMaxAllocSize() / batchStride;
+    if(batchDrawsPerAlloc == 0)
+    {
+        RE_CORE_ERROR("Uniform batch stride {0} is larger than the ring chunk.", batchStride);
+        return false;
+    }
+
+    const uint32 NumAllocs = (drawCount + batchDrawsPerAlloc - 1) / batchDrawsPerAlloc;
+    batchData.resize(NumAllocs);
+    batchOffsets.resize(slots.size() * drawCount);
+    uint32* Offsets = batchOffsets.data();
+
+    for(uint32 AllocIndex = 0; AllocIndex < NumAllocs; ++AllocIndex)
+    {
+        const uint32 FirstDraw = AllocIndex * batchDrawsPerAlloc;
+        const uint32 NumDraws  = glm::min(batchDrawsPerAlloc, drawCount - FirstDraw);
+
+        void* Data = nullptr;
+        VkDescriptorBufferInfo BufferView;
+        if(!RingBuffer->AllocConstantBuffer(batchStride * NumDraws, &Data, &BufferView))
+        {
+            return false;
+        }
+        batchData[AllocIndex] = (uint8*)Data;
+
+        // 这一段的偏移表
+        for(uint32 DrawIndex = 0; DrawIndex < NumDraws; ++DrawIndex)
+        {
+            const uint32 Base = (uint32)BufferView.offset + DrawIndex * batchStride;
+            for(int32 i = 0; i < slots.size(); ++i)
+            {
+                *Offsets++ = Base + batchSlotOffsets[i];
+            }
+        }
+    }
+    batchDrawCount = drawCount;
+
+    return true;
+}
+
+void* VulkanMaterial::GetBatchUniformData(uint32 drawIndex, uint32 slotIndex)
+{
+    return batchData[drawIndex / batchDrawsPerAlloc] + (drawIndex % batchDrawsPerAlloc) * batchStride + batchSlotOffsets[slotIndex];
+}
+
+void VulkanMaterial::SetBatchUniform(uint32 drawIndex, uint32 slotIndex, const void* dataPtr, uint32 size)
+{
+    if(drawIndex >= batchDrawCount)
+    {
+        return;
+    }
+
+    memcpy(GetBatchUniformData(drawIndex, slotIndex), dataPtr, size);
+}
+
+void VulkanMaterial::ApplyUniformBatch(uint32 drawIndex)
+{
+    if(drawIndex >= batchDrawCount)
+    {
+        return;
+    }
+
+    const uint32* Offsets = batchOffsets.data() + drawIndex * batchSlots.size();
+    for(int32 i = 0; i < batchSlots.size(); ++i)
+    {
+        DynamicOffsets[uniformSlots[batchSlots[i]].DynamicIndex] = Offsets[i];
+    }
+}
+
+void VulkanMaterial::BindUniformBatch(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, uint32 drawIndex) const
+{
+    thread_local std::vector<uint32> Offsets;
+    Offsets.assign(DynamicOffsets.begin(), DynamicOffsets.end());
+
+    if(drawIndex < batchDrawCount)
+    {
+        const uint32* BatchOffsets = batchOffsets.data() + drawIndex * batchSlots.size();
+        for(int32 i = 0; i < batchSlots.size(); ++i)
+        {
+            Offsets[uniformSlots[batchSlots[i]].DynamicIndex] = BatchOffsets[i];
+        }
+    }
+
+    vkCmdBindDescriptorSets(
+            commandBuffer,
+            bindPoint,
+            mPipeline->PipelineLayout,
+            0,
+            (uint32_t)DescriptorSet->DescriptorSets.size(),
+            DescriptorSet->DescriptorSets.data(),
+            DynamicOffsetCount,
+            Offsets.data()
+    );
+}
+
 VulkanMaterial::VulkanMaterial()
 {
     
@@ -358,7 +525,7 @@ void VulkanComputeMaterial::SetUniform(const std::string& name, VkDescriptorBuff
     dynOffsets[it->second.DynamicIndex] = (uint32)BufferView.offset;
 }
 
-void VulkanComputeMaterial::SetTexture(const std::string& name, Ref<VulkanTexture> texture)
+void VulkanComputeMaterial::SetTexture(const std::string& name, const Ref<VulkanTexture>& texture)
 {
     auto it = textures.find(name);
     if(it == textures.end())
@@ -379,7 +546,7 @@ void VulkanComputeMaterial::SetTexture(const std::string& name, Ref<VulkanTextur
     }
 }
 
-void VulkanComputeMaterial::SetStorageBuffer(const std::string& name, Ref<VulkanBuffer> buffer)
+void VulkanComputeMaterial::SetStorageBuffer(const std::string& name, const Ref<VulkanBuffer>& buffer)
 {
    auto it = storageBuffers.find(name);
     if(it == storageBuffers.end())
@@ -404,7 +571,7 @@ void VulkanComputeMaterial::SetStorageBuffer(const std::string& name, Ref<Vulkan
     }
 }
 
-void VulkanComputeMaterial::SetStorageTexture(const std::string& name, Ref<VulkanTexture> texture)
+void VulkanComputeMaterial::SetStorageTexture(const std::string& name, const Ref<VulkanTexture>& texture)
 {
     SetTexture(name,texture);
 }
@@ -25,13 +25,24 @@ namespace ReEngine
         uint32 Set = 0;
         uint32 Binding = 0;
         uint32 DynamicIndex = 0;
+        int32  Slot = -1;
         VkDescriptorType DescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         VkShaderStageFlags StageFlags = 0;
         VkDescriptorBufferInfo* BufferInfo;
     };
     
+    // 预编译的Uniform句柄，避免每次绘制都按名字查表
+    struct VulkanUniformSlot
+    {
+        uint32 DynamicIndex = 0;
+        uint32 DataSize = 0;
+    };
+    
     class VulkanMaterial
     {
+    public:
+        static constexpr int32 INVALID_UNIFORM_SLOT = -1;
+
     private:
         typedef std::unordered_map<std::string,VulkanSimulateBuffer> BuffersMap;
         typedef std::unordered_map<std::string,VulkanSimulateTexture> TexturesMap;
@@ -50,10 +61,25 @@ namespace ReEngine
         void SetLocalUniform(const std::string& name, void* dataPtr, uint32 size);
         void SetLocalUniform(const std::string& name,VkDescriptorBufferInfo BufferView);
         
-        void SetTexture(const std::string& name,Ref<VulkanTexture> texture);
-        void SetInputAttachment(const std::string& name, Ref<VulkanTexture> texture);
+        // 初始化时取一次句柄，之后绘制时不再做字符串哈希
+        int32 GetUniformSlot(const std::string& name) const;
+        void SetLocalUniform(int32 slot, void* dataPtr, uint32 size);
+        void SetLocalUniform(int32 slot, VkDescriptorBufferInfo BufferView);
+
+        // 批量上传：slots中的每个Uniform为DrawList里每个物体各占一块，按Ring的Chunk大小分段连续存放
+        // 偏移表按[drawIndex][slotIndex]排布，绘制第drawIndex个物体前调用ApplyUniformBatch
+        bool BeginUniformBatch(const std::vector<int32>& slots, uint32 drawCount);
+        void* GetBatchUniformData(uint32 drawIndex, uint32 slotIndex);
+        void SetBatchUniform(uint32 drawIndex, uint32 slotIndex, const void* dataPtr, uint32 size);
+        void ApplyUniformBatch(uint32 drawIndex);
+        // ApplyUniformBatch加BindDescriptorSets，偏移只写在线程自己的临时数组里，不改材质状态
+        // 多个录制线程可以同时调用，期间不能再SetLocalUniform或者BeginUniformBatch
+        void BindUniformBatch(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, uint32 drawIndex) const;
+        
+        void SetTexture(const std::string& name,const Ref<VulkanTexture>& texture);
+        void SetInputAttachment(const std::string& name, const Ref<VulkanTexture>& texture);
     
-        void SetStorageBuffer(const std::string& name, Ref<VulkanBuffer> buffer);
+        void SetStorageBuffer(const std::string& name, const Ref<VulkanBuffer>& buffer);
     public:
         VulkanMaterial();
 
@@ -74,11 +100,22 @@ namespace ReEngine
         BuffersMap              uniformBuffers;
         BuffersMap              storageBuffers;
         TexturesMap             textures;
+        std::vector<VulkanUniformSlot> uniformSlots;
 
         bool                    actived = false;
 
     private:
         Ref<VulkanDynamicBufferRing> RingBuffer;
+
+        // 当前批次
+        std::vector<int32>      batchSlots;
+        std::vector<uint32>     batchSlotOffsets;
+        std::vector<uint32>     batchOffsets;
+        // 每段的数据起点，一段最多batchDrawsPerAlloc个物体
+        std::vector<uint8*>     batchData;
+        uint32                  batchStride = 0;
+        uint32                  batchDrawsPerAlloc = 0;
+        uint32                  batchDrawCount = 0;
     };
 
     class VulkanComputeMaterial
@@ -102,10 +139,10 @@ namespace ReEngine
 
         void SetUniform(const std::string& name, void* dataPtr, uint32 size);
         void SetUniform(const std::string& name,VkDescriptorBufferInfo BufferView);
-        void SetTexture(const std::string& name,Ref<VulkanTexture> texture);
+        void SetTexture(const std::string& name,const Ref<VulkanTexture>& texture);
         
-        void SetStorageBuffer(const std::string& name, Ref<VulkanBuffer> buffer);
-        void SetStorageTexture(const std::string& name,Ref<VulkanTexture> texture);
+        void SetStorageBuffer(const std::string& name, const Ref<VulkanBuffer>& buffer);
+        void SetStorageTexture(const std::string& name,const Ref<VulkanTexture>& texture);
 
     public:
         FORCE_INLINE VkPipeline GetVkPipeline()const
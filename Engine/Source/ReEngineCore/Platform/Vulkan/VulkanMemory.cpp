@@ -3,18 +3,105 @@
 #include "VulkanDevice.h"
 #include "VulkanMemory.h"
 #include "glm/glm.hpp"
+#include "vk_mem_alloc.h"
 #include <algorithm>
+#include <bit>
 
 enum
 {
     GPU_ONLY_HEAP_PAGE_SIZE     = 256 * 1024 * 1024,
     STAGING_HEAP_PAGE_SIZE      = 32 * 1024 * 1024,
     ANDROID_MAX_HEAP_PAGE_SIZE  = 16 * 1024 * 1024,
+    // 空闲的页和Buffer保留几帧再还给驱动，避免反复申请释放
+    NUM_FRAMES_TO_WAIT_BEFORE_RELEASING_TO_OS = 3,
 };
 
 constexpr uint32 VulkanResourceHeapManager::m_PoolSizes[(int32)VulkanResourceHeapManager::PoolSizes::SizesCount];
 constexpr uint32 VulkanResourceHeapManager::m_BufferSizes[(int32)VulkanResourceHeapManager::PoolSizes::SizesCount + 1];
 
+// 每个线程持有的Buffer区间缓存，同一种(PoolSize, Usage, MemoryProperty)一个弹匣
+// Usage和MemoryProperty一律取区间所在Buffer的实际标记，分配时找标记包含请求的弹匣
+// 分配和释放都只操作本线程的弹匣，只有补充和溢出时才会加锁访问共享堆
+struct VulkanBufferMagazine
+{
+    struct Entry
+    {
+        VulkanSubBufferAllocator*   allocator;
+        VulkanSubAllocationRange    range;
+    };
+    
+    int32                   poolSize;
+    VkBufferUsageFlags      bufferUsageFlags;
+    VkMemoryPropertyFlags   memoryPropertyFlags;
+    std::vector<Entry>      entries;
+};
+
+struct VulkanThreadBufferCache
+{
+    VulkanResourceHeapManager*          owner = nullptr;
+    std::vector<VulkanBufferMagazine>   magazines;
+    
+    VulkanBufferMagazine& GetMagazine(int32 poolSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags)
+    {
+        for (int32 index = 0; index < magazines.size(); ++index)
+        {
+            VulkanBufferMagazine& magazine = magazines[index];
+            if (magazine.poolSize == poolSize && magazine.bufferUsageFlags == bufferUsageFlags && magazine.memoryPropertyFlags == memoryPropertyFlags) {
+                return magazine;
+            }
+        }
+        
+        VulkanBufferMagazine& magazine = magazines.emplace_back();
+        magazine.poolSize            = poolSize;
+        magazine.bufferUsageFlags    = bufferUsageFlags;
+        magazine.memoryPropertyFlags = memoryPropertyFlags;
+        return magazine;
+    }
+    
+    VulkanBufferMagazine* FindMagazine(int32 poolSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, uint32 alignment)
+    {
+        for (int32 index = 0; index < magazines.size(); ++index)
+        {
+            VulkanBufferMagazine& magazine = magazines[index];
+            if (magazine.poolSize != poolSize || magazine.entries.size() == 0) {
+                continue;
+            }
+            if ((magazine.bufferUsageFlags & bufferUsageFlags) != bufferUsageFlags || (magazine.memoryPropertyFlags & memoryPropertyFlags) != memoryPropertyFlags) {
+                continue;
+            }
+            // 区间是按放入时那次请求的对齐切分的
+            if (magazine.entries.back().range.alignedOffset % alignment == 0) {
+                return &magazine;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// 保护线程缓存的owner，线程退出和管理器销毁可能同时发生；先于管理器的m_ThreadBufferCachesLock加锁
+static std::mutex G_ThreadBufferCacheOwnerLock;
+
+struct VulkanThreadBufferCacheSlots
+{
+    std::vector<VulkanThreadBufferCache*> caches;
+    
+    ~VulkanThreadBufferCacheSlots()
+    {
+        std::lock_guard<std::mutex> lock(G_ThreadBufferCacheOwnerLock);
+        for (int32 index = 0; index < caches.size(); ++index)
+        {
+            VulkanThreadBufferCache* cache = caches[index];
+            if (cache->owner) {
+                cache->owner->ReleaseThreadBufferCache(cache);
+            }
+            delete cache;
+        }
+        caches.clear();
+    }
+};
+
+static thread_local VulkanThreadBufferCacheSlots G_ThreadBufferCacheSlots;
+
 // VulkanRange
 void VulkanRange::JoinConsecutiveRanges(std::vector<VulkanRange>& ranges)
 {
@@ -22,17 +109,8 @@ void VulkanRange::JoinConsecutiveRanges(std::vector<VulkanRange>& ranges)
         return;
     }
     
-    std::sort(ranges.begin(), ranges.end(), [](const VulkanRange& a, const VulkanRange& b) {
-        if (a.offset > b.offset) {
-            return 1;
-        }
-        else if (a.offset == b.offset) {
-            return 0;
-        }
-        else {
-            return -1;
-        }
-    });
+    // 按offset升序，原来的比较函数返回-1/0/1，转成bool之后不是严格弱序
+    std::sort(ranges.begin(), ranges.end());
     
     for (int32 index = (int32)ranges.size() - 1; index > 0; --index)
     {
@@ -46,6 +124,301 @@ void VulkanRange::JoinConsecutiveRanges(std::vector<VulkanRange>& ranges)
     }
 }
 
+// VulkanTLSFAllocator
+VulkanTLSFAllocator::VulkanTLSFAllocator()
+    : m_MaxSize(0)
+    , m_NumUsedBlocks(0)
+    , m_NumFreeBlocks(0)
+    , m_FLBitmap(0)
+{
+    memset(m_SLBitmap, 0, sizeof(m_SLBitmap));
+    memset(m_FreeHeads, 0xFF, sizeof(m_FreeHeads));
+}
+
+void VulkanTLSFAllocator::Init(uint32 maxSize)
+{
+    m_MaxSize       = maxSize;
+    m_NumUsedBlocks = 0;
+    m_NumFreeBlocks = 0;
+    m_FLBitmap      = 0;
+    memset(m_SLBitmap, 0, sizeof(m_SLBitmap));
+    memset(m_FreeHeads, 0xFF, sizeof(m_FreeHeads));
+    m_Blocks.clear();
+    m_UnusedBlocks.clear();
+    m_UsedBlocks.clear();
+
+    if (maxSize > 0) {
+        InsertFreeBlock(CreateBlock(0, maxSize));
+    }
+}
+
+void VulkanTLSFAllocator::MappingInsert(uint32 size, uint32& outFL, uint32& outSL)
+{
+    if (size < SMALL_BLOCK_SIZE)
+    {
+        outFL = 0;
+        outSL = size;
+    }
+    else
+    {
+        uint32 msb = std::bit_width(size) - 1;
+        outFL = msb - SL_INDEX_COUNT_LOG2 + 1;
+        outSL = (size >> (msb - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+    }
+}
+
+void VulkanTLSFAllocator::MappingSearch(uint64 size, uint32& outFL, uint32& outSL)
+{
+    // 向上取整到下一个区间，保证从该区间取出的任意块都能容纳请求
+    if (size >= SMALL_BLOCK_SIZE)
+    {
+        uint32 msb = std::bit_width(size) - 1;
+        size += (1ull << (msb - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+
+    if (size > 0xFFFFFFFFull)
+    {
+        outFL = FL_INDEX_COUNT;
+        outSL = 0;
+        return;
+    }
+
+    MappingInsert((uint32)size, outFL, outSL);
+}
+
+uint32 VulkanTLSFAllocator::FindSuitableBlock(uint32& inOutFL, uint32& inOutSL) const
+{
+    if (inOutFL >= FL_INDEX_COUNT) {
+        return INVALID_BLOCK;
+    }
+
+    uint32 slMap = m_SLBitmap[inOutFL] & (~0u << inOutSL);
+    if (slMap == 0)
+    {
+        uint32 flMap = inOutFL + 1 < 32 ? (m_FLBitmap & (~0u << (inOutFL + 1))) : 0;
+        if (flMap == 0) {
+            return INVALID_BLOCK;
+        }
+        inOutFL = std::countr_zero(flMap);
+        slMap   = m_SLBitmap[inOutFL];
+    }
+
+    inOutSL = std::countr_zero(slMap);
+    return m_FreeHeads[inOutFL][inOutSL];
+}
+
+uint32 VulkanTLSFAllocator::CreateBlock(uint32 offset, uint32 size)
+{
+    uint32 blockIndex = INVALID_BLOCK;
+    if (m_UnusedBlocks.size() > 0)
+    {
+        blockIndex = m_UnusedBlocks.back();
+        m_UnusedBlocks.pop_back();
+    }
+    else
+    {
+        blockIndex = (uint32)m_Blocks.size();
+        m_Blocks.emplace_back();
+    }
+
+    Block& block       = m_Blocks[blockIndex];
+    block.offset       = offset;
+    block.size         = size;
+    block.prevPhysical = INVALID_BLOCK;
+    block.nextPhysical = INVALID_BLOCK;
+    block.prevFree     = INVALID_BLOCK;
+    block.nextFree     = INVALID_BLOCK;
+    block.free         = false;
+    return blockIndex;
+}
+
+void VulkanTLSFAllocator::DestroyBlock(uint32 blockIndex)
+{
+    m_UnusedBlocks.push_back(blockIndex);
+}
+
+void VulkanTLSFAllocator::InsertFreeBlock(uint32 blockIndex)
+{
+    Block& block = m_Blocks[blockIndex];
+    uint32 fl = 0;
+    uint32 sl = 0;
+    MappingInsert(block.size, fl, sl);
+
+    uint32 head    = m_FreeHeads[fl][sl];
+    block.free     = true;
+    block.prevFree = INVALID_BLOCK;
+    block.nextFree = head;
+    if (head != INVALID_BLOCK) {
+        m_Blocks[head].prevFree = blockIndex;
+    }
+
+    m_FreeHeads[fl][sl] = blockIndex;
+    m_FLBitmap         |= 1u << fl;
+    m_SLBitmap[fl]     |= 1u << sl;
+    m_NumFreeBlocks    += 1;
+}
+
+void VulkanTLSFAllocator::RemoveFreeBlock(uint32 blockIndex)
+{
+    Block& block = m_Blocks[blockIndex];
+    uint32 fl = 0;
+    uint32 sl = 0;
+    MappingInsert(block.size, fl, sl);
+
+    if (block.prevFree != INVALID_BLOCK) {
+        m_Blocks[block.prevFree].nextFree = block.nextFree;
+    }
+    if (block.nextFree != INVALID_BLOCK) {
+        m_Blocks[block.nextFree].prevFree = block.prevFree;
+    }
+
+    if (m_FreeHeads[fl][sl] == blockIndex)
+    {
+        m_FreeHeads[fl][sl] = block.nextFree;
+        if (block.nextFree == INVALID_BLOCK)
+        {
+            m_SLBitmap[fl] &= ~(1u << sl);
+            if (m_SLBitmap[fl] == 0) {
+                m_FLBitmap &= ~(1u << fl);
+            }
+        }
+    }
+
+    block.free      = false;
+    block.prevFree  = INVALID_BLOCK;
+    block.nextFree  = INVALID_BLOCK;
+    m_NumFreeBlocks -= 1;
+}
+
+bool VulkanTLSFAllocator::Allocate(uint32 size, uint32 alignment, uint32& outAllocationOffset, uint32& outAllocationSize, uint32& outAlignedOffset)
+{
+    // 旧的空闲链表允许0字节分配，这里按1字节处理，保证每次分配都有独立的块
+    size = glm::max(size, 1u);
+    if (size > m_MaxSize) {
+        return false;
+    }
+
+    alignment = glm::max(alignment, 1u);
+
+    // 预留最坏情况下的对齐补齐，块的起始地址未知
+    uint32 fl = 0;
+    uint32 sl = 0;
+    MappingSearch((uint64)size + alignment - 1, fl, sl);
+
+    uint32 blockIndex = FindSuitableBlock(fl, sl);
+    if (blockIndex == INVALID_BLOCK)
+    {
+        // 可能存在对齐后恰好能放下的块，退化为在同一区间内精确查找
+        MappingInsert(size, fl, sl);
+        for (uint32 candidate = m_FreeHeads[fl][sl]; candidate != INVALID_BLOCK; candidate = m_Blocks[candidate].nextFree)
+        {
+            const Block& block = m_Blocks[candidate];
+            if ((uint64)Align(block.offset, alignment) - block.offset + size <= block.size)
+            {
+                blockIndex = candidate;
+                break;
+            }
+        }
+
+        if (blockIndex == INVALID_BLOCK) {
+            return false;
+        }
+    }
+
+    RemoveFreeBlock(blockIndex);
+
+    uint32 blockOffset         = m_Blocks[blockIndex].offset;
+    uint32 alignedOffset       = Align(blockOffset, alignment);
+    uint32 allocatedSize       = alignedOffset - blockOffset + size;
+
+    if (allocatedSize < m_Blocks[blockIndex].size)
+    {
+        uint32 remainIndex = CreateBlock(blockOffset + allocatedSize, m_Blocks[blockIndex].size - allocatedSize);
+        Block& block       = m_Blocks[blockIndex];
+        Block& remain      = m_Blocks[remainIndex];
+        remain.prevPhysical = blockIndex;
+        remain.nextPhysical = block.nextPhysical;
+        if (block.nextPhysical != INVALID_BLOCK) {
+            m_Blocks[block.nextPhysical].prevPhysical = remainIndex;
+        }
+        block.nextPhysical = remainIndex;
+        block.size         = allocatedSize;
+        InsertFreeBlock(remainIndex);
+    }
+
+    m_UsedBlocks[blockOffset] = blockIndex;
+    m_NumUsedBlocks += 1;
+
+    outAllocationOffset = blockOffset;
+    outAllocationSize   = allocatedSize;
+    outAlignedOffset    = alignedOffset;
+
+    return true;
+}
+
+bool VulkanTLSFAllocator::Free(uint32 allocationOffset)
+{
+    auto it = m_UsedBlocks.find(allocationOffset);
+    if (it == m_UsedBlocks.end())
+    {
+        RE_CORE_ERROR("Free unknown block at offset {0}.", allocationOffset);
+        return false;
+    }
+
+    uint32 blockIndex = it->second;
+    m_UsedBlocks.erase(it);
+    m_NumUsedBlocks -= 1;
+
+    // 与前一个物理块合并
+    uint32 prevIndex = m_Blocks[blockIndex].prevPhysical;
+    if (prevIndex != INVALID_BLOCK && m_Blocks[prevIndex].free)
+    {
+        RemoveFreeBlock(prevIndex);
+        Block& prev  = m_Blocks[prevIndex];
+        Block& block = m_Blocks[blockIndex];
+        prev.size         += block.size;
+        prev.nextPhysical  = block.nextPhysical;
+        if (block.nextPhysical != INVALID_BLOCK) {
+            m_Blocks[block.nextPhysical].prevPhysical = prevIndex;
+        }
+        DestroyBlock(blockIndex);
+        blockIndex = prevIndex;
+    }
+
+    // 与后一个物理块合并
+    uint32 nextIndex = m_Blocks[blockIndex].nextPhysical;
+    if (nextIndex != INVALID_BLOCK && m_Blocks[nextIndex].free)
+    {
+        RemoveFreeBlock(nextIndex);
+        Block& block = m_Blocks[blockIndex];
+        Block& next  = m_Blocks[nextIndex];
+        block.size         += next.size;
+        block.nextPhysical  = next.nextPhysical;
+        if (next.nextPhysical != INVALID_BLOCK) {
+            m_Blocks[next.nextPhysical].prevPhysical = blockIndex;
+        }
+        DestroyBlock(nextIndex);
+    }
+
+    InsertFreeBlock(blockIndex);
+    return true;
+}
+
+uint32 VulkanTLSFAllocator::GetLargestFreeBlock() const
+{
+    if (m_FLBitmap == 0) {
+        return 0;
+    }
+
+    uint32 fl = 31 - std::countl_zero(m_FLBitmap);
+    uint32 sl = 31 - std::countl_zero(m_SLBitmap[fl]);
+    uint32 largest = 0;
+    for (uint32 blockIndex = m_FreeHeads[fl][sl]; blockIndex != INVALID_BLOCK; blockIndex = m_Blocks[blockIndex].nextFree) {
+        largest = glm::max(largest, m_Blocks[blockIndex].size);
+    }
+    return largest;
+}
+
 // VulkanDeviceMemoryAllocation
 VulkanDeviceMemoryAllocation::VulkanDeviceMemoryAllocation()
 	: m_Size(0)
@@ -53,6 +426,7 @@ VulkanDeviceMemoryAllocation::VulkanDeviceMemoryAllocation()
 	, m_Handle(VK_NULL_HANDLE)
 	, m_MappedPointer(nullptr)
 	, m_MemoryTypeIndex(0)
+	, m_Category(VulkanMemoryCategory::Unknown)
 	, m_CanBeMapped(false)
 	, m_IsCoherent(false)
 	, m_IsCached(false)
@@ -110,6 +484,7 @@ VulkanDeviceMemoryManager::VulkanDeviceMemoryManager()
     , m_HasUnifiedMemory(false)
     , m_NumAllocations(0)
     , m_PeakNumAllocations(0)
+    , m_EvictionHandleCounter(0)
 {
     memset(&m_MemoryProperties, 0, sizeof(VkPhysicalDeviceMemoryProperties));
 }
@@ -130,6 +505,13 @@ void VulkanDeviceMemoryManager::Init(VulkanDevice* device)
     m_HeapInfos.resize(m_MemoryProperties.memoryHeapCount);
 
     SetupAndPrintMemInfo();
+    
+    // 默认硬上限为堆的可用大小，软上限留出余量给回收
+    for (int32 index = 0; index < m_HeapInfos.size(); ++index)
+    {
+        m_HeapInfos[index].hardLimit = m_HeapInfos[index].totalSize;
+        m_HeapInfos[index].softLimit = (uint64)((double)m_HeapInfos[index].totalSize * 0.85);
+    }
 }
 
 void VulkanDeviceMemoryManager::Destory()
@@ -146,6 +528,11 @@ void VulkanDeviceMemoryManager::Destory()
         }
     }
     m_NumAllocations = 0;
+
+    VulkanMemoryTracker::GetInstance().ReportLeaks();
+    
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    m_EvictionHandlers.clear();
 }
 
 bool VulkanDeviceMemoryManager::SupportsMemoryType(VkMemoryPropertyFlags properties) const
@@ -159,8 +546,15 @@ bool VulkanDeviceMemoryManager::SupportsMemoryType(VkMemoryPropertyFlags propert
     return false;
 }
 
-VulkanDeviceMemoryAllocation* VulkanDeviceMemoryManager::Alloc(bool canFail, VkDeviceSize allocationSize, uint32 memoryTypeIndex, void* dedicatedAllocateInfo, const char* file, uint32 line)
+VulkanDeviceMemoryAllocation* VulkanDeviceMemoryManager::Alloc(bool canFail, VkDeviceSize allocationSize, uint32 memoryTypeIndex, void* dedicatedAllocateInfo, const char* file, uint32 line, VulkanMemoryCategory category)
 {
+    uint32 heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    if (!RequestBudget(heapIndex, allocationSize, canFail))
+    {
+        RE_CORE_WARN("Over memory budget, Requested={0}Kb Heap={1} Category={2}", (float)allocationSize / 1024.0f, heapIndex, GetMemoryCategoryName(category));
+        return nullptr;
+    }
+    
     VkMemoryAllocateInfo allocInfo;
     ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO);
     allocInfo.allocationSize  = allocationSize;
@@ -171,12 +565,18 @@ VulkanDeviceMemoryAllocation* VulkanDeviceMemoryManager::Alloc(bool canFail, VkD
     newAllocation->m_Device          = m_DeviceHandle;
     newAllocation->m_Size            = allocationSize;
     newAllocation->m_MemoryTypeIndex = memoryTypeIndex;
+    newAllocation->m_Category        = category;
     newAllocation->m_CanBeMapped     = ((m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)  == VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
     newAllocation->m_IsCoherent      = ((m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
     newAllocation->m_IsCached        = ((m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)   == VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
     
     VkResult result = vkAllocateMemory(m_DeviceHandle, &allocInfo, VULKAN_CPU_ALLOCATOR, &newAllocation->m_Handle);
     
+    // 驱动分配失败时先让流式资源回收一次再重试
+    if ((result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) && Evict(heapIndex, allocationSize) > 0) {
+        result = vkAllocateMemory(m_DeviceHandle, &allocInfo, VULKAN_CPU_ALLOCATOR, &newAllocation->m_Handle);
+    }
+    
     if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
     {
         if (canFail)
@@ -212,10 +612,9 @@ VulkanDeviceMemoryAllocation* VulkanDeviceMemoryManager::Alloc(bool canFail, VkD
         RE_CORE_INFO("Hit Maximum # of allocations (%d) reported by device!", m_NumAllocations);
     }
     
-    uint32 heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
     m_HeapInfos[heapIndex].allocations.push_back(newAllocation);
-    m_HeapInfos[heapIndex].usedSize += allocationSize;
-    m_HeapInfos[heapIndex].peakSize = glm::max(m_HeapInfos[heapIndex].peakSize, m_HeapInfos[heapIndex].usedSize);
+    AddHeapUsage(heapIndex, category, allocationSize);
+    VulkanMemoryTracker::GetInstance().TrackAllocation(VulkanMemoryTrackKind::DeviceMemory, newAllocation, allocationSize, memoryTypeIndex, file, line);
     
     return newAllocation;
 }
@@ -223,10 +622,11 @@ VulkanDeviceMemoryAllocation* VulkanDeviceMemoryManager::Alloc(bool canFail, VkD
 void VulkanDeviceMemoryManager::Free(VulkanDeviceMemoryAllocation*& allocation)
 {
     m_NumAllocations -= 1;
+    VulkanMemoryTracker::GetInstance().UntrackAllocation(allocation);
 
     vkFreeMemory(m_DeviceHandle, allocation->m_Handle, VULKAN_CPU_ALLOCATOR);
     uint32 heapIndex = m_MemoryProperties.memoryTypes[allocation->m_MemoryTypeIndex].heapIndex;
-    m_HeapInfos[heapIndex].usedSize -= allocation->m_Size;
+    RemoveHeapUsage(heapIndex, allocation->m_Category, allocation->m_Size);
     
     auto it = std::find(m_HeapInfos[heapIndex].allocations.begin(), m_HeapInfos[heapIndex].allocations.end(), allocation);
     if (it != m_HeapInfos[heapIndex].allocations.end()) {
@@ -272,6 +672,158 @@ uint64 VulkanDeviceMemoryManager::GetTotalMemory(bool gpu) const
     return totalMemory;
 }
 
+uint32 VulkanDeviceMemoryManager::RegisterEvictionCallback(VulkanMemoryCategory category, int32 priority, EvictionCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    
+    EvictionHandler handler;
+    handler.handle   = ++m_EvictionHandleCounter;
+    handler.category = category;
+    handler.priority = priority;
+    handler.callback = std::move(callback);
+    
+    auto it = std::upper_bound(m_EvictionHandlers.begin(), m_EvictionHandlers.end(), priority, [](int32 value, const EvictionHandler& other) {
+        return value < other.priority;
+    });
+    m_EvictionHandlers.insert(it, std::move(handler));
+    
+    return m_EvictionHandleCounter;
+}
+
+void VulkanDeviceMemoryManager::UnregisterEvictionCallback(uint32 handle)
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    for (int32 index = 0; index < m_EvictionHandlers.size(); ++index)
+    {
+        if (m_EvictionHandlers[index].handle == handle)
+        {
+            m_EvictionHandlers.erase(m_EvictionHandlers.begin() + index);
+            break;
+        }
+    }
+}
+
+void VulkanDeviceMemoryManager::SetHeapBudget(uint32 heapIndex, uint64 softLimit, uint64 hardLimit)
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    m_HeapInfos[heapIndex].hardLimit = hardLimit;
+    m_HeapInfos[heapIndex].softLimit = glm::min(softLimit, hardLimit);
+}
+
+bool VulkanDeviceMemoryManager::RequestBudget(uint32 heapIndex, VkDeviceSize size, bool canFail)
+{
+    uint64 projectedSize = 0;
+    uint64 softLimit     = 0;
+    uint64 hardLimit     = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_BudgetLock);
+        projectedSize = m_HeapInfos[heapIndex].usedSize + size;
+        softLimit     = m_HeapInfos[heapIndex].softLimit;
+        hardLimit     = m_HeapInfos[heapIndex].hardLimit;
+    }
+    
+    if (projectedSize <= softLimit) {
+        return true;
+    }
+    
+    // 不按回调的返回值扣减，回收之后重新读一次实际用量，没来得及释放的不算
+    Evict(heapIndex, projectedSize - softLimit);
+    {
+        std::lock_guard<std::mutex> lock(m_BudgetLock);
+        projectedSize = m_HeapInfos[heapIndex].usedSize + size;
+    }
+    
+    if (projectedSize > hardLimit)
+    {
+        RE_CORE_WARN("Heap {0} over hard budget, used {1} MB, limit {2} MB", heapIndex, (float)((double)projectedSize / 1024.0 / 1024.0), (float)((double)hardLimit / 1024.0 / 1024.0));
+        return !canFail;
+    }
+    
+    return true;
+}
+
+uint64 VulkanDeviceMemoryManager::Evict(uint32 heapIndex, uint64 bytesToFree)
+{
+    std::vector<EvictionHandler> handlers;
+    {
+        std::lock_guard<std::mutex> lock(m_BudgetLock);
+        for (int32 index = 0; index < m_EvictionHandlers.size(); ++index)
+        {
+            const EvictionHandler& handler = m_EvictionHandlers[index];
+            if (m_HeapInfos[heapIndex].categorySize[(int32)handler.category] > 0) {
+                handlers.push_back(handler);
+            }
+        }
+    }
+    
+    uint64 evictedSize = 0;
+    for (int32 index = 0; index < handlers.size() && evictedSize < bytesToFree; ++index) {
+        evictedSize += handlers[index].callback(heapIndex, bytesToFree - evictedSize);
+    }
+    
+    if (evictedSize > 0) {
+        RE_CORE_INFO("Evicted {0} Kb from heap {1}, requested {2} Kb", (float)evictedSize / 1024.0f, heapIndex, (float)bytesToFree / 1024.0f);
+    }
+    
+    return evictedSize;
+}
+
+void VulkanDeviceMemoryManager::TrackResource(VulkanMemoryCategory category, uint32 memoryTypeIndex, VkDeviceSize size, const void* allocation, const char* file, uint32 line)
+{
+    AddHeapUsage(GetHeapIndex(memoryTypeIndex), category, size);
+    VulkanMemoryTracker::GetInstance().TrackAllocation(VulkanMemoryTrackKind::Vma, allocation, size, memoryTypeIndex, file, line);
+}
+
+void VulkanDeviceMemoryManager::UntrackResource(VulkanMemoryCategory category, uint32 memoryTypeIndex, VkDeviceSize size, const void* allocation)
+{
+    VulkanMemoryTracker::GetInstance().UntrackAllocation(allocation);
+    RemoveHeapUsage(GetHeapIndex(memoryTypeIndex), category, size);
+}
+
+void VulkanDeviceMemoryManager::AddHeapUsage(uint32 heapIndex, VulkanMemoryCategory category, VkDeviceSize size)
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    HeapInfo& heapInfo = m_HeapInfos[heapIndex];
+    heapInfo.usedSize += size;
+    heapInfo.peakSize  = glm::max(heapInfo.peakSize, heapInfo.usedSize);
+    heapInfo.categorySize[(int32)category] += size;
+}
+
+void VulkanDeviceMemoryManager::RemoveHeapUsage(uint32 heapIndex, VulkanMemoryCategory category, VkDeviceSize size)
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    HeapInfo& heapInfo = m_HeapInfos[heapIndex];
+    heapInfo.usedSize -= size;
+    heapInfo.categorySize[(int32)category] -= size;
+}
+
+VulkanHeapBudget VulkanDeviceMemoryManager::GetHeapBudget(uint32 heapIndex) const
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    const HeapInfo& heapInfo = m_HeapInfos[heapIndex];
+    
+    VulkanHeapBudget budget;
+    budget.totalSize = heapInfo.totalSize;
+    budget.softLimit = heapInfo.softLimit;
+    budget.hardLimit = heapInfo.hardLimit;
+    budget.usedSize  = heapInfo.usedSize;
+    budget.peakSize  = heapInfo.peakSize;
+    for (int32 index = 0; index < (int32)VulkanMemoryCategory::Count; ++index) {
+        budget.categorySize[index] = heapInfo.categorySize[index];
+    }
+    return budget;
+}
+
+uint64 VulkanDeviceMemoryManager::GetCategoryUsage(VulkanMemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_BudgetLock);
+    uint64 usedSize = 0;
+    for (int32 index = 0; index < m_HeapInfos.size(); ++index) {
+        usedSize += m_HeapInfos[index].categorySize[(int32)category];
+    }
+    return usedSize;
+}
+
 void VulkanDeviceMemoryManager::SetupAndPrintMemInfo()
 {
     const uint32 maxAllocations = m_Device->GetLimits().maxMemoryAllocationCount;
@@ -342,11 +894,12 @@ VulkanResourceAllocation::VulkanResourceAllocation(VulkanResourceHeapPage* owner
     , m_AlignedOffset(alignedOffset)
     , m_DeviceMemoryAllocation(deviceMemoryAllocation)
 {
-
+    VulkanMemoryTracker::GetInstance().TrackAllocation(VulkanMemoryTrackKind::Resource, this, allocationSize, deviceMemoryAllocation->GetMemoryTypeIndex(), file, line);
 }
 
 VulkanResourceAllocation::~VulkanResourceAllocation()
 {
+    VulkanMemoryTracker::GetInstance().UntrackAllocation(this);
     m_Owner->ReleaseAllocation(this);
 }
 
@@ -385,11 +938,7 @@ VulkanResourceHeapPage::VulkanResourceHeapPage(VulkanResourceHeap* owner, Vulkan
     , m_ID(id)
 {
     m_MaxSize = (uint32)m_DeviceMemoryAllocation->GetSize();
-
-    VulkanRange fullRange;
-    fullRange.offset = 0;
-    fullRange.size   = m_MaxSize;
-    m_FreeList.push_back(fullRange);
+    m_FreeBlocks.Init(m_MaxSize);
 }
 
 VulkanResourceHeapPage::~VulkanResourceHeapPage()
@@ -405,13 +954,17 @@ void VulkanResourceHeapPage::ReleaseAllocation(VulkanResourceAllocation* allocat
     if (it != m_ResourceAllocations.end())
     {
         m_ResourceAllocations.erase(it);
-        VulkanRange newFree;
-        newFree.offset = allocation->m_AllocationOffset;
-        newFree.size   = allocation->m_AllocationSize;
-        m_FreeList.push_back(newFree);
+        // GPU可能还在使用这段内存，等对应的帧执行完再归还
+        m_Owner->GetOwner()->DeferReleaseRange(this, allocation->m_AllocationOffset, allocation->m_AllocationSize);
+    }
+}
+
+void VulkanResourceHeapPage::ReleaseRange(uint32 allocationOffset, uint32 allocationSize)
+{
+    if (m_FreeBlocks.Free(allocationOffset)) {
+        m_UsedSize -= allocationSize;
     }
     
-    m_UsedSize -= allocation->m_AllocationSize;
     if (m_UsedSize < 0) {
         RE_CORE_ERROR("Used size less than zero.");
     }
@@ -423,50 +976,33 @@ void VulkanResourceHeapPage::ReleaseAllocation(VulkanResourceAllocation* allocat
 
 VulkanResourceAllocation* VulkanResourceHeapPage::TryAllocate(uint32 size, uint32 alignment, const char* file, uint32 line)
 {
-    for (int32 index = 0; index < m_FreeList.size(); ++index)
-    {
-        VulkanRange& entry         = m_FreeList[index];
-        uint32 allocatedOffset     = entry.offset;
-        uint32 alignedOffset       = Align(entry.offset, alignment);
-        uint32 alignmentAdjustment = alignedOffset - entry.offset;
-        uint32 allocatedSize       = alignmentAdjustment + size;
-
-        if (allocatedSize <= entry.size)
-        {
-            if (allocatedSize < entry.size) {
-                entry.size   -= allocatedSize;
-                entry.offset += allocatedSize;
-            }
-            else {
-                m_FreeList.erase(m_FreeList.begin() + index);
-            }
-            m_UsedSize += allocatedSize;
-            VulkanResourceAllocation* newResourceAllocation = new VulkanResourceAllocation(this, m_DeviceMemoryAllocation, size, alignedOffset, allocatedSize, allocatedOffset, file, line);
-            m_ResourceAllocations.push_back(newResourceAllocation);
-            m_PeakNumAllocations = glm::max((uint32)m_PeakNumAllocations, (uint32)m_ResourceAllocations.size());
-            
-            return newResourceAllocation;
-        }
+    uint32 allocatedOffset = 0;
+    uint32 allocatedSize   = 0;
+    uint32 alignedOffset   = 0;
+    if (!m_FreeBlocks.Allocate(size, alignment, allocatedOffset, allocatedSize, alignedOffset)) {
+        return nullptr;
     }
+
+    m_UsedSize += allocatedSize;
+    VulkanResourceAllocation* newResourceAllocation = new VulkanResourceAllocation(this, m_DeviceMemoryAllocation, size, alignedOffset, allocatedSize, allocatedOffset, file, line);
+    m_ResourceAllocations.push_back(newResourceAllocation);
+    m_PeakNumAllocations = glm::max((uint32)m_PeakNumAllocations, (uint32)m_ResourceAllocations.size());
     
-    return nullptr;
+    return newResourceAllocation;
 }
 
 bool VulkanResourceHeapPage::JoinFreeBlocks()
 {
-    VulkanRange::JoinConsecutiveRanges(m_FreeList);
-    if (m_FreeList.size() == 1)
+    // 释放时已经立即合并了相邻空闲块，这里只需要检查页是否已经完全空闲
+    if (m_FreeBlocks.IsEmpty() && m_ResourceAllocations.size() == 0)
     {
-        if (m_ResourceAllocations.size() == 0)
-        {
-            if (m_UsedSize > 0) {
-                RE_CORE_WARN("Memory leak, used size = {0}", (int32)m_UsedSize);
-            }
-            if (m_FreeList[0].offset != 0 || m_FreeList[0].size != m_MaxSize) {
-                RE_CORE_WARN("Memory leak, should have {0} free, only have {1}; missing {2} bytes", m_MaxSize, m_FreeList[0].size, m_MaxSize - m_FreeList[0].size);
-            }
-            return true;
+        if (m_UsedSize > 0) {
+            RE_CORE_WARN("Memory leak, used size = {0}", (int32)m_UsedSize);
+        }
+        if (m_FreeBlocks.GetNumFreeBlocks() != 1 || m_FreeBlocks.GetLargestFreeBlock() != m_MaxSize) {
+            RE_CORE_WARN("Memory leak, should have {0} free, only have {1}; missing {2} bytes", m_MaxSize, m_FreeBlocks.GetLargestFreeBlock(), m_MaxSize - m_FreeBlocks.GetLargestFreeBlock());
         }
+        return true;
     }
     
     return false;
@@ -549,22 +1085,25 @@ void VulkanResourceHeap::FreePage(VulkanResourceHeapPage* page)
     
     if (removed)
     {
-        page->m_FrameFreed = 0;
+        page->m_FrameFreed = m_Owner->GetCurrentFrame();
         m_FreePages.push_back(page);
     }
 }
 
 void VulkanResourceHeap::ReleaseFreedPages(bool immediately)
 {
-    for (int32 index = 0; index < m_FreePages.size(); ++index)
+    const uint64 currentFrame = m_Owner->GetCurrentFrame();
+    for (int32 index = (int32)m_FreePages.size() - 1; index >= 0; --index)
     {
         VulkanResourceHeapPage* page = m_FreePages[index];
-        m_UsedMemory -= page->m_MaxSize;
-        m_Owner->GetVulkanDevice()->GetMemoryManager().Free(page->m_DeviceMemoryAllocation);
-        delete page;
+        if (immediately || page->m_FrameFreed + NUM_FRAMES_TO_WAIT_BEFORE_RELEASING_TO_OS < currentFrame)
+        {
+            m_UsedMemory -= page->m_MaxSize;
+            m_Owner->GetVulkanDevice()->GetMemoryManager().Free(page->m_DeviceMemoryAllocation);
+            delete page;
+            m_FreePages.erase(m_FreePages.begin() + index);
+        }
     }
-    
-    m_FreePages.clear();
 }
 
 void VulkanResourceHeap::DumpMemory()
@@ -582,7 +1121,7 @@ void VulkanResourceHeap::DumpMemory()
             subAllocUsedMemory      += usedPages[index]->m_UsedSize;
             subAllocAllocatedMemory += usedPages[index]->m_MaxSize;
             numSubAllocations       += (uint32)usedPages[index]->m_ResourceAllocations.size();
-            RE_CORE_INFO("\t\t{0}: ID {1} {2} suballocs, {3}d free chunks ({4} used/{5} free/{6} max) DeviceMemory {7}", index, usedPages[index]->GetID(), (int32)usedPages[index]->m_ResourceAllocations.size(), (int32)usedPages[index]->m_FreeList.size(), usedPages[index]->m_UsedSize, usedPages[index]->m_MaxSize - usedPages[index]->m_UsedSize, usedPages[index]->m_MaxSize, (void*)usedPages[index]->m_DeviceMemoryAllocation->GetHandle());
+            RE_CORE_INFO("\t\t{0}: ID {1} {2} suballocs, {3}d free chunks ({4} used/{5} free/{6} max) DeviceMemory {7}", index, usedPages[index]->GetID(), (int32)usedPages[index]->m_ResourceAllocations.size(), (int32)usedPages[index]->m_FreeBlocks.GetNumFreeBlocks(), usedPages[index]->m_UsedSize, usedPages[index]->m_MaxSize - usedPages[index]->m_UsedSize, usedPages[index]->m_MaxSize, (void*)usedPages[index]->m_DeviceMemoryAllocation->GetHandle());
         }
         
         RE_CORE_INFO("{0} Suballocations for Used/Total: {1}/{2} = {3}%%", numSubAllocations, (int32)subAllocUsedMemory, (int32)subAllocAllocatedMemory, subAllocAllocatedMemory > 0 ? 100.0f * (float)subAllocUsedMemory / (float)subAllocAllocatedMemory : 0.0f);
@@ -673,6 +1212,7 @@ VulkanBufferSubAllocation::VulkanBufferSubAllocation(VulkanSubBufferAllocator* o
 
 VulkanBufferSubAllocation::~VulkanBufferSubAllocation()
 {
+    VulkanMemoryTracker::GetInstance().UntrackAllocation(this);
     m_Owner->Release(this);
 }
 
@@ -690,13 +1230,10 @@ VulkanSubResourceAllocator::VulkanSubResourceAllocator(VulkanResourceHeapManager
     , m_Alignment(alignment)
     , m_FrameFreed(0)
     , m_UsedSize(0)
+    , m_NumSubAllocations(0)
 {
     m_MaxSize = (uint32)deviceMemoryAllocation->GetSize();
-
-    VulkanRange fullRange;
-    fullRange.offset = 0;
-    fullRange.size   = m_MaxSize;
-    m_FreeList.push_back(fullRange);
+    m_FreeBlocks.Init(m_MaxSize);
 }
 
 VulkanSubResourceAllocator::~VulkanSubResourceAllocator()
@@ -705,48 +1242,48 @@ VulkanSubResourceAllocator::~VulkanSubResourceAllocator()
 }
 
 VulkanResourceSubAllocation* VulkanSubResourceAllocator::TryAllocateNoLocking(uint32 size, uint32 alignment, const char* file, uint32 line)
+{
+    VulkanSubAllocationRange range;
+    if (!TryAllocateRange(size, alignment, range)) {
+        return nullptr;
+    }
+    VulkanResourceSubAllocation* subAllocation = CreateSubAllocation(range.requestedSize, range.alignedOffset, range.allocationSize, range.allocationOffset);
+    VulkanMemoryTracker::GetInstance().TrackAllocation(VulkanMemoryTrackKind::SubBuffer, subAllocation, range.allocationSize, m_MemoryTypeIndex, file, line);
+    return subAllocation;
+}
+
+bool VulkanSubResourceAllocator::TryAllocateRange(uint32 size, uint32 alignment, VulkanSubAllocationRange& outRange)
 {
     m_Alignment = glm::max(m_Alignment, alignment);
-    for (int32 index = 0; index < m_FreeList.size(); ++index)
-    {
-        VulkanRange& entry         = m_FreeList[index];
-        uint32 allocatedOffset     = entry.offset;
-        uint32 alignedOffset       = Align(entry.offset, m_Alignment);
-        uint32 alignmentAdjustment = alignedOffset - entry.offset;
-        uint32 allocatedSize       = alignmentAdjustment + size;
 
-        if (allocatedSize <= entry.size)
-        {
-            if (allocatedSize < entry.size)
-            {
-                entry.size   -= allocatedSize;
-                entry.offset += allocatedSize;
-            }
-            else {
-                m_FreeList.erase(m_FreeList.begin() + index);
-            }
-            m_UsedSize += allocatedSize;
-            VulkanResourceSubAllocation* newSubAllocation = CreateSubAllocation(size, alignedOffset, allocatedSize, allocatedOffset);
-            m_SubAllocations.push_back(newSubAllocation);
-            return newSubAllocation;
-        }
+    if (!m_FreeBlocks.Allocate(size, m_Alignment, outRange.allocationOffset, outRange.allocationSize, outRange.alignedOffset)) {
+        return false;
     }
-    
-    return nullptr;
+
+    outRange.requestedSize = size;
+    m_UsedSize            += outRange.allocationSize;
+    m_NumSubAllocations   += 1;
+    return true;
+}
+
+bool VulkanSubResourceAllocator::ReleaseRange(const VulkanSubAllocationRange& range)
+{
+    if (m_FreeBlocks.Free(range.allocationOffset))
+    {
+        m_UsedSize          -= range.allocationSize;
+        m_NumSubAllocations -= 1;
+    }
+    return JoinFreeBlocks();
 }
 
 bool VulkanSubResourceAllocator::JoinFreeBlocks()
 {
-    VulkanRange::JoinConsecutiveRanges(m_FreeList);
-    if (m_FreeList.size() == 1)
+    if (m_FreeBlocks.IsEmpty() && m_NumSubAllocations == 0)
     {
-        if (m_SubAllocations.size() == 0)
-        {
-            if (m_UsedSize != 0 || m_FreeList[0].offset != 0 || m_FreeList[0].size != m_MaxSize) {
-                RE_CORE_INFO("Resource Suballocation leak, should have %d free, only have %d; missing %d bytes", m_MaxSize, m_FreeList[0].size, m_MaxSize - m_FreeList[0].size);
-            }
-            return true;
+        if (m_UsedSize != 0 || m_FreeBlocks.GetNumFreeBlocks() != 1 || m_FreeBlocks.GetLargestFreeBlock() != m_MaxSize) {
+            RE_CORE_INFO("Resource Suballocation leak, should have {0} free, only have {1}; missing {2} bytes", m_MaxSize, m_FreeBlocks.GetLargestFreeBlock(), m_MaxSize - m_FreeBlocks.GetLargestFreeBlock());
         }
+        return true;
     }
     
     return false;
@@ -782,29 +1319,12 @@ VulkanResourceSubAllocation* VulkanSubBufferAllocator::CreateSubAllocation(uint3
 
 void VulkanSubBufferAllocator::Release(VulkanBufferSubAllocation* subAllocation)
 {
-    bool released = false;
-    for (int32 index = 0; index < m_SubAllocations.size(); ++index)
-    {
-        if (m_SubAllocations[index] == subAllocation)
-        {
-            released = true;
-            m_SubAllocations.erase(m_SubAllocations.begin() + index);
-            break;
-        }
-    }
-    
-    if (released)
-    {
-        VulkanRange newFree;
-        newFree.offset = subAllocation->m_AllocationOffset;
-        newFree.size   = subAllocation->m_AllocationSize;
-        m_FreeList.push_back(newFree);
-        m_UsedSize -= subAllocation->m_AllocationSize;
-    }
-    
-    if (JoinFreeBlocks()) {
-        m_Owner->ReleaseBuffer(this);
-    }
+    VulkanSubAllocationRange range;
+    range.requestedSize    = subAllocation->m_RequestedSize;
+    range.alignedOffset    = subAllocation->m_AlignedOffset;
+    range.allocationSize   = subAllocation->m_AllocationSize;
+    range.allocationOffset = subAllocation->m_AllocationOffset;
+    m_Owner->DeferReleaseBufferRange(this, range);
 }
 
 // VulkanResourceHeapManager
@@ -812,6 +1332,8 @@ void VulkanSubBufferAllocator::Release(VulkanBufferSubAllocation* subAllocation)
 VulkanResourceHeapManager::VulkanResourceHeapManager(VulkanDevice* device)
     : m_VulkanDevice(device)
     , m_DeviceMemoryManager(&device->GetMemoryManager())
+    , m_CurrentFrame(0)
+    , m_HoldVmaReleases(false)
 {
     
 }
@@ -890,10 +1412,16 @@ void VulkanResourceHeapManager::Init()
         }
         m_ResourceTypeHeaps[typeIndex] = new VulkanResourceHeap(this, typeIndex, STAGING_HEAP_PAGE_SIZE);
     }
+    
+    VulkanMemoryTracker::GetInstance().RegisterHeapManager(this);
 }
 
 void VulkanResourceHeapManager::Destory()
 {
+    VulkanMemoryTracker::GetInstance().UnregisterHeapManager(this);
+    m_HoldVmaReleases = false;
+    ProcessPendingReleases(~0ull);
+    FlushThreadBufferCaches();
     DestroyResourceAllocations();
     for (int32 index = 0; index < m_ResourceTypeHeaps.size(); ++index)
     {
@@ -992,15 +1520,61 @@ VulkanBufferSubAllocation* VulkanResourceHeapManager::AllocateBuffer(uint32 size
         size = m_PoolSizes[poolSize];
     }
     
+    VulkanSubBufferAllocator* bufferAllocation = nullptr;
+    VulkanSubAllocationRange  range;
+    
+    if (poolSize != (int32)PoolSizes::SizesCount)
+    {
+        // 小块Buffer优先从本线程的弹匣中取，弹匣空了才加锁从共享堆中一次切分一批
+        VulkanThreadBufferCache* cache = GetThreadBufferCache();
+        VulkanBufferMagazine* magazine = cache->FindMagazine(poolSize, bufferUsageFlags, memoryPropertyFlags, alignment);
+        if (!magazine)
+        {
+            std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSize]);
+            for (int32 index = 0; index < BufferMagazineSize; ++index)
+            {
+                VulkanBufferMagazine::Entry entry;
+                entry.allocator = AllocateBufferRangeLocked(poolSize, size, alignment, bufferUsageFlags, memoryPropertyFlags, entry.range, file, line);
+                if (!entry.allocator) {
+                    break;
+                }
+                cache->GetMagazine(poolSize, entry.allocator->m_BufferUsageFlags, entry.allocator->m_MemoryPropertyFlags).entries.push_back(entry);
+            }
+            magazine = cache->FindMagazine(poolSize, bufferUsageFlags, memoryPropertyFlags, alignment);
+        }
+        
+        if (magazine)
+        {
+            bufferAllocation = magazine->entries.back().allocator;
+            range            = magazine->entries.back().range;
+            magazine->entries.pop_back();
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSize]);
+        bufferAllocation = AllocateBufferRangeLocked(poolSize, size, alignment, bufferUsageFlags, memoryPropertyFlags, range, file, line);
+    }
+    
+    if (!bufferAllocation) {
+        return nullptr;
+    }
+    
+    VulkanBufferSubAllocation* subAllocation = (VulkanBufferSubAllocation*)bufferAllocation->CreateSubAllocation(range.requestedSize, range.alignedOffset, range.allocationSize, range.allocationOffset);
+    VulkanMemoryTracker::GetInstance().TrackAllocation(VulkanMemoryTrackKind::SubBuffer, subAllocation, range.allocationSize, bufferAllocation->m_MemoryTypeIndex, file, line);
+    return subAllocation;
+}
+
+VulkanSubBufferAllocator* VulkanResourceHeapManager::AllocateBufferRangeLocked(int32 poolSize, uint32 size, uint32 alignment, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VulkanSubAllocationRange& outRange, const char* file, uint32 line)
+{
     for (int32 index = 0; index < m_UsedBufferAllocations[poolSize].size(); ++index)
     {
         VulkanSubBufferAllocator* bufferAllocation = m_UsedBufferAllocations[poolSize][index];
         if ((bufferAllocation->m_BufferUsageFlags & bufferUsageFlags) == bufferUsageFlags &&
             (bufferAllocation->m_MemoryPropertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
         {
-            VulkanBufferSubAllocation* subAllocation = (VulkanBufferSubAllocation*)bufferAllocation->TryAllocateNoLocking(size, alignment, file, line);
-            if (subAllocation) {
-                return subAllocation;
+            if (bufferAllocation->TryAllocateRange(size, alignment, outRange)) {
+                return bufferAllocation;
             }
         }
     }
@@ -1011,12 +1585,11 @@ VulkanBufferSubAllocation* VulkanResourceHeapManager::AllocateBuffer(uint32 size
         if ((bufferAllocation->m_BufferUsageFlags & bufferUsageFlags) == bufferUsageFlags &&
             (bufferAllocation->m_MemoryPropertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
         {
-            VulkanBufferSubAllocation* subAllocation = (VulkanBufferSubAllocation*)bufferAllocation->TryAllocateNoLocking(size, alignment, file, line);
-            if (subAllocation)
+            if (bufferAllocation->TryAllocateRange(size, alignment, outRange))
             {
                 m_FreeBufferAllocations[poolSize].erase(m_FreeBufferAllocations[poolSize].begin() + index);
                 m_UsedBufferAllocations[poolSize].push_back(bufferAllocation);
-                return subAllocation;
+                return bufferAllocation;
             }
         }
     }
@@ -1036,7 +1609,7 @@ VulkanBufferSubAllocation* VulkanResourceHeapManager::AllocateBuffer(uint32 size
     VERIFYVULKANRESULT(m_VulkanDevice->GetMemoryManager().GetMemoryTypeFromProperties(memReqs.memoryTypeBits, memoryPropertyFlags, &memoryTypeIndex));
     alignment = glm::max((uint32)memReqs.alignment, alignment);
     
-    VulkanDeviceMemoryAllocation* deviceMemoryAllocation = m_VulkanDevice->GetMemoryManager().Alloc(false, memReqs.size, memoryTypeIndex, nullptr, file, line);
+    VulkanDeviceMemoryAllocation* deviceMemoryAllocation = m_VulkanDevice->GetMemoryManager().Alloc(false, memReqs.size, memoryTypeIndex, nullptr, file, line, GetBufferMemoryCategory(bufferUsageFlags, memoryPropertyFlags));
     VERIFYVULKANRESULT(vkBindBufferMemory(m_VulkanDevice->GetInstanceHandle(), buffer, deviceMemoryAllocation->GetHandle(), 0));
 
     if (deviceMemoryAllocation->CanBeMapped()) {
@@ -1046,7 +1619,10 @@ VulkanBufferSubAllocation* VulkanResourceHeapManager::AllocateBuffer(uint32 size
     VulkanSubBufferAllocator* bufferAllocation = new VulkanSubBufferAllocator(this, deviceMemoryAllocation, memoryTypeIndex, memoryPropertyFlags, uint32(memReqs.alignment), buffer, bufferUsageFlags, poolSize);
     m_UsedBufferAllocations[poolSize].push_back(bufferAllocation);
     
-    return (VulkanBufferSubAllocation*)bufferAllocation->TryAllocateNoLocking(size, alignment, file, line);
+    if (!bufferAllocation->TryAllocateRange(size, alignment, outRange)) {
+        return nullptr;
+    }
+    return bufferAllocation;
 }
 
 void VulkanResourceHeapManager::ReleaseBuffer(VulkanSubBufferAllocator* bufferAllocator)
@@ -1058,10 +1634,247 @@ void VulkanResourceHeapManager::ReleaseBuffer(VulkanSubBufferAllocator* bufferAl
             m_UsedBufferAllocations[bufferAllocator->m_PoolSizeIndex].erase(m_UsedBufferAllocations[bufferAllocator->m_PoolSizeIndex].begin() + index);
         }
     }
-    bufferAllocator->m_FrameFreed = 0;
+    bufferAllocator->m_FrameFreed = m_CurrentFrame;
     m_FreeBufferAllocations[bufferAllocator->m_PoolSizeIndex].push_back(bufferAllocator);
 }
 
+void VulkanResourceHeapManager::ReleaseBufferRange(VulkanSubBufferAllocator* bufferAllocator, const VulkanSubAllocationRange& range)
+{
+    int32 poolSize = bufferAllocator->m_PoolSizeIndex;
+    
+    if (poolSize != (int32)PoolSizes::SizesCount)
+    {
+        VulkanBufferMagazine& magazine = GetThreadBufferCache()->GetMagazine(poolSize, bufferAllocator->m_BufferUsageFlags, bufferAllocator->m_MemoryPropertyFlags);
+        VulkanBufferMagazine::Entry entry;
+        entry.allocator = bufferAllocator;
+        entry.range     = range;
+        magazine.entries.push_back(entry);
+        
+        if (magazine.entries.size() < BufferMagazineSize * 2) {
+            return;
+        }
+        
+        // 弹匣溢出，一次加锁把一半区间还给共享堆
+        std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSize]);
+        for (int32 index = 0; index < BufferMagazineSize; ++index)
+        {
+            VulkanBufferMagazine::Entry& overflow = magazine.entries.back();
+            if (overflow.allocator->ReleaseRange(overflow.range)) {
+                ReleaseBuffer(overflow.allocator);
+            }
+            magazine.entries.pop_back();
+        }
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSize]);
+    if (bufferAllocator->ReleaseRange(range)) {
+        ReleaseBuffer(bufferAllocator);
+    }
+}
+
+VulkanThreadBufferCache* VulkanResourceHeapManager::GetThreadBufferCache()
+{
+    std::vector<VulkanThreadBufferCache*>& caches = G_ThreadBufferCacheSlots.caches;
+    for (int32 index = 0; index < caches.size(); ++index)
+    {
+        if (caches[index]->owner == this) {
+            return caches[index];
+        }
+    }
+    
+    VulkanThreadBufferCache* cache = new VulkanThreadBufferCache();
+    cache->owner = this;
+    caches.push_back(cache);
+    
+    std::lock_guard<std::mutex> lock(m_ThreadBufferCachesLock);
+    m_ThreadBufferCaches.push_back(cache);
+    return cache;
+}
+
+void VulkanResourceHeapManager::FlushThreadBufferCache(VulkanThreadBufferCache* cache)
+{
+    for (auto& magazine : cache->magazines)
+    {
+        std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[magazine.poolSize]);
+        for (auto& entry : magazine.entries)
+        {
+            if (entry.allocator->ReleaseRange(entry.range)) {
+                ReleaseBuffer(entry.allocator);
+            }
+        }
+        magazine.entries.clear();
+    }
+}
+
+void VulkanResourceHeapManager::ReleaseThreadBufferCache(VulkanThreadBufferCache* cache)
+{
+    FlushThreadBufferCache(cache);
+    cache->owner = nullptr;
+    
+    std::lock_guard<std::mutex> lock(m_ThreadBufferCachesLock);
+    auto it = std::find(m_ThreadBufferCaches.begin(), m_ThreadBufferCaches.end(), cache);
+    if (it != m_ThreadBufferCaches.end()) {
+        m_ThreadBufferCaches.erase(it);
+    }
+}
+
+void VulkanResourceHeapManager::FlushThreadBufferCaches()
+{
+    // 销毁时其它线程必须已经停止分配，这里直接回收所有线程缓存的区间
+    std::lock_guard<std::mutex> ownerLock(G_ThreadBufferCacheOwnerLock);
+    std::lock_guard<std::mutex> lock(m_ThreadBufferCachesLock);
+    for (int32 index = 0; index < m_ThreadBufferCaches.size(); ++index)
+    {
+        FlushThreadBufferCache(m_ThreadBufferCaches[index]);
+        m_ThreadBufferCaches[index]->owner = nullptr;
+    }
+    m_ThreadBufferCaches.clear();
+}
+
+void VulkanResourceHeapManager::BeginFrame(uint64 frameIndex)
+{
+    m_CurrentFrame = frameIndex;
+}
+
+void VulkanResourceHeapManager::DeferReleaseRange(VulkanResourceHeapPage* page, uint32 allocationOffset, uint32 allocationSize)
+{
+    PendingRelease pending;
+    pending.frame                  = m_CurrentFrame;
+    pending.page                   = page;
+    pending.bufferAllocator        = nullptr;
+    pending.vmaBuffer              = VK_NULL_HANDLE;
+    pending.vmaImage               = VK_NULL_HANDLE;
+    pending.vmaAllocation          = VK_NULL_HANDLE;
+    pending.range.requestedSize    = allocationSize;
+    pending.range.alignedOffset    = allocationOffset;
+    pending.range.allocationSize   = allocationSize;
+    pending.range.allocationOffset = allocationOffset;
+    
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_PendingReleases.push_back(pending);
+}
+
+void VulkanResourceHeapManager::DeferReleaseBufferRange(VulkanSubBufferAllocator* bufferAllocator, const VulkanSubAllocationRange& range)
+{
+    PendingRelease pending;
+    pending.frame           = m_CurrentFrame;
+    pending.page            = nullptr;
+    pending.bufferAllocator = bufferAllocator;
+    pending.range           = range;
+    pending.vmaBuffer       = VK_NULL_HANDLE;
+    pending.vmaImage        = VK_NULL_HANDLE;
+    pending.vmaAllocation   = VK_NULL_HANDLE;
+    
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_PendingReleases.push_back(pending);
+}
+
+void VulkanResourceHeapManager::DeferReleaseVmaBuffer(VkBuffer buffer, VmaAllocation allocation)
+{
+    PendingRelease pending = {};
+    pending.frame         = m_CurrentFrame;
+    pending.vmaBuffer     = buffer;
+    pending.vmaAllocation = allocation;
+    
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_PendingReleases.push_back(pending);
+}
+
+void VulkanResourceHeapManager::DeferReleaseVmaImage(VkImage image, VmaAllocation allocation)
+{
+    PendingRelease pending = {};
+    pending.frame         = m_CurrentFrame;
+    pending.vmaImage      = image;
+    pending.vmaAllocation = allocation;
+    
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_PendingReleases.push_back(pending);
+}
+
+void VulkanResourceHeapManager::HoldVmaReleases()
+{
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_HoldVmaReleases = true;
+}
+
+void VulkanResourceHeapManager::ResumeVmaReleases()
+{
+    // 暂存的条目都已经过了自己的帧，放回队首，下一次ProcessPendingReleases处理
+    std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+    m_HoldVmaReleases = false;
+    m_PendingReleases.insert(m_PendingReleases.begin(), m_HeldReleases.begin(), m_HeldReleases.end());
+    m_HeldReleases.clear();
+}
+
+void VulkanResourceHeapManager::DestroyVmaResource(VkBuffer buffer, VkImage image, VmaAllocation allocation)
+{
+    // 创建时把预算分类存在VmaAllocation的UserData里，Aliasing的贴图没有自己的VmaAllocation
+    if (allocation != VK_NULL_HANDLE)
+    {
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(m_VulkanDevice->vma_allocator, allocation, &allocationInfo);
+        m_DeviceMemoryManager->UntrackResource((VulkanMemoryCategory)(uintptr_t)allocationInfo.pUserData, allocationInfo.memoryType, allocationInfo.size, allocation);
+    }
+    
+    if (buffer != VK_NULL_HANDLE) {
+        vmaDestroyBuffer(m_VulkanDevice->vma_allocator, buffer, allocation);
+    }
+    else {
+        vmaDestroyImage(m_VulkanDevice->vma_allocator, image, allocation);
+    }
+}
+
+void VulkanResourceHeapManager::ProcessPendingReleases(uint64 completedFrameIndex)
+{
+    // 队列按帧号顺序追加，只需要取出已完成帧的前缀，处理时不持有队列锁
+    {
+        std::lock_guard<std::mutex> lock(m_PendingReleasesLock);
+        int32 retired = 0;
+        while (retired < m_PendingReleases.size() && m_PendingReleases[retired].frame <= completedFrameIndex) {
+            retired += 1;
+        }
+        m_ProcessingReleases.clear();
+        for (int32 index = 0; index < retired; ++index)
+        {
+            PendingRelease& pending = m_PendingReleases[index];
+            const bool isVma = pending.vmaBuffer != VK_NULL_HANDLE || pending.vmaImage != VK_NULL_HANDLE;
+            if (isVma && m_HoldVmaReleases) {
+                m_HeldReleases.push_back(pending);
+            }
+            else {
+                m_ProcessingReleases.push_back(pending);
+            }
+        }
+        m_PendingReleases.erase(m_PendingReleases.begin(), m_PendingReleases.begin() + retired);
+    }
+    
+    for (int32 index = 0; index < m_ProcessingReleases.size(); ++index)
+    {
+        PendingRelease& pending = m_ProcessingReleases[index];
+        if (pending.vmaBuffer != VK_NULL_HANDLE || pending.vmaImage != VK_NULL_HANDLE) {
+            DestroyVmaResource(pending.vmaBuffer, pending.vmaImage, pending.vmaAllocation);
+        }
+        else if (pending.page) {
+            pending.page->ReleaseRange(pending.range.allocationOffset, pending.range.allocationSize);
+        }
+        else {
+            ReleaseBufferRange(pending.bufferAllocator, pending.range);
+        }
+    }
+    m_ProcessingReleases.clear();
+    
+    const bool immediately = completedFrameIndex == ~0ull;
+    for (int32 index = 0; index < m_ResourceTypeHeaps.size(); ++index)
+    {
+        VulkanResourceHeap* heap = m_ResourceTypeHeaps[index];
+        if (heap) {
+            heap->ReleaseFreedPages(immediately);
+        }
+    }
+    ReleaseFreedResources(immediately);
+}
+
 void VulkanResourceHeapManager::ReleaseFreedPages()
 {
     for (int32 index = 0; index < m_ResourceTypeHeaps.size(); ++index)
@@ -1071,7 +1884,57 @@ void VulkanResourceHeapManager::ReleaseFreedPages()
             heap->ReleaseFreedPages(true);
         }
     }
-    ReleaseFreedResources(false);
+    ReleaseFreedResources(true);
+}
+
+void VulkanResourceHeapManager::GatherPageStats(std::vector<VulkanMemoryPageStats>& outPages)
+{
+    auto GatherHeapPages = [&outPages](const std::vector<VulkanResourceHeapPage*>& pages, uint32 memoryTypeIndex)
+    {
+        for (int32 index = 0; index < pages.size(); ++index)
+        {
+            VulkanResourceHeapPage* page = pages[index];
+            VulkanMemoryPageStats stats;
+            stats.PageID           = page->m_ID;
+            stats.MemoryTypeIndex  = memoryTypeIndex;
+            stats.IsSubBuffer      = false;
+            stats.Size             = page->m_MaxSize;
+            stats.UsedSize         = page->m_UsedSize;
+            stats.NumAllocations   = (uint32)page->m_ResourceAllocations.size();
+            stats.NumFreeBlocks    = page->m_FreeBlocks.GetNumFreeBlocks();
+            stats.LargestFreeBlock = page->m_FreeBlocks.GetLargestFreeBlock();
+            outPages.push_back(stats);
+        }
+    };
+    
+    for (int32 index = 0; index < m_ResourceTypeHeaps.size(); ++index)
+    {
+        VulkanResourceHeap* heap = m_ResourceTypeHeaps[index];
+        if (heap)
+        {
+            GatherHeapPages(heap->m_UsedBufferPages, heap->m_MemoryTypeIndex);
+            GatherHeapPages(heap->m_UsedImagePages, heap->m_MemoryTypeIndex);
+        }
+    }
+    
+    for (int32 poolSize = 0; poolSize <= (int32)PoolSizes::SizesCount; ++poolSize)
+    {
+        std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSize]);
+        for (int32 index = 0; index < m_UsedBufferAllocations[poolSize].size(); ++index)
+        {
+            VulkanSubBufferAllocator* bufferAllocation = m_UsedBufferAllocations[poolSize][index];
+            VulkanMemoryPageStats stats;
+            stats.PageID           = (uint32)index;
+            stats.MemoryTypeIndex  = bufferAllocation->m_MemoryTypeIndex;
+            stats.IsSubBuffer      = true;
+            stats.Size             = bufferAllocation->m_MaxSize;
+            stats.UsedSize         = (uint64)bufferAllocation->m_UsedSize;
+            stats.NumAllocations   = bufferAllocation->m_NumSubAllocations;
+            stats.NumFreeBlocks    = bufferAllocation->m_FreeBlocks.GetNumFreeBlocks();
+            stats.LargestFreeBlock = bufferAllocation->m_FreeBlocks.GetLargestFreeBlock();
+            outPages.push_back(stats);
+        }
+    }
 }
 
 #if MONKEY_DEBUG
@@ -1115,7 +1978,7 @@ void VulkanResourceHeapManager::DumpMemory()
             for (int32 index = 0; index < usedAllocations.size(); ++index)
             {
                 VulkanSubBufferAllocator* bufferAllocation = usedAllocations[index];
-                RE_CORE_INFO("%6d %p %p 0x%06x 0x%08x %6d   %6d    %d/%d", index, (void*)bufferAllocation->m_Buffer, (void*)bufferAllocation->m_DeviceMemoryAllocation->GetHandle(), bufferAllocation->m_MemoryPropertyFlags, bufferAllocation->m_BufferUsageFlags, (int32)bufferAllocation->m_SubAllocations.size(), (int32)bufferAllocation->m_FreeList.size(), (int32)bufferAllocation->m_UsedSize, bufferAllocation->m_MaxSize);
+                RE_CORE_INFO("%6d %p %p 0x%06x 0x%08x %6d   %6d    %d/%d", index, (void*)bufferAllocation->m_Buffer, (void*)bufferAllocation->m_DeviceMemoryAllocation->GetHandle(), bufferAllocation->m_MemoryPropertyFlags, bufferAllocation->m_BufferUsageFlags, (int32)bufferAllocation->m_NumSubAllocations, (int32)bufferAllocation->m_FreeBlocks.GetNumFreeBlocks(), (int32)bufferAllocation->m_UsedSize, bufferAllocation->m_MaxSize);
                 
                 if (poolSizeIndex == (int32)PoolSizes::SizesCount)
                 {
@@ -1150,16 +2013,21 @@ void VulkanResourceHeapManager::DumpMemory()
 
 void VulkanResourceHeapManager::ReleaseFreedResources(bool immediately)
 {
-    for (auto& freeAllocations : m_FreeBufferAllocations)
+    for (int32 poolSizeIndex = 0; poolSizeIndex < (int32)PoolSizes::SizesCount + 1; ++poolSizeIndex)
     {
-        for (int32 index = 0; index < freeAllocations.size(); ++index)
+        std::lock_guard<std::mutex> lock(m_BufferAllocationLocks[poolSizeIndex]);
+        std::vector<VulkanSubBufferAllocator*>& freeAllocations = m_FreeBufferAllocations[poolSizeIndex];
+        for (int32 index = (int32)freeAllocations.size() - 1; index >= 0; --index)
         {
             VulkanSubBufferAllocator* bufferAllocation = freeAllocations[index];
-            bufferAllocation->Destroy(m_VulkanDevice);
-            m_VulkanDevice->GetMemoryManager().Free(bufferAllocation->m_DeviceMemoryAllocation);
-            delete bufferAllocation;
+            if (immediately || bufferAllocation->m_FrameFreed + NUM_FRAMES_TO_WAIT_BEFORE_RELEASING_TO_OS < m_CurrentFrame)
+            {
+                bufferAllocation->Destroy(m_VulkanDevice);
+                m_VulkanDevice->GetMemoryManager().Free(bufferAllocation->m_DeviceMemoryAllocation);
+                delete bufferAllocation;
+                freeAllocations.erase(freeAllocations.begin() + index);
+            }
         }
-        freeAllocations.clear();
     }
 }
 
@@ -5,10 +5,15 @@
 #include "Core/ThreadSafeCounter.h"
 
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
+#include <unordered_map>
 
 #include "VulkanCommonDefine.h"
+#include "VulkanMemoryTracker.h"
 
 class VulkanDevice;
 class VulkanDeviceMemoryManager;
@@ -18,6 +23,73 @@ class VulkanResourceHeapManager;
 class VulkanBufferSubAllocation;
 class VulkanSubBufferAllocator;
 class VulkanSubResourceAllocator;
+struct VulkanThreadBufferCache;
+
+VK_DEFINE_HANDLE( VmaAllocation )
+
+// 显存预算按资源用途分类统计
+enum class VulkanMemoryCategory : uint8
+{
+    Unknown = 0,
+    RenderTarget,
+    Mesh,
+    Texture,
+    Staging,
+    UniformRing,
+    
+    Count
+};
+
+FORCE_INLINE const char* GetMemoryCategoryName(VulkanMemoryCategory category)
+{
+    switch (category)
+    {
+        case VulkanMemoryCategory::RenderTarget:
+            return "RenderTarget";
+        case VulkanMemoryCategory::Mesh:
+            return "Mesh";
+        case VulkanMemoryCategory::Texture:
+            return "Texture";
+        case VulkanMemoryCategory::Staging:
+            return "Staging";
+        case VulkanMemoryCategory::UniformRing:
+            return "UniformRing";
+        default:
+            return "Unknown";
+    }
+}
+
+FORCE_INLINE VulkanMemoryCategory GetBufferMemoryCategory(VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryPropertyFlags)
+{
+    if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+        return VulkanMemoryCategory::Mesh;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        return VulkanMemoryCategory::UniformRing;
+    }
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        return VulkanMemoryCategory::Staging;
+    }
+    return VulkanMemoryCategory::Unknown;
+}
+
+FORCE_INLINE VulkanMemoryCategory GetImageMemoryCategory(VkImageUsageFlags usage)
+{
+    if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) {
+        return VulkanMemoryCategory::RenderTarget;
+    }
+    return VulkanMemoryCategory::Texture;
+}
+
+struct VulkanHeapBudget
+{
+    uint64 totalSize;
+    uint64 softLimit;
+    uint64 hardLimit;
+    uint64 usedSize;
+    uint64 peakSize;
+    uint64 categorySize[(int32)VulkanMemoryCategory::Count];
+};
 
 class RefCount
 {
@@ -72,6 +144,90 @@ struct VulkanRange
     }
 };
 
+struct VulkanSubAllocationRange
+{
+    uint32 requestedSize;
+    uint32 alignedOffset;
+    uint32 allocationSize;
+    uint32 allocationOffset;
+};
+
+// 两级分离适配(TLSF)空闲块索引，分配与释放均为O(1)，释放时立即与物理相邻的空闲块合并
+class VulkanTLSFAllocator
+{
+public:
+    VulkanTLSFAllocator();
+
+    void Init(uint32 maxSize);
+
+    bool Allocate(uint32 size, uint32 alignment, uint32& outAllocationOffset, uint32& outAllocationSize, uint32& outAlignedOffset);
+
+    bool Free(uint32 allocationOffset);
+
+    FORCE_INLINE bool IsEmpty() const
+    {
+        return m_NumUsedBlocks == 0;
+    }
+
+    FORCE_INLINE uint32 GetNumFreeBlocks() const
+    {
+        return m_NumFreeBlocks;
+    }
+
+    FORCE_INLINE uint32 GetMaxSize() const
+    {
+        return m_MaxSize;
+    }
+
+    uint32 GetLargestFreeBlock() const;
+
+protected:
+    enum
+    {
+        SL_INDEX_COUNT_LOG2 = 5,
+        SL_INDEX_COUNT      = 1 << SL_INDEX_COUNT_LOG2,
+        SMALL_BLOCK_SIZE    = 1 << SL_INDEX_COUNT_LOG2,
+        FL_INDEX_COUNT      = 32 - SL_INDEX_COUNT_LOG2 + 1,
+        INVALID_BLOCK       = 0xFFFFFFFF,
+    };
+
+    struct Block
+    {
+        uint32  offset;
+        uint32  size;
+        uint32  prevPhysical;
+        uint32  nextPhysical;
+        uint32  prevFree;
+        uint32  nextFree;
+        bool    free;
+    };
+
+    static void MappingInsert(uint32 size, uint32& outFL, uint32& outSL);
+
+    static void MappingSearch(uint64 size, uint32& outFL, uint32& outSL);
+
+    uint32 FindSuitableBlock(uint32& inOutFL, uint32& inOutSL) const;
+
+    uint32 CreateBlock(uint32 offset, uint32 size);
+
+    void DestroyBlock(uint32 blockIndex);
+
+    void InsertFreeBlock(uint32 blockIndex);
+
+    void RemoveFreeBlock(uint32 blockIndex);
+
+protected:
+    uint32                              m_MaxSize;
+    uint32                              m_NumUsedBlocks;
+    uint32                              m_NumFreeBlocks;
+    uint32                              m_FLBitmap;
+    uint32                              m_SLBitmap[FL_INDEX_COUNT];
+    uint32                              m_FreeHeads[FL_INDEX_COUNT][SL_INDEX_COUNT];
+    std::vector<Block>                  m_Blocks;
+    std::vector<uint32>                 m_UnusedBlocks;
+    std::unordered_map<uint32, uint32>  m_UsedBlocks;
+};
+
 class VulkanDeviceMemoryAllocation
 {
 public:
@@ -130,6 +286,7 @@ protected:
 	VkDeviceMemory  m_Handle;
 	void*           m_MappedPointer;
 	uint32          m_MemoryTypeIndex;
+	VulkanMemoryCategory m_Category;
 	bool            m_CanBeMapped;
 	bool            m_IsCoherent;
 	bool            m_IsCached;
@@ -149,7 +306,7 @@ public:
     
     bool SupportsMemoryType(VkMemoryPropertyFlags properties) const;
     
-    VulkanDeviceMemoryAllocation* Alloc(bool canFail, VkDeviceSize allocationSize, uint32 memoryTypeIndex, void* dedicatedAllocateInfo, const char* file, uint32 line);
+    VulkanDeviceMemoryAllocation* Alloc(bool canFail, VkDeviceSize allocationSize, uint32 memoryTypeIndex, void* dedicatedAllocateInfo, const char* file, uint32 line, VulkanMemoryCategory category = VulkanMemoryCategory::Unknown);
     
     void Free(VulkanDeviceMemoryAllocation*& allocation);
     
@@ -157,6 +314,48 @@ public:
     
     uint64 GetTotalMemory(bool gpu) const;
     
+    // 超出软上限时按优先级调用，参数为堆索引和希望释放的字节数，返回回调返回前已经释放的字节数
+    // 回调里可以直接销毁资源(丢弃Mip、降低LOD)，调用时不持有预算锁；只安排之后降级的返回0
+    typedef std::function<uint64(uint32, uint64)> EvictionCallback;
+    
+    // priority越小越先被回收
+    uint32 RegisterEvictionCallback(VulkanMemoryCategory category, int32 priority, EvictionCallback callback);
+    
+    void UnregisterEvictionCallback(uint32 handle);
+    
+    void SetHeapBudget(uint32 heapIndex, uint64 softLimit, uint64 hardLimit);
+    
+    // 分配前申请预算，超出软上限先回收，回收后仍超出硬上限且canFail时返回false
+    bool RequestBudget(uint32 heapIndex, VkDeviceSize size, bool canFail);
+    
+    // 不经过Alloc分配的显存(VMA)通过这两个接口计入预算，并按调用点记进显存跟踪
+    void TrackResource(VulkanMemoryCategory category, uint32 memoryTypeIndex, VkDeviceSize size, const void* allocation, const char* file, uint32 line);
+    
+    void UntrackResource(VulkanMemoryCategory category, uint32 memoryTypeIndex, VkDeviceSize size, const void* allocation);
+    
+    VulkanHeapBudget GetHeapBudget(uint32 heapIndex) const;
+    
+    uint64 GetCategoryUsage(VulkanMemoryCategory category) const;
+    
+    FORCE_INLINE uint32 GetNumHeaps() const
+    {
+        return m_MemoryProperties.memoryHeapCount;
+    }
+    
+    FORCE_INLINE uint32 GetHeapIndex(uint32 memoryTypeIndex) const
+    {
+        return m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    }
+    
+    FORCE_INLINE uint32 GetHeapIndexFromProperties(VkMemoryPropertyFlags properties)
+    {
+        uint32 memoryTypeIndex = 0;
+        if (GetMemoryTypeFromProperties(~0u, properties, &memoryTypeIndex) != VK_SUCCESS) {
+            return 0;
+        }
+        return GetHeapIndex(memoryTypeIndex);
+    }
+    
     FORCE_INLINE bool HasUnifiedMemory() const
     {
         return m_HasUnifiedMemory;
@@ -220,20 +419,39 @@ protected:
     {
         HeapInfo()
             : totalSize(0)
+            , softLimit(0)
+            , hardLimit(0)
             , usedSize(0)
             , peakSize(0)
         {
-            
+            memset(categorySize, 0, sizeof(categorySize));
         }
         
         VkDeviceSize totalSize;
+        VkDeviceSize softLimit;
+        VkDeviceSize hardLimit;
         VkDeviceSize usedSize;
         VkDeviceSize peakSize;
+        VkDeviceSize categorySize[(int32)VulkanMemoryCategory::Count];
         std::vector<VulkanDeviceMemoryAllocation*> allocations;
     };
     
+    struct EvictionHandler
+    {
+        uint32                  handle;
+        VulkanMemoryCategory    category;
+        int32                   priority;
+        EvictionCallback        callback;
+    };
+    
     void SetupAndPrintMemInfo();
     
+    void AddHeapUsage(uint32 heapIndex, VulkanMemoryCategory category, VkDeviceSize size);
+    
+    void RemoveHeapUsage(uint32 heapIndex, VulkanMemoryCategory category, VkDeviceSize size);
+    
+    uint64 Evict(uint32 heapIndex, uint64 bytesToFree);
+    
 protected:
 
     VkPhysicalDeviceMemoryProperties m_MemoryProperties;
@@ -243,6 +461,10 @@ protected:
     uint32                           m_NumAllocations;
     uint32                           m_PeakNumAllocations;
     std::vector<HeapInfo>            m_HeapInfos;
+    
+    mutable std::mutex               m_BudgetLock;
+    std::vector<EvictionHandler>     m_EvictionHandlers;
+    uint32                           m_EvictionHandleCounter;
 };
 
 class VulkanResourceAllocation : public RefCount
@@ -317,6 +539,9 @@ public:
     
     void ReleaseAllocation(VulkanResourceAllocation* allocation);
     
+    // 延迟释放队列在GPU执行完对应帧之后调用，真正把区间还给页
+    void ReleaseRange(uint32 allocationOffset, uint32 allocationSize);
+    
     VulkanResourceAllocation* TryAllocate(uint32 size, uint32 alignment, const char* file, uint32 line);
     
     VulkanResourceAllocation* Allocate(uint32 size, uint32 alignment, const char* file, uint32 line)
@@ -339,17 +564,18 @@ protected:
     bool JoinFreeBlocks();
     
     friend class VulkanResourceHeap;
+    friend class VulkanResourceHeapManager;
 protected:
 
     VulkanResourceHeap*                     m_Owner;
     VulkanDeviceMemoryAllocation*           m_DeviceMemoryAllocation;
     std::vector<VulkanResourceAllocation*>  m_ResourceAllocations;
-    std::vector<VulkanRange>                m_FreeList;
+    VulkanTLSFAllocator                     m_FreeBlocks;
     
     uint32                                  m_MaxSize;
     uint32                                  m_UsedSize;
     int32                                   m_PeakNumAllocations;
-    uint32                                  m_FrameFreed;
+    uint64                                  m_FrameFreed;
     uint32                                  m_ID;
 };
 
@@ -417,6 +643,12 @@ public:
     
     VulkanResourceSubAllocation* TryAllocateNoLocking(uint32 size, uint32 alignment, const char* file, uint32 line);
     
+    // 只切分区间，不创建SubAllocation对象，用于线程缓存预先切分
+    bool TryAllocateRange(uint32 size, uint32 alignment, VulkanSubAllocationRange& outRange);
+    
+    // 归还区间，返回true表示整个Allocator已经空闲
+    bool ReleaseRange(const VulkanSubAllocationRange& range);
+    
     FORCE_INLINE VulkanResourceSubAllocation* TryAllocateLocking(uint32 size, uint32 alignment, const char* file, uint32 line)
     {
         return TryAllocateNoLocking(size, alignment, file, line);
@@ -442,10 +674,10 @@ protected:
     VulkanDeviceMemoryAllocation*               m_DeviceMemoryAllocation;
     uint32                                      m_MaxSize;
     uint32                                      m_Alignment;
-    uint32                                      m_FrameFreed;
+    uint64                                      m_FrameFreed;
     int64                                       m_UsedSize;
-    std::vector<VulkanRange>                    m_FreeList;
-    std::vector<VulkanResourceSubAllocation*>   m_SubAllocations;
+    VulkanTLSFAllocator                         m_FreeBlocks;
+    uint32                                      m_NumSubAllocations;
 };
 
 class VulkanSubBufferAllocator : public VulkanSubResourceAllocator
@@ -548,8 +780,41 @@ public:
     
     void ReleaseBuffer(VulkanSubBufferAllocator* bufferAllocator);
     
+    void ReleaseBufferRange(VulkanSubBufferAllocator* bufferAllocator, const VulkanSubAllocationRange& range);
+    
+    // 线程退出时归还该线程缓存的所有区间，调用方持有线程缓存的owner锁
+    void ReleaseThreadBufferCache(VulkanThreadBufferCache* cache);
+    
+    // 帧开始时调用，之后释放的内存都会打上这一帧的标记
+    void BeginFrame(uint64 frameIndex);
+    
+    // GPU已经执行完completedFrameIndex及之前的帧，一次性归还这些帧里释放的内存
+    void ProcessPendingReleases(uint64 completedFrameIndex);
+    
+    void DeferReleaseRange(VulkanResourceHeapPage* page, uint32 allocationOffset, uint32 allocationSize);
+    
+    void DeferReleaseBufferRange(VulkanSubBufferAllocator* bufferAllocator, const VulkanSubAllocationRange& range);
+    
+    // VMA分配的Buffer和Image同样等到释放它的帧执行完才销毁，预算也在那时扣除
+    void DeferReleaseVmaBuffer(VkBuffer buffer, VmaAllocation allocation);
+    
+    void DeferReleaseVmaImage(VkImage image, VmaAllocation allocation);
+    
+    // 碎片整理的Pass打开期间VMA的分配不能释放，暂存到ResumeVmaReleases之后再处理
+    void HoldVmaReleases();
+    
+    void ResumeVmaReleases();
+    
+    FORCE_INLINE uint64 GetCurrentFrame() const
+    {
+        return m_CurrentFrame;
+    }
+    
     void ReleaseFreedPages();
     
+    // 收集所有页和小块Buffer池的使用率与碎片信息，供显存跟踪快照使用
+    void GatherPageStats(std::vector<VulkanMemoryPageStats>& outPages);
+    
 #if MONKEY_DEBUG
     void DumpMemory();
 #endif
@@ -568,12 +833,35 @@ protected:
     
     void DestroyResourceAllocations();
     
+    void DestroyVmaResource(VkBuffer buffer, VkImage image, VmaAllocation allocation);
+    
+    VulkanSubBufferAllocator* AllocateBufferRangeLocked(int32 poolSize, uint32 size, uint32 alignment, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VulkanSubAllocationRange& outRange, const char* file, uint32 line);
+    
+    VulkanThreadBufferCache* GetThreadBufferCache();
+    
+    void FlushThreadBufferCache(VulkanThreadBufferCache* cache);
+    
+    void FlushThreadBufferCaches();
+    
 protected:
     
     enum
     {
         BufferAllocationSize        = 1 * 1024 * 1024,
         UniformBufferAllocationSize = 2 * 1024 * 1024,
+        // 每个线程每种Buffer一次从共享堆中预先切分的数量
+        BufferMagazineSize          = 16,
+    };
+    
+    struct PendingRelease
+    {
+        uint64                      frame;
+        VulkanResourceHeapPage*     page;
+        VulkanSubBufferAllocator*   bufferAllocator;
+        VulkanSubAllocationRange    range;
+        VkBuffer                    vmaBuffer;
+        VkImage                     vmaImage;
+        VmaAllocation               vmaAllocation;
     };
     
     enum class PoolSizes : uint8
@@ -637,4 +925,14 @@ protected:
     std::vector<VulkanResourceHeap*>        m_ResourceTypeHeaps;
     std::vector<VulkanSubBufferAllocator*>  m_UsedBufferAllocations[(int32)PoolSizes::SizesCount + 1];
     std::vector<VulkanSubBufferAllocator*>  m_FreeBufferAllocations[(int32)PoolSizes::SizesCount + 1];
+    std::mutex                              m_BufferAllocationLocks[(int32)PoolSizes::SizesCount + 1];
+    std::mutex                              m_ThreadBufferCachesLock;
+    std::vector<VulkanThreadBufferCache*>   m_ThreadBufferCaches;
+    // 渲染线程每帧写，释放资源的线程读
+    std::atomic<uint64>                     m_CurrentFrame;
+    std::mutex                              m_PendingReleasesLock;
+    std::vector<PendingRelease>             m_PendingReleases;
+    std::vector<PendingRelease>             m_ProcessingReleases;
+    std::vector<PendingRelease>             m_HeldReleases;
+    bool                                    m_HoldVmaReleases;
 };
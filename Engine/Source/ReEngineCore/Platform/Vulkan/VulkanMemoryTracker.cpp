@@ -0,0 +1,451 @@
+﻿#include "VulkanMemoryTracker.h"
+#include "VulkanDevice.h"
+#include "VulkanMemory.h"
+
+#include "glm/glm.hpp"
+#include <json.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+using json = nlohmann::json;
+
+const char* GetMemoryTrackKindName(VulkanMemoryTrackKind kind)
+{
+    switch (kind)
+    {
+    case VulkanMemoryTrackKind::DeviceMemory:   return "DeviceMemory";
+    case VulkanMemoryTrackKind::Resource:       return "Resource";
+    case VulkanMemoryTrackKind::SubBuffer:      return "SubBuffer";
+    case VulkanMemoryTrackKind::Vma:            return "Vma";
+    default:                                    return "Unknown";
+    }
+}
+
+static VulkanMemoryTrackKind GetMemoryTrackKindFromName(const std::string& name)
+{
+    for (int32 index = 0; index < (int32)VulkanMemoryTrackKind::Count; ++index)
+    {
+        if (name == GetMemoryTrackKindName((VulkanMemoryTrackKind)index)) {
+            return (VulkanMemoryTrackKind)index;
+        }
+    }
+    return VulkanMemoryTrackKind::DeviceMemory;
+}
+
+// VulkanMemoryTracker
+
+bool VulkanMemoryTracker::CallsiteKey::operator==(const CallsiteKey& other) const
+{
+    // 同一个__FILE__在不同编译单元里可能是不同的指针，需要比较内容
+    return Line == other.Line && Kind == other.Kind && (File == other.File || std::strcmp(File, other.File) == 0);
+}
+
+size_t VulkanMemoryTracker::CallsiteKeyHash::operator()(const CallsiteKey& key) const
+{
+    size_t hash = std::hash<std::string_view>()(std::string_view(key.File));
+    hash ^= std::hash<uint32>()(key.Line * 3 + (uint32)key.Kind) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void VulkanMemoryTracker::TrackAllocation(VulkanMemoryTrackKind kind, const void* allocation, uint64 size, uint32 memoryTypeIndex, const char* file, uint32 line)
+{
+    if (!m_Enabled || allocation == nullptr) {
+        return;
+    }
+
+    CallsiteKey key;
+    key.File = file ? file : "Unknown";
+    key.Line = line;
+    key.Kind = kind;
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    uint32 callsiteIndex = 0;
+    auto it = m_CallsiteMap.find(key);
+    if (it == m_CallsiteMap.end())
+    {
+        callsiteIndex = (uint32)m_Callsites.size();
+        m_CallsiteMap.insert(std::make_pair(key, callsiteIndex));
+
+        VulkanMemoryCallsiteStats stats;
+        stats.File = key.File;
+        stats.Line = line;
+        stats.Kind = kind;
+        m_Callsites.push_back(stats);
+    }
+    else
+    {
+        callsiteIndex = it->second;
+    }
+
+    VulkanMemoryCallsiteStats& stats = m_Callsites[callsiteIndex];
+    stats.Bytes            += size;
+    stats.Count            += 1;
+    stats.TotalAllocations += 1;
+    stats.PeakBytes         = glm::max(stats.PeakBytes, stats.Bytes);
+
+    if (memoryTypeIndex >= m_MemoryTypes.size())
+    {
+        const uint32 oldSize = (uint32)m_MemoryTypes.size();
+        m_MemoryTypes.resize(memoryTypeIndex + 1);
+        for (uint32 index = oldSize; index < m_MemoryTypes.size(); ++index) {
+            m_MemoryTypes[index].MemoryTypeIndex = index;
+        }
+    }
+    m_MemoryTypes[memoryTypeIndex].Bytes[(int32)kind] += size;
+    m_MemoryTypes[memoryTypeIndex].Count[(int32)kind] += 1;
+
+    Record record;
+    record.CallsiteIndex   = callsiteIndex;
+    record.MemoryTypeIndex = memoryTypeIndex;
+    record.Size            = size;
+    m_Records[allocation]  = record;
+}
+
+void VulkanMemoryTracker::UntrackAllocation(const void* allocation)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    // 关闭跟踪之前的分配仍然要能正确扣除
+    auto it = m_Records.find(allocation);
+    if (it == m_Records.end()) {
+        return;
+    }
+
+    const Record& record = it->second;
+    VulkanMemoryCallsiteStats& stats = m_Callsites[record.CallsiteIndex];
+    stats.Bytes -= record.Size;
+    stats.Count -= 1;
+
+    m_MemoryTypes[record.MemoryTypeIndex].Bytes[(int32)stats.Kind] -= record.Size;
+    m_MemoryTypes[record.MemoryTypeIndex].Count[(int32)stats.Kind] -= 1;
+
+    m_Records.erase(it);
+}
+
+void VulkanMemoryTracker::RegisterHeapManager(VulkanResourceHeapManager* heapManager)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (std::find(m_HeapManagers.begin(), m_HeapManagers.end(), heapManager) == m_HeapManagers.end()) {
+        m_HeapManagers.push_back(heapManager);
+    }
+}
+
+void VulkanMemoryTracker::UnregisterHeapManager(VulkanResourceHeapManager* heapManager)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    auto it = std::find(m_HeapManagers.begin(), m_HeapManagers.end(), heapManager);
+    if (it != m_HeapManagers.end()) {
+        m_HeapManagers.erase(it);
+    }
+}
+
+VulkanMemorySnapshot VulkanMemoryTracker::CaptureSnapshot(const std::string& name) const
+{
+    VulkanMemorySnapshot snapshot;
+    snapshot.Name = name;
+
+    std::vector<VulkanResourceHeapManager*> heapManagers;
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
+        for (int32 index = 0; index < m_Callsites.size(); ++index)
+        {
+            const VulkanMemoryCallsiteStats& stats = m_Callsites[index];
+            snapshot.TotalBytes[(int32)stats.Kind] += stats.Bytes;
+            snapshot.TotalCount[(int32)stats.Kind] += stats.Count;
+            if (stats.Count > 0) {
+                snapshot.Callsites.push_back(stats);
+            }
+        }
+        snapshot.MemoryTypes = m_MemoryTypes;
+        heapManagers         = m_HeapManagers;
+    }
+
+    std::sort(snapshot.Callsites.begin(), snapshot.Callsites.end(), [](const VulkanMemoryCallsiteStats& a, const VulkanMemoryCallsiteStats& b) {
+        return a.Bytes > b.Bytes;
+    });
+
+    // 页信息直接从资源堆里取，不在分配路径上维护
+    for (int32 index = 0; index < heapManagers.size(); ++index) {
+        heapManagers[index]->GatherPageStats(snapshot.Pages);
+    }
+
+    return snapshot;
+}
+
+void VulkanMemoryTracker::ReportLeaks() const
+{
+    VulkanMemorySnapshot snapshot = CaptureSnapshot("Leaks");
+    if (snapshot.Callsites.size() == 0) {
+        return;
+    }
+
+    RE_CORE_WARN("Vulkan memory leaks, {0} callsites still hold memory", snapshot.Callsites.size());
+    for (int32 index = 0; index < snapshot.Callsites.size(); ++index)
+    {
+        const VulkanMemoryCallsiteStats& stats = snapshot.Callsites[index];
+        RE_CORE_WARN("\t{0}({1}) [{2}] {3} allocations, {4} KB", stats.File, stats.Line, GetMemoryTrackKindName(stats.Kind), stats.Count, stats.Bytes / 1024);
+    }
+}
+
+// VulkanMemorySnapshot
+
+std::string VulkanMemorySnapshot::ToJson() const
+{
+    json root;
+    root["name"] = Name;
+
+    json totals = json::object();
+    for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind)
+    {
+        json entry;
+        entry["bytes"] = TotalBytes[kind];
+        entry["count"] = TotalCount[kind];
+        totals[GetMemoryTrackKindName((VulkanMemoryTrackKind)kind)] = entry;
+    }
+    root["totals"] = totals;
+
+    json callsites = json::array();
+    for (int32 index = 0; index < Callsites.size(); ++index)
+    {
+        const VulkanMemoryCallsiteStats& stats = Callsites[index];
+        json entry;
+        entry["file"]  = stats.File;
+        entry["line"]  = stats.Line;
+        entry["kind"]  = GetMemoryTrackKindName(stats.Kind);
+        entry["bytes"] = stats.Bytes;
+        entry["count"] = stats.Count;
+        entry["peak"]  = stats.PeakBytes;
+        entry["total"] = stats.TotalAllocations;
+        callsites.push_back(entry);
+    }
+    root["callsites"] = callsites;
+
+    json memoryTypes = json::array();
+    for (int32 index = 0; index < MemoryTypes.size(); ++index)
+    {
+        const VulkanMemoryTypeStats& stats = MemoryTypes[index];
+        json entry;
+        entry["type"] = stats.MemoryTypeIndex;
+        for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind)
+        {
+            json value;
+            value["bytes"] = stats.Bytes[kind];
+            value["count"] = stats.Count[kind];
+            entry[GetMemoryTrackKindName((VulkanMemoryTrackKind)kind)] = value;
+        }
+        memoryTypes.push_back(entry);
+    }
+    root["memoryTypes"] = memoryTypes;
+
+    json pages = json::array();
+    for (int32 index = 0; index < Pages.size(); ++index)
+    {
+        const VulkanMemoryPageStats& stats = Pages[index];
+        json entry;
+        entry["id"]            = stats.PageID;
+        entry["type"]          = stats.MemoryTypeIndex;
+        entry["subBuffer"]     = stats.IsSubBuffer;
+        entry["size"]          = stats.Size;
+        entry["used"]          = stats.UsedSize;
+        entry["allocations"]   = stats.NumAllocations;
+        entry["freeBlocks"]    = stats.NumFreeBlocks;
+        entry["largestFree"]   = stats.LargestFreeBlock;
+        entry["fragmentation"] = stats.GetFragmentation();
+        pages.push_back(entry);
+    }
+    root["pages"] = pages;
+
+    return root.dump(4);
+}
+
+bool VulkanMemorySnapshot::FromJson(const std::string& text)
+{
+    json root = json::parse(text, nullptr, false);
+    if (root.is_discarded() || !root.is_object())
+    {
+        RE_CORE_ERROR("Failed to parse memory snapshot.");
+        return false;
+    }
+
+    *this = VulkanMemorySnapshot();
+    Name = root.value("name", "");
+
+    if (root.find("totals") != root.end())
+    {
+        const json& totals = root["totals"];
+        for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind)
+        {
+            const char* kindName = GetMemoryTrackKindName((VulkanMemoryTrackKind)kind);
+            if (totals.find(kindName) != totals.end())
+            {
+                TotalBytes[kind] = totals[kindName].value("bytes", (uint64)0);
+                TotalCount[kind] = totals[kindName].value("count", (uint32)0);
+            }
+        }
+    }
+
+    if (root.find("callsites") != root.end())
+    {
+        for (const json& entry : root["callsites"])
+        {
+            VulkanMemoryCallsiteStats stats;
+            stats.File             = entry.value("file", "");
+            stats.Line             = entry.value("line", (uint32)0);
+            stats.Kind             = GetMemoryTrackKindFromName(entry.value("kind", ""));
+            stats.Bytes            = entry.value("bytes", (uint64)0);
+            stats.Count            = entry.value("count", (uint32)0);
+            stats.PeakBytes        = entry.value("peak", (uint64)0);
+            stats.TotalAllocations = entry.value("total", (uint64)0);
+            Callsites.push_back(stats);
+        }
+    }
+
+    if (root.find("memoryTypes") != root.end())
+    {
+        for (const json& entry : root["memoryTypes"])
+        {
+            VulkanMemoryTypeStats stats;
+            stats.MemoryTypeIndex = entry.value("type", (uint32)0);
+            for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind)
+            {
+                const char* kindName = GetMemoryTrackKindName((VulkanMemoryTrackKind)kind);
+                if (entry.find(kindName) != entry.end())
+                {
+                    stats.Bytes[kind] = entry[kindName].value("bytes", (uint64)0);
+                    stats.Count[kind] = entry[kindName].value("count", (uint32)0);
+                }
+            }
+            MemoryTypes.push_back(stats);
+        }
+    }
+
+    if (root.find("pages") != root.end())
+    {
+        for (const json& entry : root["pages"])
+        {
+            VulkanMemoryPageStats stats;
+            stats.PageID           = entry.value("id", (uint32)0);
+            stats.MemoryTypeIndex  = entry.value("type", (uint32)0);
+            stats.IsSubBuffer      = entry.value("subBuffer", false);
+            stats.Size             = entry.value("size", (uint64)0);
+            stats.UsedSize         = entry.value("used", (uint64)0);
+            stats.NumAllocations   = entry.value("allocations", (uint32)0);
+            stats.NumFreeBlocks    = entry.value("freeBlocks", (uint32)0);
+            stats.LargestFreeBlock = entry.value("largestFree", (uint64)0);
+            Pages.push_back(stats);
+        }
+    }
+
+    return true;
+}
+
+bool VulkanMemorySnapshot::SaveToFile(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+    {
+        RE_CORE_ERROR("Failed to open {0} for writing.", filename);
+        return false;
+    }
+    file << ToJson();
+    return true;
+}
+
+bool VulkanMemorySnapshot::LoadFromFile(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        RE_CORE_ERROR("Failed to open {0}.", filename);
+        return false;
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return FromJson(stream.str());
+}
+
+VulkanMemorySnapshotDiff VulkanMemorySnapshot::Diff(const VulkanMemorySnapshot& before, const VulkanMemorySnapshot& after)
+{
+    VulkanMemorySnapshotDiff diff;
+    for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind) {
+        diff.DeltaTotalBytes[kind] = (int64)after.TotalBytes[kind] - (int64)before.TotalBytes[kind];
+    }
+
+    // 快照可能来自不同的构建，调用点只能按文件名、行号和类型匹配
+    auto MakeKey = [](const VulkanMemoryCallsiteStats& stats) {
+        return stats.File + ":" + std::to_string(stats.Line) + ":" + GetMemoryTrackKindName(stats.Kind);
+    };
+
+    std::unordered_map<std::string, uint32> entryMap;
+    for (int32 pass = 0; pass < 2; ++pass)
+    {
+        const VulkanMemorySnapshot& snapshot = pass == 0 ? before : after;
+        const int32 sign = pass == 0 ? -1 : 1;
+
+        for (int32 index = 0; index < snapshot.Callsites.size(); ++index)
+        {
+            const VulkanMemoryCallsiteStats& stats = snapshot.Callsites[index];
+            const std::string key = MakeKey(stats);
+
+            auto it = entryMap.find(key);
+            if (it == entryMap.end())
+            {
+                VulkanMemorySnapshotDiff::Entry entry;
+                entry.File = stats.File;
+                entry.Line = stats.Line;
+                entry.Kind = stats.Kind;
+                it = entryMap.insert(std::make_pair(key, (uint32)diff.Callsites.size())).first;
+                diff.Callsites.push_back(entry);
+            }
+
+            VulkanMemorySnapshotDiff::Entry& entry = diff.Callsites[it->second];
+            entry.DeltaBytes += sign * (int64)stats.Bytes;
+            entry.DeltaCount += sign * (int32)stats.Count;
+        }
+    }
+
+    diff.Callsites.erase(std::remove_if(diff.Callsites.begin(), diff.Callsites.end(), [](const VulkanMemorySnapshotDiff::Entry& entry) {
+        return entry.DeltaBytes == 0 && entry.DeltaCount == 0;
+    }), diff.Callsites.end());
+
+    std::sort(diff.Callsites.begin(), diff.Callsites.end(), [](const VulkanMemorySnapshotDiff::Entry& a, const VulkanMemorySnapshotDiff::Entry& b) {
+        return std::abs(a.DeltaBytes) > std::abs(b.DeltaBytes);
+    });
+
+    return diff;
+}
+
+// VulkanMemorySnapshotDiff
+
+std::string VulkanMemorySnapshotDiff::ToJson() const
+{
+    json root;
+
+    json totals = json::object();
+    for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind) {
+        totals[GetMemoryTrackKindName((VulkanMemoryTrackKind)kind)] = DeltaTotalBytes[kind];
+    }
+    root["totals"] = totals;
+
+    json callsites = json::array();
+    for (int32 index = 0; index < Callsites.size(); ++index)
+    {
+        const Entry& stats = Callsites[index];
+        json entry;
+        entry["file"]  = stats.File;
+        entry["line"]  = stats.Line;
+        entry["kind"]  = GetMemoryTrackKindName(stats.Kind);
+        entry["bytes"] = stats.DeltaBytes;
+        entry["count"] = stats.DeltaCount;
+        callsites.push_back(entry);
+    }
+    root["callsites"] = callsites;
+
+    return root.dump(4);
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Core/SIngletonTemplate.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class VulkanResourceHeapManager;
+
+enum class VulkanMemoryTrackKind : uint8
+{
+    DeviceMemory,   // vkAllocateMemory得到的整块内存
+    Resource,       // 从资源堆页里切分的Buffer/Image内存
+    SubBuffer,      // 从小块Buffer池里切分的区间
+    Vma,            // 经过VMA分配的Buffer/Image内存
+    Count,
+};
+
+const char* GetMemoryTrackKindName(VulkanMemoryTrackKind kind);
+
+struct VulkanMemoryCallsiteStats
+{
+    std::string             File;
+    uint32                  Line = 0;
+    VulkanMemoryTrackKind   Kind = VulkanMemoryTrackKind::DeviceMemory;
+    uint64                  Bytes = 0;
+    uint32                  Count = 0;
+    uint64                  PeakBytes = 0;
+    uint64                  TotalAllocations = 0;
+};
+
+struct VulkanMemoryTypeStats
+{
+    uint32  MemoryTypeIndex = 0;
+    uint64  Bytes[(int32)VulkanMemoryTrackKind::Count] = {};
+    uint32  Count[(int32)VulkanMemoryTrackKind::Count] = {};
+};
+
+struct VulkanMemoryPageStats
+{
+    uint32  PageID = 0;
+    uint32  MemoryTypeIndex = 0;
+    bool    IsSubBuffer = false;
+    uint64  Size = 0;
+    uint64  UsedSize = 0;
+    uint32  NumAllocations = 0;
+    uint32  NumFreeBlocks = 0;
+    uint64  LargestFreeBlock = 0;
+
+    // 空闲空间中不能被最大空闲块覆盖的比例，0表示空闲空间完全连续
+    FORCE_INLINE float GetFragmentation() const
+    {
+        const uint64 freeSize = Size - UsedSize;
+        return freeSize > 0 ? 1.0f - (float)LargestFreeBlock / (float)freeSize : 0.0f;
+    }
+};
+
+struct VulkanMemorySnapshotDiff
+{
+    struct Entry
+    {
+        std::string             File;
+        uint32                  Line = 0;
+        VulkanMemoryTrackKind   Kind = VulkanMemoryTrackKind::DeviceMemory;
+        int64                   DeltaBytes = 0;
+        int32                   DeltaCount = 0;
+    };
+
+    int64               DeltaTotalBytes[(int32)VulkanMemoryTrackKind::Count] = {};
+    // 按|DeltaBytes|从大到小排序
+    std::vector<Entry>  Callsites;
+
+    std::string ToJson() const;
+};
+
+struct VulkanMemorySnapshot
+{
+    std::string                             Name;
+    uint64                                  TotalBytes[(int32)VulkanMemoryTrackKind::Count] = {};
+    uint32                                  TotalCount[(int32)VulkanMemoryTrackKind::Count] = {};
+    // 按Bytes从大到小排序
+    std::vector<VulkanMemoryCallsiteStats>  Callsites;
+    std::vector<VulkanMemoryTypeStats>      MemoryTypes;
+    std::vector<VulkanMemoryPageStats>      Pages;
+
+    std::string ToJson() const;
+    bool FromJson(const std::string& text);
+
+    bool SaveToFile(const std::string& filename) const;
+    bool LoadFromFile(const std::string& filename);
+
+    static VulkanMemorySnapshotDiff Diff(const VulkanMemorySnapshot& before, const VulkanMemorySnapshot& after);
+};
+
+// 显存分配跟踪，按调用点(file:line)、内存类型和页统计字节数与数量
+// 分配路径已经带了file/line，这里只在分配和释放时各做一次哈希表更新
+// 导出的快照可以存成JSON，两次构建之间做Diff查找显存增长
+class VulkanMemoryTracker : public ReEngine::SingletonTemplate<VulkanMemoryTracker>
+{
+public:
+    void TrackAllocation(VulkanMemoryTrackKind kind, const void* allocation, uint64 size, uint32 memoryTypeIndex, const char* file, uint32 line);
+
+    void UntrackAllocation(const void* allocation);
+
+    // 资源堆管理器注册后，快照会带上每个页的使用率和碎片信息
+    void RegisterHeapManager(VulkanResourceHeapManager* heapManager);
+
+    void UnregisterHeapManager(VulkanResourceHeapManager* heapManager);
+
+    VulkanMemorySnapshot CaptureSnapshot(const std::string& name = "") const;
+
+    // 报告还没有释放的分配，按调用点汇总
+    void ReportLeaks() const;
+
+    FORCE_INLINE void SetEnabled(bool enabled)
+    {
+        m_Enabled = enabled;
+    }
+
+    FORCE_INLINE bool IsEnabled() const
+    {
+        return m_Enabled;
+    }
+
+private:
+    struct CallsiteKey
+    {
+        const char*             File;
+        uint32                  Line;
+        VulkanMemoryTrackKind   Kind;
+
+        bool operator==(const CallsiteKey& other) const;
+    };
+
+    struct CallsiteKeyHash
+    {
+        size_t operator()(const CallsiteKey& key) const;
+    };
+
+    struct Record
+    {
+        uint32  CallsiteIndex;
+        uint32  MemoryTypeIndex;
+        uint64  Size;
+    };
+
+    mutable std::mutex                                      m_Lock;
+    bool                                                    m_Enabled = true;
+    std::unordered_map<CallsiteKey, uint32, CallsiteKeyHash> m_CallsiteMap;
+    std::vector<VulkanMemoryCallsiteStats>                  m_Callsites;
+    std::vector<VulkanMemoryTypeStats>                      m_MemoryTypes;
+    std::unordered_map<const void*, Record>                 m_Records;
+    std::vector<VulkanResourceHeapManager*>                 m_HeapManagers;
+};
@@ -0,0 +1,124 @@
+﻿#include "VulkanParallelRecorder.h"
+#include "Core/WorkerPool.h"
+
+namespace ReEngine
+{
+    void VulkanParallelRecorder::Init(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 numThreads)
+    {
+        m_Device     = device;
+        m_NumFrames  = numFramesInFlight;
+        m_NumThreads = Clamp<uint32>(numThreads, 1, MAX_RECORD_THREADS);
+        m_FrameIndex = 0;
+
+        VkCommandPoolCreateInfo cmdPoolInfo;
+        ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+        cmdPoolInfo.queueFamilyIndex = device->GetGraphicsQueue()->GetFamilyIndex();
+        cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        m_Pools.resize(m_NumFrames * m_NumThreads);
+        for (int32 index = 0; index < m_Pools.size(); ++index) {
+            VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_Pools[index].CommandPool));
+        }
+    }
+
+    void VulkanParallelRecorder::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        // 销毁Pool时一起释放其中的CommandBuffer
+        VkDevice device = m_Device->GetInstanceHandle();
+        for (int32 index = 0; index < m_Pools.size(); ++index) {
+            vkDestroyCommandPool(device, m_Pools[index].CommandPool, VULKAN_CPU_ALLOCATOR);
+        }
+        m_Pools.clear();
+        m_Recorded.clear();
+        m_Device.reset();
+    }
+
+    void VulkanParallelRecorder::BeginFrame(uint32 frameIndex)
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        m_FrameIndex = frameIndex % m_NumFrames;
+        m_NumSecondaryRecorded = m_NumSecondaryFrame;
+        m_NumSecondaryFrame    = 0;
+
+        VkDevice device = m_Device->GetInstanceHandle();
+        for (uint32 chunkIndex = 0; chunkIndex < m_NumThreads; ++chunkIndex)
+        {
+            ThreadPool& pool = GetThreadPool(chunkIndex);
+            if (pool.NumUsed > 0) {
+                VERIFYVULKANRESULT(vkResetCommandPool(device, pool.CommandPool, 0));
+            }
+            pool.NumUsed = 0;
+        }
+    }
+
+    void VulkanParallelRecorder::RecordPass(VkCommandBuffer primary, VkRenderPass renderPass, uint32 subpass, VkFramebuffer framebuffer, uint32 drawCount, const RecordFunction& record)
+    {
+        if (!m_Device || drawCount == 0) {
+            return;
+        }
+
+        uint32 numChunks = (drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK;
+        numChunks = numChunks > m_NumThreads ? m_NumThreads : numChunks;
+        const uint32 drawsPerChunk = (drawCount + numChunks - 1) / numChunks;
+
+        // 主线程先取好每块的CommandBuffer，第i块只会用第i个Pool
+        m_Recorded.resize(numChunks);
+        for (uint32 chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex) {
+            m_Recorded[chunkIndex] = AcquireSecondary(GetThreadPool(chunkIndex));
+        }
+
+        VkCommandBufferInheritanceInfo inheritanceInfo;
+        ZeroVulkanStruct(inheritanceInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO);
+        inheritanceInfo.renderPass  = renderPass;
+        inheritanceInfo.subpass     = subpass;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        WorkerPool::GetInstance().ParallelFor(numChunks, [&](uint32 chunkIndex)
+        {
+            const uint32 drawBegin = chunkIndex * drawsPerChunk;
+            const uint32 drawEnd   = drawBegin + drawsPerChunk > drawCount ? drawCount : drawBegin + drawsPerChunk;
+            VkCommandBuffer cmdBuffer = m_Recorded[chunkIndex];
+
+            VkCommandBufferBeginInfo beginInfo;
+            ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+            beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+            vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+
+            if (drawBegin < drawEnd) {
+                record(cmdBuffer, drawBegin, drawEnd);
+            }
+
+            vkEndCommandBuffer(cmdBuffer);
+        });
+
+        vkCmdExecuteCommands(primary, numChunks, m_Recorded.data());
+        m_NumSecondaryFrame += numChunks;
+    }
+
+    VkCommandBuffer VulkanParallelRecorder::AcquireSecondary(ThreadPool& pool)
+    {
+        if (pool.NumUsed < pool.CmdBuffers.size()) {
+            return pool.CmdBuffers[pool.NumUsed++];
+        }
+
+        VkCommandBufferAllocateInfo allocInfo;
+        ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+        allocInfo.commandPool        = pool.CommandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+        VERIFYVULKANRESULT(vkAllocateCommandBuffers(m_Device->GetInstanceHandle(), &allocInfo, &cmdBuffer));
+        pool.CmdBuffers.push_back(cmdBuffer);
+        pool.NumUsed += 1;
+        return cmdBuffer;
+    }
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+
+#include <functional>
+#include <vector>
+
+namespace ReEngine
+{
+    // 把一个Pass的DrawList按顺序切成连续的块，每块在一个工作线程上录进自己的Secondary CommandBuffer
+    // 主CommandBuffer按块的顺序Execute，执行结果和单线程录制一致
+    // 每个帧槽位、每个块各一个CommandPool，槽位复用时整池Reset，Secondary不逐个释放
+    class VulkanParallelRecorder
+    {
+    public:
+        // cmdBuffer已经Begin并继承了RenderPass，录制[drawBegin, drawEnd)范围的绘制
+        // Secondary不继承动态状态，需要的Viewport和Scissor在这里重新设置
+        typedef std::function<void(VkCommandBuffer cmdBuffer, uint32 drawBegin, uint32 drawEnd)> RecordFunction;
+
+        enum
+        {
+            MAX_RECORD_THREADS  = 16,
+            // 每块太少时线程调度的开销比录制还大
+            MIN_DRAWS_PER_CHUNK = 128,
+        };
+
+        void Init(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 numThreads);
+
+        void Destroy();
+
+        // Acquire之后调用，这个槽位上一次提交的Secondary已经执行完
+        void BeginFrame(uint32 frameIndex);
+
+        // 主CommandBuffer必须已经用VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS开始了renderPass的subpass
+        void RecordPass(VkCommandBuffer primary, VkRenderPass renderPass, uint32 subpass, VkFramebuffer framebuffer, uint32 drawCount, const RecordFunction& record);
+
+        FORCE_INLINE uint32 GetNumThreads() const
+        {
+            return m_NumThreads;
+        }
+
+        // 上一帧录制的Secondary数量
+        FORCE_INLINE uint32 GetNumSecondaryRecorded() const
+        {
+            return m_NumSecondaryRecorded;
+        }
+
+    private:
+        struct ThreadPool
+        {
+            VkCommandPool                   CommandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer>    CmdBuffers;
+            // 这一帧已经用掉的CmdBuffers
+            uint32                          NumUsed = 0;
+        };
+
+        VkCommandBuffer AcquireSecondary(ThreadPool& pool);
+
+        FORCE_INLINE ThreadPool& GetThreadPool(uint32 chunkIndex)
+        {
+            return m_Pools[m_FrameIndex * m_NumThreads + chunkIndex];
+        }
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        uint32                          m_NumFrames = 0;
+        uint32                          m_NumThreads = 0;
+        uint32                          m_FrameIndex = 0;
+
+        // 按[frameIndex][chunkIndex]排布
+        std::vector<ThreadPool>         m_Pools;
+        std::vector<VkCommandBuffer>    m_Recorded;
+
+        uint32                          m_NumSecondaryFrame = 0;
+        uint32                          m_NumSecondaryRecorded = 0;
+    };
+}
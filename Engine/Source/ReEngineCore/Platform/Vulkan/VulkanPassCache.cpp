@@ -0,0 +1,126 @@
+﻿#include "VulkanPassCache.h"
+
+#include <atomic>
+
+namespace ReEngine
+{
+    static std::atomic<uint64> G_PassCacheGeneration { 0 };
+
+    void VulkanPassKey::Add(const void* data, uint32 size)
+    {
+        const uint8* bytes = (const uint8*)data;
+        for (uint32 index = 0; index < size; ++index)
+        {
+            m_Hash ^= bytes[index];
+            m_Hash *= 1099511628211ULL;
+        }
+    }
+
+    void VulkanPassCache::Init(Ref<VulkanDevice> device, Ref<VulkanDynamicBufferRing> ringBuffer, uint32 numFramesInFlight)
+    {
+        m_Device     = device;
+        m_RingBuffer = ringBuffer;
+        m_Valid      = false;
+        m_Current    = 0;
+
+        VkCommandPoolCreateInfo cmdPoolInfo;
+        ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+        cmdPoolInfo.queueFamilyIndex = device->GetGraphicsQueue()->GetFamilyIndex();
+        cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_CommandPool));
+
+        // 每帧都重新录制时，第i个要等numFramesInFlight帧之后才轮回来
+        m_CmdBuffers.resize(numFramesInFlight + 1);
+
+        VkCommandBufferAllocateInfo allocInfo;
+        ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+        allocInfo.commandPool        = m_CommandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = (uint32)m_CmdBuffers.size();
+        VERIFYVULKANRESULT(vkAllocateCommandBuffers(device->GetInstanceHandle(), &allocInfo, m_CmdBuffers.data()));
+    }
+
+    void VulkanPassCache::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        if (m_RetainId != 0)
+        {
+            m_RingBuffer->ReleaseRetained(m_RetainId);
+            m_RetainId = 0;
+        }
+
+        vkDestroyCommandPool(m_Device->GetInstanceHandle(), m_CommandPool, VULKAN_CPU_ALLOCATOR);
+        m_CommandPool = VK_NULL_HANDLE;
+        m_CmdBuffers.clear();
+        m_Valid = false;
+
+        m_RingBuffer.reset();
+        m_Device.reset();
+    }
+
+    bool VulkanPassCache::ExecutePass(VkCommandBuffer primary, VkRenderPass renderPass, uint32 subpass, uint64 key, const RecordFunction& record)
+    {
+        if (!m_Device) {
+            return false;
+        }
+
+        const uint64 generation = G_PassCacheGeneration.load();
+        if (m_Enabled && m_Valid && m_Key == key && m_RenderPass == renderPass && m_Subpass == subpass && m_Generation == generation)
+        {
+            vkCmdExecuteCommands(primary, 1, &m_CmdBuffers[m_Current]);
+            m_NumReused += 1;
+            return false;
+        }
+
+        // 旧的录制最晚在上一帧还被引用，保留区挂到这一帧上回收
+        if (m_RetainId != 0)
+        {
+            m_RingBuffer->ReleaseRetained(m_RetainId);
+            m_RetainId = 0;
+        }
+
+        m_Current = (m_Current + 1) % m_CmdBuffers.size();
+        VkCommandBuffer cmdBuffer = m_CmdBuffers[m_Current];
+
+        VkCommandBufferInheritanceInfo inheritanceInfo;
+        ZeroVulkanStruct(inheritanceInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO);
+        inheritanceInfo.renderPass  = renderPass;
+        inheritanceInfo.subpass     = subpass;
+        inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+        VkCommandBufferBeginInfo beginInfo;
+        ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+        beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VERIFYVULKANRESULT(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+
+        m_RetainId = m_RingBuffer->BeginRetain();
+        record(cmdBuffer);
+        m_RingBuffer->EndRetain();
+
+        vkEndCommandBuffer(cmdBuffer);
+
+        vkCmdExecuteCommands(primary, 1, &cmdBuffer);
+
+        m_Valid      = true;
+        m_Key        = key;
+        m_Generation = generation;
+        m_RenderPass = renderPass;
+        m_Subpass    = subpass;
+        m_NumRecorded += 1;
+        return true;
+    }
+
+    void VulkanPassCache::Invalidate()
+    {
+        m_Valid = false;
+    }
+
+    void VulkanPassCache::InvalidateAll()
+    {
+        G_PassCacheGeneration += 1;
+    }
+}
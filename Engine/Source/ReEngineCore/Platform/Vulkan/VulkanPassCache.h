@@ -0,0 +1,101 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffers/VulkanDynamicBufferRing.h"
+
+#include <functional>
+#include <vector>
+
+namespace ReEngine
+{
+    // 把Pass的输入按字节累加成64位的Key，FNV-1a
+    class VulkanPassKey
+    {
+    public:
+        void Add(const void* data, uint32 size);
+
+        template<typename T>
+        FORCE_INLINE VulkanPassKey& Add(const T& value)
+        {
+            Add(&value, sizeof(T));
+            return *this;
+        }
+
+        FORCE_INLINE uint64 Get() const
+        {
+            return m_Hash;
+        }
+
+    private:
+        uint64 m_Hash = 14695981039346656037ULL;
+    };
+
+    // 静态Pass的录制缓存：Key不变时直接Execute上一次录好的Secondary，不再走录制代码
+    // Secondary用SIMULTANEOUS_USE录制，不继承FrameBuffer，几个帧槽位和交换链图像可以共用
+    // 录制期间从Ring分配的Uniform放进保留区，Key变化重新录制时才还给Ring
+    // 缓存期间用到的描述符集不能更新，Pass读的纹理、Buffer、矩阵和参数都要算进Key，流式贴图还要算上ResidencyVersion
+    class VulkanPassCache
+    {
+    public:
+        // cmdBuffer已经Begin并继承了RenderPass，Viewport和Scissor要在这里设置
+        typedef std::function<void(VkCommandBuffer cmdBuffer)> RecordFunction;
+
+        void Init(Ref<VulkanDevice> device, Ref<VulkanDynamicBufferRing> ringBuffer, uint32 numFramesInFlight);
+
+        void Destroy();
+
+        // 主CommandBuffer必须已经用VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS开始了renderPass的subpass
+        // 每个缓存对应一个Pass，每帧最多调用一次；返回这次是否重新录制
+        bool ExecutePass(VkCommandBuffer primary, VkRenderPass renderPass, uint32 subpass, uint64 key, const RecordFunction& record);
+
+        // 下一次ExecutePass一定重新录制，例如FrameBuffer重建之后
+        void Invalidate();
+
+        // 所有缓存下一次都重新录制，例如碎片整理把网格的Buffer换成了新的
+        static void InvalidateAll();
+
+        // 关闭时每帧都重新录制，用来对比CPU开销
+        FORCE_INLINE void SetEnabled(bool enabled)
+        {
+            m_Enabled = enabled;
+        }
+
+        FORCE_INLINE bool IsEnabled() const
+        {
+            return m_Enabled;
+        }
+
+        FORCE_INLINE uint64 GetNumRecorded() const
+        {
+            return m_NumRecorded;
+        }
+
+        FORCE_INLINE uint64 GetNumReused() const
+        {
+            return m_NumReused;
+        }
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        Ref<VulkanDynamicBufferRing>    m_RingBuffer;
+        VkCommandPool                   m_CommandPool = VK_NULL_HANDLE;
+
+        // 重新录制时换下一个，轮回来时用它的那一帧已经执行完
+        std::vector<VkCommandBuffer>    m_CmdBuffers;
+        uint32                          m_Current = 0;
+
+        bool                            m_Valid = false;
+        bool                            m_Enabled = true;
+        uint64                          m_Key = 0;
+        // 录制时的全局代数，InvalidateAll之后对不上
+        uint64                          m_Generation = 0;
+        VkRenderPass                    m_RenderPass = VK_NULL_HANDLE;
+        uint32                          m_Subpass = 0;
+        // 当前录制引用的Ring保留区，0表示没有
+        uint32                          m_RetainId = 0;
+
+        uint64                          m_NumRecorded = 0;
+        uint64                          m_NumReused = 0;
+    };
+}
@@ -2,15 +2,148 @@
 #include "VulkanDevice.h"
 #include "VulkanFence.h"
 
-VulkanQueue::VulkanQueue(VulkanDevice* device, uint32 familyIndex)
+VulkanQueue::VulkanQueue(VulkanDevice* device, uint32 familyIndex, uint32 queueIndex)
     : m_Queue(VK_NULL_HANDLE)
     , m_FamilyIndex(familyIndex)
     , m_Device(device)
 {
-    vkGetDeviceQueue(m_Device->GetInstanceHandle(), m_FamilyIndex, 0, &m_Queue);
+    vkGetDeviceQueue(m_Device->GetInstanceHandle(), m_FamilyIndex, queueIndex, &m_Queue);
+
+    // 每个队列一个单调递增的Timeline Semaphore，替代每次提交一个Fence
+    VkSemaphoreTypeCreateInfo typeCreateInfo;
+    ZeroVulkanStruct(typeCreateInfo, VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO);
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo createInfo;
+    ZeroVulkanStruct(createInfo, VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO);
+    createInfo.pNext = &typeCreateInfo;
+    VERIFYVULKANRESULT(vkCreateSemaphore(m_Device->GetInstanceHandle(), &createInfo, VULKAN_CPU_ALLOCATOR, &m_Timeline));
 }
 
 VulkanQueue::~VulkanQueue()
 {
     auto pause = 1;
+}
+
+void VulkanQueue::Destroy()
+{
+    if (m_Timeline == VK_NULL_HANDLE) {
+        return;
+    }
+
+    WaitIdle();
+    vkDestroySemaphore(m_Device->GetInstanceHandle(), m_Timeline, VULKAN_CPU_ALLOCATOR);
+    m_Timeline = VK_NULL_HANDLE;
+}
+
+uint64 VulkanQueue::Submit(uint32 numCmdBuffers, const VkCommandBuffer* cmdBuffers, uint32 numWaitSemaphores, const VkSemaphore* waitSemaphores, const VkPipelineStageFlags* waitStageMasks, uint32 numSignalSemaphores, const VkSemaphore* signalSemaphores)
+{
+    std::lock_guard<std::mutex> lock(m_SubmitLock);
+
+    const uint64 signalValue = m_LastSubmitted.load() + 1;
+
+    // 二进制Semaphore的值会被忽略，填0占位
+    m_WaitSemaphores.assign(waitSemaphores, waitSemaphores + numWaitSemaphores);
+    m_WaitStageMasks.assign(waitStageMasks, waitStageMasks + numWaitSemaphores);
+    m_WaitValues.assign(numWaitSemaphores, 0);
+    for (int32 index = 0; index < m_PendingWaits.size(); ++index)
+    {
+        m_WaitSemaphores.push_back(m_PendingWaits[index].Semaphore);
+        m_WaitStageMasks.push_back(m_PendingWaits[index].StageMask);
+        m_WaitValues.push_back(m_PendingWaits[index].Value);
+    }
+    m_PendingWaits.clear();
+
+    m_SignalSemaphores.assign(signalSemaphores, signalSemaphores + numSignalSemaphores);
+    m_SignalValues.assign(numSignalSemaphores, 0);
+    m_SignalSemaphores.push_back(m_Timeline);
+    m_SignalValues.push_back(signalValue);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo;
+    ZeroVulkanStruct(timelineInfo, VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO);
+    timelineInfo.waitSemaphoreValueCount   = (uint32)m_WaitValues.size();
+    timelineInfo.pWaitSemaphoreValues      = m_WaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = (uint32)m_SignalValues.size();
+    timelineInfo.pSignalSemaphoreValues    = m_SignalValues.data();
+
+    VkSubmitInfo submitInfo;
+    ZeroVulkanStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = numCmdBuffers;
+    submitInfo.pCommandBuffers      = cmdBuffers;
+    submitInfo.waitSemaphoreCount   = (uint32)m_WaitSemaphores.size();
+    submitInfo.pWaitSemaphores      = m_WaitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = m_WaitStageMasks.data();
+    submitInfo.signalSemaphoreCount = (uint32)m_SignalSemaphores.size();
+    submitInfo.pSignalSemaphores    = m_SignalSemaphores.data();
+    VERIFYVULKANRESULT(vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    m_LastSubmitted.store(signalValue);
+    return signalValue;
+}
+
+void VulkanQueue::AddWait(const VulkanQueue& other, uint64 point, VkPipelineStageFlags waitStageMask)
+{
+    // 同一个队列按提交顺序执行，不需要等待自己
+    if (&other == this || point == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_SubmitLock);
+
+    for (int32 index = 0; index < m_PendingWaits.size(); ++index)
+    {
+        PendingWait& wait = m_PendingWaits[index];
+        if (wait.Semaphore == other.m_Timeline)
+        {
+            wait.Value      = wait.Value > point ? wait.Value : point;
+            wait.StageMask |= waitStageMask;
+            return;
+        }
+    }
+
+    m_PendingWaits.push_back({ other.m_Timeline, point, waitStageMask });
+}
+
+bool VulkanQueue::IsComplete(uint64 point)
+{
+    if (point <= m_LastCompleted.load()) {
+        return true;
+    }
+
+    uint64 value = 0;
+    VERIFYVULKANRESULT(vkGetSemaphoreCounterValue(m_Device->GetInstanceHandle(), m_Timeline, &value));
+    UpdateCompleted(value);
+    return point <= value;
+}
+
+void VulkanQueue::WaitFor(uint64 point)
+{
+    if (point <= m_LastCompleted.load()) {
+        return;
+    }
+
+    // 等一个还没提交的值会永远挂住
+    if (point > m_LastSubmitted.load())
+    {
+        RE_CORE_ERROR("Waiting for timeline point {0} that was never submitted, last submitted {1}", point, m_LastSubmitted.load());
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo;
+    ZeroVulkanStruct(waitInfo, VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO);
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &m_Timeline;
+    waitInfo.pValues        = &point;
+    VERIFYVULKANRESULT(vkWaitSemaphores(m_Device->GetInstanceHandle(), &waitInfo, ((uint64)	0xffffffffffffffff)));
+
+    UpdateCompleted(point);
+}
+
+void VulkanQueue::UpdateCompleted(uint64 value)
+{
+    uint64 completed = m_LastCompleted.load();
+    while (completed < value && !m_LastCompleted.compare_exchange_weak(completed, value)) {
+    }
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 
 #include "VulkanCommonDefine.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class VulkanDevice;
 
@@ -10,7 +13,7 @@ class VulkanQueue
 {
 public:
     
-    VulkanQueue(VulkanDevice* device, uint32 familyIndex);
+    VulkanQueue(VulkanDevice* device, uint32 familyIndex, uint32 queueIndex = 0);
     VulkanQueue():m_Queue(nullptr),m_FamilyIndex(-1),m_Device(nullptr){}
     
     virtual ~VulkanQueue();
@@ -24,10 +27,72 @@ public:
     {
         return m_Queue;
     }
+
+    FORCE_INLINE VkSemaphore GetTimelineSemaphore() const
+    {
+        return m_Timeline;
+    }
+
+    // 最后一次提交Signal的值，还没有提交过时为0
+    FORCE_INLINE uint64 GetLastSubmitted() const
+    {
+        return m_LastSubmitted.load();
+    }
+
+    // 上一次查询到的完成值，不会访问GPU
+    FORCE_INLINE uint64 GetLastCompleted() const
+    {
+        return m_LastCompleted.load();
+    }
+
+    // 设备销毁前调用
+    void Destroy();
+
+    // 提交后在这个队列的时间线上Signal下一个值并返回，不会等待GPU
+    // 二进制Semaphore只用于交换链，其它同步都用返回的值
+    uint64 Submit(uint32 numCmdBuffers, const VkCommandBuffer* cmdBuffers,
+                  uint32 numWaitSemaphores = 0, const VkSemaphore* waitSemaphores = nullptr, const VkPipelineStageFlags* waitStageMasks = nullptr,
+                  uint32 numSignalSemaphores = 0, const VkSemaphore* signalSemaphores = nullptr);
+
+    // 下一次Submit在GPU上等待other的时间线到达point，用于图形、计算、传输队列之间的依赖
+    void AddWait(const VulkanQueue& other, uint64 point, VkPipelineStageFlags waitStageMask);
+
+    // 缓存的完成值够了就直接返回，不够才查询一次Semaphore
+    bool IsComplete(uint64 point);
+
+    void WaitFor(uint64 point);
+
+    FORCE_INLINE void WaitIdle()
+    {
+        WaitFor(GetLastSubmitted());
+    }
     
+private:
+    struct PendingWait
+    {
+        VkSemaphore             Semaphore;
+        uint64                  Value;
+        VkPipelineStageFlags    StageMask;
+    };
+
+    void UpdateCompleted(uint64 value);
+
 private:
     VkQueue         m_Queue;
     uint32          m_FamilyIndex;
     VulkanDevice*   m_Device;
+
+    VkSemaphore                 m_Timeline = VK_NULL_HANDLE;
+    std::atomic<uint64>         m_LastSubmitted { 0 };
+    std::atomic<uint64>         m_LastCompleted { 0 };
+
+    // vkQueueSubmit需要外部同步，等待列表也在同一把锁里
+    std::mutex                  m_SubmitLock;
+    std::vector<PendingWait>    m_PendingWaits;
+    std::vector<VkSemaphore>    m_WaitSemaphores;
+    std::vector<uint64>         m_WaitValues;
+    std::vector<VkPipelineStageFlags> m_WaitStageMasks;
+    std::vector<VkSemaphore>    m_SignalSemaphores;
+    std::vector<uint64>         m_SignalValues;
 };
 
@@ -180,7 +180,7 @@ VulkanFrameBuffer::VulkanFrameBuffer(VkDevice InDevice,const VulkanRenderTargetL
     Extent2D.height = RtLayout.extent3D.height;
 }
 
-void VulkanRenderTarget::BeginRenderPass(VkCommandBuffer CmdBuffer)
+void VulkanRenderTarget::BeginRenderPass(VkCommandBuffer CmdBuffer, VkSubpassContents contents)
 {
      for (int32 index = 0; index < RenderPassInfo.NumColorRenderTargets; ++index)
     {
@@ -208,6 +208,26 @@ void VulkanRenderTarget::BeginRenderPass(VkCommandBuffer CmdBuffer)
         ImagePipelineBarrier(CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::DepthStencilAttachment, subResRange);
     }
 
+    VkRenderPassBeginInfo renderPassBeginInfo;
+    ZeroVulkanStruct(renderPassBeginInfo, VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO);
+    renderPassBeginInfo.renderPass               = mRenderPass->RenderPass;
+    renderPassBeginInfo.framebuffer              = mFrameBuffer->FrameBuffer;
+    renderPassBeginInfo.renderArea.offset.x      = 0;
+    renderPassBeginInfo.renderArea.offset.y      = 0;
+    renderPassBeginInfo.renderArea.extent.width  = Extent2D.width;
+    renderPassBeginInfo.renderArea.extent.height = Extent2D.height;
+    renderPassBeginInfo.clearValueCount          = (uint32_t)ClearValues.size();
+    renderPassBeginInfo.pClearValues             = ClearValues.data();
+    vkCmdBeginRenderPass(CmdBuffer, &renderPassBeginInfo, contents);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+    {
+        SetViewportScissor(CmdBuffer);
+    }
+}
+
+void VulkanRenderTarget::SetViewportScissor(VkCommandBuffer CmdBuffer)
+{
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = (float)Extent2D.height;
@@ -222,18 +242,6 @@ void VulkanRenderTarget::BeginRenderPass(VkCommandBuffer CmdBuffer)
     scissor.offset.x = 0;
     scissor.offset.y = 0;
 
-    VkRenderPassBeginInfo renderPassBeginInfo;
-    ZeroVulkanStruct(renderPassBeginInfo, VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO);
-    renderPassBeginInfo.renderPass               = mRenderPass->RenderPass;
-    renderPassBeginInfo.framebuffer              = mFrameBuffer->FrameBuffer;
-    renderPassBeginInfo.renderArea.offset.x      = 0;
-    renderPassBeginInfo.renderArea.offset.y      = 0;
-    renderPassBeginInfo.renderArea.extent.width  = Extent2D.width;
-    renderPassBeginInfo.renderArea.extent.height = Extent2D.height;
-    renderPassBeginInfo.clearValueCount          = (uint32_t)ClearValues.size();
-    renderPassBeginInfo.pClearValues             = ClearValues.data();
-    vkCmdBeginRenderPass(CmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
     vkCmdSetViewport(CmdBuffer, 0, 1, &viewport);
     vkCmdSetScissor(CmdBuffer,  0, 1, &scissor);
 }
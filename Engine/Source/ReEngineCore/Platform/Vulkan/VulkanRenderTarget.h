@@ -340,7 +340,9 @@ namespace ReEngine
             mFrameBuffer.reset();
         }
 
-        void BeginRenderPass(VkCommandBuffer CmdBuffer);
+        // contents为SECONDARY_COMMAND_BUFFERS时主CommandBuffer里不能再录别的命令，Viewport和Scissor要在Secondary里用SetViewportScissor设置
+        void BeginRenderPass(VkCommandBuffer CmdBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+        void SetViewportScissor(VkCommandBuffer CmdBuffer);
         void EndRenderPass(VkCommandBuffer CmdBuffer);
 
         FORCEINLINE VkRenderPass GetRenderPass()const
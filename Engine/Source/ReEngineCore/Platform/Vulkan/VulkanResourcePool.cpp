@@ -0,0 +1,305 @@
+﻿#include "VulkanResourcePool.h"
+#include "Mesh/VulkanMesh.h"
+#include "Mesh/VulkanPrimitive.h"
+#include "VulkanBuffers/VulkanBuffer.h"
+#include "VulkanBuffers/VulkanTexture.h"
+#include "Core/Assert.h"
+
+/*------------------ Buffer ---------------------------*/
+
+BufferHandle VulkanResourcePool::RegisterBuffer(VulkanBuffer* buffer)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    BufferHandle handle = m_Buffers.Handles.Allocate();
+    m_Buffers.Descriptors.push_back(buffer->Descriptor);
+    m_Buffers.Mapped.push_back(buffer->Mapped);
+    m_Buffers.Objects.push_back(buffer);
+
+    // Descriptor可能还没Setup，至少保证Buffer是对的
+    m_Buffers.Descriptors.back().buffer = buffer->Buffer;
+    return handle;
+}
+
+void VulkanResourcePool::UpdateBuffer(BufferHandle handle, VulkanBuffer* buffer)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Buffers.Handles.IsValid(handle)) {
+        return;
+    }
+
+    const uint32 index = m_Buffers.Handles.GetDenseIndex(handle);
+    m_Buffers.Descriptors[index]        = buffer->Descriptor;
+    m_Buffers.Descriptors[index].buffer = buffer->Buffer;
+    m_Buffers.Mapped[index]             = buffer->Mapped;
+}
+
+bool VulkanResourcePool::IsValid(BufferHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Buffers.Handles.IsValid(handle);
+}
+
+void VulkanResourcePool::ReleaseBuffer(BufferHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    const uint32 index = m_Buffers.Handles.Release(handle);
+    if (index == HandlePool<VulkanBuffer>::INVALID_INDEX) {
+        return;
+    }
+
+    HandlePool<VulkanBuffer>::SwapRemove(m_Buffers.Descriptors, index);
+    HandlePool<VulkanBuffer>::SwapRemove(m_Buffers.Mapped, index);
+    HandlePool<VulkanBuffer>::SwapRemove(m_Buffers.Objects, index);
+}
+
+/*------------------ Texture ---------------------------*/
+
+TextureHandle VulkanResourcePool::RegisterTexture(VulkanTexture* texture)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    TextureHandle handle = m_Textures.Handles.Allocate();
+    m_Textures.Images.push_back(texture->Image);
+    m_Textures.Descriptors.push_back(texture->DescriptorInfo);
+    m_Textures.Objects.push_back(texture);
+    return handle;
+}
+
+void VulkanResourcePool::UpdateTexture(TextureHandle handle, VulkanTexture* texture)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Textures.Handles.IsValid(handle)) {
+        return;
+    }
+
+    const uint32 index = m_Textures.Handles.GetDenseIndex(handle);
+    m_Textures.Images[index]      = texture->Image;
+    m_Textures.Descriptors[index] = texture->DescriptorInfo;
+}
+
+bool VulkanResourcePool::IsValid(TextureHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Textures.Handles.IsValid(handle);
+}
+
+void VulkanResourcePool::ReleaseTexture(TextureHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    const uint32 index = m_Textures.Handles.Release(handle);
+    if (index == HandlePool<VulkanTexture>::INVALID_INDEX) {
+        return;
+    }
+
+    HandlePool<VulkanTexture>::SwapRemove(m_Textures.Images, index);
+    HandlePool<VulkanTexture>::SwapRemove(m_Textures.Descriptors, index);
+    HandlePool<VulkanTexture>::SwapRemove(m_Textures.Objects, index);
+}
+
+/*------------------ Primitive ---------------------------*/
+
+PrimitiveHandle VulkanResourcePool::RegisterPrimitive(VulkanPrimitive* primitive)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    PrimitiveHandle handle = m_Primitives.Handles.Allocate();
+    m_Primitives.VertexBuffers.push_back(VK_NULL_HANDLE);
+    m_Primitives.VertexOffsets.push_back(0);
+    m_Primitives.IndexBuffers.push_back(VK_NULL_HANDLE);
+    m_Primitives.IndexTypes.push_back(VK_INDEX_TYPE_UINT16);
+    m_Primitives.DrawCounts.push_back(0);
+    m_Primitives.Objects.push_back(primitive);
+
+    const uint32 index = m_Primitives.Handles.GetDenseIndex(handle);
+    if (primitive->VertexBuffer)
+    {
+        m_Primitives.VertexBuffers[index] = primitive->VertexBuffer->Buffer->Buffer;
+        m_Primitives.VertexOffsets[index] = primitive->VertexBuffer->Offset;
+    }
+    if (primitive->IndexBuffer)
+    {
+        m_Primitives.IndexBuffers[index] = primitive->IndexBuffer->Buffer->Buffer;
+        m_Primitives.IndexTypes[index]   = primitive->IndexBuffer->IndexType;
+        m_Primitives.DrawCounts[index]   = primitive->IndexBuffer->IndexCount;
+    }
+    else
+    {
+        m_Primitives.DrawCounts[index] = primitive->vertexCount;
+    }
+    return handle;
+}
+
+bool VulkanResourcePool::IsValid(PrimitiveHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Primitives.Handles.IsValid(handle);
+}
+
+void VulkanResourcePool::ReleasePrimitive(PrimitiveHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    const uint32 index = m_Primitives.Handles.Release(handle);
+    if (index == HandlePool<VulkanPrimitive>::INVALID_INDEX) {
+        return;
+    }
+
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.VertexBuffers, index);
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.VertexOffsets, index);
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.IndexBuffers, index);
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.IndexTypes, index);
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.DrawCounts, index);
+    HandlePool<VulkanPrimitive>::SwapRemove(m_Primitives.Objects, index);
+}
+
+Ref<VulkanBuffer> VulkanResourcePool::FindPrimitiveBuffer(VmaAllocation allocation)
+{
+    // Primitive析构时先释放句柄，在锁里看到的Primitive成员都还活着
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    for (VulkanPrimitive* primitive : m_Primitives.Objects)
+    {
+        if (primitive->VertexBuffer && primitive->VertexBuffer->Buffer && primitive->VertexBuffer->Buffer->VmaAllocation == allocation) {
+            return primitive->VertexBuffer->Buffer;
+        }
+        if (primitive->IndexBuffer && primitive->IndexBuffer->Buffer && primitive->IndexBuffer->Buffer->VmaAllocation == allocation) {
+            return primitive->IndexBuffer->Buffer;
+        }
+    }
+    return nullptr;
+}
+
+void VulkanResourcePool::ReplacePrimitiveBuffer(VkBuffer oldBuffer, VkBuffer newBuffer)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    for (uint32 index = 0; index < m_Primitives.Objects.size(); ++index)
+    {
+        if (m_Primitives.VertexBuffers[index] == oldBuffer) {
+            m_Primitives.VertexBuffers[index] = newBuffer;
+        }
+        if (m_Primitives.IndexBuffers[index] == oldBuffer) {
+            m_Primitives.IndexBuffers[index] = newBuffer;
+        }
+    }
+}
+
+void VulkanResourcePool::BindDraw(VkCommandBuffer cmdBuffer, PrimitiveHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    BindDrawLocked(cmdBuffer, handle);
+}
+
+void VulkanResourcePool::BindDrawLocked(VkCommandBuffer cmdBuffer, PrimitiveHandle handle) const
+{
+    RE_CORE_ASSERT(m_Primitives.Handles.IsValid(handle), "Stale primitive handle!");
+    if (!m_Primitives.Handles.IsValid(handle)) {
+        return;
+    }
+
+    const uint32 index = m_Primitives.Handles.GetDenseIndex(handle);
+    if (m_Primitives.VertexBuffers[index] == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_Primitives.VertexBuffers[index], &m_Primitives.VertexOffsets[index]);
+    if (m_Primitives.IndexBuffers[index] != VK_NULL_HANDLE)
+    {
+        vkCmdBindIndexBuffer(cmdBuffer, m_Primitives.IndexBuffers[index], 0, m_Primitives.IndexTypes[index]);
+        vkCmdDrawIndexed(cmdBuffer, m_Primitives.DrawCounts[index], 1, 0, 0, 0);
+    }
+    else
+    {
+        vkCmdDraw(cmdBuffer, m_Primitives.DrawCounts[index], 1, 0, 0);
+    }
+}
+
+/*------------------ Mesh ---------------------------*/
+
+MeshHandle VulkanResourcePool::RegisterMesh(VulkanMesh* mesh)
+{
+    // 先注册Primitive，GetHandle内部会加锁
+    std::vector<PrimitiveHandle> primitives;
+    primitives.reserve(mesh->m_Primitives.size());
+    for (int32 index = 0; index < mesh->m_Primitives.size(); ++index) {
+        primitives.push_back(mesh->m_Primitives[index]->GetHandle());
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    MeshHandle handle = m_Meshes.Handles.Allocate();
+    m_Meshes.Bounds.push_back(mesh->m_BoundingBox);
+    m_Meshes.Primitives.push_back(std::move(primitives));
+    m_Meshes.Objects.push_back(mesh);
+    return handle;
+}
+
+void VulkanResourcePool::UpdateMesh(MeshHandle handle, VulkanMesh* mesh)
+{
+    std::vector<PrimitiveHandle> primitives;
+    primitives.reserve(mesh->m_Primitives.size());
+    for (int32 index = 0; index < mesh->m_Primitives.size(); ++index) {
+        primitives.push_back(mesh->m_Primitives[index]->GetHandle());
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    if (!m_Meshes.Handles.IsValid(handle)) {
+        return;
+    }
+
+    const uint32 index = m_Meshes.Handles.GetDenseIndex(handle);
+    m_Meshes.Bounds[index]     = mesh->m_BoundingBox;
+    m_Meshes.Primitives[index] = std::move(primitives);
+}
+
+bool VulkanResourcePool::IsValid(MeshHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Meshes.Handles.IsValid(handle);
+}
+
+ReEngine::BoundingBox VulkanResourcePool::GetBounds(MeshHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    RE_CORE_ASSERT(m_Meshes.Handles.IsValid(handle), "Stale mesh handle!");
+    if (!m_Meshes.Handles.IsValid(handle)) {
+        return ReEngine::BoundingBox();
+    }
+    return m_Meshes.Bounds[m_Meshes.Handles.GetDenseIndex(handle)];
+}
+
+void VulkanResourcePool::ReleaseMesh(MeshHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    const uint32 index = m_Meshes.Handles.Release(handle);
+    if (index == HandlePool<VulkanMesh>::INVALID_INDEX) {
+        return;
+    }
+
+    HandlePool<VulkanMesh>::SwapRemove(m_Meshes.Bounds, index);
+    HandlePool<VulkanMesh>::SwapRemove(m_Meshes.Primitives, index);
+    HandlePool<VulkanMesh>::SwapRemove(m_Meshes.Objects, index);
+}
+
+void VulkanResourcePool::BindDraw(VkCommandBuffer cmdBuffer, MeshHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+
+    RE_CORE_ASSERT(m_Meshes.Handles.IsValid(handle), "Stale mesh handle!");
+    if (!m_Meshes.Handles.IsValid(handle)) {
+        return;
+    }
+
+    const std::vector<PrimitiveHandle>& primitives = m_Meshes.Primitives[m_Meshes.Handles.GetDenseIndex(handle)];
+    for (int32 index = 0; index < primitives.size(); ++index) {
+        BindDrawLocked(cmdBuffer, primitives[index]);
+    }
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Core/HandlePool.h"
+#include "Core/SIngletonTemplate.h"
+#include "Mesh/BoundingBox.h"
+#include "VulkanCommonDefine.h"
+
+#include <mutex>
+#include <vector>
+
+class VulkanBuffer;
+class VulkanTexture;
+class VulkanPrimitive;
+class VulkanMesh;
+
+typedef Handle<VulkanBuffer>    BufferHandle;
+typedef Handle<VulkanTexture>   TextureHandle;
+typedef Handle<VulkanPrimitive> PrimitiveHandle;
+typedef Handle<VulkanMesh>      MeshHandle;
+
+VK_DEFINE_HANDLE( VmaAllocation )
+
+// GPU资源的句柄池，录制命令时只需要32位句柄和紧凑数组，不再拷贝Ref<>
+// 资源的生命周期仍然由Ref<>决定，对象第一次GetHandle时注册，析构时释放句柄
+// 录制用到的字段按SoA存成连续数组，对象内的字段变化时需要同步一次
+// 注册、更新、释放和读取都加锁，失效的句柄在读取时断言并跳过
+class VulkanResourcePool : public ReEngine::SingletonTemplate<VulkanResourcePool>
+{
+public:
+    /*------------------ Buffer ---------------------------*/
+
+    BufferHandle RegisterBuffer(VulkanBuffer* buffer);
+    void UpdateBuffer(BufferHandle handle, VulkanBuffer* buffer);
+    void ReleaseBuffer(BufferHandle handle);
+
+    bool IsValid(BufferHandle handle) const;
+
+    /*------------------ Texture ---------------------------*/
+
+    TextureHandle RegisterTexture(VulkanTexture* texture);
+    void UpdateTexture(TextureHandle handle, VulkanTexture* texture);
+    void ReleaseTexture(TextureHandle handle);
+
+    bool IsValid(TextureHandle handle) const;
+
+    /*------------------ Primitive ---------------------------*/
+
+    PrimitiveHandle RegisterPrimitive(VulkanPrimitive* primitive);
+    void ReleasePrimitive(PrimitiveHandle handle);
+
+    bool IsValid(PrimitiveHandle handle) const;
+
+    // 没有顶点Buffer的Primitive（没有上传到GPU）跳过
+    void BindDraw(VkCommandBuffer cmdBuffer, PrimitiveHandle handle) const;
+
+    // 碎片整理用：找到使用这块显存的顶点或索引Buffer，持有Ref保证搬家期间不析构
+    Ref<VulkanBuffer> FindPrimitiveBuffer(VmaAllocation allocation);
+
+    // Buffer搬家后把Primitive里记录的VkBuffer换成新的
+    void ReplacePrimitiveBuffer(VkBuffer oldBuffer, VkBuffer newBuffer);
+
+    /*------------------ Mesh ---------------------------*/
+
+    MeshHandle RegisterMesh(VulkanMesh* mesh);
+    void UpdateMesh(MeshHandle handle, VulkanMesh* mesh);
+    void ReleaseMesh(MeshHandle handle);
+
+    bool IsValid(MeshHandle handle) const;
+
+    ReEngine::BoundingBox GetBounds(MeshHandle handle) const;
+
+    void BindDraw(VkCommandBuffer cmdBuffer, MeshHandle handle) const;
+
+private:
+    // 调用方持有m_Lock
+    void BindDrawLocked(VkCommandBuffer cmdBuffer, PrimitiveHandle handle) const;
+
+private:
+    struct BufferPool
+    {
+        HandlePool<VulkanBuffer>            Handles;
+        std::vector<VkDescriptorBufferInfo> Descriptors;
+        std::vector<void*>                  Mapped;
+        std::vector<VulkanBuffer*>          Objects;
+    };
+
+    struct TexturePool
+    {
+        HandlePool<VulkanTexture>           Handles;
+        std::vector<VkImage>                Images;
+        std::vector<VkDescriptorImageInfo>  Descriptors;
+        std::vector<VulkanTexture*>         Objects;
+    };
+
+    struct PrimitivePool
+    {
+        HandlePool<VulkanPrimitive>         Handles;
+        std::vector<VkBuffer>               VertexBuffers;
+        std::vector<VkDeviceSize>           VertexOffsets;
+        std::vector<VkBuffer>               IndexBuffers;
+        std::vector<VkIndexType>            IndexTypes;
+        // 有索引时是索引数，否则是顶点数
+        std::vector<uint32>                 DrawCounts;
+        std::vector<VulkanPrimitive*>       Objects;
+    };
+
+    struct MeshPool
+    {
+        HandlePool<VulkanMesh>              Handles;
+        std::vector<ReEngine::BoundingBox>  Bounds;
+        std::vector<std::vector<PrimitiveHandle>> Primitives;
+        std::vector<VulkanMesh*>            Objects;
+    };
+
+    mutable std::mutex  m_Lock;
+
+    BufferPool      m_Buffers;
+    TexturePool     m_Textures;
+    PrimitivePool   m_Primitives;
+    MeshPool        m_Meshes;
+};
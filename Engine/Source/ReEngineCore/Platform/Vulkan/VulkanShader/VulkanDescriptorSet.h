@@ -114,10 +114,30 @@ struct VulkanAttribute
 class VulkanDescriptorSet
 {
 public:
-    ~VulkanDescriptorSet(){}
+    ~VulkanDescriptorSet()
+    {
+        for (const StreamedTextureBinding& streamed : StreamedTextures)
+        {
+            if (Ref<VulkanTexture> texture = streamed.Texture.lock()) {
+                texture->RemoveDescriptorBinding(streamed.Set, streamed.Binding, streamed.ArrayElement);
+            }
+        }
+    }
     VulkanDescriptorSet(){}
 
-    void WriteImage(const std::string& name,Ref<VulkanTexture> Texture)
+    void WriteImage(const std::string& name,const Ref<VulkanTexture>& Texture)
+    {
+        WriteImage(name,&(Texture->DescriptorInfo));
+
+        auto it = SetLayoutsInfo.ParamsMap.find(name);
+        if (it != SetLayoutsInfo.ParamsMap.end())
+        {
+            const auto& bindInfo = it->second;
+            TrackStreamedTexture(Texture, bindInfo.Set, bindInfo.Binding, 0, SetLayoutsInfo.GetDescriptorType(bindInfo.Set, bindInfo.Binding));
+        }
+    }
+
+    void WriteImage(const std::string& name,const VkDescriptorImageInfo* imageInfo)
     {
         auto it = SetLayoutsInfo.ParamsMap.find(name);
         if (it == SetLayoutsInfo.ParamsMap.end())
@@ -134,7 +154,7 @@ public:
         writeDescriptorSet.descriptorCount = 1;
         writeDescriptorSet.descriptorType  = SetLayoutsInfo.GetDescriptorType(BindInfo.Set, BindInfo.Binding);
         writeDescriptorSet.pBufferInfo     = nullptr;
-        writeDescriptorSet.pImageInfo      = &(Texture->DescriptorInfo);
+        writeDescriptorSet.pImageInfo      = imageInfo;
         writeDescriptorSet.dstBinding      = BindInfo.Binding;
         vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
     }
@@ -237,6 +257,11 @@ public:
         textureWriteDescriptorSet.pImageInfo = textureImageInfos.data();
         
         vkUpdateDescriptorSets(device, 1, &textureWriteDescriptorSet, 0, nullptr);
+
+        for (int32 i = 0; i < TextureArray.size(); ++i)
+        {
+            TrackStreamedTexture(TextureArray[i], bindInfo.Set, bindInfo.Binding, i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        }
     }
 
     void WriteAccelerationStruct(const std::string& name,const VkAccelerationStructureKHR& accel)
@@ -309,10 +334,49 @@ public:
         }
     }
 
+private:
+    struct StreamedTextureBinding
+    {
+        std::weak_ptr<VulkanTexture>    Texture;
+        VkDescriptorSet                 Set;
+        uint32                          Binding;
+        uint32                          ArrayElement;
+    };
+
+    //流式贴图换Image之后要重写这里的描述符，同一个位置写了别的贴图时取消旧的记录
+    void TrackStreamedTexture(const Ref<VulkanTexture>& texture, int32 set, uint32 binding, uint32 arrayElement, VkDescriptorType type)
+    {
+        const VkDescriptorSet descriptorSet = DescriptorSets[set];
+
+        for (size_t index = 0; index < StreamedTextures.size(); ++index)
+        {
+            StreamedTextureBinding& streamed = StreamedTextures[index];
+            if (streamed.Set == descriptorSet && streamed.Binding == binding && streamed.ArrayElement == arrayElement)
+            {
+                if (Ref<VulkanTexture> oldTexture = streamed.Texture.lock()) {
+                    oldTexture->RemoveDescriptorBinding(descriptorSet, binding, arrayElement);
+                }
+                streamed = StreamedTextures.back();
+                StreamedTextures.pop_back();
+                break;
+            }
+        }
+
+        if (!texture->IsStreamed) {
+            return;
+        }
+
+        texture->AddDescriptorBinding(descriptorSet, binding, arrayElement, type);
+        StreamedTextures.push_back({ texture, descriptorSet, binding, arrayElement });
+    }
+
 public:
     VkDevice    device;
 
     //这两者一个是描述，一个是真实的GPU上的Sets
     VulkanDescriptorSetLayoutsInfo     SetLayoutsInfo;
     std::vector<VkDescriptorSet>    DescriptorSets;
+
+private:
+    std::vector<StreamedTextureBinding> StreamedTextures;
 };
@@ -4,8 +4,10 @@
 #include "VulkanSwapChain.h"
 #include "VulkanInstance.h"
 
+#include "vk_mem_alloc.h"
+
 VulkanSwapChain::VulkanSwapChain(VkInstance instance,std::shared_ptr<VulkanDevice> device,VkSurfaceKHR Surface, PixelFormat& outPixelFormat, uint32 width, uint32 height,
-                                 uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages, int8 lockToVsync)
+                                 uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages, VkPresentModeKHR desiredPresentMode)
 	: m_Instance(instance)
 	, m_SwapChain(VK_NULL_HANDLE)
     , m_Surface(Surface)
@@ -16,7 +18,8 @@ VulkanSwapChain::VulkanSwapChain(VkInstance instance,std::shared_ptr<VulkanDevic
 	, m_SemaphoreIndex(0)
 	, m_NumPresentCalls(0)
 	, m_NumAcquireCalls(0)
-	, m_LockToVsync(lockToVsync)
+	, m_LockToVsync(1)
+	, m_PresentMode(VK_PRESENT_MODE_FIFO_KHR)
 	, m_PresentID(0)
 {
 	
@@ -131,11 +134,12 @@ VulkanSwapChain::VulkanSwapChain(VkInstance instance,std::shared_ptr<VulkanDevic
         }
     }
     
+    // Immediate不支持时退回Mailbox，至少不撕裂；Fifo是规范要求必须支持的
     VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
-    if (foundPresentModeImmediate && !m_LockToVsync) {
+    if (desiredPresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR && foundPresentModeImmediate) {
         presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
     }
-    else if (foundPresentModeMailbox) {
+    else if (desiredPresentMode != VK_PRESENT_MODE_FIFO_KHR && foundPresentModeMailbox) {
         presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
     }
     else if (foundPresentModeFIFO) {
@@ -146,6 +150,10 @@ VulkanSwapChain::VulkanSwapChain(VkInstance instance,std::shared_ptr<VulkanDevic
         RE_CORE_INFO("Couldn't find desired PresentMode! Using {0}", (int32)foundPresentModes[0]);
         presentMode = foundPresentModes[0];
     }
+
+    m_PresentMode = presentMode;
+    m_LockToVsync = presentMode != VK_PRESENT_MODE_IMMEDIATE_KHR;
+    m_SupportedPresentModes = foundPresentModes;
     
     RE_CORE_INFO("Selected VkPresentModeKHR mode {0}", presentMode);
 
@@ -240,10 +248,84 @@ VulkanSwapChain::VulkanSwapChain(VkInstance instance,std::shared_ptr<VulkanDevic
     RE_CORE_INFO("SwapChain: Backbuffer:{0} Format:{1} ColorSpace:{2} Size:{3}x{4} Present:{5}", m_SwapChainInfo.minImageCount, m_SwapChainInfo.imageFormat, m_SwapChainInfo.imageColorSpace, m_SwapChainInfo.imageExtent.width, m_SwapChainInfo.imageExtent.height, m_SwapChainInfo.presentMode);
 }
 
+VulkanSwapChain::VulkanSwapChain(std::shared_ptr<VulkanDevice> device, PixelFormat& outPixelFormat, uint32 width, uint32 height, uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages)
+	: m_Instance(VK_NULL_HANDLE)
+	, m_SwapChain(VK_NULL_HANDLE)
+	, m_Surface(VK_NULL_HANDLE)
+	, m_ColorFormat(VK_FORMAT_R8G8B8A8_UNORM)
+	, m_BackBufferCount(3)
+	, m_Device(device)
+	, m_CurrentImageIndex(-1)
+	, m_SemaphoreIndex(0)
+	, m_NumPresentCalls(0)
+	, m_NumAcquireCalls(0)
+	, m_LockToVsync(0)
+	, m_PresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR)
+	, m_PresentID(0)
+{
+	// 没有Surface时帧提交在图形队列上
+	m_Device->SetupPresentQueue(VK_NULL_HANDLE);
+
+	if (outPixelFormat == PF_Unknown || !G_PixelFormats[outPixelFormat].supported) {
+		outPixelFormat = PF_B8G8R8A8;
+	}
+	m_ColorFormat     = (VkFormat)G_PixelFormats[outPixelFormat].platformFormat;
+	m_BackBufferCount = (int32)*outDesiredNumBackBuffers;
+
+	// 其它地方只读这几项
+	ZeroVulkanStruct(m_SwapChainInfo, VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR);
+	m_SwapChainInfo.minImageCount		= m_BackBufferCount;
+	m_SwapChainInfo.imageFormat			= m_ColorFormat;
+	m_SwapChainInfo.imageColorSpace		= VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+	m_SwapChainInfo.imageExtent.width	= width;
+	m_SwapChainInfo.imageExtent.height	= height;
+	m_SwapChainInfo.imageUsage			= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	m_SwapChainInfo.imageArrayLayers	= 1;
+	m_SwapChainInfo.imageSharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+	m_SwapChainInfo.presentMode			= m_PresentMode;
+
+	VkImageCreateInfo imageCreateInfo;
+	ZeroVulkanStruct(imageCreateInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+	imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format        = m_ColorFormat;
+	imageCreateInfo.extent        = { width, height, 1 };
+	imageCreateInfo.mipLevels     = 1;
+	imageCreateInfo.arrayLayers   = 1;
+	imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage         = m_SwapChainInfo.imageUsage;
+	imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocationInfo{};
+	allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	m_OffscreenImages.resize(m_BackBufferCount);
+	m_OffscreenAllocations.resize(m_BackBufferCount);
+	for (int32 index = 0; index < m_BackBufferCount; ++index)
+	{
+		VERIFYVULKANRESULT(vmaCreateImage(m_Device->vma_allocator, &imageCreateInfo, &allocationInfo, &m_OffscreenImages[index], &m_OffscreenAllocations[index], nullptr));
+	}
+	outImages = m_OffscreenImages;
+
+	RE_CORE_WARN("Offscreen SwapChain: Backbuffer:{0} Format:{1} Size:{2}x{3}", m_BackBufferCount, (int32)m_ColorFormat, width, height);
+}
+
 VulkanSwapChain::~VulkanSwapChain()
 {
 }
 
+bool VulkanSwapChain::IsPresentModeSupported(VkPresentModeKHR presentMode) const
+{
+	for (int32 index = 0; index < m_SupportedPresentModes.size(); ++index)
+	{
+		if (m_SupportedPresentModes[index] == presentMode) {
+			return true;
+		}
+	}
+	return false;
+}
+
 int32 VulkanSwapChain::AcquireImageIndex(VkSemaphore* outSemaphore)
 {
 	uint32 imageIndex = 0;
@@ -274,6 +356,34 @@ int32 VulkanSwapChain::AcquireImageIndex(VkSemaphore* outSemaphore)
 	return m_CurrentImageIndex;
 }
 
+int32 VulkanSwapChain::AcquireImageIndex(VkSemaphore signalSemaphore)
+{
+	if (IsHeadless())
+	{
+		m_NumAcquireCalls   += 1;
+		m_CurrentImageIndex = (m_CurrentImageIndex + 1) % m_BackBufferCount;
+		return m_CurrentImageIndex;
+	}
+
+	uint32 imageIndex = 0;
+	VkResult result   = vkAcquireNextImageKHR(m_Device->GetInstanceHandle(), m_SwapChain, ((uint64)	0xffffffffffffffff), signalSemaphore, VK_NULL_HANDLE, &imageIndex);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		return (int32)SwapStatus::OutOfDate;
+	}
+
+	if (result == VK_ERROR_SURFACE_LOST_KHR)
+	{
+		return (int32)SwapStatus::SurfaceLost;
+	}
+
+	m_NumAcquireCalls   += 1;
+	m_CurrentImageIndex = (int32)imageIndex;
+
+	return m_CurrentImageIndex;
+}
+
 void VulkanSwapChain::ShutDown()
 {
 	VkDevice device = m_Device->GetInstanceHandle();
@@ -282,13 +392,20 @@ void VulkanSwapChain::ShutDown()
 	{
 		vkDestroySemaphore(m_Device->GetInstanceHandle(), m_ImageAcquiredSemaphore[index], VULKAN_CPU_ALLOCATOR);
 	}
+
+	for (int32 index = 0; index < m_OffscreenImages.size(); ++index)
+	{
+		vmaDestroyImage(m_Device->vma_allocator, m_OffscreenImages[index], m_OffscreenAllocations[index]);
+	}
+	m_OffscreenImages.clear();
+	m_OffscreenAllocations.clear();
     
 	vkDestroySwapchainKHR(device, m_SwapChain, VULKAN_CPU_ALLOCATOR);
 }
 
 VulkanSwapChain::SwapStatus VulkanSwapChain::Present(VulkanQueue& gfxQueue, VulkanQueue& presentQueue, VkSemaphore* doneSemaphore)
 {
-	if (m_CurrentImageIndex == -1)
+	if (m_CurrentImageIndex == -1 || IsHeadless())
 	{
 		return SwapStatus::Healthy;
 	}
@@ -332,6 +449,12 @@ void VulkanDevice::SetupPresentQueue(VkSurfaceKHR surface)
 		return;
 	}
 
+	if (surface == VK_NULL_HANDLE)
+	{
+		m_PresentQueue = m_GfxQueue;
+		return;
+	}
+
 	const auto SupportsPresent = [surface](VkPhysicalDevice physicalDevice, VulkanQueue& queue)
 	{
 		VkBool32 supportsPresent = VK_FALSE;
@@ -344,12 +467,11 @@ void VulkanDevice::SetupPresentQueue(VkSurfaceKHR surface)
 		return (supportsPresent == VK_TRUE);
 	};
 
-	bool compute = SupportsPresent(m_PhysicalDevice, *m_ComputeQueue);
-	if (m_TransferQueue->GetFamilyIndex() != m_GfxQueue->GetFamilyIndex() && m_TransferQueue->GetFamilyIndex() != m_ComputeQueue->GetFamilyIndex()) {
-		SupportsPresent(m_PhysicalDevice, *m_TransferQueue);
+	// 帧的CommandBuffer提交在PresentQueue上，优先用图形队列，计算队列留给异步计算
+	if (SupportsPresent(m_PhysicalDevice, *m_GfxQueue)) {
+		m_PresentQueue = m_GfxQueue;
 	}
-	
-	if (m_ComputeQueue->GetFamilyIndex() != m_GfxQueue->GetFamilyIndex() && compute) {
+	else if (m_ComputeQueue != m_GfxQueue && SupportsPresent(m_PhysicalDevice, *m_ComputeQueue)) {
 		m_PresentQueue = m_ComputeQueue;
 	}
 	else {
@@ -6,6 +6,8 @@
 #include <memory>
 #include <vector>
 
+VK_DEFINE_HANDLE( VmaAllocation )
+
 using namespace ReEngine;
 
 class VulkanQueue;
@@ -23,7 +25,10 @@ public:
         SurfaceLost = -2,
     };
 
-    VulkanSwapChain(VkInstance instance, std::shared_ptr<VulkanDevice> device,VkSurfaceKHR Surface,PixelFormat& outPixelFormat, uint32 width, uint32 height, uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages, int8 lockToVsync);
+    VulkanSwapChain(VkInstance instance, std::shared_ptr<VulkanDevice> device,VkSurfaceKHR Surface,PixelFormat& outPixelFormat, uint32 width, uint32 height, uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages, VkPresentModeKHR desiredPresentMode);
+
+    // 没有Surface的离屏交换链：自己创建图像，Acquire按顺序轮换，不Signal Semaphore，Present什么都不做
+    VulkanSwapChain(std::shared_ptr<VulkanDevice> device, PixelFormat& outPixelFormat, uint32 width, uint32 height, uint32* outDesiredNumBackBuffers, std::vector<VkImage>& outImages);
 
     virtual ~VulkanSwapChain();
 
@@ -31,11 +36,27 @@ public:
 
     int32 AcquireImageIndex(VkSemaphore* outSemaphore);
 
+    // 由调用者按帧槽位管理Semaphore，槽位的Fence等过之后才能复用
+    int32 AcquireImageIndex(VkSemaphore signalSemaphore);
+
     FORCE_INLINE int8 DoesLockToVsync() 
     { 
         return m_LockToVsync;
     }
 
+    // 实际使用的模式，要求的模式不支持时会退回
+    FORCE_INLINE VkPresentModeKHR GetPresentMode() const
+    {
+        return m_PresentMode;
+    }
+
+    bool IsPresentModeSupported(VkPresentModeKHR presentMode) const;
+
+    FORCE_INLINE bool IsHeadless() const
+    {
+        return m_SwapChain == VK_NULL_HANDLE;
+    }
+
     FORCE_INLINE VkSwapchainKHR GetInstanceHandle()
     {
         return m_SwapChain;
@@ -88,5 +109,10 @@ protected:
     uint32							m_NumPresentCalls;
     uint32							m_NumAcquireCalls;
     int8							m_LockToVsync;
+    VkPresentModeKHR				m_PresentMode;
+    std::vector<VkPresentModeKHR>	m_SupportedPresentModes;
     uint32							m_PresentID;
+    // 离屏时图像的显存
+    std::vector<VkImage>			m_OffscreenImages;
+    std::vector<VmaAllocation>		m_OffscreenAllocations;
 };
@@ -0,0 +1,233 @@
+﻿#include "VulkanTextureAtlas.h"
+#include "VulkanBuffers/VulkanBuffer.h"
+#include "Resource/AssetManager/AssetManager.h"
+#include "Core/Alignment.h"
+#include "Core/WorkerPool.h"
+#include "Math/Math.h"
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ReEngine
+{
+    Ref<VulkanTextureAtlas> VulkanTextureAtlas::Create(const std::vector<std::string>& filenames, Ref<VulkanDevice> vulkanDevice, Ref<VulkanCommandBuffer> cmdBuffer, uint32 pageSize)
+    {
+        struct DecodedImage
+        {
+            uint8* Pixels = nullptr;
+            int32  Width = 0;
+            int32  Height = 0;
+        };
+
+        const uint32 numImages = (uint32)filenames.size();
+        std::vector<DecodedImage> images(numImages);
+
+        WorkerPool::GetInstance().ParallelFor(numImages, [&](uint32 index)
+        {
+            uint32 dataSize = 0;
+            uint8* dataPtr  = nullptr;
+            if (!AssetManager::ReadFile(filenames[index], dataPtr, dataSize))
+            {
+                RE_CORE_ERROR("Failed to Load Image : {0}", filenames[index].c_str());
+                return;
+            }
+
+            int32 comp = 0;
+            DecodedImage& image = images[index];
+            image.Pixels = StbImage::LoadFromMemory(dataPtr, dataSize, &image.Width, &image.Height, &comp, 4);
+            delete[] dataPtr;
+
+            if (image.Pixels == nullptr) {
+                RE_CORE_ERROR("Failed load image From StbImage: {0}", filenames[index].c_str());
+            }
+        });
+
+        std::vector<TextureAtlasRect> sizes(numImages);
+        for (uint32 i = 0; i < numImages; ++i)
+        {
+            sizes[i].Width  = images[i].Pixels ? images[i].Width : 0;
+            sizes[i].Height = images[i].Pixels ? images[i].Height : 0;
+            pageSize = std::max(pageSize, Align(std::max(sizes[i].Width, sizes[i].Height) + PADDING * 2, 4u));
+        }
+
+        Ref<VulkanTextureAtlas> atlas = CreateRef<VulkanTextureAtlas>();
+        TextureAtlasPacker packer;
+        packer.Init(pageSize, pageSize, PADDING, vulkanDevice->GetLimits().maxImageArrayLayers);
+        atlas->m_Rects     = packer.InsertBatch(sizes);
+        atlas->m_PageSize  = pageSize;
+        atlas->m_NumLayers = std::max(packer.GetNumLayers(), 1u);
+
+        const uint32 numLayers = atlas->m_NumLayers;
+        const VkDeviceSize layerSize = (VkDeviceSize)pageSize * pageSize * 4;
+
+        Ref<VulkanBuffer> staging = VulkanBuffer::CreateBuffer(
+            vulkanDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            layerSize * numLayers);
+        staging->Map();
+        uint8* mapped = (uint8*)staging->Mapped;
+        std::memset(mapped, 0, layerSize * numLayers);
+
+        // 带边距的区域互不重叠，可以并行写
+        WorkerPool::GetInstance().ParallelFor(numImages, [&](uint32 index)
+        {
+            const DecodedImage& image = images[index];
+            const TextureAtlasRect& rect = atlas->m_Rects[index];
+            if (image.Pixels == nullptr || rect.Width == 0) {
+                return;
+            }
+
+            uint8* layer = mapped + layerSize * rect.Layer;
+            for (int32 y = -PADDING; y < image.Height + PADDING; ++y)
+            {
+                const int32 srcY = Math::Clamp(y, 0, image.Height - 1);
+                const uint8* srcRow = image.Pixels + (size_t)srcY * image.Width * 4;
+                uint8* dstRow = layer + ((size_t)(rect.Y + y) * pageSize + rect.X) * 4;
+
+                for (int32 x = 1; x <= PADDING; ++x)
+                {
+                    std::memcpy(dstRow - x * 4, srcRow, 4);
+                    std::memcpy(dstRow + (image.Width - 1 + x) * 4, srcRow + (image.Width - 1) * 4, 4);
+                }
+                std::memcpy(dstRow, srcRow, (size_t)image.Width * 4);
+            }
+        });
+
+        for (DecodedImage& image : images)
+        {
+            if (image.Pixels) {
+                StbImage::Free(image.Pixels);
+            }
+        }
+
+        const int32 mipLevels = std::min(Math::FloorToInt(Math::Log2((float)pageSize)) + 1, (int32)MAX_MIP_LEVELS);
+        VkDevice device = vulkanDevice->GetInstanceHandle();
+
+        VkImageCreateInfo imageCreateInfo;
+        ZeroVulkanStruct(imageCreateInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+        imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format        = VK_FORMAT_R8G8B8A8_UNORM;
+        imageCreateInfo.mipLevels     = mipLevels;
+        imageCreateInfo.arrayLayers   = numLayers;
+        imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.extent        = { pageSize, pageSize, 1 };
+        imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCreateInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+        VkImage image = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VERIFYVULKANRESULT(VulkanTexture::CreateBudgetedImage(vulkanDevice.get(), imageCreateInfo, VulkanMemoryCategory::Texture, &image, &allocation));
+
+        cmdBuffer->Begin();
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.baseMipLevel   = 0;
+        subresourceRange.levelCount     = 1;
+        subresourceRange.baseArrayLayer = 0;
+        subresourceRange.layerCount     = numLayers;
+        ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+
+        std::vector<VkBufferImageCopy> copyRegions(numLayers);
+        for (uint32 layer = 0; layer < numLayers; ++layer)
+        {
+            VkBufferImageCopy& region = copyRegions[layer];
+            region = {};
+            region.bufferOffset                    = layerSize * layer;
+            region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel       = 0;
+            region.imageSubresource.baseArrayLayer = layer;
+            region.imageSubresource.layerCount     = 1;
+            region.imageExtent                     = { pageSize, pageSize, 1 };
+        }
+        vkCmdCopyBufferToImage(cmdBuffer->CmdBuffer, staging->Buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, numLayers, copyRegions.data());
+        ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource, subresourceRange);
+
+        // 所有层一起Blit
+        for (int32 i = 1; i < mipLevels; ++i)
+        {
+            const int32 srcSize = Math::Max((int32)pageSize >> (i - 1), 1);
+            const int32 dstSize = Math::Max((int32)pageSize >> i, 1);
+
+            VkImageBlit imageBlit = {};
+            imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlit.srcSubresource.layerCount = numLayers;
+            imageBlit.srcSubresource.mipLevel   = i - 1;
+            imageBlit.srcOffsets[1]             = { srcSize, srcSize, 1 };
+            imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlit.dstSubresource.layerCount = numLayers;
+            imageBlit.dstSubresource.mipLevel   = i;
+            imageBlit.dstOffsets[1]             = { dstSize, dstSize, 1 };
+
+            VkImageSubresourceRange mipSubRange = subresourceRange;
+            mipSubRange.baseMipLevel = i;
+
+            ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, mipSubRange);
+            vkCmdBlitImage(cmdBuffer->CmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+            ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::TransferSource, mipSubRange);
+        }
+
+        subresourceRange.levelCount = mipLevels;
+        ImagePipelineBarrier(cmdBuffer->CmdBuffer, image, ImageLayoutBarrier::TransferSource, ImageLayoutBarrier::PixelShaderRead, subresourceRange);
+
+        cmdBuffer->End();
+        cmdBuffer->Submit();
+        staging->UnMap();
+
+        VkSamplerCreateInfo samplerInfo;
+        ZeroVulkanStruct(samplerInfo, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
+        samplerInfo.magFilter        = VK_FILTER_LINEAR;
+        samplerInfo.minFilter        = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.compareOp        = VK_COMPARE_OP_NEVER;
+        samplerInfo.borderColor      = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        samplerInfo.maxAnisotropy    = 1.0;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxLod           = (float)mipLevels;
+        samplerInfo.minLod           = 0.0f;
+        VkSampler sampler = VK_NULL_HANDLE;
+        VERIFYVULKANRESULT(vkCreateSampler(device, &samplerInfo, VULKAN_CPU_ALLOCATOR, &sampler));
+
+        VkImageViewCreateInfo viewInfo;
+        ZeroVulkanStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+        viewInfo.image      = image;
+        viewInfo.viewType   = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format     = VK_FORMAT_R8G8B8A8_UNORM;
+        viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+        viewInfo.subresourceRange = subresourceRange;
+        VkImageView imageView = VK_NULL_HANDLE;
+        VERIFYVULKANRESULT(vkCreateImageView(device, &viewInfo, VULKAN_CPU_ALLOCATOR, &imageView));
+
+        Ref<VulkanTexture> texture = CreateRef<VulkanTexture>();
+        texture->Device                     = vulkanDevice;
+        texture->Image                      = image;
+        texture->mVmaAllocation             = allocation;
+        texture->ImageView                  = imageView;
+        texture->ImageSampler               = sampler;
+        texture->ImageLayout                = GetImageLayout(ImageLayoutBarrier::PixelShaderRead);
+        texture->DescriptorInfo.sampler     = sampler;
+        texture->DescriptorInfo.imageView   = imageView;
+        texture->DescriptorInfo.imageLayout = texture->ImageLayout;
+        texture->Format                     = VK_FORMAT_R8G8B8A8_UNORM;
+        texture->Width                      = pageSize;
+        texture->Height                     = pageSize;
+        texture->MipLevels                  = mipLevels;
+        texture->LayerCount                 = numLayers;
+
+        atlas->m_Texture = texture;
+        return atlas;
+    }
+
+    glm::vec4 VulkanTextureAtlas::GetUVRect(uint32 index) const
+    {
+        const TextureAtlasRect& rect = m_Rects[index];
+        const float invSize = 1.0f / m_PageSize;
+        return glm::vec4(rect.X * invSize, rect.Y * invSize, rect.Width * invSize, rect.Height * invSize);
+    }
+}
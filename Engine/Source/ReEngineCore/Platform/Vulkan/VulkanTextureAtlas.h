@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffers/VulkanTexture.h"
+#include "VulkanBuffers/VulkanCommandBuffer.h"
+#include "Resource/Texture/TextureAtlasPacker.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    // 多张小贴图打包成一张2D数组贴图，每一页是一层，shader里用sampler2DArray采样
+    // 一个描述符就能覆盖全部贴图，换贴图不用再换描述符集
+    // 边距用边缘像素外扩，Mip只生成到边距缩到1像素的那一级，避免低级Mip混进相邻的图
+    class VulkanTextureAtlas
+    {
+    public:
+        enum
+        {
+            DEFAULT_PAGE_SIZE = 2048,
+            PADDING = 4,
+            // 第2级时PADDING缩到1像素
+            MAX_MIP_LEVELS = 3,
+        };
+
+        // 路径相对引擎根目录；有图比页大时页大小放大到能放下它；解码失败的图区域为空
+        static Ref<VulkanTextureAtlas> Create(
+            const std::vector<std::string>& filenames,
+            Ref<VulkanDevice> vulkanDevice,
+            Ref<VulkanCommandBuffer> cmdBuffer,
+            uint32 pageSize = DEFAULT_PAGE_SIZE
+        );
+
+        FORCE_INLINE const Ref<VulkanTexture>& GetTexture() const
+        {
+            return m_Texture;
+        }
+
+        FORCE_INLINE uint32 GetNumLayers() const
+        {
+            return m_NumLayers;
+        }
+
+        FORCE_INLINE const TextureAtlasRect& GetRect(uint32 index) const
+        {
+            return m_Rects[index];
+        }
+
+        // xy是UV偏移，zw是UV缩放：atlasUV = xy + fract(uv) * zw
+        glm::vec4 GetUVRect(uint32 index) const;
+
+    private:
+        Ref<VulkanTexture>              m_Texture;
+        std::vector<TextureAtlasRect>   m_Rects;
+        uint32                          m_PageSize = 0;
+        uint32                          m_NumLayers = 0;
+    };
+}
@@ -0,0 +1,234 @@
+﻿#include "VulkanTextureLoader.h"
+#include "Resource/AssetManager/AssetManager.h"
+#include "Resource/Texture/TextureConvert.h"
+#include "Core/Alignment.h"
+#include "Core/WorkerPool.h"
+#include "ImageLoader.h"
+
+namespace ReEngine
+{
+    void VulkanTextureLoader::Init(Ref<VulkanDevice> device, uint64 ringSize)
+    {
+        m_Device      = device;
+        m_Queue       = device->GetPresentQueue();
+        m_SegmentSize = Align(ringSize / NUM_SEGMENTS, (uint64)STAGING_ALIGNMENT);
+
+        VkCommandPoolCreateInfo cmdPoolInfo;
+        ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+        cmdPoolInfo.queueFamilyIndex = m_Queue->GetFamilyIndex();
+        cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_CommandPool));
+
+        VkCommandBufferAllocateInfo allocInfo;
+        ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+        allocInfo.commandPool        = m_CommandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = NUM_SEGMENTS;
+        VERIFYVULKANRESULT(vkAllocateCommandBuffers(device->GetInstanceHandle(), &allocInfo, m_CmdBuffers));
+
+        // 常驻映射，解码线程直接往里写
+        m_Ring = VulkanBuffer::CreateBuffer(
+            m_Device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_SegmentSize * NUM_SEGMENTS);
+        m_Ring->Map();
+    }
+
+    void VulkanTextureLoader::Destroy()
+    {
+        if (m_CommandPool == VK_NULL_HANDLE) {
+            return;
+        }
+
+        for (int32 i = 0; i < NUM_SEGMENTS; ++i) {
+            m_Queue->WaitFor(m_SegmentPoints[i]);
+        }
+
+        m_Ring->UnMap();
+        m_Ring = nullptr;
+
+        vkDestroyCommandPool(m_Device->GetInstanceHandle(), m_CommandPool, VULKAN_CPU_ALLOCATOR);
+        m_CommandPool = VK_NULL_HANDLE;
+        for (int32 i = 0; i < NUM_SEGMENTS; ++i) {
+            m_CmdBuffers[i] = VK_NULL_HANDLE;
+        }
+
+        m_Queue  = nullptr;
+        m_Device = nullptr;
+    }
+
+    void VulkanTextureLoader::DecodeInto(const VulkanTextureLoadDesc& desc, DecodeJob& job)
+    {
+        const uint32 numPixels = (uint32)(job.Width * job.Height);
+
+        // RGB按3通道解码再扩展，省掉stb里面的一次扩展；其它都让stb转成4通道
+        const int32 reqComp = job.Comp == 3 ? 3 : 4;
+
+        int32 width  = 0;
+        int32 height = 0;
+        int32 comp   = 0;
+        uint8* pixels = StbImage::LoadFromMemory(job.Encoded, (int32)job.EncodedSize, &width, &height, &comp, reqComp);
+        if (pixels == nullptr || width != job.Width || height != job.Height)
+        {
+            RE_CORE_ERROR("Failed load image From StbImage: {0}", desc.Filename.c_str());
+            if (pixels) {
+                StbImage::Free(pixels);
+            }
+            return;
+        }
+
+        if (reqComp == 3) {
+            TextureConvert::ExpandRGBToRGBA(pixels, job.Dst, numPixels);
+        }
+        else if (desc.PremultiplyAlpha) {
+            TextureConvert::PremultiplyAlpha(pixels, job.Dst, numPixels, desc.SRGB);
+        }
+        else {
+            TextureConvert::CopyRGBA(pixels, job.Dst, numPixels);
+        }
+
+        StbImage::Free(pixels);
+        job.Decoded = true;
+    }
+
+    std::vector<Ref<VulkanTexture>> VulkanTextureLoader::LoadBatch(const std::vector<VulkanTextureLoadDesc>& descs)
+    {
+        const uint32 numTextures = (uint32)descs.size();
+        std::vector<Ref<VulkanTexture>> textures(numTextures);
+        std::vector<DecodeJob> jobs(numTextures);
+
+        // 读文件和解析文件头，拿到尺寸之后才能在环里分配位置
+        WorkerPool::GetInstance().ParallelFor(numTextures, [&](uint32 index)
+        {
+            const VulkanTextureLoadDesc& desc = descs[index];
+            DecodeJob& job = jobs[index];
+
+            if (desc.EncodedData)
+            {
+                job.Encoded     = desc.EncodedData;
+                job.EncodedSize = desc.EncodedSize;
+            }
+            else if (AssetManager::ReadFile(desc.Filename, job.FileData, job.EncodedSize))
+            {
+                job.Encoded = job.FileData;
+            }
+            else
+            {
+                RE_CORE_ERROR("Failed to Load Image : {0}", desc.Filename.c_str());
+                return;
+            }
+
+            job.Valid = StbImage::InfoFromMemory(job.Encoded, (int32)job.EncodedSize, &job.Width, &job.Height, &job.Comp) && job.Width > 0 && job.Height > 0;
+        });
+
+        // 超过半个环的图用的Staging，批次结束之前不能释放
+        std::vector<Ref<VulkanBuffer>> dedicatedStagings;
+        std::vector<uint32> chunk;
+        uint32 next = 0;
+        uint32 segment = 0;
+
+        while (next < numTextures)
+        {
+            // 这一半上次提交的上传执行完才能覆盖
+            m_Queue->WaitFor(m_SegmentPoints[segment]);
+
+            const uint64 segmentBase = segment * m_SegmentSize;
+            uint64 segmentOffset = 0;
+            chunk.clear();
+
+            for (; next < numTextures; ++next)
+            {
+                DecodeJob& job = jobs[next];
+                if (!job.Valid) {
+                    continue;
+                }
+
+                const uint64 size = (uint64)job.Width * job.Height * 4;
+                if (size > m_SegmentSize)
+                {
+                    // 大图单独成块
+                    if (!chunk.empty()) {
+                        break;
+                    }
+
+                    Ref<VulkanBuffer> staging = VulkanBuffer::CreateBuffer(
+                        m_Device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        size);
+                    staging->Map();
+                    dedicatedStagings.push_back(staging);
+
+                    job.StagingBuffer = staging->Buffer;
+                    job.StagingOffset = 0;
+                    job.Dst           = (uint8*)staging->Mapped;
+                    chunk.push_back(next++);
+                    break;
+                }
+
+                const uint64 offset = Align(segmentOffset, (uint64)STAGING_ALIGNMENT);
+                if (offset + size > m_SegmentSize) {
+                    break;
+                }
+
+                job.StagingBuffer = m_Ring->Buffer;
+                job.StagingOffset = segmentBase + offset;
+                job.Dst           = (uint8*)m_Ring->Mapped + job.StagingOffset;
+                segmentOffset     = offset + size;
+                chunk.push_back(next);
+            }
+
+            if (chunk.empty()) {
+                continue;
+            }
+
+            WorkerPool::GetInstance().ParallelFor((uint32)chunk.size(), [&](uint32 index)
+            {
+                const uint32 textureIndex = chunk[index];
+                DecodeInto(descs[textureIndex], jobs[textureIndex]);
+            });
+
+            VkCommandBuffer cmdBuffer = m_CmdBuffers[segment];
+            VERIFYVULKANRESULT(vkResetCommandBuffer(cmdBuffer, 0));
+
+            VkCommandBufferBeginInfo beginInfo;
+            ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            VERIFYVULKANRESULT(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+
+            for (uint32 textureIndex : chunk)
+            {
+                const VulkanTextureLoadDesc& desc = descs[textureIndex];
+                const DecodeJob& job = jobs[textureIndex];
+                if (!job.Decoded) {
+                    continue;
+                }
+
+                textures[textureIndex] = VulkanTexture::Create2DFromStaging(
+                    cmdBuffer, job.StagingBuffer, job.StagingOffset,
+                    desc.SRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+                    job.Width, job.Height, m_Device,
+                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                    desc.Layout);
+            }
+
+            VERIFYVULKANRESULT(vkEndCommandBuffer(cmdBuffer));
+            m_SegmentPoints[segment] = m_Queue->Submit(1, &cmdBuffer);
+
+            segment = (segment + 1) % NUM_SEGMENTS;
+        }
+
+        for (int32 i = 0; i < NUM_SEGMENTS; ++i) {
+            m_Queue->WaitFor(m_SegmentPoints[i]);
+        }
+
+        for (DecodeJob& job : jobs) {
+            delete[] job.FileData;
+        }
+
+        for (Ref<VulkanBuffer>& staging : dedicatedStagings) {
+            staging->UnMap();
+        }
+
+        return textures;
+    }
+}
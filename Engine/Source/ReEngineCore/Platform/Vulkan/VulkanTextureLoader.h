@@ -0,0 +1,78 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanBuffers/VulkanTexture.h"
+#include "VulkanBuffers/VulkanBuffer.h"
+
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    struct VulkanTextureLoadDesc
+    {
+        // 路径相对引擎根目录；EncodedData不为空时直接用内存里的编码数据
+        std::string         Filename;
+        const uint8*        EncodedData = nullptr;
+        uint32              EncodedSize = 0;
+        bool                SRGB = false;
+        bool                PremultiplyAlpha = false;
+        ImageLayoutBarrier  Layout = ImageLayoutBarrier::PixelShaderRead;
+    };
+
+    // 批量加载未烘焙的贴图：读文件和解析文件头并行，然后按Staging环的一半分块
+    // 每块在工作线程上解码，RGB扩展/预乘Alpha直接写进映射的Staging，不再经过中间的RGBA缓冲
+    // 一块解码完录制拷贝和Mip生成并提交，下一块用另一半，GPU上传和CPU解码重叠
+    // 超过半个环的图单独建Staging；返回时全部上传完成，失败的位置是nullptr
+    class VulkanTextureLoader
+    {
+    public:
+        enum
+        {
+            DEFAULT_RING_SIZE   = 32 * 1024 * 1024,
+            NUM_SEGMENTS        = 2,
+            STAGING_ALIGNMENT   = 16,
+        };
+
+        void Init(Ref<VulkanDevice> device, uint64 ringSize = DEFAULT_RING_SIZE);
+
+        void Destroy();
+
+        // 只在主线程调用，内部会占用WorkerPool
+        std::vector<Ref<VulkanTexture>> LoadBatch(const std::vector<VulkanTextureLoadDesc>& descs);
+
+    private:
+        struct DecodeJob
+        {
+            // ReadFile读出来的文件，内存里的编码数据不归这里管
+            uint8*              FileData = nullptr;
+            const uint8*        Encoded = nullptr;
+            uint32              EncodedSize = 0;
+
+            int32               Width = 0;
+            int32               Height = 0;
+            int32               Comp = 0;
+            bool                Valid = false;
+            bool                Decoded = false;
+
+            VkBuffer            StagingBuffer = VK_NULL_HANDLE;
+            VkDeviceSize        StagingOffset = 0;
+            uint8*              Dst = nullptr;
+        };
+
+        void DecodeInto(const VulkanTextureLoadDesc& desc, DecodeJob& job);
+
+    private:
+        Ref<VulkanDevice>   m_Device;
+        Ref<VulkanQueue>    m_Queue;
+        VkCommandPool       m_CommandPool = VK_NULL_HANDLE;
+        VkCommandBuffer     m_CmdBuffers[NUM_SEGMENTS] = {};
+        // 每一半最后一次提交的时间线位置
+        uint64              m_SegmentPoints[NUM_SEGMENTS] = {};
+
+        Ref<VulkanBuffer>   m_Ring;
+        uint64              m_SegmentSize = 0;
+    };
+}
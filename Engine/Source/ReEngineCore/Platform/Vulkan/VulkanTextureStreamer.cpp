@@ -0,0 +1,870 @@
+﻿#include "VulkanTextureStreamer.h"
+#include "VulkanPassCache.h"
+#include "Resource/AssetManager/AssetManager.h"
+#include "Core/Alignment.h"
+
+#include "vk_mem_alloc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace ReEngine
+{
+    void VulkanTextureStreamer::Init(Ref<VulkanDevice> device, uint64 poolBudget)
+    {
+        m_Device     = device;
+        m_Queue      = device->GetPresentQueue();
+        m_PoolBudget = poolBudget;
+
+        VkCommandPoolCreateInfo cmdPoolInfo;
+        ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+        cmdPoolInfo.queueFamilyIndex = m_Queue->GetFamilyIndex();
+        cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        VERIFYVULKANRESULT(vkCreateCommandPool(device->GetInstanceHandle(), &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &m_CommandPool));
+
+        VkCommandBufferAllocateInfo allocInfo;
+        ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+        allocInfo.commandPool        = m_CommandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VERIFYVULKANRESULT(vkAllocateCommandBuffers(device->GetInstanceHandle(), &allocInfo, &m_CmdBuffer));
+
+        VulkanDeviceMemoryManager& memoryManager = device->GetMemoryManager();
+        m_DeviceHeap = memoryManager.GetHeapIndexFromProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // 流式Mip丢了还能再加载，比其它贴图先回收
+        m_EvictionHandle = memoryManager.RegisterEvictionCallback(VulkanMemoryCategory::Texture, 0, [this](uint32 heapIndex, uint64 bytesToFree)
+        {
+            return Evict(heapIndex, bytesToFree);
+        });
+    }
+
+    void VulkanTextureStreamer::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        m_Queue->WaitIdle();
+
+        if (m_DefragPassOpen) {
+            RetireDefragPass(true);
+        }
+        if (m_DefragContext != VK_NULL_HANDLE) {
+            EndDefragmentation();
+        }
+
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            DestroyPending(*state);
+            if (Ref<VulkanTexture> texture = state->Texture.lock()) {
+                texture->IsStreamed = false;
+            }
+        }
+        m_Textures.clear();
+        m_Staging.reset();
+        m_HasPending = false;
+
+        m_Device->GetMemoryManager().UnregisterEvictionCallback(m_EvictionHandle);
+        vkDestroyCommandPool(m_Device->GetInstanceHandle(), m_CommandPool, VULKAN_CPU_ALLOCATOR);
+        m_CommandPool = VK_NULL_HANDLE;
+        m_CmdBuffer   = VK_NULL_HANDLE;
+
+        m_Queue.reset();
+        m_Device.reset();
+    }
+
+    Ref<VulkanTexture> VulkanTextureStreamer::CreateTexture(const std::string& filename, Ref<VulkanCommandBuffer> cmdBuffer, ImageLayoutBarrier imageLayout)
+    {
+        const bool isCooked = std::filesystem::path(filename).extension() == ".rtex";
+        const std::string cookedPath = isCooked ? filename : TextureFile::GetCookedPath(filename);
+
+        Scope<StreamingTexture> state = CreateScope<StreamingTexture>();
+        bool canStream = m_Device && (isCooked || std::filesystem::exists(AssetManager::GetFullPath(cookedPath)));
+        canStream = canStream && TextureFile::Load(cookedPath, state->File);
+        canStream = canStream && G_PixelFormats[state->File.Format].supported;
+
+        if (!canStream) {
+            return VulkanTexture::Create2D(filename, m_Device, cmdBuffer, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageLayout);
+        }
+
+        const TextureFile& file = state->File;
+        const uint32 numMips = (uint32)file.Mips.size();
+
+        uint32 tailMip = numMips - 1;
+        for (uint32 level = 0; level < numMips; ++level)
+        {
+            if (glm::max(file.Mips[level].Width, file.Mips[level].Height) <= TAIL_SIZE)
+            {
+                tailMip = level;
+                break;
+            }
+        }
+
+        // 整张贴图已经在尾部里，不需要流式
+        if (tailMip == 0) {
+            return VulkanTexture::Create2D(file, m_Device, cmdBuffer, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageLayout);
+        }
+
+        // 碎片整理要从旧Image拷贝
+        Ref<VulkanTexture> texture = VulkanTexture::Create2D(file, m_Device, cmdBuffer, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, imageLayout, tailMip);
+        texture->IsStreamed = true;
+
+        state->Texture         = texture;
+        state->Format          = texture->Format;
+        state->Layout          = imageLayout;
+        state->ResidentMip     = tailMip;
+        state->TailMip         = tailMip;
+        state->WantedMip       = tailMip;
+        state->LastReportFrame = m_FrameNumber;
+        m_Textures.push_back(std::move(state));
+
+        return texture;
+    }
+
+    void VulkanTextureStreamer::ReportFootprint(const Ref<VulkanTexture>& texture, float screenPixels)
+    {
+        if (!texture || !texture->IsStreamed) {
+            return;
+        }
+
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            if (state->Texture.lock() == texture)
+            {
+                state->ReportedPixels  = glm::max(state->ReportedPixels, screenPixels);
+                state->LastReportFrame = m_FrameNumber;
+                return;
+            }
+        }
+    }
+
+    float VulkanTextureStreamer::ComputeScreenPixels(const glm::vec3& center, float radius, const glm::mat4& view, const glm::mat4& proj, float viewportHeight)
+    {
+        const glm::vec4 viewCenter = view * glm::vec4(center, 1.0f);
+        const float distance = glm::length(glm::vec3(viewCenter));
+
+        if (distance <= radius) {
+            return viewportHeight * 16.0f;
+        }
+
+        // proj[1][1]是cot(fovY/2)，直径在NDC里占 2r*cot/d，NDC高度是2
+        return radius * glm::abs(proj[1][1]) / distance * viewportHeight;
+    }
+
+    void VulkanTextureStreamer::Tick()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        m_FrameNumber += 1;
+
+        // Pass打开期间列出的分配不能释放，上传的Image也不换，等Pass结束
+        if (m_DefragPassOpen)
+        {
+            RetireDefragPass(false);
+            return;
+        }
+
+        // 上一批还没换进去时不发起新的一批，也不做碎片整理
+        ApplyPending();
+        if (m_HasPending) {
+            return;
+        }
+
+        // 和上传批次错开半个间隔
+        if (m_FrameNumber % UPDATE_INTERVAL == UPDATE_INTERVAL / 2)
+        {
+            Defragment();
+            return;
+        }
+
+        if (m_FrameNumber % UPDATE_INTERVAL != 0) {
+            return;
+        }
+
+        // 贴图销毁之后去掉它的状态，这时没有待换的Image
+        m_Textures.erase(std::remove_if(m_Textures.begin(), m_Textures.end(), [](const Scope<StreamingTexture>& state)
+        {
+            return state->Texture.expired();
+        }), m_Textures.end());
+
+        if (m_PressureBudget > 0 && m_FrameNumber - m_PressureFrame > PRESSURE_COOLDOWN) {
+            m_PressureBudget = 0;
+        }
+
+        UpdateWantedMips();
+        SubmitBatch();
+    }
+
+    void VulkanTextureStreamer::SetPoolBudget(uint64 poolBudget)
+    {
+        m_PoolBudget = poolBudget;
+    }
+
+    VulkanTextureStreamingStats VulkanTextureStreamer::GetStats() const
+    {
+        VulkanTextureStreamingStats stats;
+        stats.NumTextures   = (uint32)m_Textures.size();
+        stats.PoolBudget    = m_PressureBudget > 0 ? glm::min(m_PoolBudget, m_PressureBudget) : m_PoolBudget;
+        stats.UploadedBytes = m_UploadedBytes;
+        stats.NumSwaps      = m_NumSwaps;
+        stats.NumEvictions  = m_NumEvictions;
+        stats.DefragmentedBytes = m_DefragmentedBytes;
+
+        for (const Scope<StreamingTexture>& state : m_Textures)
+        {
+            stats.NumPending    += state->PendingImage != VK_NULL_HANDLE ? 1 : 0;
+            stats.ResidentBytes += GetMipTailSize(*state, state->ResidentMip);
+            stats.WantedBytes   += GetMipTailSize(*state, state->WantedMip);
+        }
+        return stats;
+    }
+
+    uint64 VulkanTextureStreamer::GetMipTailSize(const StreamingTexture& state, uint32 mipLevel)
+    {
+        return state.File.Data.size() - state.File.Mips[mipLevel].Offset;
+    }
+
+    void VulkanTextureStreamer::UpdateWantedMips()
+    {
+        uint64 totalBytes = 0;
+
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            if (state->ReportedPixels > 0.0f)
+            {
+                state->ScreenPixels = state->ReportedPixels;
+                state->ReportedPixels = 0.0f;
+
+                // 贴图边长是屏幕覆盖的2^n倍时用第n级
+                const float maxSize = (float)glm::max(state->File.Width, state->File.Height);
+                const float ratio = maxSize / glm::max(state->ScreenPixels, 1.0f);
+                const uint32 mipLevel = ratio <= 1.0f ? 0 : (uint32)std::floor(std::log2(ratio));
+                state->WantedMip = glm::min(mipLevel, state->TailMip);
+            }
+            else if (m_FrameNumber - state->LastReportFrame > DECAY_FRAMES)
+            {
+                state->ScreenPixels = 0.0f;
+                state->WantedMip = state->TailMip;
+            }
+
+            if (state->EvictedFrame > 0)
+            {
+                if (m_FrameNumber - state->EvictedFrame > PRESSURE_COOLDOWN) {
+                    state->EvictedFrame = 0;
+                }
+                else {
+                    state->WantedMip = glm::max(state->WantedMip, state->EvictedMip);
+                }
+            }
+
+            totalBytes += GetMipTailSize(*state, state->WantedMip);
+        }
+
+        const uint64 budget = m_PressureBudget > 0 ? glm::min(m_PoolBudget, m_PressureBudget) : m_PoolBudget;
+
+        // 超出预算时每次从屏幕上最小的贴图去掉一级，直到放得下或者都只剩尾部
+        while (totalBytes > budget)
+        {
+            StreamingTexture* victim = nullptr;
+            for (Scope<StreamingTexture>& state : m_Textures)
+            {
+                if (state->WantedMip < state->TailMip && (!victim || state->ScreenPixels < victim->ScreenPixels)) {
+                    victim = state.get();
+                }
+            }
+
+            if (!victim) {
+                break;
+            }
+
+            totalBytes -= GetMipTailSize(*victim, victim->WantedMip) - GetMipTailSize(*victim, victim->WantedMip + 1);
+            victim->WantedMip += 1;
+        }
+    }
+
+    void VulkanTextureStreamer::ApplyPending()
+    {
+        if (!m_HasPending) {
+            return;
+        }
+
+        // 上传和用旧Image的帧都提交在这个队列，空闲之后描述符和旧Image都不再被引用
+        if (!PollQueueIdle(m_PendingFrame)) {
+            return;
+        }
+
+        VkDevice device = m_Device->GetInstanceHandle();
+
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            if (state->PendingImage == VK_NULL_HANDLE) {
+                continue;
+            }
+
+            Ref<VulkanTexture> texture = state->Texture.lock();
+            if (!texture)
+            {
+                DestroyPending(*state);
+                continue;
+            }
+
+            const VkImage oldImage            = texture->Image;
+            const VkImageView oldView         = texture->ImageView;
+            const VmaAllocation oldAllocation = texture->mVmaAllocation;
+
+            const TextureFile::Mip& baseMip = state->File.Mips[state->PendingMip];
+            texture->Image                    = state->PendingImage;
+            texture->mVmaAllocation           = state->PendingAllocation;
+            texture->ImageView                = state->PendingView;
+            texture->DescriptorInfo.imageView = state->PendingView;
+            texture->Width                    = (int32)baseMip.Width;
+            texture->Height                   = (int32)baseMip.Height;
+            texture->MipLevels                = (int32)(state->File.Mips.size() - state->PendingMip);
+            texture->ResidencyVersion        += 1;
+            texture->SyncHandle();
+            texture->RewriteDescriptors();
+
+            vkDestroyImageView(device, oldView, VULKAN_CPU_ALLOCATOR);
+            VulkanTexture::DestroyBudgetedImage(m_Device.get(), oldImage, oldAllocation);
+
+            state->ResidentMip       = state->PendingMip;
+            state->PendingImage      = VK_NULL_HANDLE;
+            state->PendingAllocation = VK_NULL_HANDLE;
+            state->PendingView       = VK_NULL_HANDLE;
+            m_NumSwaps += 1;
+        }
+
+        m_Staging.reset();
+        m_HasPending = false;
+    }
+
+    void VulkanTextureStreamer::SubmitBatch()
+    {
+        // 先降级腾出显存，再按屏幕大小从大到小升级，升级受每批上传量限制
+        std::vector<StreamingTexture*> batch;
+        std::vector<StreamingTexture*> upgrades;
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            if (state->WantedMip > state->ResidentMip) {
+                batch.push_back(state.get());
+            }
+            else if (state->WantedMip < state->ResidentMip) {
+                upgrades.push_back(state.get());
+            }
+        }
+
+        std::sort(upgrades.begin(), upgrades.end(), [](const StreamingTexture* a, const StreamingTexture* b)
+        {
+            return a->ScreenPixels > b->ScreenPixels;
+        });
+
+        uint64 uploadBytes = 0;
+        for (StreamingTexture* state : upgrades)
+        {
+            const uint64 size = GetMipTailSize(*state, state->WantedMip);
+            if (uploadBytes > 0 && uploadBytes + size > MAX_UPLOAD_PER_BATCH) {
+                continue;
+            }
+            uploadBytes += size;
+            batch.push_back(state);
+        }
+
+        if (batch.empty()) {
+            return;
+        }
+
+        uint64 stagingSize = 0;
+        for (StreamingTexture* state : batch) {
+            stagingSize += Align(GetMipTailSize(*state, state->WantedMip), (uint64)TextureFile::DATA_ALIGNMENT);
+        }
+
+        m_Staging = VulkanBuffer::CreateBuffer(
+            m_Device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingSize);
+        m_Staging->Map();
+
+        VERIFYVULKANRESULT(vkResetCommandPool(m_Device->GetInstanceHandle(), m_CommandPool, 0));
+
+        VkCommandBufferBeginInfo beginInfo;
+        ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(m_CmdBuffer, &beginInfo);
+
+        uint64 stagingOffset = 0;
+        std::vector<VkBufferImageCopy> copyRegions;
+        for (StreamingTexture* state : batch)
+        {
+            const uint32 mipLevel = state->WantedMip;
+            if (!CreateResidentImage(*state, mipLevel)) {
+                continue;
+            }
+
+            // Mip按从大到小连续存放，尾部整块拷贝
+            const TextureFile& file = state->File;
+            const uint64 dataOffset = file.Mips[mipLevel].Offset;
+            const uint64 dataSize   = GetMipTailSize(*state, mipLevel);
+            std::memcpy((uint8*)m_Staging->Mapped + stagingOffset, file.Data.data() + dataOffset, dataSize);
+
+            const uint32 numLevels = (uint32)file.Mips.size() - mipLevel;
+            copyRegions.resize(numLevels);
+            for (uint32 level = 0; level < numLevels; ++level)
+            {
+                const TextureFile::Mip& mip = file.Mips[mipLevel + level];
+
+                VkBufferImageCopy& region = copyRegions[level];
+                region = {};
+                region.bufferOffset                    = stagingOffset + mip.Offset - dataOffset;
+                region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel       = level;
+                region.imageSubresource.baseArrayLayer = 0;
+                region.imageSubresource.layerCount     = 1;
+                region.imageExtent.width               = mip.Width;
+                region.imageExtent.height              = mip.Height;
+                region.imageExtent.depth               = 1;
+            }
+
+            VkImageSubresourceRange subresourceRange = {};
+            subresourceRange.aspectMask   = VK_IMAGE_ASPECT_COLOR_BIT;
+            subresourceRange.levelCount   = numLevels;
+            subresourceRange.layerCount   = 1;
+
+            ImagePipelineBarrier(m_CmdBuffer, state->PendingImage, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+            vkCmdCopyBufferToImage(m_CmdBuffer, m_Staging->Buffer, state->PendingImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32)copyRegions.size(), copyRegions.data());
+            ImagePipelineBarrier(m_CmdBuffer, state->PendingImage, ImageLayoutBarrier::TransferDest, state->Layout, subresourceRange);
+
+            stagingOffset   += Align(dataSize, (uint64)TextureFile::DATA_ALIGNMENT);
+            m_UploadedBytes += dataSize;
+            m_HasPending     = true;
+        }
+
+        vkEndCommandBuffer(m_CmdBuffer);
+        m_Staging->UnMap();
+
+        // 和帧在同一个队列上，按提交顺序在这一帧之前执行；之后的Tick等队列空闲后换进去
+        m_Queue->Submit(1, &m_CmdBuffer);
+        m_PendingFrame = m_FrameNumber;
+    }
+
+    bool VulkanTextureStreamer::PollQueueIdle(uint64 sinceFrame)
+    {
+        const uint64 lastSubmitted = m_Queue->GetLastSubmitted();
+        if (m_Queue->IsComplete(lastSubmitted)) {
+            return true;
+        }
+
+        // GPU一直满载时队列等不到空闲，换Image不能无限推迟
+        if (m_FrameNumber - sinceFrame < IDLE_WAIT_FRAMES) {
+            return false;
+        }
+
+        m_Queue->WaitFor(lastSubmitted);
+        return true;
+    }
+
+    void VulkanTextureStreamer::GetImageCreateInfo(const StreamingTexture& state, uint32 mipLevel, VkImageCreateInfo& outInfo) const
+    {
+        const TextureFile::Mip& baseMip = state.File.Mips[mipLevel];
+
+        ZeroVulkanStruct(outInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+        outInfo.imageType     = VK_IMAGE_TYPE_2D;
+        outInfo.format        = state.Format;
+        outInfo.mipLevels     = (uint32)state.File.Mips.size() - mipLevel;
+        outInfo.arrayLayers   = 1;
+        outInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        outInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        outInfo.extent        = { baseMip.Width, baseMip.Height, 1 };
+        outInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        outInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        outInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+
+    VkImageView VulkanTextureStreamer::CreateImageView(const StreamingTexture& state, VkImage image, uint32 numLevels) const
+    {
+        VkImageViewCreateInfo viewInfo;
+        ZeroVulkanStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+        viewInfo.image      = image;
+        viewInfo.viewType   = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format     = state.Format;
+        viewInfo.components = m_Device->GetFormatComponentMapping(state.File.Format);
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.levelCount = numLevels;
+
+        VkImageView imageView = VK_NULL_HANDLE;
+        VERIFYVULKANRESULT(vkCreateImageView(m_Device->GetInstanceHandle(), &viewInfo, VULKAN_CPU_ALLOCATOR, &imageView));
+        return imageView;
+    }
+
+    bool VulkanTextureStreamer::CreateResidentImage(StreamingTexture& state, uint32 mipLevel)
+    {
+        const TextureFile::Mip& baseMip = state.File.Mips[mipLevel];
+
+        VkImageCreateInfo imageCreateInfo;
+        GetImageCreateInfo(state, mipLevel, imageCreateInfo);
+
+        // 超预算时这次不升级，保持当前常驻的Mip，下次更新再试
+        if (VulkanTexture::CreateBudgetedImage(m_Device.get(), imageCreateInfo, VulkanMemoryCategory::Texture, &state.PendingImage, &state.PendingAllocation, true) != VK_SUCCESS)
+        {
+            state.PendingImage      = VK_NULL_HANDLE;
+            state.PendingAllocation = VK_NULL_HANDLE;
+            RE_CORE_WARN("Texture streaming failed to allocate mip {0}, {1}x{2}", mipLevel, baseMip.Width, baseMip.Height);
+            return false;
+        }
+
+        state.PendingView = CreateImageView(state, state.PendingImage, imageCreateInfo.mipLevels);
+        state.PendingMip  = mipLevel;
+        return true;
+    }
+
+    void VulkanTextureStreamer::Defragment()
+    {
+        VmaAllocator allocator = m_Device->vma_allocator;
+        if (m_DefragContext == VK_NULL_HANDLE)
+        {
+            if (m_FrameNumber - m_DefragFrame < DEFRAG_INTERVAL) {
+                return;
+            }
+            m_DefragFrame = m_FrameNumber;
+
+            VmaDefragmentationInfo defragInfo = {};
+            defragInfo.flags           = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT;
+            defragInfo.maxBytesPerPass = MAX_DEFRAG_PER_PASS;
+            if (vmaBeginDefragmentation(allocator, &defragInfo, &m_DefragContext) != VK_SUCCESS)
+            {
+                m_DefragContext = VK_NULL_HANDLE;
+                return;
+            }
+        }
+
+        // 返回VK_SUCCESS说明已经没有可以移动的分配
+        VmaDefragmentationPassMoveInfo passInfo = {};
+        if (vmaBeginDefragmentationPass(allocator, m_DefragContext, &passInfo) == VK_SUCCESS)
+        {
+            EndDefragmentation();
+            return;
+        }
+
+        // 列出的分配在EndPass之前不能释放，别处析构的资源先暂存在延迟释放队列里
+        m_Device->GetResourceHeapManager().HoldVmaReleases();
+        m_DefragPassMoves     = passInfo.pMoves;
+        m_DefragPassMoveCount = passInfo.moveCount;
+        m_DefragPassOpen      = true;
+        m_DefragPassFrame     = m_FrameNumber;
+
+        VERIFYVULKANRESULT(vkResetCommandPool(m_Device->GetInstanceHandle(), m_CommandPool, 0));
+
+        VkCommandBufferBeginInfo beginInfo;
+        ZeroVulkanStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(m_CmdBuffer, &beginInfo);
+
+        bool hasBufferMoves = false;
+        for (uint32 index = 0; index < passInfo.moveCount; ++index)
+        {
+            VmaDefragmentationMove& move = passInfo.pMoves[index];
+
+            // 流式贴图记录了描述符，网格的顶点、索引Buffer录制时才读，其它分配不知道被谁引用，不移动
+            bool recorded = false;
+            for (Scope<StreamingTexture>& candidate : m_Textures)
+            {
+                Ref<VulkanTexture> texture = candidate->Texture.lock();
+                if (texture && texture->mVmaAllocation == move.srcAllocation)
+                {
+                    recorded = RecordImageMove(move, *candidate, texture);
+                    break;
+                }
+            }
+
+            if (!recorded)
+            {
+                Ref<VulkanBuffer> buffer = VulkanResourcePool::GetInstance().FindPrimitiveBuffer(move.srcAllocation);
+                recorded = buffer && RecordBufferMove(move, buffer);
+                hasBufferMoves = hasBufferMoves || recorded;
+            }
+
+            if (!recorded) {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            }
+        }
+
+        if (hasBufferMoves)
+        {
+            // 之后提交的帧按队列顺序在拷贝之后读新Buffer
+            VkMemoryBarrier memoryBarrier;
+            ZeroVulkanStruct(memoryBarrier, VK_STRUCTURE_TYPE_MEMORY_BARRIER);
+            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(m_CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+        }
+
+        vkEndCommandBuffer(m_CmdBuffer);
+
+        if (m_DefragMoves.empty())
+        {
+            RetireDefragPass(true);
+            return;
+        }
+
+        m_DefragPoint = m_Queue->Submit(1, &m_CmdBuffer);
+
+        // 这一帧开始录制的命令就用新Buffer，旧Buffer只剩拷贝之前提交的帧在用
+        if (hasBufferMoves)
+        {
+            for (DefragMove& defragMove : m_DefragMoves)
+            {
+                if (!defragMove.Buffer) {
+                    continue;
+                }
+
+                Ref<VulkanBuffer>& buffer = defragMove.Buffer;
+                defragMove.OldBuffer = buffer->Buffer;
+                buffer->Buffer       = defragMove.NewBuffer;
+                buffer->SetupDescriptor(buffer->Descriptor.range, buffer->Descriptor.offset);
+                VulkanResourcePool::GetInstance().ReplacePrimitiveBuffer(defragMove.OldBuffer, defragMove.NewBuffer);
+            }
+
+            // 缓存的Secondary里录的是旧Buffer
+            VulkanPassCache::InvalidateAll();
+        }
+    }
+
+    bool VulkanTextureStreamer::RecordImageMove(VmaDefragmentationMove& move, StreamingTexture& state, const Ref<VulkanTexture>& texture)
+    {
+        VkDevice device = m_Device->GetInstanceHandle();
+
+        VkImageCreateInfo imageCreateInfo;
+        GetImageCreateInfo(state, state.ResidentMip, imageCreateInfo);
+
+        VkImage newImage = VK_NULL_HANDLE;
+        if (vkCreateImage(device, &imageCreateInfo, VULKAN_CPU_ALLOCATOR, &newImage) != VK_SUCCESS) {
+            return false;
+        }
+
+        if (vmaBindImageMemory(m_Device->vma_allocator, move.dstTmpAllocation, newImage) != VK_SUCCESS)
+        {
+            vkDestroyImage(device, newImage, VULKAN_CPU_ALLOCATOR);
+            return false;
+        }
+
+        const uint32 numLevels = imageCreateInfo.mipLevels;
+        std::vector<VkImageCopy> copyRegions(numLevels);
+        for (uint32 level = 0; level < numLevels; ++level)
+        {
+            VkImageCopy& region = copyRegions[level];
+            region = {};
+            region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.srcSubresource.mipLevel   = level;
+            region.srcSubresource.layerCount = 1;
+            region.dstSubresource            = region.srcSubresource;
+            region.extent.width              = glm::max(imageCreateInfo.extent.width >> level, 1u);
+            region.extent.height             = glm::max(imageCreateInfo.extent.height >> level, 1u);
+            region.extent.depth              = 1;
+        }
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.levelCount = numLevels;
+        subresourceRange.layerCount = 1;
+
+        // 换进新Image之前的帧还在采样旧Image，拷完转回原来的布局
+        ImagePipelineBarrier(m_CmdBuffer, texture->Image, state.Layout, ImageLayoutBarrier::TransferSource, subresourceRange);
+        ImagePipelineBarrier(m_CmdBuffer, newImage, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+        vkCmdCopyImage(m_CmdBuffer, texture->Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32)copyRegions.size(), copyRegions.data());
+        ImagePipelineBarrier(m_CmdBuffer, texture->Image, ImageLayoutBarrier::TransferSource, state.Layout, subresourceRange);
+        ImagePipelineBarrier(m_CmdBuffer, newImage, ImageLayoutBarrier::TransferDest, state.Layout, subresourceRange);
+
+        DefragMove& defragMove = m_DefragMoves.emplace_back();
+        defragMove.Texture  = texture;
+        defragMove.NewImage = newImage;
+        defragMove.NewView  = CreateImageView(state, newImage, numLevels);
+        return true;
+    }
+
+    bool VulkanTextureStreamer::RecordBufferMove(VmaDefragmentationMove& move, const Ref<VulkanBuffer>& buffer)
+    {
+        // 只移动仅用作顶点、索引的设备Buffer，描述符和映射指针都不会引用它；上传没完成的不动
+        const VkBufferUsageFlags movableUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        if ((buffer->UsageFlags & ~movableUsage) != 0 || (buffer->UsageFlags & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) == 0 || buffer->Mapped || buffer->CreateSize == 0) {
+            return false;
+        }
+        if (!m_Device->GetStagingManager().IsComplete(buffer->UploadTicket) || !m_Device->GetUploadScheduler().IsComplete(buffer->UploadRequest)) {
+            return false;
+        }
+
+        VkDevice device = m_Device->GetInstanceHandle();
+
+        VkBufferCreateInfo bufferCreateInfo;
+        ZeroVulkanStruct(bufferCreateInfo, VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO);
+        bufferCreateInfo.usage = buffer->UsageFlags;
+        bufferCreateInfo.size  = buffer->CreateSize;
+
+        VkBuffer newBuffer = VK_NULL_HANDLE;
+        if (vkCreateBuffer(device, &bufferCreateInfo, VULKAN_CPU_ALLOCATOR, &newBuffer) != VK_SUCCESS) {
+            return false;
+        }
+
+        if (vmaBindBufferMemory(m_Device->vma_allocator, move.dstTmpAllocation, newBuffer) != VK_SUCCESS)
+        {
+            vkDestroyBuffer(device, newBuffer, VULKAN_CPU_ALLOCATOR);
+            return false;
+        }
+
+        // 旧Buffer只被顶点输入读过，拷贝读它不需要屏障
+        VkBufferCopy copyRegion = {};
+        copyRegion.size = buffer->CreateSize;
+        vkCmdCopyBuffer(m_CmdBuffer, buffer->Buffer, newBuffer, 1, &copyRegion);
+
+        DefragMove& defragMove = m_DefragMoves.emplace_back();
+        defragMove.Buffer    = buffer;
+        defragMove.NewBuffer = newBuffer;
+        return true;
+    }
+
+    bool VulkanTextureStreamer::RetireDefragPass(bool force)
+    {
+        VkDevice device = m_Device->GetInstanceHandle();
+
+        // 旧Buffer和旧的显存位置在拷贝的时间线值之前都可能被读
+        if (force) {
+            m_Queue->WaitFor(m_DefragPoint);
+        }
+        else if (!m_Queue->IsComplete(m_DefragPoint)) {
+            return false;
+        }
+
+        // 贴图要重写描述符，还得等用旧描述符的帧也执行完
+        bool hasImageMoves = false;
+        for (DefragMove& defragMove : m_DefragMoves) {
+            hasImageMoves = hasImageMoves || defragMove.Texture;
+        }
+
+        if (hasImageMoves)
+        {
+            if (force) {
+                m_Queue->WaitIdle();
+            }
+            else if (!PollQueueIdle(m_DefragPassFrame)) {
+                return false;
+            }
+        }
+
+        for (DefragMove& defragMove : m_DefragMoves)
+        {
+            if (defragMove.Buffer)
+            {
+                // 分配还是同一个VmaAllocation，EndPass之后指向新位置，这里只销毁旧Buffer
+                vkDestroyBuffer(device, defragMove.OldBuffer, VULKAN_CPU_ALLOCATOR);
+                continue;
+            }
+
+            Ref<VulkanTexture>& texture = defragMove.Texture;
+            const VkImage oldImage    = texture->Image;
+            const VkImageView oldView = texture->ImageView;
+
+            texture->Image                    = defragMove.NewImage;
+            texture->ImageView                = defragMove.NewView;
+            texture->DescriptorInfo.imageView = defragMove.NewView;
+            texture->ResidencyVersion        += 1;
+            texture->SyncHandle();
+            texture->RewriteDescriptors();
+
+            vkDestroyImageView(device, oldView, VULKAN_CPU_ALLOCATOR);
+            vkDestroyImage(device, oldImage, VULKAN_CPU_ALLOCATOR);
+        }
+        m_DefragMoves.clear();
+
+        VmaDefragmentationPassMoveInfo passInfo = {};
+        passInfo.moveCount = m_DefragPassMoveCount;
+        passInfo.pMoves    = m_DefragPassMoves;
+        const bool finished = vmaEndDefragmentationPass(m_Device->vma_allocator, m_DefragContext, &passInfo) == VK_SUCCESS;
+
+        m_DefragPassMoves     = nullptr;
+        m_DefragPassMoveCount = 0;
+        m_DefragPassOpen      = false;
+        m_Device->GetResourceHeapManager().ResumeVmaReleases();
+
+        if (finished) {
+            EndDefragmentation();
+        }
+        return true;
+    }
+
+    void VulkanTextureStreamer::EndDefragmentation()
+    {
+        VmaDefragmentationStats defragStats = {};
+        vmaEndDefragmentation(m_Device->vma_allocator, m_DefragContext, &defragStats);
+        m_DefragContext = VK_NULL_HANDLE;
+        m_DefragmentedBytes += defragStats.bytesMoved;
+    }
+
+    void VulkanTextureStreamer::DestroyPending(StreamingTexture& state)
+    {
+        if (state.PendingImage == VK_NULL_HANDLE) {
+            return;
+        }
+
+        vkDestroyImageView(m_Device->GetInstanceHandle(), state.PendingView, VULKAN_CPU_ALLOCATOR);
+        VulkanTexture::DestroyBudgetedImage(m_Device.get(), state.PendingImage, state.PendingAllocation);
+        state.PendingImage      = VK_NULL_HANDLE;
+        state.PendingAllocation = VK_NULL_HANDLE;
+        state.PendingView       = VK_NULL_HANDLE;
+    }
+
+    uint64 VulkanTextureStreamer::Evict(uint32 heapIndex, uint64 bytesToFree)
+    {
+        if (heapIndex != m_DeviceHeap) {
+            return 0;
+        }
+
+        // 只改目标Mip，真正的释放在下一批里重建Image时发生，回调可能在SubmitBatch分配显存时重入
+        // 所以这里没有立即释放任何显存，返回0，预算按实际用量计算
+        uint64 residentBytes = 0;
+        uint64 freedBytes = 0;
+        for (Scope<StreamingTexture>& state : m_Textures)
+        {
+            residentBytes += GetMipTailSize(*state, state->ResidentMip);
+            if (state->EvictedFrame == 0) {
+                state->EvictedMip = state->ResidentMip;
+            }
+        }
+
+        // 每次从最久没上报、屏幕上最小的贴图去掉一级
+        while (freedBytes < bytesToFree)
+        {
+            StreamingTexture* victim = nullptr;
+            for (Scope<StreamingTexture>& state : m_Textures)
+            {
+                if (state->PendingImage != VK_NULL_HANDLE || state->EvictedMip >= state->TailMip) {
+                    continue;
+                }
+
+                if (!victim || state->LastReportFrame < victim->LastReportFrame ||
+                    (state->LastReportFrame == victim->LastReportFrame && state->ScreenPixels < victim->ScreenPixels)) {
+                    victim = state.get();
+                }
+            }
+
+            if (!victim) {
+                break;
+            }
+
+            freedBytes += GetMipTailSize(*victim, victim->EvictedMip) - GetMipTailSize(*victim, victim->EvictedMip + 1);
+            victim->EvictedMip  += 1;
+            victim->EvictedFrame = glm::max(m_FrameNumber, (uint64)1);
+        }
+
+        if (freedBytes > 0)
+        {
+            m_PressureBudget = residentBytes - freedBytes;
+            m_PressureFrame  = m_FrameNumber;
+            m_NumEvictions  += 1;
+        }
+
+        return 0;
+    }
+}
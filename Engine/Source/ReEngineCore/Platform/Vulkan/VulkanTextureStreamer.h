@@ -0,0 +1,194 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffers/VulkanTexture.h"
+#include "VulkanBuffers/VulkanBuffer.h"
+#include "Resource/Texture/TextureFile.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+VK_DEFINE_HANDLE( VmaDefragmentationContext )
+struct VmaDefragmentationMove;
+
+namespace ReEngine
+{
+    struct VulkanTextureStreamingStats
+    {
+        uint32 NumTextures          = 0;
+        uint32 NumPending           = 0;    // 已提交上传、等下一帧换Image的贴图
+        uint64 ResidentBytes        = 0;
+        uint64 WantedBytes          = 0;    // 按足迹全部满足时需要的大小
+        uint64 PoolBudget           = 0;    // 显存紧张时会临时降低
+        uint64 UploadedBytes        = 0;
+        uint32 NumSwaps             = 0;
+        uint32 NumEvictions         = 0;
+        uint64 DefragmentedBytes    = 0;    // 碎片整理移动过的贴图和Buffer大小
+    };
+
+    // 烘焙贴图的流式Mip：加载时只上传尾部的低精度Mip，CPU上保留整个文件
+    // 调用方每帧上报贴图在屏幕上的像素大小，按它算出需要的最精细Mip，没上报的贴图过一段时间降回尾部
+    // 常驻Mip变化时用需要的Mip范围重建Image，从CPU数据上传后在之后的Tick里换进贴图并重写描述符
+    // 描述符集没有UPDATE_AFTER_BIND，换Image要等帧队列上已提交的工作全部执行完；每次Tick不阻塞地查时间线，
+    // GPU一直满载、IDLE_WAIT_FRAMES帧内都等不到空闲时才退回等待一次
+    // 显存超出软上限时回收回调按优先级降低常驻Mip，池预算临时降到回收后的大小，冷却后恢复
+    // 每隔DEFRAG_INTERVAL帧对VMA的默认池做一轮增量碎片整理，移动流式贴图和网格的顶点、索引Buffer，其它分配跳过
+    // 一次Pass跨多帧：提交拷贝后Buffer立即换成新的，旧Buffer等拷贝的时间线值完成后销毁；贴图等队列空闲后再换，之后EndPass
+    // VMA要求列出的分配在EndPass之前都不能释放，Pass打开期间暂停流式批次，并让堆管理器暂存VMA的延迟释放
+    // 描述符要用VulkanDescriptorSet::WriteImage(name, Ref)写才会被记录和重写；只在主线程调用
+    class VulkanTextureStreamer
+    {
+    public:
+        enum
+        {
+            DEFAULT_POOL_BUDGET     = 256 * 1024 * 1024,
+            // 一批上传的上限，超出的留到下一批
+            MAX_UPLOAD_PER_BATCH    = 32 * 1024 * 1024,
+            // 边长不超过它的Mip始终常驻
+            TAIL_SIZE               = 64,
+            UPDATE_INTERVAL         = 8,
+            // 这么多帧没有上报足迹就降回尾部
+            DECAY_FRAMES            = 120,
+            // 回收之后这么多帧内不恢复池预算
+            PRESSURE_COOLDOWN       = 240,
+            // 两轮碎片整理之间至少隔这么多帧，一轮分多次，每次和上传批次错开
+            DEFRAG_INTERVAL         = 600,
+            MAX_DEFRAG_PER_PASS     = 16 * 1024 * 1024,
+            // 等帧队列自然空闲的最多帧数，超过之后等待一次
+            IDLE_WAIT_FRAMES        = 32,
+        };
+
+        void Init(Ref<VulkanDevice> device, uint64 poolBudget = DEFAULT_POOL_BUDGET);
+
+        void Destroy();
+
+        // 有烘焙文件并且设备支持它的格式时创建流式贴图，否则退回VulkanTexture::Create2D完整加载
+        Ref<VulkanTexture> CreateTexture(const std::string& filename, Ref<VulkanCommandBuffer> cmdBuffer, ImageLayoutBarrier imageLayout = ImageLayoutBarrier::PixelShaderRead);
+
+        // screenPixels是贴图完整铺开时在屏幕上的边长，同一帧多次上报取最大
+        void ReportFootprint(const Ref<VulkanTexture>& texture, float screenPixels);
+
+        // 世界空间包围球投影到屏幕上的直径，单位像素；相机在球内时返回viewportHeight的很多倍
+        static float ComputeScreenPixels(const glm::vec3& center, float radius, const glm::mat4& view, const glm::mat4& proj, float viewportHeight);
+
+        // 帧CommandBuffer开始录制之前调用：换进上一批的Image，再按足迹发起下一批
+        void Tick();
+
+        void SetPoolBudget(uint64 poolBudget);
+
+        VulkanTextureStreamingStats GetStats() const;
+
+    private:
+        struct StreamingTexture
+        {
+            std::weak_ptr<VulkanTexture>    Texture;
+            TextureFile                     File;
+            VkFormat                        Format = VK_FORMAT_UNDEFINED;
+            ImageLayoutBarrier              Layout = ImageLayoutBarrier::PixelShaderRead;
+            // 当前Image的第0级对应文件的哪一级
+            uint32                          ResidentMip = 0;
+            uint32                          TailMip = 0;
+            uint32                          WantedMip = 0;
+            // 回收时强制的最精细Mip，冷却后清掉
+            uint32                          EvictedMip = 0;
+            uint64                          EvictedFrame = 0;
+
+            // 这一批里上报的最大值，和上一批算出来的结果，后者用作预算不够时的优先级
+            float                           ReportedPixels = 0.0f;
+            float                           ScreenPixels = 0.0f;
+            uint64                          LastReportFrame = 0;
+
+            // 已上传、等下一帧换进去的Image
+            VkImage                         PendingImage = VK_NULL_HANDLE;
+            VmaAllocation                   PendingAllocation = VK_NULL_HANDLE;
+            VkImageView                     PendingView = VK_NULL_HANDLE;
+            uint32                          PendingMip = 0;
+        };
+
+        // 碎片整理里一张贴图或一个Buffer的搬家
+        struct DefragMove
+        {
+            Ref<VulkanTexture>              Texture;
+            VkImage                         NewImage = VK_NULL_HANDLE;
+            VkImageView                     NewView = VK_NULL_HANDLE;
+            // Buffer提交拷贝后立即换成新的，这里留着旧的
+            Ref<VulkanBuffer>               Buffer;
+            VkBuffer                        NewBuffer = VK_NULL_HANDLE;
+            VkBuffer                        OldBuffer = VK_NULL_HANDLE;
+        };
+
+        // 文件的mipLevel级到最后一级的数据大小
+        static uint64 GetMipTailSize(const StreamingTexture& state, uint32 mipLevel);
+
+        // 按足迹算需要的最精细Mip，再用池预算按优先级限制
+        void UpdateWantedMips();
+
+        void ApplyPending();
+
+        void SubmitBatch();
+
+        void GetImageCreateInfo(const StreamingTexture& state, uint32 mipLevel, VkImageCreateInfo& outInfo) const;
+
+        VkImageView CreateImageView(const StreamingTexture& state, VkImage image, uint32 numLevels) const;
+
+        bool CreateResidentImage(StreamingTexture& state, uint32 mipLevel);
+
+        // 开始一次碎片整理的Pass：给VMA安排的流式贴图和顶点、索引Buffer在新位置创建并提交拷贝
+        void Defragment();
+
+        // 拷贝完成、队列空闲后换进贴图，销毁旧的Image和Buffer并结束Pass；force时直接等待
+        bool RetireDefragPass(bool force);
+
+        bool RecordImageMove(VmaDefragmentationMove& move, StreamingTexture& state, const Ref<VulkanTexture>& texture);
+
+        bool RecordBufferMove(VmaDefragmentationMove& move, const Ref<VulkanBuffer>& buffer);
+
+        void EndDefragmentation();
+
+        // sinceFrame起等帧队列上提交的工作都执行完，不阻塞；等了IDLE_WAIT_FRAMES帧还没等到就等待一次
+        bool PollQueueIdle(uint64 sinceFrame);
+
+        void DestroyPending(StreamingTexture& state);
+
+        uint64 Evict(uint32 heapIndex, uint64 bytesToFree);
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        Ref<VulkanQueue>                m_Queue;
+        VkCommandPool                   m_CommandPool = VK_NULL_HANDLE;
+        VkCommandBuffer                 m_CmdBuffer = VK_NULL_HANDLE;
+        uint32                          m_EvictionHandle = 0;
+        uint32                          m_DeviceHeap = 0;
+
+        std::vector<Scope<StreamingTexture>> m_Textures;
+        // 这一批上传用的Staging，换进Image之后释放
+        Ref<VulkanBuffer>               m_Staging;
+        bool                            m_HasPending = false;
+        uint64                          m_PendingFrame = 0;
+
+        uint64                          m_FrameNumber = 0;
+        uint64                          m_PoolBudget = DEFAULT_POOL_BUDGET;
+        uint64                          m_PressureBudget = 0;
+        uint64                          m_PressureFrame = 0;
+
+        uint64                          m_UploadedBytes = 0;
+        uint32                          m_NumSwaps = 0;
+        uint32                          m_NumEvictions = 0;
+
+        VmaDefragmentationContext       m_DefragContext = VK_NULL_HANDLE;
+        uint64                          m_DefragFrame = 0;
+        uint64                          m_DefragmentedBytes = 0;
+
+        // 打开的Pass：VMA给出的移动列表，EndPass时原样交回
+        VmaDefragmentationMove*         m_DefragPassMoves = nullptr;
+        uint32                          m_DefragPassMoveCount = 0;
+        std::vector<DefragMove>         m_DefragMoves;
+        // 拷贝提交到的时间线值和提交的帧
+        uint64                          m_DefragPoint = 0;
+        uint64                          m_DefragPassFrame = 0;
+        bool                            m_DefragPassOpen = false;
+    };
+}
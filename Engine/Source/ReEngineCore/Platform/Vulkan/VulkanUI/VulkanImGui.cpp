@@ -86,8 +86,7 @@ static uint32_t g__glsl_shader_frag_spv[] =
 
 VulkanImGui::VulkanImGui()
 : m_VulkanDevice(nullptr)
-   , m_VertexCount(0)
-   , m_IndexCount(0)
+   , m_FrameIndex(0)
    , m_Subpass(0)
    , m_DescriptorPool(VK_NULL_HANDLE)
    , m_DescriptorSetLayout(VK_NULL_HANDLE)
@@ -117,7 +116,10 @@ void VulkanImGui::Init(const std::string& font,VulkanContext * Context)
     ImGui::CreateContext();
     ImGui::StyleColorsLight();
 
-    ImGui_ImplGlfw_InitForVulkan(Context->GetGLFWwindow(),true);
+    m_HasWindow = Context->GetGLFWwindow() != nullptr;
+    if (m_HasWindow) {
+        ImGui_ImplGlfw_InitForVulkan(Context->GetGLFWwindow(),true);
+    }
     
     const float windowWidth  = (float)Application::GetInstance().GetWindowInfo().Width;
     const float windowHeight = (float)Application::GetInstance().GetWindowInfo().Height;
@@ -128,6 +130,7 @@ void VulkanImGui::Init(const std::string& font,VulkanContext * Context)
     m_Scale        = frameWidth / windowWidth;
     m_VulkanDevice = Context->GetVulkanInstance()->GetDevice();
     g_VulkanInstance = Context->Instance;
+    m_FrameData.resize(Context->CommandPool->GetFramesInFlight());
 
     ImGuiIO& io = ImGui::GetIO();
     io.DisplaySize = ImVec2((float)(windowWidth), (float)(windowHeight));
@@ -136,7 +139,9 @@ void VulkanImGui::Init(const std::string& font,VulkanContext * Context)
     io.BackendFlags |= ImGuiBackendFlags_HasMouseCursors;
     io.BackendFlags |= ImGuiBackendFlags_HasSetMousePos;
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    if (m_HasWindow) {
+        io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    }
     
     PrepareFontResources();
     PreparePipelineResources();
@@ -160,10 +165,18 @@ void VulkanImGui::Destroy()
     }
     m_UIFrameBuffers.clear();
     
-    ImGui_ImplGlfw_Shutdown();
+    if (m_HasWindow) {
+        ImGui_ImplGlfw_Shutdown();
+    }
     ImGui::DestroyContext();
-    m_VertexBuffer.Destroy();
-    m_IndexBuffer.Destroy();
+    for (int32 i = 0; i < m_FrameData.size(); ++i)
+    {
+        m_FrameData[i].VertexBuffer.Unmap();
+        m_FrameData[i].VertexBuffer.Destroy();
+        m_FrameData[i].IndexBuffer.Unmap();
+        m_FrameData[i].IndexBuffer.Destroy();
+    }
+    m_FrameData.clear();
     vkDestroyDescriptorPool(device, m_DescriptorPool, VULKAN_CPU_ALLOCATOR);
     vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, VULKAN_CPU_ALLOCATOR);
     vkDestroyPipelineLayout(device, m_PipelineLayout, VULKAN_CPU_ALLOCATOR);
@@ -181,8 +194,11 @@ void VulkanImGui::Resize(uint32 width, uint32 height)
     io.DisplaySize = ImVec2((float)(width), (float)(height));
 }
 
-bool VulkanImGui::Update()
+bool VulkanImGui::Update(int32 frameIndex)
 {
+    m_FrameIndex = frameIndex;
+    UIFrameData& frameData = m_FrameData[frameIndex];
+
     ImDrawData* imDrawData = ImGui::GetDrawData();
     bool updateCmdBuffers  = false;
 
@@ -202,30 +218,30 @@ bool VulkanImGui::Update()
     }
 
     // Vertex buffer
-    if ((m_VertexBuffer.buffer == VK_NULL_HANDLE) || (m_VertexCount != imDrawData->TotalVtxCount))
+    if ((frameData.VertexBuffer.buffer == VK_NULL_HANDLE) || (frameData.VertexCount != imDrawData->TotalVtxCount))
     {
-        m_VertexCount = imDrawData->TotalVtxCount;
-        m_VertexBuffer.Unmap();
-        m_VertexBuffer.Destroy();
-        CreateBuffer(m_VertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, vertexBufferSize);
-        m_VertexBuffer.Map();
+        frameData.VertexCount = imDrawData->TotalVtxCount;
+        frameData.VertexBuffer.Unmap();
+        frameData.VertexBuffer.Destroy();
+        CreateBuffer(frameData.VertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, vertexBufferSize);
+        frameData.VertexBuffer.Map();
         updateCmdBuffers = true;
     }
 
     // Index buffer
-    if ((m_IndexBuffer.buffer == VK_NULL_HANDLE) || (m_IndexCount < imDrawData->TotalIdxCount))
+    if ((frameData.IndexBuffer.buffer == VK_NULL_HANDLE) || (frameData.IndexCount < imDrawData->TotalIdxCount))
     {
-        m_IndexCount = imDrawData->TotalIdxCount;
-        m_IndexBuffer.Unmap();
-        m_IndexBuffer.Destroy();
-        CreateBuffer(m_IndexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, indexBufferSize);
-        m_IndexBuffer.Map();
+        frameData.IndexCount = imDrawData->TotalIdxCount;
+        frameData.IndexBuffer.Unmap();
+        frameData.IndexBuffer.Destroy();
+        CreateBuffer(frameData.IndexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, indexBufferSize);
+        frameData.IndexBuffer.Map();
         updateCmdBuffers = true;
     }
 
     // Upload data
-    ImDrawVert* vtxDst = (ImDrawVert*)m_VertexBuffer.mapped;
-    ImDrawIdx* idxDst  = (ImDrawIdx*)m_IndexBuffer.mapped;
+    ImDrawVert* vtxDst = (ImDrawVert*)frameData.VertexBuffer.mapped;
+    ImDrawIdx* idxDst  = (ImDrawIdx*)frameData.IndexBuffer.mapped;
 
     for (int n = 0; n < imDrawData->CmdListsCount; n++)
     {
@@ -236,15 +252,17 @@ bool VulkanImGui::Update()
         idxDst += cmdList->IdxBuffer.Size;
     }
 
-    m_VertexBuffer.Flush();
-    m_IndexBuffer.Flush();
+    frameData.VertexBuffer.Flush();
+    frameData.IndexBuffer.Flush();
 
     return updateCmdBuffers || m_Updated;
 }
 
 void VulkanImGui::StartFrame()
 {
-    ImGui_ImplGlfw_NewFrame();
+    if (m_HasWindow) {
+        ImGui_ImplGlfw_NewFrame();
+    }
     ImGui::NewFrame();
 }
 
@@ -297,8 +315,9 @@ void VulkanImGui::BindDrawCmd(const VkCommandBuffer& commandBuffer, const VkRend
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
     vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstBlock), &m_PushData);
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer.buffer, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+    const UIFrameData& frameData = m_FrameData[m_FrameIndex];
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frameData.VertexBuffer.buffer, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, frameData.IndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
 
     for (int32_t i = 0; i < imDrawData->CmdListsCount; ++i)
     {
@@ -527,7 +546,8 @@ void VulkanImGui::PrepareFontResources()
     {
         VkCommandPoolCreateInfo cmdPoolInfo;
         ZeroVulkanStruct(cmdPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
-        cmdPoolInfo.queueFamilyIndex = m_VulkanDevice->GetTransferQueue()->GetFamilyIndex();
+        // 要在片元着色器阶段做布局转换，传输队列可能是不支持的DMA队列，用图形队列
+        cmdPoolInfo.queueFamilyIndex = m_VulkanDevice->GetGraphicsQueue()->GetFamilyIndex();
         cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         VERIFYVULKANRESULT(vkCreateCommandPool(device, &cmdPoolInfo, VULKAN_CPU_ALLOCATOR, &commandPool));
     }
@@ -629,24 +649,10 @@ void VulkanImGui::PrepareFontResources()
         VERIFYVULKANRESULT(vkEndCommandBuffer(cmdBuffer));
     }
 
-    VkSubmitInfo submitInfo;
-    ZeroVulkanStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &cmdBuffer;
-
-    VkFence fence = VK_NULL_HANDLE;
-    {
-        VkFenceCreateInfo fenceCreateInfo;
-        ZeroVulkanStruct(fenceCreateInfo, VK_STRUCTURE_TYPE_FENCE_CREATE_INFO);
-        fenceCreateInfo.flags = 0;
-        VERIFYVULKANRESULT(vkCreateFence(device, &fenceCreateInfo, VULKAN_CPU_ALLOCATOR, &fence));
-    }
-
-    VERIFYVULKANRESULT(vkQueueSubmit(m_VulkanDevice->GetTransferQueue()->GetHandle(), 1, &submitInfo, fence));
-    VERIFYVULKANRESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, ((uint64)	0xffffffffffffffff)));
+    VulkanQueue& gfxQueue = *m_VulkanDevice->GetGraphicsQueue();
+    gfxQueue.WaitFor(gfxQueue.Submit(1, &cmdBuffer));
 
     vkFreeCommandBuffers(device, commandPool, 1, &cmdBuffer);
-    vkDestroyFence(device, fence, VULKAN_CPU_ALLOCATOR);
     vkDestroyCommandPool(device, commandPool, VULKAN_CPU_ALLOCATOR);
     vkDestroyBuffer(device, stagingBuffer, VULKAN_CPU_ALLOCATOR);
     vkFreeMemory(device, stagingMemory, VULKAN_CPU_ALLOCATOR);
@@ -84,6 +84,15 @@ namespace ReEngine
             }
         };
 
+        // 每个帧槽位一份，CPU写这一帧时GPU可能还在读上一帧的
+        struct UIFrameData
+        {
+            UIBuffer    VertexBuffer;
+            UIBuffer    IndexBuffer;
+            int32       VertexCount = 0;
+            int32       IndexCount = 0;
+        };
+
         struct PushConstBlock
         {
             glm::vec2 scale;
@@ -98,7 +107,7 @@ namespace ReEngine
 
         void Resize(uint32 width, uint32 height);
 
-        bool Update();
+        bool Update(int32 frameIndex);
 
         void StartFrame();
 
@@ -129,10 +138,8 @@ namespace ReEngine
 
         VulkanDeviceRef         m_VulkanDevice;
 
-        UIBuffer                m_VertexBuffer;
-        UIBuffer                m_IndexBuffer;
-        int32                   m_VertexCount;
-        int32                   m_IndexCount;
+        std::vector<UIFrameData> m_FrameData;
+        int32                   m_FrameIndex;
 
         int32                   m_Subpass;
 
@@ -158,6 +165,8 @@ namespace ReEngine
         bool                    m_Visible;
         bool                    m_Updated;
         float                   m_Scale;
+        // 离屏模式没有窗口，不接GLFW的输入后端
+        bool                    m_HasWindow = true;
 
         std::string             m_FontPath;
 
@@ -0,0 +1,848 @@
+﻿#include "VulkanVirtualTexture.h"
+#include "Resource/AssetManager/AssetManager.h"
+#include "Core/Alignment.h"
+#include "Math/Math.h"
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace ReEngine
+{
+    namespace
+    {
+        FORCE_INLINE void BufferPipelineBarrier(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize size, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+        {
+            VkBufferMemoryBarrier barrier;
+            ZeroVulkanStruct(barrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
+            barrier.srcAccessMask       = srcAccess;
+            barrier.dstAccessMask       = dstAccess;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer              = buffer;
+            barrier.offset              = 0;
+            barrier.size                = size;
+            vkCmdPipelineBarrier(cmdBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+
+        // 页表像素：R是槽位x，G是槽位y，B是常驻的Mip，A不为0时有效
+        FORCE_INLINE uint32 PackPageEntry(uint32 slotX, uint32 slotY, uint32 mip)
+        {
+            return slotX | (slotY << 8) | (mip << 16) | (1u << 24);
+        }
+
+        FORCE_INLINE bool IsEntryValid(uint32 entry)
+        {
+            return (entry >> 24) != 0;
+        }
+
+        FORCE_INLINE uint32 GetEntryMip(uint32 entry)
+        {
+            return (entry >> 16) & 0xFF;
+        }
+
+        Ref<VulkanTexture> CreateTextureObject(Ref<VulkanDevice> vulkanDevice, const VkImageCreateInfo& imageCreateInfo, VkFilter filter)
+        {
+            VkDevice device = vulkanDevice->GetInstanceHandle();
+
+            VkImage image = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VERIFYVULKANRESULT(VulkanTexture::CreateBudgetedImage(vulkanDevice.get(), imageCreateInfo, VulkanMemoryCategory::Texture, &image, &allocation));
+
+            VkSamplerCreateInfo samplerInfo;
+            ZeroVulkanStruct(samplerInfo, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
+            samplerInfo.magFilter        = filter;
+            samplerInfo.minFilter        = filter;
+            samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            samplerInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.compareOp        = VK_COMPARE_OP_NEVER;
+            samplerInfo.borderColor      = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+            samplerInfo.maxAnisotropy    = 1.0;
+            samplerInfo.anisotropyEnable = VK_FALSE;
+            samplerInfo.maxLod           = (float)imageCreateInfo.mipLevels;
+            samplerInfo.minLod           = 0.0f;
+            VkSampler sampler = VK_NULL_HANDLE;
+            VERIFYVULKANRESULT(vkCreateSampler(device, &samplerInfo, VULKAN_CPU_ALLOCATOR, &sampler));
+
+            VkImageViewCreateInfo viewInfo;
+            ZeroVulkanStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+            viewInfo.image      = image;
+            viewInfo.viewType   = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format     = imageCreateInfo.format;
+            viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.levelCount = imageCreateInfo.mipLevels;
+            viewInfo.subresourceRange.layerCount = 1;
+            VkImageView imageView = VK_NULL_HANDLE;
+            VERIFYVULKANRESULT(vkCreateImageView(device, &viewInfo, VULKAN_CPU_ALLOCATOR, &imageView));
+
+            Ref<VulkanTexture> texture = CreateRef<VulkanTexture>();
+            texture->Device                     = vulkanDevice;
+            texture->Image                      = image;
+            texture->mVmaAllocation             = allocation;
+            texture->ImageView                  = imageView;
+            texture->ImageSampler               = sampler;
+            texture->ImageLayout                = GetImageLayout(ImageLayoutBarrier::PixelShaderRead);
+            texture->DescriptorInfo.sampler     = sampler;
+            texture->DescriptorInfo.imageView   = imageView;
+            texture->DescriptorInfo.imageLayout = texture->ImageLayout;
+            texture->Format                     = imageCreateInfo.format;
+            texture->Width                      = (int32)imageCreateInfo.extent.width;
+            texture->Height                     = (int32)imageCreateInfo.extent.height;
+            texture->MipLevels                  = (int32)imageCreateInfo.mipLevels;
+            return texture;
+        }
+    }
+
+    void VulkanVirtualTextureSystem::Init(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 cacheSize)
+    {
+        m_Device            = device;
+        m_NumFramesInFlight = numFramesInFlight;
+
+        // 槽位坐标存在页表的8位通道里
+        m_CacheSize    = std::min(cacheSize, device->GetLimits().maxImageDimension2D);
+        m_SlotsPerAxis = std::min(m_CacheSize / (uint32)PAGE_SIZE, 255u);
+
+        VkImageCreateInfo imageCreateInfo;
+        ZeroVulkanStruct(imageCreateInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+        imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format        = VK_FORMAT_R8G8B8A8_UNORM;
+        imageCreateInfo.mipLevels     = 1;
+        imageCreateInfo.arrayLayers   = 1;
+        imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.extent        = { m_CacheSize, m_CacheSize, 1 };
+        imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCreateInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        m_PhysicalCache = CreateTextureObject(device, imageCreateInfo, VK_FILTER_LINEAR);
+
+        m_Slots.resize(m_SlotsPerAxis * m_SlotsPerAxis);
+        m_FreeSlots.resize(m_Slots.size());
+        for (uint32 index = 0; index < (uint32)m_FreeSlots.size(); ++index) {
+            m_FreeSlots[index] = (int32)(m_FreeSlots.size() - 1 - index);
+        }
+
+        m_FeedbackBuffer = VulkanBuffer::CreateBuffer(
+            device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            (VkDeviceSize)FEEDBACK_CAPACITY * sizeof(uint32));
+
+        m_Readbacks.resize(numFramesInFlight);
+        m_ReadbackStamps.assign(numFramesInFlight, 0);
+        m_Stagings.resize(numFramesInFlight);
+        for (Ref<VulkanBuffer>& readback : m_Readbacks)
+        {
+            readback = VulkanBuffer::CreateBuffer(
+                device, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                (VkDeviceSize)FEEDBACK_CAPACITY * sizeof(uint32));
+            readback->Map();
+        }
+
+        m_Quit   = false;
+        m_Thread = std::thread(&VulkanVirtualTextureSystem::LoaderThread, this);
+    }
+
+    void VulkanVirtualTextureSystem::Destroy()
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Quit = true;
+        }
+        m_Condition.notify_all();
+        m_Thread.join();
+
+        m_Requests.clear();
+        m_Results.clear();
+        m_Textures.clear();
+        m_Slots.clear();
+        m_FreeSlots.clear();
+
+        for (Ref<VulkanBuffer>& readback : m_Readbacks) {
+            readback->UnMap();
+        }
+        for (Ref<VulkanBuffer>& staging : m_Stagings)
+        {
+            if (staging) {
+                staging->UnMap();
+            }
+        }
+        m_Readbacks.clear();
+        m_ReadbackStamps.clear();
+        m_Stagings.clear();
+        m_FeedbackBuffer.reset();
+        m_PhysicalCache.reset();
+        m_CacheCleared = false;
+        m_FeedbackUsed = 0;
+
+        m_Device.reset();
+    }
+
+    Ref<VulkanVirtualTexture> VulkanVirtualTextureSystem::CreateTexture(const std::string& filename, Ref<VulkanCommandBuffer> cmdBuffer)
+    {
+        if (!m_Device) {
+            return nullptr;
+        }
+
+        const bool isCooked = std::filesystem::path(filename).extension() == ".rvt";
+        const std::string cookedPath = isCooked ? filename : VirtualTextureFile::GetCookedPath(filename);
+
+        if (!isCooked && !std::filesystem::exists(AssetManager::GetFullPath(cookedPath)))
+        {
+            uint32 dataSize = 0;
+            uint8* dataPtr  = nullptr;
+            if (!AssetManager::ReadFile(filename, dataPtr, dataSize))
+            {
+                RE_CORE_ERROR("Failed to Load Image : {0}", filename.c_str());
+                return nullptr;
+            }
+
+            int32 width = 0, height = 0, comp = 0;
+            uint8* pixels = StbImage::LoadFromMemory(dataPtr, dataSize, &width, &height, &comp, 4);
+            delete[] dataPtr;
+            if (pixels == nullptr)
+            {
+                RE_CORE_ERROR("Failed load image From StbImage: {0}", filename.c_str());
+                return nullptr;
+            }
+
+            // 运行时烘焙按颜色贴图处理，数据贴图要用ReTextureCooker --virtual预先烘焙
+            const bool cooked = VirtualTextureFile::Cook(pixels, width, height, true, AssetManager::GetFullPath(cookedPath).string());
+            StbImage::Free(pixels);
+            if (!cooked) {
+                return nullptr;
+            }
+            RE_CORE_INFO("Cooked virtual texture {0}", cookedPath);
+        }
+
+        Scope<VirtualTextureState> state = CreateScope<VirtualTextureState>();
+        VirtualTextureFile& file = state->File;
+        if (!file.Open(cookedPath))
+        {
+            RE_CORE_ERROR("Failed to open virtual texture : {0}", cookedPath);
+            return nullptr;
+        }
+
+        const uint32 numMips  = (uint32)file.Mips.size();
+        const uint32 numPages = file.GetNumPages();
+        if (file.GetPageSize() != PAGE_SIZE || numMips > VulkanVirtualTexture::MAX_MIPS)
+        {
+            RE_CORE_ERROR("Virtual texture {0} has page size {1} and {2} mips, expected page size {3}.", cookedPath, file.GetPageSize(), numMips, (uint32)PAGE_SIZE);
+            return nullptr;
+        }
+
+        // 反馈区间只分配不回收
+        if (m_FeedbackUsed + numPages > FEEDBACK_CAPACITY)
+        {
+            RE_CORE_ERROR("Virtual texture feedback buffer is full, can't add {0}.", cookedPath);
+            return nullptr;
+        }
+        state->FeedbackOffset = m_FeedbackUsed;
+        m_FeedbackUsed += numPages;
+
+        state->PageSlots.assign(numPages, -1);
+        state->PageStates.assign(numPages, PAGE_EMPTY);
+
+        // 第0级按页数向上取到2的幂，每级减半之后仍然放得下这一级的页
+        const uint32 tableWidth  = Math::RoundUpToPowerOfTwo(file.Mips[0].PagesX);
+        const uint32 tableHeight = Math::RoundUpToPowerOfTwo(file.Mips[0].PagesY);
+        state->PageTableMips.resize(numMips);
+        state->PageTableSizes.resize(numMips);
+        for (uint32 mip = 0; mip < numMips; ++mip)
+        {
+            state->PageTableSizes[mip] = glm::uvec2(std::max(tableWidth >> mip, 1u), std::max(tableHeight >> mip, 1u));
+            state->PageTableMips[mip].assign(state->PageTableSizes[mip].x * state->PageTableSizes[mip].y, 0);
+        }
+
+        VkImageCreateInfo imageCreateInfo;
+        ZeroVulkanStruct(imageCreateInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+        imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format        = VK_FORMAT_R8G8B8A8_UINT;
+        imageCreateInfo.mipLevels     = numMips;
+        imageCreateInfo.arrayLayers   = 1;
+        imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.extent        = { tableWidth, tableHeight, 1 };
+        imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCreateInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        state->PageTable = CreateTextureObject(m_Device, imageCreateInfo, VK_FILTER_NEAREST);
+
+        cmdBuffer->Begin();
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.levelCount = numMips;
+        subresourceRange.layerCount = 1;
+
+        VkClearColorValue clearColor = {};
+        ImagePipelineBarrier(cmdBuffer->CmdBuffer, state->PageTable->Image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+        vkCmdClearColorImage(cmdBuffer->CmdBuffer, state->PageTable->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &subresourceRange);
+        ImagePipelineBarrier(cmdBuffer->CmdBuffer, state->PageTable->Image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::PixelShaderRead, subresourceRange);
+
+        if (!m_CacheCleared)
+        {
+            subresourceRange.levelCount = 1;
+            ImagePipelineBarrier(cmdBuffer->CmdBuffer, m_PhysicalCache->Image, ImageLayoutBarrier::Undefined, ImageLayoutBarrier::TransferDest, subresourceRange);
+            vkCmdClearColorImage(cmdBuffer->CmdBuffer, m_PhysicalCache->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &subresourceRange);
+            ImagePipelineBarrier(cmdBuffer->CmdBuffer, m_PhysicalCache->Image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::PixelShaderRead, subresourceRange);
+
+            // 帧标记从1开始，0表示没有用过
+            vkCmdFillBuffer(cmdBuffer->CmdBuffer, m_FeedbackBuffer->Buffer, 0, VK_WHOLE_SIZE, 0);
+            BufferPipelineBarrier(cmdBuffer->CmdBuffer, m_FeedbackBuffer->Buffer, VK_WHOLE_SIZE,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            m_CacheCleared = true;
+        }
+
+        cmdBuffer->End();
+        cmdBuffer->Submit();
+
+        Ref<VulkanVirtualTexture> texture = CreateRef<VulkanVirtualTexture>();
+        texture->m_PageTable = state->PageTable;
+
+        VulkanVirtualTexture::Params& params = texture->m_Params;
+        params.PageInfo  = glm::uvec4(file.Width, file.Height, numMips, state->FeedbackOffset);
+        params.CacheInfo = glm::uvec4(file.TileSize, file.Border, file.GetPageSize(), m_CacheSize);
+        params.FrameInfo = glm::uvec4(m_FrameStamp, 0, 0, 0);
+        for (uint32 mip = 0; mip < numMips; ++mip) {
+            params.MipFirstPage[mip / 4][mip % 4] = file.Mips[mip].FirstPage;
+        }
+
+        state->Texture = texture;
+
+        // 最粗的一级只有一页，先加载它，之后常驻
+        const uint32 lastMip = numMips - 1;
+        LoadRequest request;
+        request.State = state.get();
+        request.Page  = GetMipFirstPage(*state, lastMip);
+        request.Mip   = lastMip;
+        state->PageStates[request.Page] = PAGE_LOADING;
+        state->NumLoading += 1;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Requests.push_back(request);
+        }
+        m_Condition.notify_one();
+
+        m_Textures.push_back(std::move(state));
+        return texture;
+    }
+
+    void VulkanVirtualTextureSystem::BeginFrame(VkCommandBuffer cmdBuffer, uint32 frameIndex)
+    {
+        if (!m_Device) {
+            return;
+        }
+
+        m_FrameStamp += 1;
+        m_FrameIndex  = frameIndex;
+
+        ReleaseExpired();
+        ProcessFeedback(frameIndex);
+        RecordUploads(cmdBuffer, frameIndex);
+
+        for (Scope<VirtualTextureState>& state : m_Textures)
+        {
+            if (Ref<VulkanVirtualTexture> texture = state->Texture.lock()) {
+                texture->m_Params.FrameInfo.x = m_FrameStamp;
+            }
+        }
+    }
+
+    void VulkanVirtualTextureSystem::EndFrame(VkCommandBuffer cmdBuffer)
+    {
+        if (!m_Device || m_FeedbackUsed == 0) {
+            return;
+        }
+
+        const VkDeviceSize size = (VkDeviceSize)m_FeedbackUsed * sizeof(uint32);
+
+        BufferPipelineBarrier(cmdBuffer, m_FeedbackBuffer->Buffer, size,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkBufferCopy region = {};
+        region.size = size;
+        vkCmdCopyBuffer(cmdBuffer, m_FeedbackBuffer->Buffer, m_Readbacks[m_FrameIndex]->Buffer, 1, &region);
+
+        // 下一帧的shader在拷贝读完之后再写
+        BufferPipelineBarrier(cmdBuffer, m_FeedbackBuffer->Buffer, size,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        BufferPipelineBarrier(cmdBuffer, m_Readbacks[m_FrameIndex]->Buffer, size,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+
+        m_ReadbackStamps[m_FrameIndex] = m_FrameStamp;
+    }
+
+    VulkanVirtualTextureStats VulkanVirtualTextureSystem::GetStats() const
+    {
+        VulkanVirtualTextureStats stats;
+        stats.NumTextures   = (uint32)m_Textures.size();
+        stats.NumSlots      = (uint32)m_Slots.size();
+        stats.NumResident   = (uint32)(m_Slots.size() - m_FreeSlots.size());
+        stats.NumRequested  = m_NumRequested;
+        stats.UploadedPages = m_UploadedPages;
+        stats.NumEvictions  = m_NumEvictions;
+
+        for (const Scope<VirtualTextureState>& state : m_Textures) {
+            stats.NumLoading += state->NumLoading;
+        }
+        return stats;
+    }
+
+    void VulkanVirtualTextureSystem::LoaderThread()
+    {
+        while (true)
+        {
+            LoadRequest request;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this]() { return m_Quit || !m_Requests.empty(); });
+                if (m_Quit) {
+                    return;
+                }
+                request = m_Requests.front();
+                m_Requests.pop_front();
+            }
+
+            // 请求出队之后NumLoading还没减，状态不会被释放
+            LoadResult result;
+            result.Request = request;
+            result.Data.resize(request.State->File.GetPageBytes());
+            result.Succeeded = request.State->File.ReadPage(request.Mip, request.X, request.Y, result.Data.data());
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Results.push_back(std::move(result));
+            }
+        }
+    }
+
+    void VulkanVirtualTextureSystem::ProcessFeedback(uint32 frameIndex)
+    {
+        // 这个槽位上一次的帧在Acquire时已经执行完
+        const uint32 stamp = m_ReadbackStamps[frameIndex];
+        if (stamp == 0) {
+            return;
+        }
+        m_ReadbackStamps[frameIndex] = 0;
+        m_LastSeenStamp = std::max(m_LastSeenStamp, stamp);
+
+        // 还没开始读的请求收回来，和这次的请求一起重新排
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto keep = std::remove_if(m_Requests.begin(), m_Requests.end(), [](const LoadRequest& request)
+            {
+                VirtualTextureState& state = *request.State;
+                if (request.Mip + 1 == (uint32)state.File.Mips.size()) {
+                    return false;
+                }
+                state.PageStates[request.Page] = PAGE_EMPTY;
+                state.NumLoading -= 1;
+                return true;
+            });
+            m_Requests.erase(keep, m_Requests.end());
+        }
+
+        const uint32* stamps = (const uint32*)m_Readbacks[frameIndex]->Mapped;
+        std::vector<LoadRequest> requests;
+        m_NumRequested = 0;
+
+        for (Scope<VirtualTextureState>& statePtr : m_Textures)
+        {
+            VirtualTextureState& state = *statePtr;
+            if (state.Released) {
+                continue;
+            }
+
+            const std::vector<VirtualTextureFile::Mip>& mips = state.File.Mips;
+            const uint32 numMips = (uint32)mips.size();
+            const uint32* textureStamps = stamps + state.FeedbackOffset;
+
+            for (uint32 mip = 0; mip < numMips; ++mip)
+            {
+                for (uint32 pageY = 0; pageY < mips[mip].PagesY; ++pageY)
+                {
+                    for (uint32 pageX = 0; pageX < mips[mip].PagesX; ++pageX)
+                    {
+                        if (textureStamps[mips[mip].FirstPage + pageY * mips[mip].PagesX + pageX] != stamp) {
+                            continue;
+                        }
+                        m_NumRequested += 1;
+
+                        // 一直往上找到已经常驻的祖先，路上没加载的页都请求，采样回退到的那一页记为用过
+                        for (uint32 level = mip, x = pageX, y = pageY; level < numMips; ++level)
+                        {
+                            const uint32 page = mips[level].FirstPage + y * mips[level].PagesX + x;
+                            if (state.PageStates[page] == PAGE_RESIDENT)
+                            {
+                                m_Slots[state.PageSlots[page]].LastUsed = stamp;
+                                break;
+                            }
+
+                            if (state.PageStates[page] == PAGE_EMPTY)
+                            {
+                                LoadRequest request;
+                                request.State = &state;
+                                request.Page  = page;
+                                request.Mip   = level;
+                                request.X     = x;
+                                request.Y     = y;
+                                requests.push_back(request);
+                            }
+
+                            if (level + 1 < numMips)
+                            {
+                                x = std::min(x >> 1, mips[level + 1].PagesX - 1);
+                                y = std::min(y >> 1, mips[level + 1].PagesY - 1);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // 粗的先加载，保证回退的页尽快就位；同一个祖先会被多个子页请求
+        std::sort(requests.begin(), requests.end(), [](const LoadRequest& a, const LoadRequest& b)
+        {
+            if (a.Mip != b.Mip) {
+                return a.Mip > b.Mip;
+            }
+            return a.State != b.State ? a.State < b.State : a.Page < b.Page;
+        });
+        requests.erase(std::unique(requests.begin(), requests.end(), [](const LoadRequest& a, const LoadRequest& b)
+        {
+            return a.State == b.State && a.Page == b.Page;
+        }), requests.end());
+
+        uint32 numPending = 0;
+        for (Scope<VirtualTextureState>& state : m_Textures) {
+            numPending += state->NumLoading;
+        }
+
+        const uint32 numAllowed = numPending < MAX_PENDING_LOADS ? std::min((uint32)MAX_PENDING_LOADS - numPending, (uint32)MAX_REQUESTS_PER_FRAME) : 0;
+        if (requests.size() > numAllowed) {
+            requests.resize(numAllowed);
+        }
+
+        if (requests.empty()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (const LoadRequest& request : requests)
+            {
+                request.State->PageStates[request.Page] = PAGE_LOADING;
+                request.State->NumLoading += 1;
+                m_Requests.push_back(request);
+            }
+        }
+        m_Condition.notify_one();
+    }
+
+    void VulkanVirtualTextureSystem::RecordUploads(VkCommandBuffer cmdBuffer, uint32 frameIndex)
+    {
+        std::vector<LoadResult> results;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            while (!m_Results.empty() && results.size() < MAX_UPLOADS_PER_FRAME)
+            {
+                results.push_back(std::move(m_Results.front()));
+                m_Results.pop_front();
+            }
+        }
+
+        // 先在CPU上分配槽位并更新页表副本，淘汰的页也在这里改掉页表
+        std::vector<std::pair<const LoadResult*, int32>> uploads;
+        for (const LoadResult& result : results)
+        {
+            VirtualTextureState& state = *result.Request.State;
+            state.NumLoading -= 1;
+            state.PageStates[result.Request.Page] = PAGE_EMPTY;
+
+            if (state.Released) {
+                continue;
+            }
+
+            if (!result.Succeeded)
+            {
+                RE_CORE_ERROR("Failed to read virtual texture page {0} ({1}, {2}) mip {3}", result.Request.Page, result.Request.X, result.Request.Y, result.Request.Mip);
+                continue;
+            }
+
+            // 缓存里都是刚用过的页时放弃这一页，还看得到的话之后会再请求
+            const int32 slot = AllocateSlot();
+            if (slot < 0) {
+                continue;
+            }
+
+            MapPage(state, result.Request.Mip, result.Request.X, result.Request.Y, slot);
+            uploads.emplace_back(&result, slot);
+        }
+
+        const uint64 pageBytes = (uint64)PAGE_SIZE * PAGE_SIZE * 4;
+        uint64 stagingSize = uploads.size() * pageBytes;
+        for (Scope<VirtualTextureState>& state : m_Textures)
+        {
+            for (uint32 mip = 0; mip < (uint32)state->PageTableMips.size(); ++mip)
+            {
+                if (state->DirtyMips & (1u << mip)) {
+                    stagingSize += Align((uint64)state->PageTableMips[mip].size() * sizeof(uint32), (uint64)16);
+                }
+            }
+        }
+
+        if (stagingSize == 0) {
+            return;
+        }
+
+        // 这个槽位上一次的帧已经执行完，Staging可以直接覆盖
+        Ref<VulkanBuffer>& staging = m_Stagings[frameIndex];
+        if (!staging || staging->Size < stagingSize)
+        {
+            if (staging) {
+                staging->UnMap();
+            }
+            staging = VulkanBuffer::CreateBuffer(
+                m_Device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                std::max(stagingSize, (uint64)MAX_UPLOADS_PER_FRAME * pageBytes));
+            staging->Map();
+        }
+        uint8* mapped = (uint8*)staging->Mapped;
+        uint64 stagingOffset = 0;
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.levelCount = 1;
+        subresourceRange.layerCount = 1;
+
+        if (!uploads.empty())
+        {
+            std::vector<VkBufferImageCopy> copyRegions(uploads.size());
+            for (uint32 index = 0; index < (uint32)uploads.size(); ++index)
+            {
+                const int32 slot = uploads[index].second;
+                std::memcpy(mapped + stagingOffset, uploads[index].first->Data.data(), pageBytes);
+
+                VkBufferImageCopy& region = copyRegions[index];
+                region = {};
+                region.bufferOffset                = stagingOffset;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.layerCount = 1;
+                region.imageOffset                 = { (int32)((slot % m_SlotsPerAxis) * PAGE_SIZE), (int32)((slot / m_SlotsPerAxis) * PAGE_SIZE), 0 };
+                region.imageExtent                 = { (uint32)PAGE_SIZE, (uint32)PAGE_SIZE, 1 };
+
+                stagingOffset += pageBytes;
+            }
+
+            // 屏障的前一半包含之前提交的帧，被覆盖的槽位不会还在被它们采样
+            ImagePipelineBarrier(cmdBuffer, m_PhysicalCache->Image, ImageLayoutBarrier::PixelShaderRead, ImageLayoutBarrier::TransferDest, subresourceRange);
+            vkCmdCopyBufferToImage(cmdBuffer, staging->Buffer, m_PhysicalCache->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32)copyRegions.size(), copyRegions.data());
+            ImagePipelineBarrier(cmdBuffer, m_PhysicalCache->Image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::PixelShaderRead, subresourceRange);
+
+            m_UploadedPages += uploads.size();
+        }
+
+        std::vector<VkBufferImageCopy> tableRegions;
+        for (Scope<VirtualTextureState>& state : m_Textures)
+        {
+            if (state->DirtyMips == 0) {
+                continue;
+            }
+
+            tableRegions.clear();
+            const uint32 numMips = (uint32)state->PageTableMips.size();
+            for (uint32 mip = 0; mip < numMips; ++mip)
+            {
+                if ((state->DirtyMips & (1u << mip)) == 0) {
+                    continue;
+                }
+
+                const std::vector<uint32>& texels = state->PageTableMips[mip];
+                std::memcpy(mapped + stagingOffset, texels.data(), texels.size() * sizeof(uint32));
+
+                VkBufferImageCopy region = {};
+                region.bufferOffset                = stagingOffset;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel   = mip;
+                region.imageSubresource.layerCount = 1;
+                region.imageExtent                 = { state->PageTableSizes[mip].x, state->PageTableSizes[mip].y, 1 };
+                tableRegions.push_back(region);
+
+                stagingOffset += Align((uint64)texels.size() * sizeof(uint32), (uint64)16);
+            }
+            state->DirtyMips = 0;
+
+            subresourceRange.levelCount = numMips;
+            ImagePipelineBarrier(cmdBuffer, state->PageTable->Image, ImageLayoutBarrier::PixelShaderRead, ImageLayoutBarrier::TransferDest, subresourceRange);
+            vkCmdCopyBufferToImage(cmdBuffer, staging->Buffer, state->PageTable->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32)tableRegions.size(), tableRegions.data());
+            ImagePipelineBarrier(cmdBuffer, state->PageTable->Image, ImageLayoutBarrier::TransferDest, ImageLayoutBarrier::PixelShaderRead, subresourceRange);
+        }
+    }
+
+    void VulkanVirtualTextureSystem::ReleaseExpired()
+    {
+        for (Scope<VirtualTextureState>& statePtr : m_Textures)
+        {
+            VirtualTextureState& state = *statePtr;
+            if (state.Released || !state.Texture.expired()) {
+                continue;
+            }
+            state.Released = true;
+
+            for (int32 slot = 0; slot < (int32)m_Slots.size(); ++slot)
+            {
+                if (m_Slots[slot].State == &state)
+                {
+                    m_Slots[slot] = CacheSlot();
+                    m_FreeSlots.push_back(slot);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto keep = std::remove_if(m_Requests.begin(), m_Requests.end(), [&state](const LoadRequest& request)
+            {
+                return request.State == &state;
+            });
+            state.NumLoading -= (uint32)std::distance(keep, m_Requests.end());
+            m_Requests.erase(keep, m_Requests.end());
+        }
+
+        // 加载线程和结果队列里都不再引用时才删掉
+        m_Textures.erase(std::remove_if(m_Textures.begin(), m_Textures.end(), [](const Scope<VirtualTextureState>& state)
+        {
+            return state->Released && state->NumLoading == 0;
+        }), m_Textures.end());
+    }
+
+    int32 VulkanVirtualTextureSystem::AllocateSlot()
+    {
+        if (!m_FreeSlots.empty())
+        {
+            const int32 slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+            return slot;
+        }
+
+        // 最近一次读回的反馈里用到的页和读回之后才放进来的页都不淘汰
+        int32 victim = -1;
+        for (int32 slot = 0; slot < (int32)m_Slots.size(); ++slot)
+        {
+            const CacheSlot& cacheSlot = m_Slots[slot];
+            if (cacheSlot.Pinned || cacheSlot.LastUsed >= m_LastSeenStamp) {
+                continue;
+            }
+
+            if (victim < 0 || cacheSlot.LastUsed < m_Slots[victim].LastUsed) {
+                victim = slot;
+            }
+        }
+
+        if (victim >= 0)
+        {
+            UnmapPage(victim);
+            m_NumEvictions += 1;
+        }
+        return victim;
+    }
+
+    void VulkanVirtualTextureSystem::MapPage(VirtualTextureState& state, uint32 mip, uint32 x, uint32 y, int32 slot)
+    {
+        const uint32 page = GetMipFirstPage(state, mip) + y * state.File.Mips[mip].PagesX + x;
+
+        CacheSlot& cacheSlot = m_Slots[slot];
+        cacheSlot.State    = &state;
+        cacheSlot.Page     = page;
+        cacheSlot.Mip      = mip;
+        cacheSlot.X        = x;
+        cacheSlot.Y        = y;
+        cacheSlot.LastUsed = m_FrameStamp;
+        cacheSlot.Pinned   = mip + 1 == (uint32)state.File.Mips.size();
+
+        state.PageSlots[page]  = slot;
+        state.PageStates[page] = PAGE_RESIDENT;
+
+        FillPageTable(state, mip, x, y, PackPageEntry(slot % m_SlotsPerAxis, slot / m_SlotsPerAxis, mip), ~0u);
+    }
+
+    void VulkanVirtualTextureSystem::UnmapPage(int32 slot)
+    {
+        CacheSlot& cacheSlot = m_Slots[slot];
+        VirtualTextureState& state = *cacheSlot.State;
+        const std::vector<VirtualTextureFile::Mip>& mips = state.File.Mips;
+
+        // 上一级页表里存的就是父页所在位置最精细的常驻页
+        uint32 entry = 0;
+        const uint32 parentMip = cacheSlot.Mip + 1;
+        if (parentMip < (uint32)mips.size())
+        {
+            const uint32 parentX = std::min(cacheSlot.X >> 1, mips[parentMip].PagesX - 1);
+            const uint32 parentY = std::min(cacheSlot.Y >> 1, mips[parentMip].PagesY - 1);
+            entry = state.PageTableMips[parentMip][parentY * state.PageTableSizes[parentMip].x + parentX];
+        }
+
+        FillPageTable(state, cacheSlot.Mip, cacheSlot.X, cacheSlot.Y, entry, cacheSlot.Mip);
+
+        state.PageSlots[cacheSlot.Page]  = -1;
+        state.PageStates[cacheSlot.Page] = PAGE_EMPTY;
+        cacheSlot = CacheSlot();
+    }
+
+    void VulkanVirtualTextureSystem::FillPageTable(VirtualTextureState& state, uint32 mip, uint32 x, uint32 y, uint32 entry, uint32 fromMip)
+    {
+        const std::vector<VirtualTextureFile::Mip>& mips = state.File.Mips;
+
+        // 第level级的页p在第mip级的祖先是min(p >> (mip - level), 页数 - 1)，shader里按同样的规则找
+        for (uint32 level = 0; level <= mip; ++level)
+        {
+            const uint32 shift = mip - level;
+            const uint32 beginX = x << shift;
+            const uint32 beginY = y << shift;
+            const uint32 endX = x + 1 == mips[mip].PagesX ? mips[level].PagesX : std::min((x + 1) << shift, mips[level].PagesX);
+            const uint32 endY = y + 1 == mips[mip].PagesY ? mips[level].PagesY : std::min((y + 1) << shift, mips[level].PagesY);
+
+            std::vector<uint32>& texels = state.PageTableMips[level];
+            const uint32 rowPitch = state.PageTableSizes[level].x;
+            bool changed = false;
+
+            for (uint32 texelY = beginY; texelY < endY; ++texelY)
+            {
+                for (uint32 texelX = beginX; texelX < endX; ++texelX)
+                {
+                    uint32& texel = texels[texelY * rowPitch + texelX];
+                    const bool replace = fromMip == ~0u ?
+                        (!IsEntryValid(texel) || GetEntryMip(texel) > mip) :
+                        (IsEntryValid(texel) && GetEntryMip(texel) == fromMip);
+
+                    if (replace)
+                    {
+                        texel = entry;
+                        changed = true;
+                    }
+                }
+            }
+
+            if (changed) {
+                state.DirtyMips |= 1u << level;
+            }
+        }
+    }
+
+    uint32 VulkanVirtualTextureSystem::GetMipFirstPage(const VirtualTextureState& state, uint32 mip)
+    {
+        return state.File.Mips[mip].FirstPage;
+    }
+}
@@ -0,0 +1,238 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "VulkanCommonDefine.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffers/VulkanTexture.h"
+#include "VulkanBuffers/VulkanBuffer.h"
+#include "VulkanBuffers/VulkanCommandBuffer.h"
+#include "Resource/Texture/VirtualTextureFile.h"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ReEngine
+{
+    // 一张虚拟贴图，shader里用lib/VirtualTexture.h的SampleVirtualTexture采样
+    // 绑定页表、VulkanVirtualTextureSystem的物理缓存和反馈Buffer，Params每帧都要重新写，里面有帧标记
+    class VulkanVirtualTexture
+    {
+    public:
+        enum
+        {
+            MAX_MIPS = 16,
+        };
+
+        // 和lib/VirtualTexture.h里的VirtualTextureParams一致，std140
+        struct Params
+        {
+            glm::uvec4  PageInfo;       // 宽, 高, Mip数, 反馈区间起点
+            glm::uvec4  CacheInfo;      // TileSize, Border, 页边长, 物理缓存边长
+            glm::uvec4  FrameInfo;      // x是这一帧的标记
+            glm::uvec4  MipFirstPage[MAX_MIPS / 4];
+        };
+
+        FORCE_INLINE const Ref<VulkanTexture>& GetPageTable() const
+        {
+            return m_PageTable;
+        }
+
+        FORCE_INLINE const Params& GetParams() const
+        {
+            return m_Params;
+        }
+
+        FORCE_INLINE uint32 GetWidth() const
+        {
+            return m_Params.PageInfo.x;
+        }
+
+        FORCE_INLINE uint32 GetHeight() const
+        {
+            return m_Params.PageInfo.y;
+        }
+
+    private:
+        friend class VulkanVirtualTextureSystem;
+
+        // R8G8B8A8_UINT，每级Mip一个像素对应一页：缓存槽位x, y, 实际常驻的Mip, 是否有效
+        Ref<VulkanTexture>  m_PageTable;
+        Params              m_Params = {};
+    };
+
+    struct VulkanVirtualTextureStats
+    {
+        uint32 NumTextures      = 0;
+        uint32 NumSlots         = 0;
+        uint32 NumResident      = 0;
+        uint32 NumLoading       = 0;
+        // 最近一次读回的反馈里请求的页
+        uint32 NumRequested     = 0;
+        uint64 UploadedPages    = 0;
+        uint64 NumEvictions     = 0;
+    };
+
+    // 软件虚拟贴图：大贴图按页存在.rvt里，只有看得到的页放进固定大小的物理缓存，显存占用和贴图大小无关
+    // 采样时shader按导数选Mip，把这一页写进反馈Buffer，再查页表映射到物理缓存；页不在时用页表里最精细的已加载祖先
+    // 帧结束前把反馈拷到这个帧槽位的回读Buffer，下一次用这个槽位时读回，请求的页交给加载线程读文件
+    // 读好的页在帧开始时录进帧CommandBuffer，每帧最多MAX_UPLOADS_PER_FRAME页，缓存满了按最近使用帧淘汰，最粗的一级常驻
+    // 所有贴图的页边长必须和缓存槽位一样大；只在主线程调用
+    class VulkanVirtualTextureSystem
+    {
+    public:
+        enum
+        {
+            DEFAULT_CACHE_SIZE      = 4096,
+            PAGE_SIZE               = VirtualTextureFile::DEFAULT_TILE_SIZE + VirtualTextureFile::DEFAULT_BORDER * 2,
+            // 反馈Buffer的uint个数，所有贴图的页数加起来不能超过它
+            FEEDBACK_CAPACITY       = 1 << 20,
+            MAX_UPLOADS_PER_FRAME   = 32,
+            MAX_REQUESTS_PER_FRAME  = 64,
+            // 排队加上正在读的页的上限
+            MAX_PENDING_LOADS       = 256,
+        };
+
+        void Init(Ref<VulkanDevice> device, uint32 numFramesInFlight, uint32 cacheSize = DEFAULT_CACHE_SIZE);
+
+        void Destroy();
+
+        // filename是.rvt，或者是原图，这时用同目录下的.rvt，没有就先烘焙一份
+        // cmdBuffer用来清空页表，第一次调用时也清空物理缓存和反馈Buffer
+        Ref<VulkanVirtualTexture> CreateTexture(const std::string& filename, Ref<VulkanCommandBuffer> cmdBuffer);
+
+        // 帧CommandBuffer Begin之后、任何Pass之前调用：读回反馈、发起加载，录制这一帧的页上传和页表更新
+        void BeginFrame(VkCommandBuffer cmdBuffer, uint32 frameIndex);
+
+        // 帧CommandBuffer End之前调用：把反馈拷到这个槽位的回读Buffer
+        void EndFrame(VkCommandBuffer cmdBuffer);
+
+        FORCE_INLINE const Ref<VulkanTexture>& GetPhysicalCache() const
+        {
+            return m_PhysicalCache;
+        }
+
+        FORCE_INLINE const Ref<VulkanBuffer>& GetFeedbackBuffer() const
+        {
+            return m_FeedbackBuffer;
+        }
+
+        VulkanVirtualTextureStats GetStats() const;
+
+    private:
+        enum PageState : uint8
+        {
+            PAGE_EMPTY = 0,
+            PAGE_LOADING,
+            PAGE_RESIDENT,
+        };
+
+        struct VirtualTextureState
+        {
+            std::weak_ptr<VulkanVirtualTexture> Texture;
+            Ref<VulkanTexture>              PageTable;
+            // 文件头在主线程上只读，ReadPage只在加载线程上调用
+            VirtualTextureFile              File;
+            uint32                          FeedbackOffset = 0;
+
+            // 按全局页号
+            std::vector<int32>              PageSlots;
+            std::vector<uint8>              PageStates;
+
+            // 页表的CPU副本，按Mip存，有变化的Mip整级上传
+            std::vector<std::vector<uint32>> PageTableMips;
+            std::vector<glm::uvec2>         PageTableSizes;
+            uint32                          DirtyMips = 0;
+
+            uint32                          NumLoading = 0;
+            bool                            Released = false;
+        };
+
+        struct CacheSlot
+        {
+            VirtualTextureState*            State = nullptr;
+            uint32                          Page = 0;
+            uint32                          Mip = 0;
+            uint32                          X = 0;
+            uint32                          Y = 0;
+            uint32                          LastUsed = 0;
+            // 最粗一级的页不淘汰，任何地方都至少有它可以采样
+            bool                            Pinned = false;
+        };
+
+        struct LoadRequest
+        {
+            VirtualTextureState*            State = nullptr;
+            uint32                          Page = 0;
+            uint32                          Mip = 0;
+            uint32                          X = 0;
+            uint32                          Y = 0;
+        };
+
+        struct LoadResult
+        {
+            LoadRequest                     Request;
+            std::vector<uint8>              Data;
+            bool                            Succeeded = false;
+        };
+
+        void LoaderThread();
+
+        void ProcessFeedback(uint32 frameIndex);
+
+        void RecordUploads(VkCommandBuffer cmdBuffer, uint32 frameIndex);
+
+        void ReleaseExpired();
+
+        int32 AllocateSlot();
+
+        void MapPage(VirtualTextureState& state, uint32 mip, uint32 x, uint32 y, int32 slot);
+
+        void UnmapPage(int32 slot);
+
+        // 页(mip, x, y)覆盖的各级页表像素里，常驻Mip等于fromMip的改成entry；fromMip为~0u时只改比mip更粗或无效的像素
+        void FillPageTable(VirtualTextureState& state, uint32 mip, uint32 x, uint32 y, uint32 entry, uint32 fromMip);
+
+        static uint32 GetMipFirstPage(const VirtualTextureState& state, uint32 mip);
+
+    private:
+        Ref<VulkanDevice>               m_Device;
+        uint32                          m_NumFramesInFlight = 0;
+        uint32                          m_CacheSize = 0;
+        uint32                          m_SlotsPerAxis = 0;
+
+        Ref<VulkanTexture>              m_PhysicalCache;
+        bool                            m_CacheCleared = false;
+        std::vector<CacheSlot>          m_Slots;
+        std::vector<int32>              m_FreeSlots;
+
+        Ref<VulkanBuffer>               m_FeedbackBuffer;
+        uint32                          m_FeedbackUsed = 0;
+        // 每个帧槽位一份，记录拷贝时的帧标记
+        std::vector<Ref<VulkanBuffer>>  m_Readbacks;
+        std::vector<uint32>             m_ReadbackStamps;
+        // 页数据和页表的上传，每个帧槽位一份，不够时重建
+        std::vector<Ref<VulkanBuffer>>  m_Stagings;
+
+        std::vector<Scope<VirtualTextureState>> m_Textures;
+
+        uint32                          m_FrameStamp = 0;
+        uint32                          m_FrameIndex = 0;
+        uint32                          m_LastSeenStamp = 0;
+
+        std::thread                     m_Thread;
+        std::mutex                      m_Mutex;
+        std::condition_variable         m_Condition;
+        std::deque<LoadRequest>         m_Requests;
+        std::deque<LoadResult>          m_Results;
+        bool                            m_Quit = false;
+
+        uint32                          m_NumRequested = 0;
+        uint64                          m_UploadedPages = 0;
+        uint64                          m_NumEvictions = 0;
+    };
+}
@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 #include "SceneGraph.h"
 #include "Core/Core.h"
 #include "Platform/Vulkan/VulkanBuffers/VulkanBuffer.h"
@@ -10,8 +10,10 @@ namespace ReEngine
     static const uint16 k_invalid_scene_texture_index      = UINT16_MAX;
     static const uint32 k_material_descriptor_set_index    = 1;
 
-    static bool recreate_per_thread_descriptors = false;
-    static bool use_secondary_command_buffers   = false;
+    // 全局开关，所有编译单元共用一份
+    inline bool recreate_per_thread_descriptors = false;
+    // 打开后DrawList按块分给工作线程录进Secondary CommandBuffer，见VulkanParallelRecorder
+    inline bool use_secondary_command_buffers   = false;
     
     enum DrawFlags
     {
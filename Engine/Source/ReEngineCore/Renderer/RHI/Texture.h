@@ -17,6 +17,11 @@ namespace ReEngine
         virtual uint32_t GetRendererID() const = 0;
 
         virtual void SetData(void* data,uint32_t size){};
+        // 更新一块子区域，data是紧密排列的width*height个像素；目前只有OpenGL实现
+        virtual void SetSubData(void* data,uint32_t x,uint32_t y,uint32_t width,uint32_t height)
+        {
+            RE_CORE_ASSERT(false, "Texture::SetSubData is not implemented for this RendererAPI!");
+        }
         virtual void Bind(uint32_t slot = 0)const = 0;
         virtual void UnBind() const = 0;
 
@@ -0,0 +1,77 @@
+﻿#include "TextureAtlas2D.h"
+#include "Resource/AssetManager/AssetManager.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+
+namespace ReEngine
+{
+    TextureAtlas2D::TextureAtlas2D(uint32 pageSize)
+        :mPageSize(pageSize)
+    {
+        mPacker.Init(pageSize, pageSize, PADDING);
+    }
+
+    Ref<SubTexture2D> TextureAtlas2D::Add(const std::string& path)
+    {
+        int Width,Height,Channels;
+        stbi_set_flip_vertically_on_load(1);
+        stbi_uc* data = stbi_load(AssetManager::GetFullPath(path).c_str(), &Width, &Height, &Channels, 4);
+        if (!data)
+        {
+            RE_CORE_ERROR("Failed to Load Image : {0}", path.c_str());
+            return nullptr;
+        }
+
+        Ref<SubTexture2D> subTexture = Add(data, Width, Height);
+        stbi_image_free(data);
+        return subTexture;
+    }
+
+    Ref<SubTexture2D> TextureAtlas2D::Add(const uint8* rgba, uint32 width, uint32 height)
+    {
+        TextureAtlasRect rect;
+        if (!mPacker.Insert(width, height, rect))
+        {
+            RE_CORE_WARN("Image {0}x{1} does not fit into atlas page {2}.", width, height, mPageSize);
+            return nullptr;
+        }
+
+        while (mPages.size() <= rect.Layer)
+        {
+            // Vulkan还没有Texture2D的实现，建不出页时直接失败
+            Ref<Texture2D> page = Texture2D::Create(mPageSize, mPageSize);
+            if (!page)
+            {
+                RE_CORE_ERROR("TextureAtlas2D needs a Texture2D backend, the current RendererAPI has none.");
+                return nullptr;
+            }
+            std::vector<uint32> clearData((size_t)mPageSize * mPageSize, 0);
+            page->SetData(clearData.data(), mPageSize * mPageSize * 4);
+            mPages.push_back(page);
+        }
+
+        // 连同边距一起上传，边距复制最近的边缘像素
+        const uint32 padding      = mPacker.GetPadding();
+        const uint32 paddedWidth  = width + padding * 2;
+        const uint32 paddedHeight = height + padding * 2;
+        std::vector<uint32> padded((size_t)paddedWidth * paddedHeight);
+        for (uint32 y = 0; y < paddedHeight; ++y)
+        {
+            const uint32 srcY = (uint32)glm::clamp((int32)y - (int32)padding, 0, (int32)height - 1);
+            for (uint32 x = 0; x < paddedWidth; ++x)
+            {
+                const uint32 srcX = (uint32)glm::clamp((int32)x - (int32)padding, 0, (int32)width - 1);
+                std::memcpy(&padded[(size_t)y * paddedWidth + x], rgba + ((size_t)srcY * width + srcX) * 4, 4);
+            }
+        }
+
+        const Ref<Texture2D>& page = mPages[rect.Layer];
+        page->SetSubData(padded.data(), rect.X - padding, rect.Y - padding, paddedWidth, paddedHeight);
+
+        const glm::vec2 min = { (float)rect.X / mPageSize, (float)rect.Y / mPageSize };
+        const glm::vec2 max = { (float)(rect.X + width) / mPageSize, (float)(rect.Y + height) / mPageSize };
+        return CreateRef<SubTexture2D>(page, min, max);
+    }
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include "Texture.h"
+#include "SubTexture2D.h"
+#include "Resource/Texture/TextureAtlasPacker.h"
+
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    // 运行时图集：小图打包进几张共享的大页，返回指向页内子区域的SubTexture2D
+    // Renderer2D按页占TextureSlots，成百上千张精灵只占几个槽位，不会每32张就Flush一次
+    // 边距用图片边缘像素外扩，线性过滤不会采到相邻的图；子区域不能用tilingFactor平铺
+    class TextureAtlas2D
+    {
+    public:
+        enum
+        {
+            DEFAULT_PAGE_SIZE = 2048,
+            PADDING = 2,
+        };
+
+        TextureAtlas2D(uint32 pageSize = DEFAULT_PAGE_SIZE);
+
+        // 路径相对引擎根目录，和Texture2D::Create一样加载时上下翻转；失败或者比页大时返回nullptr
+        Ref<SubTexture2D> Add(const std::string& path);
+
+        // rgba是紧密排列的RGBA8像素
+        Ref<SubTexture2D> Add(const uint8* rgba, uint32 width, uint32 height);
+
+        const std::vector<Ref<Texture2D>>& GetPages() const { return mPages; }
+
+        float GetOccupancy() const { return mPacker.GetOccupancy(); }
+
+    private:
+        uint32 mPageSize;
+        TextureAtlasPacker mPacker;
+        std::vector<Ref<Texture2D>> mPages;
+    };
+}
@@ -190,46 +190,12 @@ namespace ReEngine
     
     void Renderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size, const Ref<Texture2D>& texture,float tilingFactor, const glm::vec4& tintColor)
     {
-        constexpr size_t quadVertexCount = 4;
         constexpr glm::vec2 textureCoords[] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
 
-        if (s_Data->QuadIndexCount >= Renderer2DData::MaxIndices)
-            FlushAndReset();
-
-        float textureIndex = 0.0f;
-        for (uint32_t i = 1; i < s_Data->TextureSlotIndex; i++)
-        {
-            if (*s_Data->TextureSlots[i].get() == *texture.get())
-            {
-                textureIndex = (float)i;
-                break;
-            }
-        }
-
-        if (textureIndex == 0.0f)
-        {
-            if (s_Data->TextureSlotIndex >= Renderer2DData::MaxTextureSlots)
-                FlushAndReset();
-
-            textureIndex = (float)s_Data->TextureSlotIndex;
-            s_Data->TextureSlots[s_Data->TextureSlotIndex] = texture;
-            s_Data->TextureSlotIndex++;
-        }
-
         glm::mat4 transform = glm::translate(glm::mat4(1.0f), position)
             * glm::scale(glm::mat4(1.0f), { size.x, size.y, 1.0f });
 
-        for (size_t i = 0; i < quadVertexCount; i++)
-        {
-            s_Data->QuadVertexBufferPtr->position = transform * s_Data->QuadVertexPositions[i];
-            s_Data->QuadVertexBufferPtr->color = tintColor;
-            s_Data->QuadVertexBufferPtr->texCoord = textureCoords[i];
-            s_Data->QuadVertexBufferPtr->texIndex = textureIndex;
-            s_Data->QuadVertexBufferPtr->tilingFactor = tilingFactor;
-            s_Data->QuadVertexBufferPtr++;
-        }
-
-        s_Data->QuadIndexCount += 6;
+        DrawTexturedQuad(transform, texture, textureCoords, tilingFactor, tintColor);
     }
 
     void Renderer2D::DrawQuad(const glm::vec2& position, const glm::vec2& size, const Ref<SubTexture2D>& texture,
@@ -313,6 +279,52 @@ namespace ReEngine
         s_Data->QuadIndexCount += 6;
     }
 
+    void Renderer2D::DrawQuad(const glm::mat4& transform, const Ref<SubTexture2D>& subtexture, const glm::vec4& tintColor)
+    {
+        // 图集里的子区域不能平铺
+        DrawTexturedQuad(transform, subtexture->GetTexture(), subtexture->GetTexCoords(), 1.0f, tintColor);
+    }
+
+    void Renderer2D::DrawTexturedQuad(const glm::mat4& transform, const Ref<Texture2D>& texture, const glm::vec2* textureCoords, float tilingFactor, const glm::vec4& tintColor)
+    {
+        constexpr size_t quadVertexCount = 4;
+
+        if (s_Data->QuadIndexCount >= Renderer2DData::MaxIndices)
+            FlushAndReset();
+
+        float textureIndex = 0.0f;
+        for (uint32_t i = 1; i < s_Data->TextureSlotIndex; i++)
+        {
+            if (*s_Data->TextureSlots[i].get() == *texture.get())
+            {
+                textureIndex = (float)i;
+                break;
+            }
+        }
+
+        if (textureIndex == 0.0f)
+        {
+            if (s_Data->TextureSlotIndex >= Renderer2DData::MaxTextureSlots)
+                FlushAndReset();
+
+            textureIndex = (float)s_Data->TextureSlotIndex;
+            s_Data->TextureSlots[s_Data->TextureSlotIndex] = texture;
+            s_Data->TextureSlotIndex++;
+        }
+
+        for (size_t i = 0; i < quadVertexCount; i++)
+        {
+            s_Data->QuadVertexBufferPtr->position = transform * s_Data->QuadVertexPositions[i];
+            s_Data->QuadVertexBufferPtr->color = tintColor;
+            s_Data->QuadVertexBufferPtr->texCoord = textureCoords[i];
+            s_Data->QuadVertexBufferPtr->texIndex = textureIndex;
+            s_Data->QuadVertexBufferPtr->tilingFactor = tilingFactor;
+            s_Data->QuadVertexBufferPtr++;
+        }
+
+        s_Data->QuadIndexCount += 6;
+    }
+
     void Renderer2D::DrawRotateQuad(const glm::vec3& position, const glm::vec2& size, float Rotation,const Ref<SubTexture2D>& subtexture, float tilingFactor, const glm::vec4& tintColor)
     {
         constexpr size_t quadVertexCount = 4;
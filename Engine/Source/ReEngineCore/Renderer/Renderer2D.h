@@ -6,6 +6,7 @@
 
 namespace ReEngine
 {
+    // 同一批里最多MaxTextureSlots张贴图，精灵多时用TextureAtlas2D打包，画SubTexture2D
     class Renderer2D
     {
     public:
@@ -26,6 +27,7 @@ namespace ReEngine
         static void DrawQuad(const glm::vec2& position,const glm::vec2& size,const Ref<SubTexture2D>& texture,float tilingFactor = 1.0f, const glm::vec4& tintColor = glm::vec4(1.0f));
         static void DrawQuad(const glm::vec3& position,const glm::vec2& size,const Ref<SubTexture2D>& texture,float tilingFactor = 1.0f, const glm::vec4& tintColor = glm::vec4(1.0f));
         static void DrawQuad(const glm::mat4& transform,const glm::vec4& color);
+        static void DrawQuad(const glm::mat4& transform,const Ref<SubTexture2D>& subtexture,const glm::vec4& tintColor = glm::vec4(1.0f));
 
 
         static void DrawRotateQuad(const glm::vec2& position, const glm::vec2& size,float Rotation,const glm::vec4& color);
@@ -37,5 +39,7 @@ namespace ReEngine
 
     private:
         static void FlushAndReset();
+        // 带贴图的Quad共用的顶点写入，textureCoords是四个角的UV
+        static void DrawTexturedQuad(const glm::mat4& transform, const Ref<Texture2D>& texture, const glm::vec2* textureCoords, float tilingFactor, const glm::vec4& tintColor);
     };
 }
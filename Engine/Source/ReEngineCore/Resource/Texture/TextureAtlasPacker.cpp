@@ -0,0 +1,185 @@
+﻿#include "TextureAtlasPacker.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace ReEngine
+{
+    void TextureAtlasPacker::Init(uint32 pageWidth, uint32 pageHeight, uint32 padding, uint32 maxLayers)
+    {
+        m_PageWidth  = pageWidth;
+        m_PageHeight = pageHeight;
+        m_Padding    = padding;
+        m_MaxLayers  = maxLayers;
+        m_Pages.clear();
+    }
+
+    bool TextureAtlasPacker::Fit(const Page& page, uint32 index, uint32 width, uint32 height, uint32& outY) const
+    {
+        const uint32 x = page.Skyline[index].X;
+        if (x + width > m_PageWidth) {
+            return false;
+        }
+
+        // 矩形跨过的节点里最高的一个决定底边
+        uint32 y = 0;
+        uint32 remaining = width;
+        for (uint32 i = index; remaining > 0; ++i)
+        {
+            const SkylineNode& node = page.Skyline[i];
+            y = std::max(y, node.Y);
+            if (y + height > m_PageHeight) {
+                return false;
+            }
+            remaining -= std::min(remaining, node.Width);
+        }
+
+        outY = y;
+        return true;
+    }
+
+    bool TextureAtlasPacker::InsertIntoPage(Page& page, uint32 width, uint32 height, uint32& outX, uint32& outY)
+    {
+        uint32 bestIndex  = UINT32_MAX;
+        uint32 bestTop    = UINT32_MAX;
+        uint32 bestWidth  = UINT32_MAX;
+        uint32 bestY      = 0;
+
+        for (uint32 i = 0; i < (uint32)page.Skyline.size(); ++i)
+        {
+            uint32 y = 0;
+            if (!Fit(page, i, width, height, y)) {
+                continue;
+            }
+
+            // 顶边最低优先，一样高时选更窄的那段天际线，少留空隙
+            const uint32 top = y + height;
+            if (top < bestTop || (top == bestTop && page.Skyline[i].Width < bestWidth))
+            {
+                bestIndex = i;
+                bestTop   = top;
+                bestWidth = page.Skyline[i].Width;
+                bestY     = y;
+            }
+        }
+
+        if (bestIndex == UINT32_MAX) {
+            return false;
+        }
+
+        outX = page.Skyline[bestIndex].X;
+        outY = bestY;
+
+        // 新节点盖住后面被遮挡的部分
+        const SkylineNode newNode = { outX, bestTop, width };
+        page.Skyline.insert(page.Skyline.begin() + bestIndex, newNode);
+
+        for (uint32 i = bestIndex + 1; i < (uint32)page.Skyline.size();)
+        {
+            SkylineNode& node = page.Skyline[i];
+            const uint32 coveredEnd = newNode.X + newNode.Width;
+            if (node.X >= coveredEnd) {
+                break;
+            }
+
+            const uint32 shrink = coveredEnd - node.X;
+            if (shrink >= node.Width)
+            {
+                page.Skyline.erase(page.Skyline.begin() + i);
+                continue;
+            }
+
+            node.X     += shrink;
+            node.Width -= shrink;
+            break;
+        }
+
+        // 合并同高度的相邻节点
+        for (uint32 i = 0; i + 1 < (uint32)page.Skyline.size();)
+        {
+            if (page.Skyline[i].Y == page.Skyline[i + 1].Y)
+            {
+                page.Skyline[i].Width += page.Skyline[i + 1].Width;
+                page.Skyline.erase(page.Skyline.begin() + i + 1);
+                continue;
+            }
+            ++i;
+        }
+
+        page.UsedArea += (uint64)width * height;
+        return true;
+    }
+
+    bool TextureAtlasPacker::Insert(uint32 width, uint32 height, TextureAtlasRect& outRect)
+    {
+        const uint32 paddedWidth  = width + m_Padding * 2;
+        const uint32 paddedHeight = height + m_Padding * 2;
+        if (width == 0 || height == 0 || paddedWidth > m_PageWidth || paddedHeight > m_PageHeight) {
+            return false;
+        }
+
+        uint32 x = 0;
+        uint32 y = 0;
+        uint32 layer = 0;
+        for (; layer < (uint32)m_Pages.size(); ++layer)
+        {
+            if (InsertIntoPage(m_Pages[layer], paddedWidth, paddedHeight, x, y)) {
+                break;
+            }
+        }
+
+        if (layer == (uint32)m_Pages.size())
+        {
+            if (m_MaxLayers != 0 && layer >= m_MaxLayers) {
+                return false;
+            }
+
+            Page page;
+            page.Skyline.push_back({ 0, 0, m_PageWidth });
+            m_Pages.push_back(page);
+            InsertIntoPage(m_Pages.back(), paddedWidth, paddedHeight, x, y);
+        }
+
+        outRect.Layer  = layer;
+        outRect.X      = x + m_Padding;
+        outRect.Y      = y + m_Padding;
+        outRect.Width  = width;
+        outRect.Height = height;
+        return true;
+    }
+
+    std::vector<TextureAtlasRect> TextureAtlasPacker::InsertBatch(const std::vector<TextureAtlasRect>& sizes)
+    {
+        std::vector<uint32> order(sizes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&sizes](uint32 a, uint32 b)
+        {
+            if (sizes[a].Height != sizes[b].Height) {
+                return sizes[a].Height > sizes[b].Height;
+            }
+            return sizes[a].Width > sizes[b].Width;
+        });
+
+        std::vector<TextureAtlasRect> rects(sizes.size());
+        for (uint32 index : order)
+        {
+            if (!Insert(sizes[index].Width, sizes[index].Height, rects[index])) {
+                rects[index] = TextureAtlasRect();
+            }
+        }
+        return rects;
+    }
+
+    float TextureAtlasPacker::GetOccupancy() const
+    {
+        if (m_Pages.empty()) {
+            return 0.0f;
+        }
+
+        uint64 usedArea = 0;
+        for (const Page& page : m_Pages) {
+            usedArea += page.UsedArea;
+        }
+        return (float)((double)usedArea / ((double)m_PageWidth * m_PageHeight * m_Pages.size()));
+    }
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include "Core/Core.h"
+
+#include <vector>
+
+namespace ReEngine
+{
+    // 打包结果，X/Y是不含边距的左上角，Layer是页号，对应图集的第几页或数组贴图的第几层
+    struct TextureAtlasRect
+    {
+        uint32 Layer = 0;
+        uint32 X = 0;
+        uint32 Y = 0;
+        uint32 Width = 0;
+        uint32 Height = 0;
+    };
+
+    // Skyline Bottom-Left打包：每页记录一条从左到右的天际线，新矩形放在能让顶边最低的位置
+    // 放不进已有的页就开新页；矩形四周留padding像素，给采样过滤和低级Mip用，放的时候不旋转
+    // 只做CPU上的矩形分配，页的纹理由调用方创建
+    class TextureAtlasPacker
+    {
+    public:
+        // maxLayers为0时不限页数
+        void Init(uint32 pageWidth, uint32 pageHeight, uint32 padding, uint32 maxLayers = 0);
+
+        // 加上边距超过页大小，或者页数已满时返回false
+        bool Insert(uint32 width, uint32 height, TextureAtlasRect& outRect);
+
+        // 先按高度从大到小排序再逐个放，比按原顺序插入更紧凑；结果和输入一一对应，放不下的Width为0
+        std::vector<TextureAtlasRect> InsertBatch(const std::vector<TextureAtlasRect>& sizes);
+
+        FORCE_INLINE uint32 GetNumLayers() const
+        {
+            return (uint32)m_Pages.size();
+        }
+
+        FORCE_INLINE uint32 GetPageWidth() const
+        {
+            return m_PageWidth;
+        }
+
+        FORCE_INLINE uint32 GetPageHeight() const
+        {
+            return m_PageHeight;
+        }
+
+        FORCE_INLINE uint32 GetPadding() const
+        {
+            return m_Padding;
+        }
+
+        // 已放入的面积（含边距）占全部页面积的比例
+        float GetOccupancy() const;
+
+    private:
+        struct SkylineNode
+        {
+            uint32 X;
+            uint32 Y;
+            uint32 Width;
+        };
+
+        struct Page
+        {
+            std::vector<SkylineNode> Skyline;
+            uint64 UsedArea = 0;
+        };
+
+        // 从第index个节点开始放width宽的矩形时底边的高度，放不下返回false
+        bool Fit(const Page& page, uint32 index, uint32 width, uint32 height, uint32& outY) const;
+
+        bool InsertIntoPage(Page& page, uint32 width, uint32 height, uint32& outX, uint32& outY);
+
+    private:
+        uint32 m_PageWidth = 0;
+        uint32 m_PageHeight = 0;
+        uint32 m_Padding = 0;
+        uint32 m_MaxLayers = 0;
+
+        std::vector<Page> m_Pages;
+    };
+}
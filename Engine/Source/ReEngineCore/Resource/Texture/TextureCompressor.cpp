@@ -0,0 +1,594 @@
+﻿#include "TextureCompressor.h"
+#include "Core/WorkerPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RE_TEXTURE_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define RE_TEXTURE_SSE2 0
+#endif
+
+namespace ReEngine
+{
+    namespace
+    {
+        // BC7 4bit索引的插值权重
+        const int32 BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        // 16个像素每个通道的最小最大值
+        FORCE_INLINE void ComputeBlockBounds(const uint8* pixels, uint8 outMin[4], uint8 outMax[4])
+        {
+#if RE_TEXTURE_SSE2
+            const __m128i row0 = _mm_loadu_si128((const __m128i*)(pixels +  0));
+            const __m128i row1 = _mm_loadu_si128((const __m128i*)(pixels + 16));
+            const __m128i row2 = _mm_loadu_si128((const __m128i*)(pixels + 32));
+            const __m128i row3 = _mm_loadu_si128((const __m128i*)(pixels + 48));
+
+            __m128i minValue = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+            __m128i maxValue = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+            // 一行4个像素，对折两次落到第一个像素上
+            minValue = _mm_min_epu8(minValue, _mm_srli_si128(minValue, 8));
+            maxValue = _mm_max_epu8(maxValue, _mm_srli_si128(maxValue, 8));
+            minValue = _mm_min_epu8(minValue, _mm_srli_si128(minValue, 4));
+            maxValue = _mm_max_epu8(maxValue, _mm_srli_si128(maxValue, 4));
+
+            const uint32 minBits = (uint32)_mm_cvtsi128_si32(minValue);
+            const uint32 maxBits = (uint32)_mm_cvtsi128_si32(maxValue);
+            std::memcpy(outMin, &minBits, 4);
+            std::memcpy(outMax, &maxBits, 4);
+#else
+            for (uint32 c = 0; c < 4; ++c)
+            {
+                outMin[c] = 255;
+                outMax[c] = 0;
+            }
+            for (uint32 i = 0; i < 16; ++i)
+            {
+                for (uint32 c = 0; c < 4; ++c)
+                {
+                    outMin[c] = std::min(outMin[c], pixels[i * 4 + c]);
+                    outMax[c] = std::max(outMax[c], pixels[i * 4 + c]);
+                }
+            }
+#endif
+        }
+
+        // 沿像素分布的主轴取两端作为端点，mask里为0的像素不参与；没有包围盒跨度时两端相同
+        void FitEndpoints(const uint8* pixels, uint32 numChannels, uint32 mask, const uint8 boundsMin[4], const uint8 boundsMax[4], float outEnd0[4], float outEnd1[4])
+        {
+            float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            uint32 count = 0;
+            for (uint32 i = 0; i < 16; ++i)
+            {
+                if ((mask & (1u << i)) == 0) {
+                    continue;
+                }
+                for (uint32 c = 0; c < numChannels; ++c) {
+                    mean[c] += pixels[i * 4 + c];
+                }
+                count += 1;
+            }
+
+            if (count == 0)
+            {
+                for (uint32 c = 0; c < 4; ++c) {
+                    outEnd0[c] = outEnd1[c] = 0.0f;
+                }
+                return;
+            }
+
+            for (uint32 c = 0; c < numChannels; ++c) {
+                mean[c] /= (float)count;
+            }
+
+            float covariance[4][4] = {};
+            for (uint32 i = 0; i < 16; ++i)
+            {
+                if ((mask & (1u << i)) == 0) {
+                    continue;
+                }
+                float delta[4];
+                for (uint32 c = 0; c < numChannels; ++c) {
+                    delta[c] = pixels[i * 4 + c] - mean[c];
+                }
+                for (uint32 row = 0; row < numChannels; ++row)
+                {
+                    for (uint32 col = 0; col < numChannels; ++col) {
+                        covariance[row][col] += delta[row] * delta[col];
+                    }
+                }
+            }
+
+            // 幂迭代，初值用包围盒对角线
+            float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (uint32 c = 0; c < numChannels; ++c) {
+                axis[c] = (float)(boundsMax[c] - boundsMin[c]);
+            }
+            for (uint32 iteration = 0; iteration < 8; ++iteration)
+            {
+                float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                float length = 0.0f;
+                for (uint32 row = 0; row < numChannels; ++row)
+                {
+                    for (uint32 col = 0; col < numChannels; ++col) {
+                        next[row] += covariance[row][col] * axis[col];
+                    }
+                    length = std::max(length, std::abs(next[row]));
+                }
+                if (length < 1e-6f) {
+                    break;
+                }
+                for (uint32 c = 0; c < numChannels; ++c) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            float lengthSq = 0.0f;
+            for (uint32 c = 0; c < numChannels; ++c) {
+                lengthSq += axis[c] * axis[c];
+            }
+
+            float minT = 0.0f;
+            float maxT = 0.0f;
+            if (lengthSq > 1e-12f)
+            {
+                const float invLength = 1.0f / std::sqrt(lengthSq);
+                for (uint32 c = 0; c < numChannels; ++c) {
+                    axis[c] *= invLength;
+                }
+
+                minT = FLT_MAX;
+                maxT = -FLT_MAX;
+                for (uint32 i = 0; i < 16; ++i)
+                {
+                    if ((mask & (1u << i)) == 0) {
+                        continue;
+                    }
+                    float t = 0.0f;
+                    for (uint32 c = 0; c < numChannels; ++c) {
+                        t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+                    }
+                    minT = std::min(minT, t);
+                    maxT = std::max(maxT, t);
+                }
+            }
+
+            for (uint32 c = 0; c < 4; ++c)
+            {
+                if (c < numChannels)
+                {
+                    outEnd0[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+                    outEnd1[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+                }
+                else
+                {
+                    outEnd0[c] = outEnd1[c] = 255.0f;
+                }
+            }
+        }
+
+        FORCE_INLINE uint16 PackRGB565(const float color[4])
+        {
+            const uint32 r = (uint32)(color[0] * 31.0f / 255.0f + 0.5f);
+            const uint32 g = (uint32)(color[1] * 63.0f / 255.0f + 0.5f);
+            const uint32 b = (uint32)(color[2] * 31.0f / 255.0f + 0.5f);
+            return (uint16)((r << 11) | (g << 5) | b);
+        }
+
+        FORCE_INLINE void UnpackRGB565(uint16 packed, int32 outColor[3])
+        {
+            const int32 r = (packed >> 11) & 31;
+            const int32 g = (packed >> 5) & 63;
+            const int32 b = packed & 31;
+            outColor[0] = (r << 3) | (r >> 2);
+            outColor[1] = (g << 2) | (g >> 4);
+            outColor[2] = (b << 3) | (b >> 2);
+        }
+
+        FORCE_INLINE void WriteUint16(uint8* outData, uint16 value)
+        {
+            outData[0] = (uint8)(value & 0xFF);
+            outData[1] = (uint8)(value >> 8);
+        }
+
+        // BC3的颜色块固定4色模式，BC1有透明像素时用3色模式，索引3是透明
+        void CompressColorBlock(const uint8* pixels, bool allowTransparent, uint8* outBlock)
+        {
+            uint32 opaqueMask = 0xFFFF;
+            if (allowTransparent)
+            {
+                for (uint32 i = 0; i < 16; ++i)
+                {
+                    if (pixels[i * 4 + 3] < 128) {
+                        opaqueMask &= ~(1u << i);
+                    }
+                }
+            }
+            const bool hasTransparent = opaqueMask != 0xFFFF;
+
+            uint8 boundsMin[4];
+            uint8 boundsMax[4];
+            ComputeBlockBounds(pixels, boundsMin, boundsMax);
+
+            float end0[4];
+            float end1[4];
+            FitEndpoints(pixels, 3, opaqueMask, boundsMin, boundsMax, end0, end1);
+
+            uint16 color0 = PackRGB565(end1);
+            uint16 color1 = PackRGB565(end0);
+
+            // color0 > color1是4色模式，否则是3色模式
+            if (hasTransparent ? (color0 > color1) : (color0 < color1)) {
+                std::swap(color0, color1);
+            }
+
+            int32 palette[4][3];
+            UnpackRGB565(color0, palette[0]);
+            UnpackRGB565(color1, palette[1]);
+
+            uint32 numColors = 4;
+            if (color0 > color1)
+            {
+                for (uint32 c = 0; c < 3; ++c)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+            }
+            else
+            {
+                for (uint32 c = 0; c < 3; ++c)
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+                numColors = 3;
+            }
+
+            uint32 indices = 0;
+            for (uint32 i = 0; i < 16; ++i)
+            {
+                uint32 bestIndex = 3;
+                if (opaqueMask & (1u << i))
+                {
+                    int32 bestError = INT32_MAX;
+                    for (uint32 index = 0; index < numColors; ++index)
+                    {
+                        int32 error = 0;
+                        for (uint32 c = 0; c < 3; ++c)
+                        {
+                            const int32 delta = (int32)pixels[i * 4 + c] - palette[index][c];
+                            error += delta * delta;
+                        }
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            bestIndex = index;
+                        }
+                    }
+                }
+                indices |= bestIndex << (i * 2);
+            }
+
+            WriteUint16(outBlock + 0, color0);
+            WriteUint16(outBlock + 2, color1);
+            std::memcpy(outBlock + 4, &indices, 4);
+        }
+
+        // 按位从低到高写128位的BC7块
+        struct BlockBitWriter
+        {
+            uint8*  Data;
+            uint32  Position = 0;
+
+            void Write(uint32 value, uint32 numBits)
+            {
+                for (uint32 bit = 0; bit < numBits; ++bit, ++Position)
+                {
+                    if (value & (1u << bit)) {
+                        Data[Position >> 3] |= (uint8)(1u << (Position & 7));
+                    }
+                }
+            }
+        };
+
+        // 端点量化到7bit加一个共享的最低位，两种P位都试一遍取误差小的
+        void QuantizeBC7Endpoint(const float endpoint[4], uint32 outValue[4], uint32& outPBit)
+        {
+            float bestError = FLT_MAX;
+            for (uint32 pBit = 0; pBit < 2; ++pBit)
+            {
+                uint32 value[4];
+                float error = 0.0f;
+                for (uint32 c = 0; c < 4; ++c)
+                {
+                    const int32 quantized = (int32)((endpoint[c] - pBit) * 0.5f + 0.5f);
+                    value[c] = (uint32)std::min(std::max(quantized, 0), 127);
+                    const float delta = (float)((value[c] << 1) | pBit) - endpoint[c];
+                    error += delta * delta;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    outPBit = pBit;
+                    std::memcpy(outValue, value, sizeof(value));
+                }
+            }
+        }
+    }
+
+    PixelFormat TextureCompressor::GetPixelFormat(TextureCompression compression)
+    {
+        switch (compression)
+        {
+        case TextureCompression::BC1:   return PF_DXT1;
+        case TextureCompression::BC3:   return PF_DXT5;
+        case TextureCompression::BC4:   return PF_BC4;
+        case TextureCompression::BC5:   return PF_BC5;
+        case TextureCompression::BC7:   return PF_BC7;
+        default:                        return PF_R8G8B8A8;
+        }
+    }
+
+    uint64 TextureCompressor::GetImageSize(TextureCompression compression, uint32 width, uint32 height)
+    {
+        if (compression == TextureCompression::None) {
+            return (uint64)width * height * 4;
+        }
+
+        const uint64 numBlocks = (uint64)((width + 3) / 4) * ((height + 3) / 4);
+        const bool halfBlock = compression == TextureCompression::BC1 || compression == TextureCompression::BC4;
+        return numBlocks * (halfBlock ? 8 : 16);
+    }
+
+    void TextureCompressor::CompressImage(TextureCompression compression, const uint8* rgbaData, uint32 width, uint32 height, uint8* outData)
+    {
+        if (compression == TextureCompression::None)
+        {
+            std::memcpy(outData, rgbaData, (size_t)width * height * 4);
+            return;
+        }
+
+        const uint32 numBlocksX = (width + 3) / 4;
+        const uint32 numBlocksY = (height + 3) / 4;
+        const uint32 blockBytes = (uint32)(GetImageSize(compression, 4, 4));
+
+        WorkerPool::GetInstance().ParallelFor(numBlocksY, [&](uint32 blockY)
+        {
+            uint8 pixels[64];
+            for (uint32 blockX = 0; blockX < numBlocksX; ++blockX)
+            {
+                for (uint32 y = 0; y < 4; ++y)
+                {
+                    const uint32 srcY = std::min(blockY * 4 + y, height - 1);
+                    for (uint32 x = 0; x < 4; ++x)
+                    {
+                        const uint32 srcX = std::min(blockX * 4 + x, width - 1);
+                        std::memcpy(pixels + (y * 4 + x) * 4, rgbaData + ((size_t)srcY * width + srcX) * 4, 4);
+                    }
+                }
+
+                uint8* block = outData + ((size_t)blockY * numBlocksX + blockX) * blockBytes;
+                switch (compression)
+                {
+                case TextureCompression::BC1:   CompressBlockBC1(pixels, block);        break;
+                case TextureCompression::BC3:   CompressBlockBC3(pixels, block);        break;
+                case TextureCompression::BC4:   CompressBlockBC4(pixels, 0, block);     break;
+                case TextureCompression::BC5:   CompressBlockBC5(pixels, block);        break;
+                case TextureCompression::BC7:   CompressBlockBC7(pixels, block);        break;
+                default:                                                                break;
+                }
+            }
+        });
+    }
+
+    void TextureCompressor::DownsampleImage(const uint8* rgbaData, uint32 width, uint32 height, bool srgb, std::vector<uint8>& outData)
+    {
+        static float s_SRGBToLinear[256];
+        static bool s_TableReady = [] {
+            for (uint32 i = 0; i < 256; ++i)
+            {
+                const float value = i / 255.0f;
+                s_SRGBToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            return true;
+        }();
+        (void)s_TableReady;
+
+        auto LinearToSRGB = [](float value) -> uint8
+        {
+            value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+            return (uint8)std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f);
+        };
+
+        const uint32 dstWidth  = std::max(width / 2, 1u);
+        const uint32 dstHeight = std::max(height / 2, 1u);
+        outData.resize((size_t)dstWidth * dstHeight * 4);
+
+        for (uint32 y = 0; y < dstHeight; ++y)
+        {
+            const uint32 y0 = std::min(y * 2, height - 1);
+            const uint32 y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32 x = 0; x < dstWidth; ++x)
+            {
+                const uint32 x0 = std::min(x * 2, width - 1);
+                const uint32 x1 = std::min(x * 2 + 1, width - 1);
+                const uint8* samples[4] = {
+                    rgbaData + ((size_t)y0 * width + x0) * 4,
+                    rgbaData + ((size_t)y0 * width + x1) * 4,
+                    rgbaData + ((size_t)y1 * width + x0) * 4,
+                    rgbaData + ((size_t)y1 * width + x1) * 4,
+                };
+
+                uint8* dst = outData.data() + ((size_t)y * dstWidth + x) * 4;
+                for (uint32 c = 0; c < 4; ++c)
+                {
+                    if (srgb && c < 3)
+                    {
+                        const float sum = s_SRGBToLinear[samples[0][c]] + s_SRGBToLinear[samples[1][c]] + s_SRGBToLinear[samples[2][c]] + s_SRGBToLinear[samples[3][c]];
+                        dst[c] = LinearToSRGB(sum * 0.25f);
+                    }
+                    else
+                    {
+                        dst[c] = (uint8)((samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c] + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    bool TextureCompressor::HasAlpha(const uint8* rgbaData, uint32 width, uint32 height)
+    {
+        const size_t numPixels = (size_t)width * height;
+        for (size_t i = 0; i < numPixels; ++i)
+        {
+            if (rgbaData[i * 4 + 3] != 255) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TextureCompressor::CompressBlockBC1(const uint8* pixels, uint8* outBlock)
+    {
+        CompressColorBlock(pixels, true, outBlock);
+    }
+
+    void TextureCompressor::CompressBlockBC3(const uint8* pixels, uint8* outBlock)
+    {
+        CompressBlockBC4(pixels, 3, outBlock);
+        CompressColorBlock(pixels, false, outBlock + 8);
+    }
+
+    void TextureCompressor::CompressBlockBC4(const uint8* pixels, uint32 channel, uint8* outBlock)
+    {
+        uint8 boundsMin[4];
+        uint8 boundsMax[4];
+        ComputeBlockBounds(pixels, boundsMin, boundsMax);
+
+        // value0 > value1是8值模式，相等时所有索引都是0
+        const int32 value0 = boundsMax[channel];
+        const int32 value1 = boundsMin[channel];
+
+        int32 palette[8];
+        palette[0] = value0;
+        palette[1] = value1;
+        for (int32 i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * value0 + i * value1) / 7;
+        }
+
+        uint64 indices = 0;
+        if (value0 != value1)
+        {
+            for (uint32 i = 0; i < 16; ++i)
+            {
+                const int32 value = pixels[i * 4 + channel];
+                uint64 bestIndex = 0;
+                int32 bestError = INT32_MAX;
+                for (uint32 index = 0; index < 8; ++index)
+                {
+                    const int32 error = std::abs(value - palette[index]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = index;
+                    }
+                }
+                indices |= bestIndex << (i * 3);
+            }
+        }
+
+        outBlock[0] = (uint8)value0;
+        outBlock[1] = (uint8)value1;
+        for (uint32 i = 0; i < 6; ++i) {
+            outBlock[2 + i] = (uint8)(indices >> (i * 8));
+        }
+    }
+
+    void TextureCompressor::CompressBlockBC5(const uint8* pixels, uint8* outBlock)
+    {
+        CompressBlockBC4(pixels, 0, outBlock);
+        CompressBlockBC4(pixels, 1, outBlock + 8);
+    }
+
+    void TextureCompressor::CompressBlockBC7(const uint8* pixels, uint8* outBlock)
+    {
+        uint8 boundsMin[4];
+        uint8 boundsMax[4];
+        ComputeBlockBounds(pixels, boundsMin, boundsMax);
+
+        float end0[4];
+        float end1[4];
+        FitEndpoints(pixels, 4, 0xFFFF, boundsMin, boundsMax, end0, end1);
+
+        uint32 endpoints[2][4];
+        uint32 pBits[2];
+        QuantizeBC7Endpoint(end0, endpoints[0], pBits[0]);
+        QuantizeBC7Endpoint(end1, endpoints[1], pBits[1]);
+
+        int32 palette[16][4];
+        for (uint32 index = 0; index < 16; ++index)
+        {
+            const int32 weight = BC7_WEIGHTS4[index];
+            for (uint32 c = 0; c < 4; ++c)
+            {
+                const int32 color0 = (int32)((endpoints[0][c] << 1) | pBits[0]);
+                const int32 color1 = (int32)((endpoints[1][c] << 1) | pBits[1]);
+                palette[index][c] = ((64 - weight) * color0 + weight * color1 + 32) >> 6;
+            }
+        }
+
+        uint32 indices[16];
+        for (uint32 i = 0; i < 16; ++i)
+        {
+            int32 bestError = INT32_MAX;
+            for (uint32 index = 0; index < 16; ++index)
+            {
+                int32 error = 0;
+                for (uint32 c = 0; c < 4; ++c)
+                {
+                    const int32 delta = (int32)pixels[i * 4 + c] - palette[index][c];
+                    error += delta * delta;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = index;
+                }
+            }
+        }
+
+        // 第一个像素的索引最高位隐含为0，不满足时交换端点并翻转索引
+        if (indices[0] & 8)
+        {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (uint32 i = 0; i < 16; ++i) {
+                indices[i] = 15 - indices[i];
+            }
+        }
+
+        std::memset(outBlock, 0, 16);
+        BlockBitWriter writer { outBlock };
+        // Mode 6：低6位是0，第7位是1
+        writer.Write(1u << 6, 7);
+        for (uint32 c = 0; c < 4; ++c)
+        {
+            writer.Write(endpoints[0][c], 7);
+            writer.Write(endpoints[1][c], 7);
+        }
+        writer.Write(pBits[0], 1);
+        writer.Write(pBits[1], 1);
+        writer.Write(indices[0], 3);
+        for (uint32 i = 1; i < 16; ++i) {
+            writer.Write(indices[i], 4);
+        }
+    }
+}
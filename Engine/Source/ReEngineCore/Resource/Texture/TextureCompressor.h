@@ -0,0 +1,44 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Renderer/RHI/PixelFormat.h"
+
+#include <vector>
+
+namespace ReEngine
+{
+    enum class TextureCompression : uint8
+    {
+        None = 0,   // RGBA8，不压缩
+        BC1,        // RGB + 1bit Alpha，8字节一块
+        BC3,        // RGBA，颜色同BC1，Alpha同BC4
+        BC4,        // 单通道
+        BC5,        // 双通道，法线贴图用
+        BC7,        // RGBA，只用Mode 6，质量比BC3好
+    };
+
+    // 离线烘焙用的BC编码：每个4x4块先用SSE2求包围盒，再沿主轴拟合端点，索引逐像素取最近的插值
+    // 块之间互不依赖，整张图按块行分给WorkerPool
+    // 宽高不是4的倍数时，边上的块重复最后一行/列的像素
+    class TextureCompressor
+    {
+    public:
+        static PixelFormat GetPixelFormat(TextureCompression compression);
+
+        static uint64 GetImageSize(TextureCompression compression, uint32 width, uint32 height);
+
+        // rgbaData是width*height个RGBA8像素，outData的大小用GetImageSize算
+        static void CompressImage(TextureCompression compression, const uint8* rgbaData, uint32 width, uint32 height, uint8* outData);
+
+        // 2x2盒式滤波生成下一级，尺寸向下取整和运行时的Mip一致；sRGB时在线性空间平均RGB
+        static void DownsampleImage(const uint8* rgbaData, uint32 width, uint32 height, bool srgb, std::vector<uint8>& outData);
+
+        static bool HasAlpha(const uint8* rgbaData, uint32 width, uint32 height);
+
+        // 单个4x4块，pixels是16个RGBA8像素
+        static void CompressBlockBC1(const uint8* pixels, uint8* outBlock);
+        static void CompressBlockBC3(const uint8* pixels, uint8* outBlock);
+        static void CompressBlockBC4(const uint8* pixels, uint32 channel, uint8* outBlock);
+        static void CompressBlockBC5(const uint8* pixels, uint8* outBlock);
+        static void CompressBlockBC7(const uint8* pixels, uint8* outBlock);
+    };
+}
@@ -0,0 +1,174 @@
+﻿#include "TextureConvert.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RE_TEXTURE_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define RE_TEXTURE_SSE2 0
+#endif
+
+// MSVC开了/arch:AVX以上才会定义__AVX__，这时SSSE3一定可用
+#if defined(__SSSE3__) || defined(__AVX__)
+    #define RE_TEXTURE_SSSE3 1
+    #include <tmmintrin.h>
+#else
+    #define RE_TEXTURE_SSSE3 0
+#endif
+
+namespace ReEngine
+{
+    namespace
+    {
+        // x*a/255四舍五入，t = x*a + 128 不超过16位
+        FORCE_INLINE uint8 MulDiv255(uint32 value, uint32 alpha)
+        {
+            const uint32 t = value * alpha + 128;
+            return (uint8)((t + (t >> 8)) >> 8);
+        }
+
+        enum
+        {
+            LINEAR_TO_SRGB_SIZE = 4096,
+        };
+
+        struct SRGBTables
+        {
+            float ToLinear[256];
+            uint8 ToSRGB[LINEAR_TO_SRGB_SIZE];
+
+            SRGBTables()
+            {
+                for (int32 i = 0; i < 256; ++i)
+                {
+                    const float value = i / 255.0f;
+                    ToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                }
+
+                for (int32 i = 0; i < LINEAR_TO_SRGB_SIZE; ++i)
+                {
+                    const float value = i / (float)(LINEAR_TO_SRGB_SIZE - 1);
+                    const float srgb  = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                    ToSRGB[i] = (uint8)(srgb * 255.0f + 0.5f);
+                }
+            }
+        };
+
+        // 局部静态变量的初始化是线程安全的，多个解码任务可以同时第一次调用
+        const SRGBTables& GetSRGBTables()
+        {
+            static SRGBTables s_Tables;
+            return s_Tables;
+        }
+    }
+
+    void TextureConvert::ExpandRGBToRGBA(const uint8* src, uint8* dst, uint32 numPixels)
+    {
+        uint32 index = 0;
+
+#if RE_TEXTURE_SSSE3
+        // 一次读16字节用前12字节，剩余不足6个像素时会越界，交给后面逐个处理
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha   = _mm_set1_epi32((int32)0xFF000000);
+        for (; index + 6 <= numPixels; index += 4)
+        {
+            const __m128i rgb = _mm_loadu_si128((const __m128i*)(src + index * 3));
+            _mm_storeu_si128((__m128i*)(dst + index * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+        }
+#elif RE_TEXTURE_SSE2
+        // 每个像素按4字节读，最高字节是下一个像素的R，用Alpha覆盖掉
+        const __m128i alpha = _mm_set1_epi32((int32)0xFF000000);
+        for (; index + 6 <= numPixels; index += 4)
+        {
+            const uint8* pixel = src + index * 3;
+            int32 p0, p1, p2, p3;
+            std::memcpy(&p0, pixel + 0, 4);
+            std::memcpy(&p1, pixel + 3, 4);
+            std::memcpy(&p2, pixel + 6, 4);
+            std::memcpy(&p3, pixel + 9, 4);
+            _mm_storeu_si128((__m128i*)(dst + index * 4), _mm_or_si128(_mm_set_epi32(p3, p2, p1, p0), alpha));
+        }
+#endif
+
+        for (; index < numPixels; ++index)
+        {
+            dst[index * 4 + 0] = src[index * 3 + 0];
+            dst[index * 4 + 1] = src[index * 3 + 1];
+            dst[index * 4 + 2] = src[index * 3 + 2];
+            dst[index * 4 + 3] = 255;
+        }
+    }
+
+    void TextureConvert::CopyRGBA(const uint8* src, uint8* dst, uint32 numPixels)
+    {
+        std::memcpy(dst, src, (size_t)numPixels * 4);
+    }
+
+    void TextureConvert::PremultiplyAlpha(const uint8* src, uint8* dst, uint32 numPixels, bool srgb)
+    {
+        if (srgb)
+        {
+            const SRGBTables& tables = GetSRGBTables();
+            for (uint32 index = 0; index < numPixels; ++index)
+            {
+                const uint8* pixel = src + index * 4;
+                uint8* out = dst + index * 4;
+                const uint8 alpha = pixel[3];
+
+                if (alpha == 255)
+                {
+                    std::memcpy(out, pixel, 4);
+                    continue;
+                }
+
+                const float scale = alpha / 255.0f * (LINEAR_TO_SRGB_SIZE - 1);
+                for (int32 c = 0; c < 3; ++c) {
+                    out[c] = tables.ToSRGB[(int32)(tables.ToLinear[pixel[c]] * scale + 0.5f)];
+                }
+                out[3] = alpha;
+            }
+            return;
+        }
+
+        uint32 index = 0;
+
+#if RE_TEXTURE_SSE2
+        // 每次4个像素，展开成16位后乘各自的Alpha；Alpha通道乘255，除完保持不变
+        const __m128i zero     = _mm_setzero_si128();
+        const __m128i keepRGB  = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+        const __m128i alpha255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+        const __m128i round    = _mm_set1_epi16(128);
+        for (; index + 4 <= numPixels; index += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128((const __m128i*)(src + index * 4));
+
+            __m128i result[2];
+            for (int32 half = 0; half < 2; ++half)
+            {
+                const __m128i value = half == 0 ? _mm_unpacklo_epi8(pixels, zero) : _mm_unpackhi_epi8(pixels, zero);
+
+                __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                alpha = _mm_or_si128(_mm_and_si128(alpha, keepRGB), alpha255);
+
+                const __m128i t = _mm_add_epi16(_mm_mullo_epi16(value, alpha), round);
+                result[half] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+            }
+
+            _mm_storeu_si128((__m128i*)(dst + index * 4), _mm_packus_epi16(result[0], result[1]));
+        }
+#endif
+
+        for (; index < numPixels; ++index)
+        {
+            const uint8* pixel = src + index * 4;
+            uint8* out = dst + index * 4;
+            const uint8 alpha = pixel[3];
+            out[0] = MulDiv255(pixel[0], alpha);
+            out[1] = MulDiv255(pixel[1], alpha);
+            out[2] = MulDiv255(pixel[2], alpha);
+            out[3] = alpha;
+        }
+    }
+}
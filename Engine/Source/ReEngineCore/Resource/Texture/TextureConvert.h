@@ -0,0 +1,20 @@
+﻿#pragma once
+#include "Core/Core.h"
+
+namespace ReEngine
+{
+    // 解码后到上传前的像素转换，src和dst可以是不同的内存，dst一般直接是映射的Staging
+    // 编译器开了SSSE3时RGB扩展用pshufb，否则用SSE2，尾部不足一组的像素逐个处理
+    class TextureConvert
+    {
+    public:
+        // RGB8扩展成RGBA8，Alpha填255
+        static void ExpandRGBToRGBA(const uint8* src, uint8* dst, uint32 numPixels);
+
+        // RGBA8拷贝
+        static void CopyRGBA(const uint8* src, uint8* dst, uint32 numPixels);
+
+        // RGBA8预乘Alpha，Alpha本身不变；sRGB时先转到线性空间再乘，结果转回sRGB
+        static void PremultiplyAlpha(const uint8* src, uint8* dst, uint32 numPixels, bool srgb);
+    };
+}
@@ -0,0 +1,145 @@
+﻿#include "TextureFile.h"
+#include "Log/Log.h"
+#include "Resource/AssetManager/AssetManager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace ReEngine
+{
+    namespace
+    {
+        struct FileHeader
+        {
+            uint32  Magic;
+            uint32  Version;
+            uint32  Format;
+            uint32  Flags;
+            uint32  Width;
+            uint32  Height;
+            uint32  NumMips;
+            uint32  Reserved;
+            uint64  DataSize;
+        };
+
+        struct FileMip
+        {
+            uint32  Width;
+            uint32  Height;
+            uint64  Offset;
+            uint64  Size;
+        };
+    }
+
+    void TextureFile::AddMip(uint32 width, uint32 height, const uint8* data, uint64 size)
+    {
+        const uint64 offset = (Data.size() + DATA_ALIGNMENT - 1) & ~(uint64)(DATA_ALIGNMENT - 1);
+        Data.resize(offset + size, 0);
+        std::memcpy(Data.data() + offset, data, size);
+
+        Mip mip;
+        mip.Width  = width;
+        mip.Height = height;
+        mip.Offset = offset;
+        mip.Size   = size;
+        Mips.push_back(mip);
+    }
+
+    bool TextureFile::Save(const std::string& filepath) const
+    {
+        FILE* file = fopen(filepath.c_str(), "wb");
+        if (!file)
+        {
+            RE_CORE_ERROR("Failed to open {0} for writing.", filepath);
+            return false;
+        }
+
+        FileHeader header = {};
+        header.Magic    = MAGIC;
+        header.Version  = VERSION;
+        header.Format   = (uint32)Format;
+        header.Flags    = Flags;
+        header.Width    = Width;
+        header.Height   = Height;
+        header.NumMips  = (uint32)Mips.size();
+        header.DataSize = Data.size();
+        fwrite(&header, sizeof(header), 1, file);
+
+        for (const Mip& mip : Mips)
+        {
+            FileMip fileMip = { mip.Width, mip.Height, mip.Offset, mip.Size };
+            fwrite(&fileMip, sizeof(fileMip), 1, file);
+        }
+
+        const size_t written = fwrite(Data.data(), 1, Data.size(), file);
+        fclose(file);
+        return written == Data.size();
+    }
+
+    bool TextureFile::LoadFromMemory(const uint8* data, uint64 size, TextureFile& outFile)
+    {
+        if (size < sizeof(FileHeader)) {
+            return false;
+        }
+
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.Magic != MAGIC || header.Version != VERSION || header.Format >= PixelFormat_MAX || header.NumMips == 0) {
+            return false;
+        }
+
+        const uint64 mipTableSize = (uint64)header.NumMips * sizeof(FileMip);
+        if (size < sizeof(FileHeader) + mipTableSize + header.DataSize) {
+            return false;
+        }
+
+        outFile.Format = (PixelFormat)header.Format;
+        outFile.Flags  = header.Flags;
+        outFile.Width  = header.Width;
+        outFile.Height = header.Height;
+        outFile.Mips.resize(header.NumMips);
+
+        const uint8* mipTable = data + sizeof(FileHeader);
+        for (uint32 index = 0; index < header.NumMips; ++index)
+        {
+            FileMip fileMip;
+            std::memcpy(&fileMip, mipTable + index * sizeof(FileMip), sizeof(fileMip));
+            if (fileMip.Offset + fileMip.Size > header.DataSize) {
+                return false;
+            }
+
+            Mip& mip  = outFile.Mips[index];
+            mip.Width  = fileMip.Width;
+            mip.Height = fileMip.Height;
+            mip.Offset = fileMip.Offset;
+            mip.Size   = fileMip.Size;
+        }
+
+        const uint8* fileData = mipTable + mipTableSize;
+        outFile.Data.assign(fileData, fileData + header.DataSize);
+        return true;
+    }
+
+    bool TextureFile::Load(const std::string& filepath, TextureFile& outFile)
+    {
+        uint32 dataSize = 0;
+        uint8* dataPtr = nullptr;
+        if (!AssetManager::ReadFile(filepath, dataPtr, dataSize)) {
+            return false;
+        }
+
+        const bool result = LoadFromMemory(dataPtr, dataSize, outFile);
+        delete[] dataPtr;
+
+        if (!result) {
+            RE_CORE_ERROR("Invalid cooked texture : {0}", filepath);
+        }
+        return result;
+    }
+
+    std::string TextureFile::GetCookedPath(const std::string& filepath)
+    {
+        return std::filesystem::path(filepath).replace_extension(".rtex").generic_string();
+    }
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+#include "Core/Core.h"
+#include "Renderer/RHI/PixelFormat.h"
+
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    // 烘焙后的贴图文件(.rtex)：文件头 + 每级Mip的描述 + 按Mip从大到小排列的数据
+    // 数据已经是GPU的格式（BCn或RGBA8），运行时整块拷贝到Staging后直接上传
+    class TextureFile
+    {
+    public:
+        enum
+        {
+            MAGIC   = 0x58455452,   // "RTEX"
+            VERSION = 1,
+            // 每级Mip数据的起始偏移按它对齐，满足vkCmdCopyBufferToImage的块大小要求
+            DATA_ALIGNMENT = 16,
+        };
+
+        enum
+        {
+            FLAG_SRGB = 1 << 0,
+        };
+
+        struct Mip
+        {
+            uint32  Width = 0;
+            uint32  Height = 0;
+            uint64  Offset = 0;     // 相对数据区开头
+            uint64  Size = 0;
+        };
+
+        // 把一级Mip追加到数据区末尾
+        void AddMip(uint32 width, uint32 height, const uint8* data, uint64 size);
+
+        bool Save(const std::string& filepath) const;
+
+        // 校验文件头和每级Mip的范围，失败时outFile内容无效
+        static bool LoadFromMemory(const uint8* data, uint64 size, TextureFile& outFile);
+
+        // 路径相对引擎根目录，同AssetManager::ReadFile
+        static bool Load(const std::string& filepath, TextureFile& outFile);
+
+        // "a/b.png" -> "a/b.rtex"
+        static std::string GetCookedPath(const std::string& filepath);
+
+        FORCE_INLINE bool IsSRGB() const
+        {
+            return (Flags & FLAG_SRGB) != 0;
+        }
+
+        FORCE_INLINE const uint8* GetMipData(uint32 mipLevel) const
+        {
+            return Data.data() + Mips[mipLevel].Offset;
+        }
+
+    public:
+        PixelFormat         Format = PF_Unknown;
+        uint32              Flags = 0;
+        uint32              Width = 0;
+        uint32              Height = 0;
+        std::vector<Mip>    Mips;
+        std::vector<uint8>  Data;
+    };
+}
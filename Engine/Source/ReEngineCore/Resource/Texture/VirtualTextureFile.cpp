@@ -0,0 +1,208 @@
+﻿#include "VirtualTextureFile.h"
+#include "TextureCompressor.h"
+#include "Log/Log.h"
+#include "Resource/AssetManager/AssetManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace ReEngine
+{
+    namespace
+    {
+        struct FileHeader
+        {
+            uint32  Magic;
+            uint32  Version;
+            uint32  Flags;
+            uint32  Width;
+            uint32  Height;
+            uint32  TileSize;
+            uint32  Border;
+            uint32  NumMips;
+        };
+
+        struct FileMip
+        {
+            uint32  PagesX;
+            uint32  PagesY;
+            uint32  FirstPage;
+            uint32  Reserved;
+        };
+    }
+
+    VirtualTextureFile::~VirtualTextureFile()
+    {
+        Close();
+    }
+
+    bool VirtualTextureFile::Cook(const uint8* rgbaData, uint32 width, uint32 height, bool srgb, const std::string& outputPath, uint32 tileSize, uint32 border)
+    {
+        FILE* file = fopen(outputPath.c_str(), "wb");
+        if (!file)
+        {
+            RE_CORE_ERROR("Failed to open {0} for writing.", outputPath);
+            return false;
+        }
+
+        // 先算每级的页数，写出文件头和Mip表
+        std::vector<FileMip> mips;
+        uint32 firstPage = 0;
+        for (uint32 mipWidth = width, mipHeight = height; ; mipWidth = std::max(mipWidth / 2, 1u), mipHeight = std::max(mipHeight / 2, 1u))
+        {
+            FileMip mip = {};
+            mip.PagesX    = (mipWidth + tileSize - 1) / tileSize;
+            mip.PagesY    = (mipHeight + tileSize - 1) / tileSize;
+            mip.FirstPage = firstPage;
+            mips.push_back(mip);
+            firstPage += mip.PagesX * mip.PagesY;
+
+            if (mip.PagesX == 1 && mip.PagesY == 1) {
+                break;
+            }
+        }
+
+        FileHeader header = {};
+        header.Magic    = MAGIC;
+        header.Version  = VERSION;
+        header.Flags    = srgb ? FLAG_SRGB : 0;
+        header.Width    = width;
+        header.Height   = height;
+        header.TileSize = tileSize;
+        header.Border   = border;
+        header.NumMips  = (uint32)mips.size();
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(mips.data(), sizeof(FileMip), mips.size(), file);
+
+        const uint32 pageSize = tileSize + border * 2;
+        std::vector<uint8> page((size_t)pageSize * pageSize * 4);
+        std::vector<uint8> mipData(rgbaData, rgbaData + (size_t)width * height * 4);
+        std::vector<uint8> nextMipData;
+
+        uint32 mipWidth  = width;
+        uint32 mipHeight = height;
+        bool succeeded = true;
+        for (uint32 mipLevel = 0; mipLevel < (uint32)mips.size() && succeeded; ++mipLevel)
+        {
+            // 页的范围超出图片时重复边缘像素
+            for (uint32 pageY = 0; pageY < mips[mipLevel].PagesY; ++pageY)
+            {
+                for (uint32 pageX = 0; pageX < mips[mipLevel].PagesX; ++pageX)
+                {
+                    const int32 originX = (int32)(pageX * tileSize) - (int32)border;
+                    const int32 originY = (int32)(pageY * tileSize) - (int32)border;
+                    for (uint32 y = 0; y < pageSize; ++y)
+                    {
+                        const int32 srcY = std::clamp(originY + (int32)y, 0, (int32)mipHeight - 1);
+                        for (uint32 x = 0; x < pageSize; ++x)
+                        {
+                            const int32 srcX = std::clamp(originX + (int32)x, 0, (int32)mipWidth - 1);
+                            std::memcpy(&page[((size_t)y * pageSize + x) * 4], &mipData[((size_t)srcY * mipWidth + srcX) * 4], 4);
+                        }
+                    }
+
+                    if (fwrite(page.data(), 1, page.size(), file) != page.size())
+                    {
+                        succeeded = false;
+                        break;
+                    }
+                }
+
+                if (!succeeded) {
+                    break;
+                }
+            }
+
+            if (mipLevel + 1 < (uint32)mips.size())
+            {
+                TextureCompressor::DownsampleImage(mipData.data(), mipWidth, mipHeight, srgb, nextMipData);
+                mipData.swap(nextMipData);
+                mipWidth  = std::max(mipWidth / 2, 1u);
+                mipHeight = std::max(mipHeight / 2, 1u);
+            }
+        }
+
+        fclose(file);
+        return succeeded;
+    }
+
+    bool VirtualTextureFile::Open(const std::string& filepath)
+    {
+        Close();
+
+        m_File = fopen(AssetManager::GetFullPath(filepath).c_str(), "rb");
+        if (!m_File) {
+            return false;
+        }
+
+        FileHeader header;
+        if (fread(&header, sizeof(header), 1, m_File) != 1 || header.Magic != MAGIC || header.Version != VERSION ||
+            header.NumMips == 0 || header.TileSize == 0)
+        {
+            RE_CORE_ERROR("Invalid virtual texture : {0}", filepath);
+            Close();
+            return false;
+        }
+
+        std::vector<FileMip> fileMips(header.NumMips);
+        if (fread(fileMips.data(), sizeof(FileMip), fileMips.size(), m_File) != fileMips.size())
+        {
+            RE_CORE_ERROR("Invalid virtual texture : {0}", filepath);
+            Close();
+            return false;
+        }
+
+        Flags    = header.Flags;
+        Width    = header.Width;
+        Height   = header.Height;
+        TileSize = header.TileSize;
+        Border   = header.Border;
+        Mips.resize(header.NumMips);
+        for (uint32 index = 0; index < header.NumMips; ++index)
+        {
+            Mips[index].PagesX    = fileMips[index].PagesX;
+            Mips[index].PagesY    = fileMips[index].PagesY;
+            Mips[index].FirstPage = fileMips[index].FirstPage;
+        }
+
+        m_DataOffset = sizeof(FileHeader) + fileMips.size() * sizeof(FileMip);
+        return true;
+    }
+
+    void VirtualTextureFile::Close()
+    {
+        if (m_File)
+        {
+            fclose(m_File);
+            m_File = nullptr;
+        }
+    }
+
+    bool VirtualTextureFile::ReadPage(uint32 mipLevel, uint32 pageX, uint32 pageY, uint8* outData)
+    {
+        if (!m_File || mipLevel >= (uint32)Mips.size() || pageX >= Mips[mipLevel].PagesX || pageY >= Mips[mipLevel].PagesY) {
+            return false;
+        }
+
+        const Mip& mip = Mips[mipLevel];
+        const uint64 pageIndex = mip.FirstPage + (uint64)pageY * mip.PagesX + pageX;
+        const uint64 offset = m_DataOffset + pageIndex * GetPageBytes();
+
+#if defined(_WIN32)
+        if (_fseeki64(m_File, (int64)offset, SEEK_SET) != 0) {
+            return false;
+        }
+#else
+        if (fseeko(m_File, (off_t)offset, SEEK_SET) != 0) {
+            return false;
+        }
+#endif
+        return fread(outData, 1, GetPageBytes(), m_File) == GetPageBytes();
+    }
+
+    std::string VirtualTextureFile::GetCookedPath(const std::string& filepath)
+    {
+        return std::filesystem::path(filepath).replace_extension(".rvt").generic_string();
+    }
+}
@@ -0,0 +1,89 @@
+﻿#pragma once
+#include "Core/Core.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ReEngine
+{
+    // 虚拟贴图的分块文件(.rvt)：文件头 + 每级Mip的页数 + 按Mip从大到小、行优先排列的页
+    // 每页是(TileSize + 2 * Border)^2个RGBA8像素，Border取自相邻的页，物理缓存里线性过滤不会采到别的页
+    // 页大小固定，按页号直接算偏移，运行时只读需要的页
+    class VirtualTextureFile
+    {
+    public:
+        enum
+        {
+            MAGIC   = 0x30545652,   // "RVT0"
+            VERSION = 1,
+            DEFAULT_TILE_SIZE = 128,
+            DEFAULT_BORDER = 4,
+        };
+
+        enum
+        {
+            FLAG_SRGB = 1 << 0,
+        };
+
+        struct Mip
+        {
+            uint32 PagesX = 0;
+            uint32 PagesY = 0;
+            // 这一级第一页的全局页号
+            uint32 FirstPage = 0;
+        };
+
+        VirtualTextureFile() = default;
+        ~VirtualTextureFile();
+
+        VirtualTextureFile(const VirtualTextureFile&) = delete;
+        VirtualTextureFile& operator=(const VirtualTextureFile&) = delete;
+
+        // rgbaData是width*height个RGBA8像素，一直生成到整张图只剩一页
+        static bool Cook(const uint8* rgbaData, uint32 width, uint32 height, bool srgb, const std::string& outputPath, uint32 tileSize = DEFAULT_TILE_SIZE, uint32 border = DEFAULT_BORDER);
+
+        // 路径相对引擎根目录；只读文件头，文件保持打开
+        bool Open(const std::string& filepath);
+
+        void Close();
+
+        // outData大小为GetPageBytes()；同一个文件不能在多个线程上同时读
+        bool ReadPage(uint32 mipLevel, uint32 pageX, uint32 pageY, uint8* outData);
+
+        // "a/b.png" -> "a/b.rvt"
+        static std::string GetCookedPath(const std::string& filepath);
+
+        FORCE_INLINE uint32 GetPageSize() const
+        {
+            return TileSize + Border * 2;
+        }
+
+        FORCE_INLINE uint64 GetPageBytes() const
+        {
+            return (uint64)GetPageSize() * GetPageSize() * 4;
+        }
+
+        FORCE_INLINE uint32 GetNumPages() const
+        {
+            return Mips.empty() ? 0 : Mips.back().FirstPage + Mips.back().PagesX * Mips.back().PagesY;
+        }
+
+        FORCE_INLINE bool IsSRGB() const
+        {
+            return (Flags & FLAG_SRGB) != 0;
+        }
+
+    public:
+        uint32              Flags = 0;
+        uint32              Width = 0;
+        uint32              Height = 0;
+        uint32              TileSize = 0;
+        uint32              Border = 0;
+        std::vector<Mip>    Mips;
+
+    private:
+        FILE*               m_File = nullptr;
+        uint64              m_DataOffset = 0;
+    };
+}
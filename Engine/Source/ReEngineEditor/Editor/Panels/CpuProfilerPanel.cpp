@@ -0,0 +1,53 @@
+﻿#include "CpuProfilerPanel.h"
+#include "imgui.h"
+#include "Core/CpuProfiler.h"
+
+namespace ReEngine
+{
+    void CpuProfilerPanel::OnImGuiRender()
+    {
+        ImGui::Begin("CPU Profiler");
+
+#if RE_ENABLE_PROFILER
+        CpuProfiler& profiler = CpuProfiler::GetInstance();
+
+        ImGui::InputText("Path", mTracePath, sizeof(mTracePath));
+        ImGui::SliderInt("Frames", &mCaptureFrames, 1, CpuProfiler::MAX_CAPTURE_FRAMES);
+        if (profiler.IsCapturing())
+        {
+            ImGui::TextDisabled("Capturing...");
+        }
+        else if (ImGui::Button("Capture Frames"))
+        {
+            profiler.RequestCapture((uint32)mCaptureFrames, mTracePath);
+        }
+
+        ImGui::Text("Frame  %.3f ms", profiler.GetLastFrameMs());
+
+        if (ImGui::BeginTable("CpuZones", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Zone");
+            ImGui::TableSetupColumn("Start (ms)");
+            ImGui::TableSetupColumn("Time (ms)");
+            ImGui::TableHeadersRow();
+
+            const uint64 frameStartNs = profiler.GetLastFrameStartNs();
+            for (const CpuProfileEvent& event : profiler.GetLastFrameEvents())
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%*s%s", event.Depth * 2, "", event.Name);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", (event.BeginNs - frameStartNs) / 1000000.0);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.3f", (event.EndNs - event.BeginNs) / 1000000.0);
+            }
+            ImGui::EndTable();
+        }
+#else
+        ImGui::TextDisabled("Built with RE_ENABLE_PROFILER=0.");
+#endif
+
+        ImGui::End();
+    }
+}
@@ -0,0 +1,16 @@
+﻿#pragma once
+#include "Core/PCH.h"
+
+namespace ReEngine
+{
+    // CPU时间面板：主线程上一帧的Zone列表，抓取连续多帧导出Chrome trace
+    class CpuProfilerPanel
+    {
+    public:
+        void OnImGuiRender();
+
+    private:
+        char                        mTracePath[256] = "CpuTrace.json";
+        int                         mCaptureFrames = 120;
+    };
+}
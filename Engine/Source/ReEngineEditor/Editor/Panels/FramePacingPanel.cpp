@@ -0,0 +1,65 @@
+﻿#include "FramePacingPanel.h"
+#include "imgui.h"
+#include "Core/Application.h"
+#include "Platform/Vulkan/VulkanContext.h"
+#include "Renderer/RHI/Renderer.h"
+
+namespace ReEngine
+{
+    static const char* GetVkPresentModeName(VkPresentModeKHR presentMode)
+    {
+        switch (presentMode)
+        {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:
+                return "Immediate";
+            case VK_PRESENT_MODE_MAILBOX_KHR:
+                return "Mailbox";
+            case VK_PRESENT_MODE_FIFO_KHR:
+                return "Fifo";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+                return "FifoRelaxed";
+            default:
+                return "Unknown";
+        }
+    }
+
+    void FramePacingPanel::OnImGuiRender()
+    {
+        Application& app = Application::GetInstance();
+        FramePacer& pacer = app.GetFramePacer();
+        auto context = dynamic_cast<VulkanContext*>(Renderer::GetContext().get());
+        auto swapChain = context->GetVulkanInstance()->GetSwapChain();
+
+        ImGui::Begin("Frame Pacing");
+
+        static const char* presentModes[] = { "Fifo", "Mailbox", "Immediate" };
+        static const VkPresentModeKHR vkPresentModes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+        int presentMode = (int)app.GetPresentMode();
+        if (ImGui::Combo("Present Mode", &presentMode, presentModes, IM_ARRAYSIZE(presentModes))) {
+            app.SetPresentMode((PresentMode)presentMode);
+        }
+        ImGui::Text("Active: %s", GetVkPresentModeName(swapChain->GetPresentMode()));
+        for (int32 index = 0; index < IM_ARRAYSIZE(vkPresentModes); ++index)
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("%s%s", presentModes[index], swapChain->IsPresentModeSupported(vkPresentModes[index]) ? "" : "(N/A)");
+        }
+
+        float maxFrameRate = pacer.GetMaxFrameRate();
+        if (ImGui::SliderFloat("Max FPS", &maxFrameRate, 0.0f, 360.0f, maxFrameRate > 0.0f ? "%.0f" : "Off")) {
+            pacer.SetMaxFrameRate(maxFrameRate);
+        }
+
+        bool justInTime = pacer.IsJustInTime();
+        if (ImGui::Checkbox("Just In Time Input", &justInTime)) {
+            pacer.SetJustInTime(justInTime);
+        }
+
+        ImGui::Text("Refresh Rate  %.0f Hz", pacer.GetRefreshRate());
+        ImGui::Text("Frame         %.2f ms (%.0f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        ImGui::Text("CPU Work      %.2f ms", pacer.GetPredictedWorkMs());
+        ImGui::Text("Pacing Wait   %.2f ms", pacer.GetWaitMs());
+
+        ImGui::End();
+    }
+}
@@ -0,0 +1,12 @@
+﻿#pragma once
+#include "Core/PCH.h"
+
+namespace ReEngine
+{
+    // 帧节奏面板：切换交换链的显示模式，设置帧率上限和JustInTime输入采样
+    class FramePacingPanel
+    {
+    public:
+        void OnImGuiRender();
+    };
+}
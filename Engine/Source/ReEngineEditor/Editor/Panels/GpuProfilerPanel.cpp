@@ -0,0 +1,130 @@
+﻿#include "GpuProfilerPanel.h"
+#include "imgui.h"
+#include "Platform/Vulkan/VulkanContext.h"
+#include "Renderer/RHI/Renderer.h"
+
+namespace ReEngine
+{
+    static ImU32 GetScopeColor(const std::string& name)
+    {
+        // 按名字取色，同一个Scope每帧颜色不变
+        uint32 hash = 2166136261u;
+        for (char c : name) {
+            hash = (hash ^ (uint8)c) * 16777619u;
+        }
+        return ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.75f);
+    }
+
+    void GpuProfilerPanel::OnImGuiRender()
+    {
+        auto context = dynamic_cast<VulkanContext*>(Renderer::GetContext().get());
+        VulkanGpuProfiler& profiler = context->GetGpuProfiler();
+
+        ImGui::Begin("GPU Profiler");
+
+        if (!profiler.IsSupported())
+        {
+            ImGui::TextDisabled("Timestamps are not supported on the present queue.");
+            ImGui::End();
+            return;
+        }
+
+        bool enabled = profiler.IsEnabled();
+        if (ImGui::Checkbox("Enabled", &enabled)) {
+            profiler.SetEnabled(enabled);
+        }
+
+        ImGui::InputText("Path", mTracePath, sizeof(mTracePath));
+        if (ImGui::Button("Save Chrome Trace")) {
+            profiler.SaveChromeTrace(mTracePath);
+        }
+
+        const std::deque<VulkanGpuFrameResult>& history = profiler.GetHistory();
+        if (!history.empty())
+        {
+            std::vector<float> frameTimes;
+            frameTimes.reserve(history.size());
+            for (const VulkanGpuFrameResult& frame : history) {
+                frameTimes.push_back((float)frame.DurationMs);
+            }
+            ImGui::PlotLines("GPU Frame", frameTimes.data(), (int)frameTimes.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+        }
+
+        const VulkanGpuFrameResult& frame = profiler.GetLastFrame();
+        if (frame.Scopes.empty())
+        {
+            ImGui::TextDisabled("Waiting for results...");
+            ImGui::End();
+            return;
+        }
+
+        ImGui::Text("Frame %llu  %.3f ms", (unsigned long long)frame.FrameNumber, frame.DurationMs);
+        ImGui::SliderFloat("Timeline", &mTimelineMs, 0.0f, 50.0f, mTimelineMs > 0.0f ? "%.1f ms" : "Fit");
+
+        uint32 maxDepth = 0;
+        for (const VulkanGpuScopeResult& scope : frame.Scopes) {
+            maxDepth = std::max(maxDepth, scope.Depth);
+        }
+
+        const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+        const float width     = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+        const float height    = rowHeight * (maxDepth + 1);
+        const double rangeMs  = mTimelineMs > 0.0f ? mTimelineMs : std::max(frame.DurationMs, 0.001);
+        const ImVec2 origin   = ImGui::GetCursorScreenPos();
+
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(30, 30, 30, 255));
+
+        ImGui::InvisibleButton("##GpuTimeline", ImVec2(width, height));
+        const bool hovered = ImGui::IsItemHovered();
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+        for (const VulkanGpuScopeResult& scope : frame.Scopes)
+        {
+            const float x0 = origin.x + (float)(scope.BeginMs / rangeMs) * width;
+            const float x1 = std::max(origin.x + (float)(scope.EndMs / rangeMs) * width, x0 + 1.0f);
+            const float y0 = origin.y + scope.Depth * rowHeight;
+            const float y1 = y0 + rowHeight - 1.0f;
+            if (x0 > origin.x + width) {
+                continue;
+            }
+
+            drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), GetScopeColor(scope.Name));
+
+            // 放得下时才画名字
+            const ImVec2 textSize = ImGui::CalcTextSize(scope.Name.c_str());
+            if (textSize.x + 4.0f < x1 - x0)
+            {
+                drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+                drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(255, 255, 255, 255), scope.Name.c_str());
+                drawList->PopClipRect();
+            }
+
+            if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+                ImGui::SetTooltip("%s\n%.3f ms", scope.Name.c_str(), scope.EndMs - scope.BeginMs);
+            }
+        }
+
+        if (ImGui::BeginTable("GpuScopes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("Start (ms)");
+            ImGui::TableSetupColumn("Time (ms)");
+            ImGui::TableHeadersRow();
+
+            for (const VulkanGpuScopeResult& scope : frame.Scopes)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%*s%s", scope.Depth * 2, "", scope.Name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", scope.BeginMs);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.3f", scope.EndMs - scope.BeginMs);
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+#include "Core/PCH.h"
+
+namespace ReEngine
+{
+    // GPU时间面板：最近读回的一帧按Scope画成时间轴，每层嵌套一行，可以导出Chrome trace
+    class GpuProfilerPanel
+    {
+    public:
+        void OnImGuiRender();
+
+    private:
+        char                        mTracePath[256] = "GpuTrace.json";
+        // 时间轴横向覆盖的毫秒数，0表示按这一帧的长度
+        float                       mTimelineMs = 0.0f;
+    };
+}
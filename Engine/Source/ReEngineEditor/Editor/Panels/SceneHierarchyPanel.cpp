@@ -287,6 +287,15 @@ namespace ReEngine
 			{
 				auto& src = entity.GetComponent<SpriteRenderComponent>();
 				ImGui::ColorEdit4("Color", glm::value_ptr(src.Color));
+
+				char buffer[256];
+				memset(buffer, 0, sizeof(buffer));
+				strcpy_s(buffer, sizeof(buffer), src.TexturePath.c_str());
+				if (ImGui::InputText("Texture", buffer, sizeof(buffer), ImGuiInputTextFlags_EnterReturnsTrue))
+				{
+					src.TexturePath = std::string(buffer);
+					src.Texture = nullptr;
+				}
 				ImGui::TreePop();
 			}
 
@@ -0,0 +1,184 @@
+﻿#include "VulkanMemoryPanel.h"
+#include "imgui.h"
+#include "glm/glm.hpp"
+
+namespace ReEngine
+{
+    static float ToMB(uint64 bytes)
+    {
+        return (float)bytes / 1024.0f / 1024.0f;
+    }
+
+    void VulkanMemoryPanel::OnImGuiRender()
+    {
+        VulkanMemoryTracker& tracker = VulkanMemoryTracker::GetInstance();
+
+        ImGui::Begin("Vulkan Memory");
+
+        bool enabled = tracker.IsEnabled();
+        if (ImGui::Checkbox("Tracking", &enabled)) {
+            tracker.SetEnabled(enabled);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Auto Refresh", &mAutoRefresh);
+        ImGui::SameLine();
+        if (ImGui::Button("Refresh") || mAutoRefresh) {
+            mSnapshot = tracker.CaptureSnapshot("Current");
+        }
+
+        for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind) {
+            ImGui::Text("%-12s %8.2f MB  %6u allocations", GetMemoryTrackKindName((VulkanMemoryTrackKind)kind), ToMB(mSnapshot.TotalBytes[kind]), mSnapshot.TotalCount[kind]);
+        }
+
+        ImGui::InputText("Path", mSnapshotPath, sizeof(mSnapshotPath));
+        if (ImGui::Button("Save Snapshot")) {
+            mSnapshot.SaveToFile(mSnapshotPath);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Load Baseline"))
+        {
+            mHasBaseline = mBaseline.LoadFromFile(mSnapshotPath);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Set Baseline"))
+        {
+            mBaseline    = mSnapshot;
+            mHasBaseline = true;
+        }
+
+        ImGui::SliderInt("Top", &mTopCount, 5, 100);
+
+        if (ImGui::CollapsingHeader("Callsites", ImGuiTreeNodeFlags_DefaultOpen)) {
+            DrawCallsites();
+        }
+        if (ImGui::CollapsingHeader("Memory Types")) {
+            DrawMemoryTypes();
+        }
+        if (ImGui::CollapsingHeader("Pages")) {
+            DrawPages();
+        }
+        if (mHasBaseline && ImGui::CollapsingHeader("Diff", ImGuiTreeNodeFlags_DefaultOpen)) {
+            DrawDiff();
+        }
+
+        ImGui::End();
+    }
+
+    void VulkanMemoryPanel::DrawCallsites()
+    {
+        if (!ImGui::BeginTable("Callsites", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable)) {
+            return;
+        }
+
+        ImGui::TableSetupColumn("Callsite");
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Peak MB");
+        ImGui::TableHeadersRow();
+
+        const int32 count = glm::min((int32)mSnapshot.Callsites.size(), mTopCount);
+        for (int32 index = 0; index < count; ++index)
+        {
+            const VulkanMemoryCallsiteStats& stats = mSnapshot.Callsites[index];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s(%u)", stats.File.c_str(), stats.Line);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(GetMemoryTrackKindName(stats.Kind));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", ToMB(stats.Bytes));
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.Count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", ToMB(stats.PeakBytes));
+        }
+
+        ImGui::EndTable();
+    }
+
+    void VulkanMemoryPanel::DrawMemoryTypes()
+    {
+        if (!ImGui::BeginTable("MemoryTypes", 1 + (int32)VulkanMemoryTrackKind::Count, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            return;
+        }
+
+        ImGui::TableSetupColumn("Type");
+        for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind) {
+            ImGui::TableSetupColumn(GetMemoryTrackKindName((VulkanMemoryTrackKind)kind));
+        }
+        ImGui::TableHeadersRow();
+
+        for (int32 index = 0; index < mSnapshot.MemoryTypes.size(); ++index)
+        {
+            const VulkanMemoryTypeStats& stats = mSnapshot.MemoryTypes[index];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.MemoryTypeIndex);
+            for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f MB (%u)", ToMB(stats.Bytes[kind]), stats.Count[kind]);
+            }
+        }
+
+        ImGui::EndTable();
+    }
+
+    void VulkanMemoryPanel::DrawPages()
+    {
+        if (mSnapshot.Pages.size() == 0)
+        {
+            ImGui::TextUnformatted("No resource heap pages.");
+            return;
+        }
+
+        for (int32 index = 0; index < mSnapshot.Pages.size(); ++index)
+        {
+            const VulkanMemoryPageStats& stats = mSnapshot.Pages[index];
+            const float utilization = stats.Size > 0 ? (float)stats.UsedSize / (float)stats.Size : 0.0f;
+
+            char overlay[128];
+            snprintf(overlay, sizeof(overlay), "%s %u Type %u  %.1f/%.1f MB  %u allocs  frag %.0f%%",
+                stats.IsSubBuffer ? "Buffer" : "Page", stats.PageID, stats.MemoryTypeIndex,
+                ToMB(stats.UsedSize), ToMB(stats.Size), stats.NumAllocations, stats.GetFragmentation() * 100.0f);
+            ImGui::ProgressBar(utilization, ImVec2(-1.0f, 0.0f), overlay);
+        }
+    }
+
+    void VulkanMemoryPanel::DrawDiff()
+    {
+        mDiff = VulkanMemorySnapshot::Diff(mBaseline, mSnapshot);
+
+        for (int32 kind = 0; kind < (int32)VulkanMemoryTrackKind::Count; ++kind) {
+            ImGui::Text("%-12s %+8.2f MB", GetMemoryTrackKindName((VulkanMemoryTrackKind)kind), (float)mDiff.DeltaTotalBytes[kind] / 1024.0f / 1024.0f);
+        }
+
+        if (!ImGui::BeginTable("Diff", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable)) {
+            return;
+        }
+
+        ImGui::TableSetupColumn("Callsite");
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("Delta MB");
+        ImGui::TableSetupColumn("Delta Count");
+        ImGui::TableHeadersRow();
+
+        const int32 count = glm::min((int32)mDiff.Callsites.size(), mTopCount);
+        for (int32 index = 0; index < count; ++index)
+        {
+            const VulkanMemorySnapshotDiff::Entry& entry = mDiff.Callsites[index];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s(%u)", entry.File.c_str(), entry.Line);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(GetMemoryTrackKindName(entry.Kind));
+            ImGui::TableNextColumn();
+            ImGui::Text("%+.2f", (float)entry.DeltaBytes / 1024.0f / 1024.0f);
+            ImGui::TableNextColumn();
+            ImGui::Text("%+d", entry.DeltaCount);
+        }
+
+        ImGui::EndTable();
+    }
+}
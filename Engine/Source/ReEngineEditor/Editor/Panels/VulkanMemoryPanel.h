@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "Core/PCH.h"
+#include "Platform/Vulkan/VulkanMemoryTracker.h"
+
+namespace ReEngine
+{
+    // 显存跟踪面板，显示占用最多的调用点、每种内存类型的用量和每个页的碎片
+    // 可以记录一个基准快照，之后和当前状态做Diff
+    class VulkanMemoryPanel
+    {
+    public:
+        void OnImGuiRender();
+
+    private:
+        void DrawCallsites();
+
+        void DrawMemoryTypes();
+
+        void DrawPages();
+
+        void DrawDiff();
+
+    private:
+        VulkanMemorySnapshot        mSnapshot;
+        VulkanMemorySnapshot        mBaseline;
+        VulkanMemorySnapshotDiff    mDiff;
+        bool                        mHasBaseline = false;
+        bool                        mAutoRefresh = true;
+        int                         mTopCount = 20;
+        char                        mSnapshotPath[256] = "VulkanMemory.json";
+    };
+}
@@ -64,10 +64,6 @@ void AnimationLayer::OnUpdate(Timestep ts)
 
 void AnimationLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = FrameBuffer->m_Height;
@@ -6,6 +6,7 @@
 #include <AnimObj_vert.h>
 #include <AnimObjPack_vert.h>
 #include <AnimObj_frag.h>
+#include <AnimObjAtlas_frag.h>
 #include <FilterPixelation_frag.h>
 #include <ColorFilter_frag.h>
 #include <AnimationTexture_vert.h>
@@ -13,6 +14,8 @@
 #include "Mesh/Quad.h"
 #include "Platform/Vulkan/VulkanContext.h"
 
+#include <filesystem>
+
 void AnimationTextureLayer::OnCreateBackBuffer()
 {
     GraphicalLayer::OnCreateBackBuffer();
@@ -33,10 +36,7 @@ void AnimationTextureLayer::OnDeInit()
     SceneModel.reset();
     mQuad.reset();
 
-    for(auto& tex : TextureArray)
-    {
-        tex.reset();
-    }
+    DiffuseAtlas.reset();
     
     ColorRT.reset();
     DepthRT.reset();
@@ -61,7 +61,6 @@ void AnimationTextureLayer::OnUpdate(Timestep ts)
     m_MVPData.animIndex.x = 64;
     m_MVPData.animIndex.y = 64;
     m_MVPData.animIndex.z = SceneModel->AnimationIndex() * SceneModel->Meshes[0]->Bones.size() * 4;
-    m_MVPData.animIndex.w = 0;
     
     SceneModel->RootNode->LocalMatrix = glm::rotate(SceneModel->RootNode->LocalMatrix,ts.GetSeconds() *  glm::radians(45.0f),glm::vec3(0.0f, 1.0f, 0.0f));
     
@@ -74,10 +73,6 @@ void AnimationTextureLayer::OnUpdate(Timestep ts)
 
 void AnimationTextureLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = FrameBuffer->m_Height;
@@ -98,11 +93,15 @@ void AnimationTextureLayer::OnRender()
     vkCmdBindPipeline(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS,SceneMaterial->mPipeline->Pipeline);
     
     {
-        SceneMaterial->SetTexture("DiffuseMap",TextureArray[0]); 
+        SceneMaterial->SetTexture("DiffuseMap",DiffuseAtlas->GetTexture()); 
 
-        for(auto& Mesh :SceneModel->Meshes )
+        for(int32 meshIndex = 0; meshIndex < SceneModel->Meshes.size(); meshIndex++)
         {
+            auto& Mesh = SceneModel->Meshes[meshIndex];
+            const uint32 atlasIndex = MeshAtlasIndex[meshIndex];
             m_MVPData.model = Mesh->LinkNode.lock()->GetGlobalMatrix();
+            m_MVPData.atlasRect = DiffuseAtlas->GetUVRect(atlasIndex);
+            m_MVPData.animIndex.w = (float)DiffuseAtlas->GetRect(atlasIndex).Layer;
             
             SceneMaterial->SetLocalUniform("uboMVP",&m_MVPData,sizeof(ModelViewProjectionBlock));
             SceneMaterial->SetTexture("BonesTexture",AnimTexture);
@@ -200,7 +199,7 @@ void AnimationTextureLayer::LoadAsset()
     m_RingBuffer->OnCreate(VkContext->Instance->GetDevice(),3,200 * 1024 * 1024);
 
     {
-        SceneShader = VulkanShader::Create(device,true,&ANIMATIONTEXTURE_VERT,&ANIMOBJ_FRAG,nullptr,nullptr,nullptr,nullptr); 
+        SceneShader = VulkanShader::Create(device,true,&ANIMATIONTEXTURE_VERT,&ANIMOBJATLAS_FRAG,nullptr,nullptr,nullptr,nullptr); 
         SceneMaterial = VulkanMaterial::Create(
             device,
             RenderTarget->GetRenderPass(),
@@ -225,14 +224,21 @@ void AnimationTextureLayer::LoadAsset()
         "Assets/Mesh/xiaonan/b001.jpg"
     };
     
-    TextureArray.resize(diffusePaths.size());
-    for(int32 index = 0 ; index < diffusePaths.size();index++)
+    DiffuseAtlas = VulkanTextureAtlas::Create(diffusePaths, device, cmdBuffer);
+
+    // 材质里的贴图名是去掉目录和扩展名的文件名，找不到的用第一张
+    MeshAtlasIndex.resize(SceneModel->Meshes.size(), 0);
+    for(int32 meshIndex = 0; meshIndex < SceneModel->Meshes.size(); meshIndex++)
     {
-        TextureArray[index] = VulkanTexture::Create2D(
-            diffusePaths[index],
-            device,
-            cmdBuffer
-        );
+        const std::string& DiffuseName = SceneModel->Meshes[meshIndex]->Material.Diffuse;
+        for(int32 index = 0 ; index < diffusePaths.size();index++)
+        {
+            if (std::filesystem::path(diffusePaths[index]).stem().string() == DiffuseName)
+            {
+                MeshAtlasIndex[meshIndex] = index;
+                break;
+            }
+        }
     }
 
     {
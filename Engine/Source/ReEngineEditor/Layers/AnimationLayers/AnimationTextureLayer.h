@@ -3,6 +3,7 @@
 #include "Camera/EditorCamera.h"
 #include "Platform/Vulkan/VulkanMaterial.h"
 #include "Platform/Vulkan/Mesh/VulkanMesh.h"
+#include "Platform/Vulkan/VulkanTextureAtlas.h"
 
 
 class AnimationTextureLayer : public GraphicalLayer
@@ -34,7 +35,9 @@ private:
     Ref<VulkanModel> SceneModel;
     Ref<VulkanShader> SceneShader;
     Ref<VulkanMaterial> SceneMaterial;
-    std::vector<Ref<VulkanTexture>> TextureArray;
+    // 漫反射贴图打包成一张数组贴图，Mesh按材质的贴图名找自己的区域
+    Ref<VulkanTextureAtlas> DiffuseAtlas;
+    std::vector<uint32> MeshAtlasIndex;
 
     Ref<VulkanTexture> AnimTexture;
 
@@ -47,6 +50,7 @@ private:
         glm::mat4 view;
         glm::mat4 projection;
         glm::vec4 animIndex;
+        glm::vec4 atlasRect;
     }m_MVPData;
     
 
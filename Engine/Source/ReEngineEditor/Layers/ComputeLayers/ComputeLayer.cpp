@@ -63,9 +63,22 @@ void ComputeLayer::OnUpdate(Timestep ts)
 
 void ComputeLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
+    if (m_FiltersDirty)
+    {
+        DispatchFilters();
+    }
+
+    if (m_FiltersDirty)
+    {
+        // 计算队列交回来的原图和滤镜结果
+        VulkanAsyncCompute& AsyncCompute = VkContext->GetAsyncCompute();
+        AsyncCompute.AcquireImage(VkContext->GetCommandList(), mTexture->Image, GetColorRange(mTexture), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
+        for(int32 i = 0 ; i < 3 ; ++i)
+        {
+            AsyncCompute.AcquireImage(VkContext->GetCommandList(), ComputeTargets[i]->Image, GetColorRange(ComputeTargets[i]), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
+        }
+        m_FiltersDirty = false;
+    }
     
     VkViewport viewport = {};
     viewport.x        = 0;
@@ -299,13 +312,8 @@ void ComputeLayer::ProcessImage()
         ComputeMaterial[i]->SetStorageTexture("outputImage",ComputeTargets[i]);
     }
 
-    CmdBuffer->Begin();
-    for(int32 i = 0 ; i < 3 ; ++i)
-    {
-        ComputeMaterial[i]->BindDispatch(CmdBuffer->CmdBuffer,ComputeTargets[i]->Width / 16, ComputeTargets[i]->Height / 16, 1);
-    }
-    CmdBuffer->End();
-    CmdBuffer->Submit();
+    // 滤镜不在这里阻塞提交，第一帧在计算队列上异步执行
+    m_FiltersDirty = true;
 
     m_FilterIndex = 0;
     m_FilterNames.resize(4);
@@ -314,3 +322,40 @@ void ComputeLayer::ProcessImage()
     m_FilterNames[2] = "Gamma";
     m_FilterNames[3] = "ColorInvert";
 }
+
+VkImageSubresourceRange ComputeLayer::GetColorRange(const Ref<VulkanTexture>& texture)
+{
+    VkImageSubresourceRange range = { };
+    range.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel   = 0;
+    range.levelCount     = texture->MipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount     = texture->LayerCount;
+    return range;
+}
+
+void ComputeLayer::DispatchFilters()
+{
+    VulkanAsyncCompute& AsyncCompute = VkContext->GetAsyncCompute();
+
+    // 原图是在图形队列上传的，先交给计算队列
+    // 滤镜结果是在计算队列上创建的，本来就归计算队列
+    VkCommandBuffer ReleaseCmd = AsyncCompute.BeginGraphics();
+    AsyncCompute.ReleaseImage(ReleaseCmd, mTexture->Image, GetColorRange(mTexture), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, true);
+    const uint64 ReleasePoint = AsyncCompute.SubmitGraphics(ReleaseCmd);
+
+    VkCommandBuffer FilterCmd = AsyncCompute.BeginCompute();
+    AsyncCompute.AcquireImage(FilterCmd, mTexture->Image, GetColorRange(mTexture), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, true);
+    for(int32 i = 0 ; i < 3 ; ++i)
+    {
+        ComputeMaterial[i]->BindDispatch(FilterCmd,ComputeTargets[i]->Width / 16, ComputeTargets[i]->Height / 16, 1);
+    }
+
+    AsyncCompute.ReleaseImage(FilterCmd, mTexture->Image, GetColorRange(mTexture), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
+    for(int32 i = 0 ; i < 3 ; ++i)
+    {
+        AsyncCompute.ReleaseImage(FilterCmd, ComputeTargets[i]->Image, GetColorRange(ComputeTargets[i]), ImageLayoutBarrier::ComputeGeneralRW, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, false);
+    }
+
+    AsyncCompute.SubmitCompute(FilterCmd, ReleasePoint, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
@@ -21,9 +21,13 @@ private:
     void CreateRenderTarget();
     void LoadAsset();
     void ProcessImage();
+    // 在计算队列上跑三个滤镜，主CommandBuffer在片元着色前等它
+    void DispatchFilters();
+    static VkImageSubresourceRange GetColorRange(const Ref<VulkanTexture>& texture);
     
 private:
     bool mReady = false;
+    bool m_FiltersDirty = false;
 
     Ref<VulkanModel> PlaneModel = nullptr;
     Ref<VulkanMaterial> mMaterial = nullptr;
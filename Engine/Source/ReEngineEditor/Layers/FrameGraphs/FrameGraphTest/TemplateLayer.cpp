@@ -48,10 +48,6 @@ void FrameGraphTemplateLayer::OnUpdate(Timestep ts)
 
 void FrameGraphTemplateLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = FrameBuffer->m_Height;
@@ -99,9 +95,10 @@ void FrameGraphTemplateLayer::OnRender()
 
 void FrameGraphTemplateLayer::OnUIRender(Timestep ts)
 {
-    /*
-     * TODO Write your logic
-     */
+    mMemoryPanel.OnImGuiRender();
+    mFramePacingPanel.OnImGuiRender();
+    mGpuProfilerPanel.OnImGuiRender();
+    mCpuProfilerPanel.OnImGuiRender();
 }
 
 void FrameGraphTemplateLayer::OnChangeWindowSize(std::shared_ptr<ReEngine::Event> e)
@@ -5,6 +5,10 @@
 #include "Camera/EditorCamera.h"
 #include "Platform/Vulkan/RenderGraph/RenderGraph.h"
 #include "ReEngineEditor/Layers/GraphicalLayer.h"
+#include "ReEngineEditor/Editor/Panels/VulkanMemoryPanel.h"
+#include "ReEngineEditor/Editor/Panels/FramePacingPanel.h"
+#include "ReEngineEditor/Editor/Panels/GpuProfilerPanel.h"
+#include "ReEngineEditor/Editor/Panels/CpuProfilerPanel.h"
 
 class FrameGraphTemplateLayer : public GraphicalLayer
 {
@@ -33,5 +37,10 @@ private:
 
     FrameGraphBuilder                               mFrameGraphBuilder;
     FrameGraph                                      mFrameGraph;
+
+    ReEngine::VulkanMemoryPanel                     mMemoryPanel;
+    ReEngine::FramePacingPanel                      mFramePacingPanel;
+    ReEngine::GpuProfilerPanel                      mGpuProfilerPanel;
+    ReEngine::CpuProfilerPanel                      mCpuProfilerPanel;
     
 };
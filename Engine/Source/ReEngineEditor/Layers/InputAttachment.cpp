@@ -205,6 +205,7 @@ void InputAttachment::OnDeInit()
     m_Shader1.reset();
     m_EffectShader.reset();
     
+    m_PassCache.Destroy();
     m_RingBuffer.reset();
     
     for(auto Index = 0; Index < m_AttachmentColors.size(); Index++)
@@ -230,9 +231,6 @@ void InputAttachment::OnUpdate(Timestep ts)
 
 void InputAttachment::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-
     VkClearValue clearValues[4];
     clearValues[0].color        = {
         { 0.2f, 0.2f, 0.2f, 0.0f }
@@ -272,28 +270,33 @@ void InputAttachment::OnRender()
     int32 i = VkContext->GetCurrtIndex();
     renderPassBeginInfo.framebuffer = FrameBuffer->m_FrameBuffers[i];
 
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    vkCmdBeginRenderPass(VkContext->GetCommandList(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(VkContext->GetCommandList(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    vkCmdSetViewport(VkContext->GetCommandList(), 0, 1, &viewport);
-    vkCmdSetScissor(VkContext->GetCommandList(),  0, 1, &scissor);
-    
-    // pass0
+    // pass0只和相机、角色变换和效果参数有关，房间是静态的，都没变时直接复用上一次的录制
+    VulkanPassKey passKey;
+    passKey.Add(MvpBlock.view).Add(MvpBlock.projection);
+    passKey.Add(m_Role->RootNode->LocalMatrix).Add(m_RayData);
+    passKey.Add(FrameBuffer->m_Width).Add(FrameBuffer->m_Height);
+
+    m_PassCache.ExecutePass(VkContext->GetCommandList(), FrameBuffer->m_RenderPass, 0, passKey.Get(), [&](VkCommandBuffer cmdBuffer)
     {
+        vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(cmdBuffer,  0, 1, &scissor);
+
         //Role
-        vkCmdBindPipeline(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_RoleMaterial->mPipeline->Pipeline);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RoleMaterial->mPipeline->Pipeline);
         for (int32 meshIndex = 0; meshIndex < m_Role->Meshes.size(); ++meshIndex)
         {
             MvpBlock.model =  m_Role->Meshes[meshIndex]->LinkNode.lock()->GetGlobalMatrix();
             m_RoleMaterial->SetTexture("DiffuseMap",m_RoleDiffuse);
             m_RoleMaterial->SetLocalUniform("uboMVP",&MvpBlock,sizeof(MVPBlock));
             
-            m_RoleMaterial->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
-            m_Role->Meshes[meshIndex]->BindDraw(VkContext->GetCommandList());
+            m_RoleMaterial->BindDescriptorSets(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS);
+            m_Role->Meshes[meshIndex]->BindDraw(cmdBuffer);
         }
 
         //Room
-        vkCmdBindPipeline(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_Material0->mPipeline->Pipeline); 
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Material0->mPipeline->Pipeline); 
         for (int32 textureIndex = 0; textureIndex < m_SceneMeshes.size(); ++textureIndex)
         {
             m_Material0->SetTexture("DiffuseMap",m_ModelDiffuses[textureIndex]);
@@ -302,27 +305,31 @@ void InputAttachment::OnRender()
                 MvpBlock.model = Meshes->LinkNode.lock()->GetGlobalMatrix();
             
                 m_Material0->SetLocalUniform("uboMVP",&MvpBlock,sizeof(MVPBlock));
-                m_Material0->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
+                m_Material0->BindDescriptorSets(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS);
 
-                Meshes->BindDraw(VkContext->GetCommandList());
+                Meshes->BindDraw(cmdBuffer);
             }
         }
 
         //Ray
-        vkCmdBindPipeline(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_EffectMaterial1->mPipeline->Pipeline);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_EffectMaterial1->mPipeline->Pipeline);
         for (int32 meshIndex = 0; meshIndex < m_Role->Meshes.size(); ++meshIndex)
         { 
             MvpBlock.model =  m_Role->Meshes[meshIndex]->LinkNode.lock()->GetGlobalMatrix();
             
             m_EffectMaterial1->SetLocalUniform("uboMVP",&MvpBlock,sizeof(MVPBlock));
             m_EffectMaterial1->SetLocalUniform("rayParam",&m_RayData,sizeof(RayParamBlock));
-            m_EffectMaterial1->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
+            m_EffectMaterial1->BindDescriptorSets(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS);
 
-            m_Role->Meshes[meshIndex]->BindDraw(VkContext->GetCommandList());
+            m_Role->Meshes[meshIndex]->BindDraw(cmdBuffer);
         }
-    }
+    });
 
     vkCmdNextSubpass(VkContext->GetCommandList(), VK_SUBPASS_CONTENTS_INLINE);
+
+    // Execute之后主CommandBuffer的动态状态失效，重新设置
+    vkCmdSetViewport(VkContext->GetCommandList(), 0, 1, &viewport);
+    vkCmdSetScissor(VkContext->GetCommandList(),  0, 1, &scissor);
     
     // // pass1
     {
@@ -378,7 +385,8 @@ void InputAttachment::OnUIRender(Timestep ts)
 
 void InputAttachment::OnChangeWindowSize(std::shared_ptr<ReEngine::Event> e)
 {
-   
+    // RenderPass和附件都重建了，句柄可能和原来的相同
+    m_PassCache.Invalidate();
 }
 
 void InputAttachment::CreateAttachments()
@@ -539,15 +547,18 @@ void InputAttachment::CreateBuffers()
         "Assets/Mesh/Room/miniHouse_Part4.jpg"
     };
 
-    m_ModelDiffuses.resize(diffusePaths.size());
+    // 场景和角色的贴图一起解码上传
+    std::vector<VulkanTextureLoadDesc> textureDescs(diffusePaths.size() + 1);
     for(int32 index = 0 ; index < diffusePaths.size();index++)
     {
-        m_ModelDiffuses[index] = VulkanTexture::Create2D(
-            diffusePaths[index],
-            device,
-            cmdBuffer
-        );
+        textureDescs[index].Filename = diffusePaths[index];
     }
+    textureDescs.back().Filename = "Assets/Mesh/LizardMage/Body_colors1.jpg";
+
+    std::vector<Ref<VulkanTexture>> textures = VkContext->GetTextureLoader().LoadBatch(textureDescs);
+    m_RoleDiffuse = textures.back();
+    textures.pop_back();
+    m_ModelDiffuses = textures;
 
     m_SceneMeshes.resize(diffusePaths.size());
     for(const auto& Mesh : m_Model->Meshes)
@@ -578,11 +589,6 @@ void InputAttachment::CreateBuffers()
         cmdBuffer,
         m_Shader0->perVertexAttributes
     );
-    m_RoleDiffuse = VulkanTexture::Create2D(
-            "Assets/Mesh/LizardMage/Body_colors1.jpg",
-            device,
-            cmdBuffer
-    );
     
     // quad model
     Quad DebugQuad;
@@ -597,6 +603,8 @@ void InputAttachment::CreateBuffers()
     
     m_RingBuffer = CreateRef<VulkanDynamicBufferRing>();
     m_RingBuffer->OnCreate(VkContext->Instance->GetDevice(),3,200 * 1024 * 1024);
+
+    m_PassCache.Init(device, m_RingBuffer, VkContext->CommandPool->GetFramesInFlight());
     
     m_DebugParam.zNear = 0.1f;
     m_DebugParam.zFar = 1000.0f;
@@ -3,6 +3,7 @@
 #include "Camera/EditorCamera.h"
 #include "Platform/Vulkan/VulkanMaterial.h"
 #include "Platform/Vulkan/Mesh/VulkanMesh.h"
+#include "Platform/Vulkan/VulkanPassCache.h"
 
 #define NUM_LIGHTS 64
 
@@ -76,6 +77,8 @@ protected:
     Ref<EditorCamera>                               m_Camera = nullptr;        
     
     Ref<VulkanDynamicBufferRing>                    m_RingBuffer = nullptr;
+    // pass0的录制缓存
+    VulkanPassCache                                 m_PassCache;
     
     Ref<VulkanModel>                                m_Model = nullptr;
     std::vector<Ref<VulkanTexture>>                 m_ModelDiffuses;
@@ -180,10 +180,6 @@ void MSAALayer::OnRender()
     
     VkCommandBuffer commandBuffer = VkContext->GetCommandList();
 
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(commandBuffer, &cmdBeginInfo));
-
     std::vector<VkClearValue> clearValues;
 
     clearValues.resize(3);
@@ -85,10 +85,6 @@ void SimplePathTracing::OnUpdate(Timestep ts)
 
 void SimplePathTracing::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = FrameBuffer->m_Height;
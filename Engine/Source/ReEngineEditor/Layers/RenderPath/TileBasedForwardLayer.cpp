@@ -1,4 +1,4 @@
-#include "TileBasedForwardLayer.h"
+﻿#include "TileBasedForwardLayer.h"
 
 #include <ColorFilter_frag.h>
 #include <quad_vert.h>
@@ -13,6 +13,7 @@
 
 #include "Math/Math.h"
 #include "Platform/Vulkan/VulkanContext.h"
+#include "RenderGraph/RenderScene.h"
 
 #include "Mesh/Quad.h"
 
@@ -73,97 +74,162 @@ void TileBasedForwardLayer::OnUpdate(Timestep ts)
 
 void TileBasedForwardLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
+    // 场景走传输队列分帧上传，全部提交之前只清屏
+    const uint32 DrawCount = Model->IsResident() ? (uint32)Model->Meshes.size() : 0;
+
+    // PreDepth单独提交，灯光剔除在计算队列上等它，和主CommandBuffer的录制、上一帧的着色重叠
+    VulkanAsyncCompute& AsyncCompute = VkContext->GetAsyncCompute();
+
+    VkImageSubresourceRange DepthRange = { };
+    DepthRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    DepthRange.baseMipLevel   = 0;
+    DepthRange.levelCount     = 1;
+    DepthRange.baseArrayLayer = 0;
+    DepthRange.layerCount     = PreDepthTexture->Depth;
 
     //PreDepthPass
+    VkCommandBuffer PreDepthCmd = AsyncCompute.BeginGraphics();
     {
-        PreDepthRenderTarget->BeginRenderPass(VkContext->GetCommandList());
-        for(int32 i = 0 ; i < Model->Meshes.size() ;++i)
+        // 整个DrawList的MVP一次写进Ring，按Chunk大小分段
+        m_MVPData.view = m_Camera->GetViewMatrix();
+        m_MVPData.projection = m_Camera->GetProjection();
+        const bool PreDepthBatched = PreDepthMaterial->BeginUniformBatch(PreDepthBatchSlots, DrawCount);
+        if (PreDepthBatched)
         {
-            vkCmdBindPipeline(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS,PreDepthMaterial->mPipeline->Pipeline);
-
-            m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GetGlobalMatrix();
-            m_MVPData.view = m_Camera->GetViewMatrix();
-            m_MVPData.projection = m_Camera->GetProjection();
+            for(int32 i = 0 ; i < DrawCount ;++i)
+            {
+                m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GetGlobalMatrix();
+                PreDepthMaterial->SetBatchUniform(i, 0, &m_MVPData, sizeof(MVPBlock));
+            }
+        }
 
-            PreDepthMaterial->SetLocalUniform("uboMVP",&m_MVPData,sizeof(MVPBlock));
-            PreDepthMaterial->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
+        // 批量上传失败时逐个物体上传，要改材质状态，只能在主CommandBuffer上顺序录制
+        const bool PreDepthSecondary = use_secondary_command_buffers && PreDepthBatched;
+        PreDepthRenderTarget->BeginRenderPass(PreDepthCmd, PreDepthSecondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-            Model->Meshes[i]->BindDraw(VkContext->GetCommandList());
+        if (PreDepthSecondary)
+        {
+            VkContext->GetParallelRecorder().RecordPass(
+                PreDepthCmd,
+                PreDepthRenderTarget->GetRenderPass(),
+                0,
+                PreDepthRenderTarget->GetFrameBuffer(),
+                DrawCount,
+                [this](VkCommandBuffer cmdBuffer, uint32 drawBegin, uint32 drawEnd)
+                {
+                    PreDepthRenderTarget->SetViewportScissor(cmdBuffer);
+                    vkCmdBindPipeline(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,PreDepthMaterial->mPipeline->Pipeline);
+                    for(uint32 i = drawBegin ; i < drawEnd ;++i)
+                    {
+                        PreDepthMaterial->BindUniformBatch(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,i);
+                        Model->Meshes[i]->BindDraw(cmdBuffer);
+                    }
+                });
+        }
+        else
+        {
+            for(int32 i = 0 ; i < DrawCount ;++i)
+            {
+                vkCmdBindPipeline(PreDepthCmd,VK_PIPELINE_BIND_POINT_GRAPHICS,PreDepthMaterial->mPipeline->Pipeline);
+
+                if (PreDepthBatched)
+                {
+                    PreDepthMaterial->ApplyUniformBatch(i);
+                }
+                else
+                {
+                    m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GetGlobalMatrix();
+                    PreDepthMaterial->SetLocalUniform(PreDepthBatchSlots[0], &m_MVPData, sizeof(MVPBlock));
+                }
+                PreDepthMaterial->BindDescriptorSets(PreDepthCmd,VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+                Model->Meshes[i]->BindDraw(PreDepthCmd);
+            }
         }
         
-        PreDepthRenderTarget->EndRenderPass(VkContext->GetCommandList());
+        PreDepthRenderTarget->EndRenderPass(PreDepthCmd);
     }
     
+    // 深度和剔除结果交给计算队列
+    AsyncCompute.ReleaseImage(PreDepthCmd, PreDepthTexture->Image, DepthRange, ImageLayoutBarrier::PixelShaderRead, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true);
+    AsyncCompute.ReleaseBuffer(PreDepthCmd, LightCullingBuffer->Buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, true);
+    const uint64 PreDepthPoint = AsyncCompute.SubmitGraphics(PreDepthCmd);
+    
     //ComputePass
     {
-        VkBufferMemoryBarrier bufferBarrier;
-        ZeroVulkanStruct(bufferBarrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
-        bufferBarrier.buffer = LightCullingBuffer->Buffer;
-        bufferBarrier.size   = LightCullingBuffer->Size;
-        bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        
-        bufferBarrier.srcQueueFamilyIndex = VkContext->GetVulkanInstance()->GetDevice()->GetGraphicsQueue()->GetFamilyIndex();
-        bufferBarrier.dstQueueFamilyIndex = VkContext->GetVulkanInstance()->GetDevice()->GetComputeQueue()->GetFamilyIndex();
-
-        vkCmdPipelineBarrier(
-            VkContext->GetCommandList(),
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            0,
-            0,
-            nullptr,
-            1,
-            &bufferBarrier,
-            0,
-            nullptr
-        );
+        VkCommandBuffer CullingCmd = AsyncCompute.BeginCompute();
+        AsyncCompute.AcquireImage(CullingCmd, PreDepthTexture->Image, DepthRange, ImageLayoutBarrier::PixelShaderRead, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, true);
+        AsyncCompute.AcquireBuffer(CullingCmd, LightCullingBuffer->Buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, true);
 
         ComputeProcessor->SetUniform("uboCulling", &CullingParam,sizeof(CullingParamBlock));
         ComputeProcessor->SetUniform("uboLights", &LightParam,sizeof(LightsParamBlock));
         ComputeProcessor->SetTexture("depthTexture",PreDepthTexture);
         
-        ComputeProcessor->BindDispatch(VkContext->GetCommandList(), TileCountPerRow, TileCountPerColumn, 1);
-
-        bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        bufferBarrier.srcQueueFamilyIndex = VkContext->GetVulkanInstance()->GetDevice()->GetComputeQueue()->GetFamilyIndex();
-        bufferBarrier.dstQueueFamilyIndex = VkContext->GetVulkanInstance()->GetDevice()->GetGraphicsQueue()->GetFamilyIndex();
-
-        vkCmdPipelineBarrier(
-            VkContext->GetCommandList(),
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0,
-            nullptr,
-            1,
-            &bufferBarrier,
-            0,
-            nullptr
-        );
+        ComputeProcessor->BindDispatch(CullingCmd, TileCountPerRow, TileCountPerColumn, 1);
+
+        AsyncCompute.ReleaseBuffer(CullingCmd, LightCullingBuffer->Buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, false);
+        AsyncCompute.SubmitCompute(CullingCmd, PreDepthPoint, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
     }
+
+    AsyncCompute.AcquireBuffer(VkContext->GetCommandList(), LightCullingBuffer->Buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
     
     // Obj Pass
     {
-        RenderTarget->BeginRenderPass(VkContext->GetCommandList());
-    
-        for (int32 i = 0 ; i < Model->Meshes.size();++i)
-        {
-            vkCmdBindPipeline(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS,ModelMaterial->mPipeline->Pipeline);
+        // 灯光、剔除和调试参数所有物体共用，每帧只上传一次
+        ModelMaterial->SetLocalUniform(ModelLightsSlot,&LightParam,sizeof(LightsParamBlock));
+        ModelMaterial->SetLocalUniform(ModelCullingSlot,&CullingParam,sizeof(CullingParamBlock));
+        ModelMaterial->SetLocalUniform(ModelDebugSlot,&Debug,sizeof(glm::vec4));
 
-            m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GlobalMatrix;
-
-            ModelMaterial->SetLocalUniform("uboMVP",&m_MVPData,sizeof(MVPBlock));
-            ModelMaterial->SetLocalUniform("uboLights",&LightParam,sizeof(LightsParamBlock));
-            ModelMaterial->SetLocalUniform("uboCulling",&CullingParam,sizeof(CullingParamBlock));
-            ModelMaterial->SetLocalUniform("uboDebug",&Debug,sizeof(glm::vec4));
+        const bool ModelBatched = ModelMaterial->BeginUniformBatch(ModelBatchSlots, DrawCount);
+        if (ModelBatched)
+        {
+            for (int32 i = 0 ; i < DrawCount;++i)
+            {
+                m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GlobalMatrix;
+                ModelMaterial->SetBatchUniform(i, 0, &m_MVPData, sizeof(MVPBlock));
+            }
+        }
 
-            ModelMaterial->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
-            Model->Meshes[i]->BindDraw(VkContext->GetCommandList());
+        const bool ModelSecondary = use_secondary_command_buffers && ModelBatched;
+        RenderTarget->BeginRenderPass(VkContext->GetCommandList(), ModelSecondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    
+        if (ModelSecondary)
+        {
+            VkContext->GetParallelRecorder().RecordPass(
+                VkContext->GetCommandList(),
+                RenderTarget->GetRenderPass(),
+                0,
+                RenderTarget->GetFrameBuffer(),
+                DrawCount,
+                [this](VkCommandBuffer cmdBuffer, uint32 drawBegin, uint32 drawEnd)
+                {
+                    RenderTarget->SetViewportScissor(cmdBuffer);
+                    vkCmdBindPipeline(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,ModelMaterial->mPipeline->Pipeline);
+                    for (uint32 i = drawBegin ; i < drawEnd;++i)
+                    {
+                        ModelMaterial->BindUniformBatch(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,i);
+                        Model->Meshes[i]->BindDraw(cmdBuffer);
+                    }
+                });
+        }
+        else
+        {
+            for (int32 i = 0 ; i < DrawCount;++i)
+            {
+                vkCmdBindPipeline(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS,ModelMaterial->mPipeline->Pipeline);
+
+                if (ModelBatched)
+                {
+                    ModelMaterial->ApplyUniformBatch(i);
+                }
+                else
+                {
+                    m_MVPData.model = Model->Meshes[i]->LinkNode.lock()->GlobalMatrix;
+                    ModelMaterial->SetLocalUniform(ModelBatchSlots[0], &m_MVPData, sizeof(MVPBlock));
+                }
+                ModelMaterial->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
+                Model->Meshes[i]->BindDraw(VkContext->GetCommandList());
+            }
         }
     
         RenderTarget->EndRenderPass(VkContext->GetCommandList());
@@ -217,6 +283,13 @@ void TileBasedForwardLayer::OnUIRender(Timestep ts)
     ImGui::Combo("Debug", &index, "None\0Normal\0\Tile\0");
     Debug.x = index;
 
+    ImGui::Checkbox("Parallel Recording", &use_secondary_command_buffers);
+    ImGui::Text("Record Threads:%d Secondary:%d", VkContext->GetParallelRecorder().GetNumThreads(), VkContext->GetParallelRecorder().GetNumSecondaryRecorded());
+
+    const VulkanUploadStats UploadStats = VkContext->Instance->GetDevice()->GetUploadScheduler().GetStats();
+    ImGui::Text("Upload Queue:%d (%.2f MB) InFlight:%d", UploadStats.QueueDepth, UploadStats.QueuedBytes / (1024.0f * 1024.0f), UploadStats.NumInFlight);
+    ImGui::Text("Upload Frame:%.2f/%.2f MB Latency:%.1f ms (max %.1f)", UploadStats.BytesLastFrame / (1024.0f * 1024.0f), UploadStats.FrameBudget / (1024.0f * 1024.0f), UploadStats.AvgLatencyMs, UploadStats.MaxLatencyMs);
+
     // ImGui::Text("%.3f ms/frame (%d FPS)", 1000.0f / m_LastFPS, m_LastFPS);
     ImGui::End();
 }
@@ -281,7 +354,8 @@ void TileBasedForwardLayer::LoadAsset()
             VertexAttribute::VA_Position,
             VertexAttribute::VA_UV0,
             VertexAttribute::VA_Normal,
-        }
+        },
+        VulkanUploadPriority::Normal
     );
 
     ModelShader = VulkanShader::Create(
@@ -300,6 +374,11 @@ void TileBasedForwardLayer::LoadAsset()
     );
     ModelMaterial->mPipelineInfo.RasterizationState.cullMode = VK_CULL_MODE_NONE;
     ModelMaterial->PreparePipeline();
+
+    ModelLightsSlot  = ModelMaterial->GetUniformSlot("uboLights");
+    ModelCullingSlot = ModelMaterial->GetUniformSlot("uboCulling");
+    ModelDebugSlot   = ModelMaterial->GetUniformSlot("uboDebug");
+    ModelBatchSlots  = { ModelMaterial->GetUniformSlot("uboMVP") };
     
     InitLightParams();
 
@@ -332,6 +411,7 @@ void TileBasedForwardLayer::LoadAsset()
     PreDepthMaterial->mPipelineInfo.RasterizationState.cullMode = VK_CULL_MODE_NONE;
     PreDepthMaterial->mPipelineInfo.ColorAttachmentsCount = 0;
     PreDepthMaterial->PreparePipeline();
+    PreDepthBatchSlots = { PreDepthMaterial->GetUniformSlot("uboMVP") };
     
     LightCullingBuffer = VulkanBuffer::CreateBuffer(
         device,
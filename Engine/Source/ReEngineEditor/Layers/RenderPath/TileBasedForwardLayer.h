@@ -74,10 +74,15 @@ private:
     Ref<VulkanModel>             Model;
     Ref<VulkanShader>            ModelShader;
     Ref<VulkanMaterial>          ModelMaterial;
+    int32                        ModelLightsSlot = -1;
+    int32                        ModelCullingSlot = -1;
+    int32                        ModelDebugSlot = -1;
+    std::vector<int32>           ModelBatchSlots;
 
     // PreDepth
     Ref<VulkanShader>            PreDepthShader;
     Ref<VulkanMaterial>          PreDepthMaterial;
+    std::vector<int32>           PreDepthBatchSlots;
     Ref<VulkanTexture>           PreDepthTexture;
     Ref<VulkanRenderTarget>      PreDepthRenderTarget;
 
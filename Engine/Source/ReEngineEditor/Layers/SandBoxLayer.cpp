@@ -27,12 +27,6 @@ void SandBoxLayer::OnRender()
 	auto Context = Renderer::GetContext().get();
 	auto VulkanContext = dynamic_cast<ReEngine::VulkanContext*>(Context);
 	
-	VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-
-    vkBeginCommandBuffer(VulkanContext->GetCommandList(), &beginInfo);
-
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = FrameBuffer->m_RenderPass;
@@ -172,8 +166,9 @@ void SandBoxLayer::CreateMeshBuffer()
 		cmd,
 		{ VertexAttribute::VA_Position, VertexAttribute::VA_UV0, VertexAttribute::VA_Normal, VertexAttribute::VA_Tangent});
 
-	TexDiffuse = VulkanTexture::Create2D(
-	"Assets/Textures/head_diffuse.jpg",VkContext->Instance->GetDevice(),cmd
+	//有烘焙好的.rtex时先只加载低精度Mip，按屏幕大小流式补上
+	TexDiffuse = VkContext->GetTextureStreamer().CreateTexture(
+	"Assets/Textures/head_diffuse.jpg",cmd
 	);
     	
 	TexPreIntegareted = VulkanTexture::Create2D(
@@ -184,8 +179,8 @@ void SandBoxLayer::CreateMeshBuffer()
 "Assets/Textures/curvatureLUT.png",VkContext->Instance->GetDevice(),cmd
 	);
 
-	TexNomal = VulkanTexture::Create2D(
-	"Assets/Textures/head_normal.jpg",VkContext->Instance->GetDevice(),cmd
+	TexNomal = VkContext->GetTextureStreamer().CreateTexture(
+	"Assets/Textures/head_normal.jpg",cmd
 	);
     	
 	PipeShader = VulkanShader::Create(VkContext->Instance->GetDevice(),true,&SHADER_VERT,&SHADER_FRAG,nullptr,nullptr,nullptr,nullptr);
@@ -223,5 +218,15 @@ void SandBoxLayer::UpdateUniformBuffer(Timestep ts)
 	ubo.model = glm::rotate(ubo.model, ts.GetSeconds() *  glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));;
 	ubo.view = Camera->GetViewMatrix();
 	ubo.proj = Camera->GetProjection();
+
+	//头部的UV铺满整张贴图，包围球的屏幕大小就是贴图的足迹
+	BoundingBox Box = Model->RootNode->GetBounds();
+	const glm::vec3 boundCenter = glm::vec3(ubo.model * glm::vec4((Box.Min + Box.Max) * 0.5f, 1.0f));
+	const float boundRadius = glm::length(Box.Max - Box.Min) * 0.5f;
+	const float screenPixels = VulkanTextureStreamer::ComputeScreenPixels(boundCenter, boundRadius, ubo.view, ubo.proj, (float)VkContext->WinProperty->Height);
+
+	VulkanTextureStreamer& Streamer = VkContext->GetTextureStreamer();
+	Streamer.ReportFootprint(TexDiffuse, screenPixels);
+	Streamer.ReportFootprint(TexNomal, screenPixels);
 }
 
@@ -51,6 +51,7 @@ void RTLayer::OnDeInit()
     SceneMaterial.reset();
     mFilterMaterial.reset();
     
+    m_PassCache.Destroy();
     m_RingBuffer.reset();
 }
 
@@ -59,7 +60,9 @@ void RTLayer::OnUpdate(Timestep ts)
     m_RingBuffer->OnBeginFrame();
     m_Camera->OnUpdate(ts);
     
-    SceneModel->RootNode->LocalMatrix = glm::rotate(SceneModel->RootNode->LocalMatrix,ts.GetSeconds() *  glm::radians(45.0f),glm::vec3(0.0f, 1.0f, 0.0f));
+    if (m_Rotate) {
+        SceneModel->RootNode->LocalMatrix = glm::rotate(SceneModel->RootNode->LocalMatrix,ts.GetSeconds() *  glm::radians(45.0f),glm::vec3(0.0f, 1.0f, 0.0f));
+    }
 
     m_Camera->SetFarPlane(DebugParam.zFar);
     m_Camera->SetNearPlane(DebugParam.zNear);
@@ -70,10 +73,6 @@ void RTLayer::OnUpdate(Timestep ts)
 
 void RTLayer::OnRender()
 {
-    VkCommandBufferBeginInfo cmdBeginInfo;
-    ZeroVulkanStruct(cmdBeginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
-    VERIFYVULKANRESULT(vkBeginCommandBuffer(VkContext->GetCommandList(), &cmdBeginInfo));
-    
     VkViewport viewport = {};
     viewport.x        = 0;
     viewport.y        = FrameBuffer->m_Height;
@@ -90,24 +89,34 @@ void RTLayer::OnRender()
 
     // const auto ViewBufferView = m_RingBuffer->AllocConstantBuffer(sizeof(ViewProjectionBlock),&m_VPData);
     {
-        RenderTarget->BeginRenderPass(VkContext->GetCommandList());
+        RenderTarget->BeginRenderPass(VkContext->GetCommandList(), VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // 场景停止旋转、相机不动时直接复用上一次的录制
+        VulkanPassKey passKey;
+        passKey.Add(m_MVPData.view).Add(m_MVPData.projection);
+        passKey.Add(SceneModel->RootNode->LocalMatrix);
         
-        vkCmdBindPipeline(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS,SceneMaterial->mPipeline->Pipeline);
-        for(int32 i = 0; i < RenderObject.size(); i++)
+        m_PassCache.ExecutePass(VkContext->GetCommandList(), RenderTarget->GetRenderPass(), 0, passKey.Get(), [&](VkCommandBuffer cmdBuffer)
         {
-            SceneMaterial->SetTexture("DiffuseMap",TextureArray[i]);
-            for(auto& Mesh : RenderObject[i])
-            {
-                m_MVPData.model = Mesh->LinkNode.lock()->GetGlobalMatrix();
-                
+            RenderTarget->SetViewportScissor(cmdBuffer);
 
-                // SceneMaterial->SetLocalUniform("uboViewProj",ViewBufferView);
-                SceneMaterial->SetLocalUniform("uboMVP",&m_MVPData,sizeof(ModelViewProjectionBlock));
-                SceneMaterial->BindDescriptorSets(VkContext->GetCommandList(),VK_PIPELINE_BIND_POINT_GRAPHICS);
-
-                Mesh->BindDraw(VkContext->GetCommandList());
+            vkCmdBindPipeline(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,SceneMaterial->mPipeline->Pipeline);
+            for(int32 i = 0; i < RenderObject.size(); i++)
+            {
+                SceneMaterial->SetTexture("DiffuseMap",TextureArray[i]);
+                for(auto& Mesh : RenderObject[i])
+                {
+                    m_MVPData.model = Mesh->LinkNode.lock()->GetGlobalMatrix();
+                    
+
+                    // SceneMaterial->SetLocalUniform("uboViewProj",ViewBufferView);
+                    SceneMaterial->SetLocalUniform("uboMVP",&m_MVPData,sizeof(ModelViewProjectionBlock));
+                    SceneMaterial->BindDescriptorSets(cmdBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+                    Mesh->BindDraw(cmdBuffer);
+                }
             }
-        }
+        });
 
         RenderTarget->EndRenderPass(VkContext->GetCommandList());
     }
@@ -145,12 +154,19 @@ void RTLayer::OnUIRender(Timestep ts)
     ImGui::SliderFloat("Z-Near", &DebugParam.zNear, 0.1f, 3000.0f);
     ImGui::SliderFloat("Z-Far", &DebugParam.zFar, 0.1f, 6000.0f);
 
+    ImGui::Checkbox("Rotate", &m_Rotate);
+    bool cachePass = m_PassCache.IsEnabled();
+    if (ImGui::Checkbox("Cache Scene Pass", &cachePass)) {
+        m_PassCache.SetEnabled(cachePass);
+    }
+    ImGui::Text("Recorded %llu  Reused %llu", m_PassCache.GetNumRecorded(), m_PassCache.GetNumReused());
+
     ImGui::End();
 }
 
 void RTLayer::OnChangeWindowSize(std::shared_ptr<ReEngine::Event> e)
 {
-    
+    m_PassCache.Invalidate();
 }
 
 void RTLayer::CreateRenderTarget()
@@ -194,6 +210,8 @@ void RTLayer::LoadAsset()
     m_RingBuffer = CreateRef<VulkanDynamicBufferRing>();
     m_RingBuffer->OnCreate(VkContext->Instance->GetDevice(),3,200 * 1024 * 1024);
 
+    m_PassCache.Init(device, m_RingBuffer, VkContext->CommandPool->GetFramesInFlight());
+
     {
         SceneShader = VulkanShader::Create(device,true,&OBJ_VERT,&OBJ_FRAG,nullptr,nullptr,nullptr,nullptr);
         SceneMaterial = VulkanMaterial::Create(
@@ -235,15 +253,12 @@ void RTLayer::LoadAsset()
         "Assets/Mesh/Room/miniHouse_Part4.jpg"
     };
 
-    TextureArray.resize(diffusePaths.size());
+    std::vector<VulkanTextureLoadDesc> textureDescs(diffusePaths.size());
     for(int32 index = 0 ; index < diffusePaths.size();index++)
     {
-        TextureArray[index] = VulkanTexture::Create2D(
-            diffusePaths[index],
-            device,
-            cmdBuffer
-        );
+        textureDescs[index].Filename = diffusePaths[index];
     }
+    TextureArray = VkContext->GetTextureLoader().LoadBatch(textureDescs);
 
     RenderObject.resize(diffusePaths.size());
     for(const auto& Mesh : SceneModel->Meshes)
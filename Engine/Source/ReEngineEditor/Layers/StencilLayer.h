@@ -3,6 +3,7 @@
 #include "Camera/EditorCamera.h"
 #include "Platform/Vulkan/VulkanMaterial.h"
 #include "Platform/Vulkan/Mesh/VulkanMesh.h"
+#include "Platform/Vulkan/VulkanPassCache.h"
 
 
 class RTLayer : public GraphicalLayer
@@ -49,4 +50,7 @@ private:
 
     Ref<EditorCamera>                               m_Camera = nullptr;        
     Ref<VulkanDynamicBufferRing>                    m_RingBuffer = nullptr;
+    // 场景Pass的录制缓存
+    VulkanPassCache                                 m_PassCache;
+    bool                                            m_Rotate = true;
 };
@@ -0,0 +1,245 @@
+#include "VirtualTextureLayer.h"
+
+#include <ColorFilter_frag.h>
+#include <quad_vert.h>
+#include <VirtualTexture_vert.h>
+#include <VirtualTexture_frag.h>
+#include "Mesh/Quad.h"
+#include "Platform/Vulkan/VulkanContext.h"
+#include "imgui.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+void VirtualTextureLayer::OnCreateBackBuffer()
+{
+    GraphicalLayer::OnCreateBackBuffer();
+}
+
+void VirtualTextureLayer::OnInit()
+{
+    CreateRenderTarget();
+    LoadAsset();
+}
+
+void VirtualTextureLayer::OnDeInit()
+{
+    m_Camera.reset();
+    ColorRT.reset();
+    DepthRT.reset();
+    RenderTarget.reset();
+
+    mQuad.reset();
+    mFilterShader.reset();
+    mFilterMaterial.reset();
+
+    mGround.reset();
+    mGroundShader.reset();
+    mGroundMaterial.reset();
+    mVirtualTexture.reset();
+    
+    m_RingBuffer.reset();
+}
+
+void VirtualTextureLayer::OnUpdate(Timestep ts)
+{
+    m_RingBuffer->OnBeginFrame();
+    m_Camera->OnUpdate(ts);
+
+    m_MVPData.view = m_Camera->GetViewMatrix();
+    m_MVPData.projection = m_Camera->GetProjection();
+}
+
+void VirtualTextureLayer::OnRender()
+{
+    VkViewport viewport = {};
+    viewport.x        = 0;
+    viewport.y        = FrameBuffer->m_Height;
+    viewport.width    = FrameBuffer->m_Width;
+    viewport.height   = -(float)FrameBuffer->m_Height;    // flip y axis
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.extent.width  = FrameBuffer->m_Width;
+    scissor.extent.height = FrameBuffer->m_Height;
+    scissor.offset.x      = 0;
+    scissor.offset.y      = 0;
+
+    RenderTarget->BeginRenderPass(VkContext->GetCommandList());
+    
+    if (mVirtualTexture)
+    {
+        vkCmdBindPipeline(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS, mGroundMaterial->mPipeline->Pipeline);
+
+        // 帧标记每帧都变，Params要每帧重新写
+        m_VirtualTextureData.params = mVirtualTexture->GetParams();
+        mGroundMaterial->SetLocalUniform("uboMVP", &m_MVPData, sizeof(MVPBlock));
+        mGroundMaterial->SetLocalUniform("uboVirtualTexture", &m_VirtualTextureData, sizeof(VirtualTextureBlock));
+        mGroundMaterial->BindDescriptorSets(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS);
+        mGround->Meshes[0]->BindDraw(VkContext->GetCommandList());
+    }
+    
+    RenderTarget->EndRenderPass(VkContext->GetCommandList());
+    
+    //Second Pass
+    {
+        VkClearValue clearValues[1];
+        clearValues[0].color        =
+        {
+            { 0.2f, 0.2f, 0.2f, 1.0f }
+        };
+
+        FrameBuffer->BeginPass(VkContext->GetCurrtIndex(),clearValues,VkContext->GetCommandList());
+        
+        vkCmdSetViewport(VkContext->GetCommandList(), 0, 1, &viewport);
+        vkCmdSetScissor(VkContext->GetCommandList(),  0, 1, &scissor);
+
+        {
+            vkCmdBindPipeline(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS, mFilterMaterial->mPipeline->Pipeline);
+            mFilterMaterial->SetTexture("InputImageTexture", ColorRT);
+            mFilterMaterial->BindDescriptorSets(VkContext->GetCommandList(), VK_PIPELINE_BIND_POINT_GRAPHICS);
+            mQuad->Meshes[0]->BindDraw(VkContext->GetCommandList());
+        }
+
+        vkCmdEndRenderPass(VkContext->GetCommandList());
+    }
+}
+
+void VirtualTextureLayer::OnUIRender(Timestep ts)
+{
+    const VulkanVirtualTextureStats stats = VkContext->GetVirtualTextures().GetStats();
+
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::Begin("VirtualTexture", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
+    if (mVirtualTexture) {
+        ImGui::Text("Virtual Size : %u x %u", mVirtualTexture->GetWidth(), mVirtualTexture->GetHeight());
+    }
+    ImGui::Text("Cache Pages  : %u / %u", stats.NumResident, stats.NumSlots);
+    ImGui::Text("Requested    : %u", stats.NumRequested);
+    ImGui::Text("Loading      : %u", stats.NumLoading);
+    ImGui::Text("Uploaded     : %llu", (unsigned long long)stats.UploadedPages);
+    ImGui::Text("Evictions    : %llu", (unsigned long long)stats.NumEvictions);
+    ImGui::SliderFloat("Tiling", &m_VirtualTextureData.tiling.x, 1.0f, 64.0f);
+    ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::End();
+}
+
+void VirtualTextureLayer::OnChangeWindowSize(std::shared_ptr<ReEngine::Event> e)
+{
+    GraphicalLayer::OnChangeWindowSize(e);
+}
+
+void VirtualTextureLayer::CreateRenderTarget()
+{
+    auto device = VkContext->Instance->GetDevice();
+    
+    ColorRT = VulkanTexture::CreateRenderTarget(
+        device,
+        PixelFormatToVkFormat(VkContext->Instance->GetPixelFormat(), false),
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        FrameBuffer->m_Width,
+        FrameBuffer->m_Height,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+    );
+
+    DepthRT = VulkanTexture::CreateRenderTarget(
+        device,
+        PixelFormatToVkFormat(PF_DepthStencil, false),
+        VK_IMAGE_ASPECT_DEPTH_BIT,
+        FrameBuffer->m_Width,
+        FrameBuffer->m_Height,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+    );
+
+    VulkanRenderPassInfo PassInfo 
+    {
+        ColorRT,VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_NONE,
+        DepthRT,VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_STORE
+    };
+
+    RenderTarget = VulkanRenderTarget::Create( 
+        device,
+        PassInfo
+    );
+}
+
+void VirtualTextureLayer::LoadAsset()
+{
+    auto device = VkContext->Instance->GetDevice();
+    
+    m_RingBuffer = CreateRef<VulkanDynamicBufferRing>();
+    m_RingBuffer->OnCreate(VkContext->Instance->GetDevice(),3,200 * 1024 * 1024);
+
+    auto cmdBuffer = VulkanCommandBuffer::Create(device, VkContext->CommandPool->m_CommandPool);
+
+    // 第一次运行时在同目录下烘焙出.rvt，更大的贴图用ReTextureCooker --virtual离线烘焙
+    VulkanVirtualTextureSystem& virtualTextures = VkContext->GetVirtualTextures();
+    mVirtualTexture = virtualTextures.CreateTexture("Assets/Textures/head_diffuse.jpg", cmdBuffer);
+
+    // quad model
+    Quad FilterQuad;
+
+    {
+        mGroundShader = VulkanShader::Create(device,true,&VIRTUALTEXTURE_VERT,&VIRTUALTEXTURE_FRAG,nullptr,nullptr,nullptr,nullptr);
+        mGroundMaterial = VulkanMaterial::Create(
+            device,
+            RenderTarget->GetRenderPass(),
+            VkContext->CommandPool->m_PipelineCache,
+            mGroundShader,
+            m_RingBuffer
+        );
+        // 地面两面都能看到
+        mGroundMaterial->mPipelineInfo.RasterizationState.cullMode = VK_CULL_MODE_NONE;
+        mGroundMaterial->PreparePipeline();
+
+        if (mVirtualTexture)
+        {
+            mGroundMaterial->SetTexture("PageTable", mVirtualTexture->GetPageTable());
+            mGroundMaterial->SetTexture("PhysicalCache", virtualTextures.GetPhysicalCache());
+            mGroundMaterial->SetStorageBuffer("vtFeedback", virtualTextures.GetFeedbackBuffer());
+        }
+
+        mGround = VulkanModel::Create(
+            device,
+            cmdBuffer,
+            FilterQuad.GetVertexs(),
+            FilterQuad.GetIndices(),
+            mGroundShader->perVertexAttributes
+        );
+    }
+
+    {
+        mFilterShader = VulkanShader::Create(device,true,&QUAD_VERT,&COLORFILTER_FRAG,nullptr,nullptr,nullptr,nullptr);
+        mFilterMaterial = VulkanMaterial::Create(
+            device,
+            FrameBuffer->m_RenderPass,
+            VkContext->CommandPool->m_PipelineCache,
+            mFilterShader,
+            m_RingBuffer
+        );
+        mFilterMaterial->PreparePipeline();
+
+        mQuad = VulkanModel::Create(
+            device,
+            cmdBuffer,
+            FilterQuad.GetVertexs(),
+            FilterQuad.GetIndices(),
+            mFilterShader->perVertexAttributes
+        );
+    }
+    
+    m_Camera = CreateRef<EditorCamera>();
+    m_Camera->SetSpeed(0.1f);
+    m_Camera->SetFarPlane(3000.0f);
+    m_Camera->SetCenter(glm::vec3(0.0f, 0.0f, 0.0f));
+    
+    // Quad在xy平面上，放倒成400x400的地面，放在相机下方，远处的页只会请求低精度Mip
+    m_MVPData.model = glm::translate(glm::identity<glm::mat4>(), glm::vec3(0.0f, -2.0f, 0.0f));
+    m_MVPData.model = glm::rotate(m_MVPData.model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    m_MVPData.model = glm::scale(m_MVPData.model, glm::vec3(200.0f));
+    m_MVPData.projection = m_Camera->GetProjection();
+    m_MVPData.view = m_Camera->GetViewMatrix();
+
+    m_VirtualTextureData.params = {};
+    m_VirtualTextureData.tiling = glm::vec4(8.0f, 0.0f, 0.0f, 0.0f);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Core/Core.h"
+#include "GraphicalLayer.h"
+#include "Platform/Vulkan/VulkanMaterial.h"
+#include "Platform/Vulkan/VulkanVirtualTexture.h"
+#include "Platform/Vulkan/Mesh/VulkanMesh.h"
+#include "Camera/EditorCamera.h"
+
+// 和VirtualTexture.frag里的VirtualTextureBlock一致
+struct VirtualTextureBlock
+{
+    VulkanVirtualTexture::Params params;
+    glm::vec4 tiling;
+};
+
+// 一大块地面平铺一张虚拟贴图，只有看得到的页加载进物理缓存
+class VirtualTextureLayer : public GraphicalLayer
+{
+public:
+    virtual void OnCreateBackBuffer() override;
+    virtual void OnInit() override;
+    virtual void OnDeInit() override;
+
+    virtual void OnUpdate(Timestep ts) override;
+    virtual void OnRender() override;
+    virtual void OnUIRender(Timestep ts) override;
+    virtual void OnChangeWindowSize(std::shared_ptr<ReEngine::Event> e) override;
+
+private:
+    void CreateRenderTarget();
+    void LoadAsset();
+    
+private:
+    Ref<VulkanTexture>                              ColorRT;
+    Ref<VulkanTexture>                              DepthRT;
+    Ref<VulkanRenderTarget>                         RenderTarget;
+
+    Ref<VulkanModel>                                mQuad = nullptr;
+    Ref<VulkanMaterial>                             mFilterMaterial;
+    Ref<VulkanShader>                               mFilterShader;
+
+    Ref<VulkanModel>                                mGround = nullptr;
+    Ref<VulkanMaterial>                             mGroundMaterial;
+    Ref<VulkanShader>                               mGroundShader;
+    Ref<VulkanVirtualTexture>                       mVirtualTexture;
+    VirtualTextureBlock                             m_VirtualTextureData;
+
+    MVPBlock                                        m_MVPData;
+    Ref<EditorCamera>                               m_Camera = nullptr;        
+    Ref<VulkanDynamicBufferRing>                    m_RingBuffer = nullptr;
+};
@@ -9,14 +9,51 @@
 #include "Layers/ComputeLayers/ComputeLayer.h"
 #include "Layers/RayTracing/SimplePathTracing.h"
 #include "Layers/RenderPath/TileBasedForwardLayer.h"
+#include "Layers/VirtualTextureLayer.h"
 #include "Layers/FrameGraphs/FrameGraphTest/TemplateLayer.h"
 
+#include <functional>
+#include <unordered_map>
+
 namespace ReEngine
 {
+    // --layer 按名字选择要跑的层，基准和CI里用
+    static Ref<Layer> CreateLayerByName(const std::string& name)
+    {
+        static const std::unordered_map<std::string, std::function<Ref<Layer>()>> factories =
+        {
+            { "SimplePathTracing",       []() -> Ref<Layer> { return CreateRef<SimplePathTracing>(); } },
+            { "TileBasedForwardLayer",   []() -> Ref<Layer> { return CreateRef<TileBasedForwardLayer>(); } },
+            { "MSAALayer",               []() -> Ref<Layer> { return CreateRef<MSAALayer>(); } },
+            { "AnimationTextureLayer",   []() -> Ref<Layer> { return CreateRef<AnimationTextureLayer>(); } },
+            { "AnimationLayer",          []() -> Ref<Layer> { return CreateRef<AnimationLayer>(); } },
+            { "RTLayer",                 []() -> Ref<Layer> { return CreateRef<RTLayer>(); } },
+            { "InputAttachment",         []() -> Ref<Layer> { return CreateRef<InputAttachment>(); } },
+            { "SandBoxLayer",            []() -> Ref<Layer> { return CreateRef<SandBoxLayer>(); } },
+            { "ComputeLayer",            []() -> Ref<Layer> { return CreateRef<ComputeLayer>(); } },
+            { "VirtualTextureLayer",     []() -> Ref<Layer> { return CreateRef<VirtualTextureLayer>(); } },
+            { "FrameGraphTemplateLayer", []() -> Ref<Layer> { return CreateRef<FrameGraphTemplateLayer>(); } },
+        };
+
+        auto it = factories.find(name);
+        if (it == factories.end())
+        {
+            RE_CORE_ERROR("Unknown layer {0}, using FrameGraphTemplateLayer.", name);
+            return CreateRef<FrameGraphTemplateLayer>();
+        }
+        return it->second();
+    }
+
     void AppInit(Application& app)
     {
         app.Init();
 
+        if (!app.GetBenchmark().LayerName.empty())
+        {
+            app.PushLayer(CreateLayerByName(app.GetBenchmark().LayerName));
+            return;
+        }
+
         // app.PushLayer(CreateRef<SimplePathTracing>());
         // app.PushLayer(CreateRef<TileBasedForwardLayer>());
         // app.PushLayer(CreateRef<MSAALayer>());
@@ -26,6 +63,7 @@ namespace ReEngine
         // app.PushLayer(CreateRef<InputAttachment>());
         // app.PushLayer(CreateRef<SandBoxLayer>());
         // app.PushLayer(CreateRef<ComputeLayer>());
+        // app.PushLayer(CreateRef<VirtualTextureLayer>());
         app.PushLayer(CreateRef<FrameGraphTemplateLayer>());
     }
 }
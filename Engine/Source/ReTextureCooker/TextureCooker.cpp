@@ -0,0 +1,228 @@
+﻿#include "Log/Log.h"
+#include "Core/WorkerPool.h"
+#include "Resource/Texture/TextureCompressor.h"
+#include "Resource/Texture/TextureFile.h"
+#include "Resource/Texture/VirtualTextureFile.h"
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace ReEngine;
+
+// 离线把PNG/JPG等烘焙成.rtex：生成完整Mip链后逐级BC压缩，运行时VulkanTexture::Create2D直接上传
+// 用法：ReTextureCooker [--format auto|none|bc1|bc3|bc4|bc5|bc7] [--srgb] [--no-mips] [--virtual [--tile-size N]] [-o output] input...
+// auto时不透明的图用BC1，有Alpha的用BC7；法线贴图需要手动指定bc5
+// --virtual烘焙成虚拟贴图的分块文件.rvt，页不压缩，--tile-size要和运行时物理缓存的槽位一致
+struct CookSettings
+{
+    bool                    AutoFormat = true;
+    TextureCompression      Compression = TextureCompression::BC1;
+    bool                    SRGB = false;
+    bool                    GenerateMips = true;
+    bool                    Virtual = false;
+    uint32                  TileSize = VirtualTextureFile::DEFAULT_TILE_SIZE;
+    std::string             OutputPath;
+};
+
+static bool ParseCompression(const char* name, CookSettings& settings)
+{
+    static const struct { const char* Name; TextureCompression Compression; } s_Formats[] =
+    {
+        { "none", TextureCompression::None },
+        { "bc1",  TextureCompression::BC1 },
+        { "bc3",  TextureCompression::BC3 },
+        { "bc4",  TextureCompression::BC4 },
+        { "bc5",  TextureCompression::BC5 },
+        { "bc7",  TextureCompression::BC7 },
+    };
+
+    if (std::strcmp(name, "auto") == 0)
+    {
+        settings.AutoFormat = true;
+        return true;
+    }
+
+    for (const auto& format : s_Formats)
+    {
+        if (std::strcmp(name, format.Name) == 0)
+        {
+            settings.AutoFormat  = false;
+            settings.Compression = format.Compression;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ReadSourceFile(const std::string& filepath, std::vector<uint8>& outData)
+{
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    outData.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)outData.data(), outData.size());
+    return (bool)file;
+}
+
+static bool CookTexture(const std::string& inputPath, const std::string& outputPath, const CookSettings& settings)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<uint8> fileData;
+    if (!ReadSourceFile(inputPath, fileData))
+    {
+        RE_ERROR("Failed to read {0}", inputPath);
+        return false;
+    }
+
+    int32 width  = 0;
+    int32 height = 0;
+    int32 comp   = 0;
+    uint8* rgbaData = StbImage::LoadFromMemory(fileData.data(), (int32)fileData.size(), &width, &height, &comp, 4);
+    if (rgbaData == nullptr)
+    {
+        RE_ERROR("Failed to decode {0}", inputPath);
+        return false;
+    }
+
+    if (settings.Virtual)
+    {
+        const bool cooked = VirtualTextureFile::Cook(rgbaData, (uint32)width, (uint32)height, settings.SRGB, outputPath, settings.TileSize);
+        StbImage::Free(rgbaData);
+        if (!cooked)
+        {
+            RE_ERROR("Failed to write {0}", outputPath);
+            return false;
+        }
+
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        RE_INFO("{0} -> {1}  {2}x{3} virtual, tile {4}  {5:.1f} KB  {6:.1f} ms",
+            inputPath, outputPath, width, height, settings.TileSize, std::filesystem::file_size(outputPath) / 1024.0, elapsedMs);
+        return true;
+    }
+
+    TextureCompression compression = settings.Compression;
+    if (settings.AutoFormat) {
+        compression = TextureCompressor::HasAlpha(rgbaData, width, height) ? TextureCompression::BC7 : TextureCompression::BC1;
+    }
+
+    TextureFile textureFile;
+    textureFile.Format = TextureCompressor::GetPixelFormat(compression);
+    textureFile.Flags  = settings.SRGB ? TextureFile::FLAG_SRGB : 0;
+    textureFile.Width  = (uint32)width;
+    textureFile.Height = (uint32)height;
+
+    // 每一级都从上一级未压缩的结果往下采样，误差不会逐级累积
+    std::vector<uint8> mipData(rgbaData, rgbaData + (size_t)width * height * 4);
+    std::vector<uint8> nextMipData;
+    std::vector<uint8> compressed;
+    StbImage::Free(rgbaData);
+
+    uint32 mipWidth  = (uint32)width;
+    uint32 mipHeight = (uint32)height;
+    while (true)
+    {
+        compressed.resize(TextureCompressor::GetImageSize(compression, mipWidth, mipHeight));
+        TextureCompressor::CompressImage(compression, mipData.data(), mipWidth, mipHeight, compressed.data());
+        textureFile.AddMip(mipWidth, mipHeight, compressed.data(), compressed.size());
+
+        if (!settings.GenerateMips || (mipWidth == 1 && mipHeight == 1)) {
+            break;
+        }
+
+        TextureCompressor::DownsampleImage(mipData.data(), mipWidth, mipHeight, settings.SRGB, nextMipData);
+        mipData.swap(nextMipData);
+        mipWidth  = std::max(mipWidth / 2, 1u);
+        mipHeight = std::max(mipHeight / 2, 1u);
+    }
+
+    if (!textureFile.Save(outputPath))
+    {
+        RE_ERROR("Failed to write {0}", outputPath);
+        return false;
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    const uint64 sourceBytes = (uint64)width * height * 4 * 4 / 3;
+    RE_INFO("{0} -> {1}  {2}x{3} {4} {5} mips  {6:.1f} KB (RGBA8 {7:.1f} KB)  {8:.1f} ms",
+        inputPath, outputPath, width, height, G_PixelFormats[textureFile.Format].name, textureFile.Mips.size(),
+        textureFile.Data.size() / 1024.0, sourceBytes / 1024.0, elapsedMs);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Log::Init();
+
+    CookSettings settings;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--format") == 0 && hasValue)
+        {
+            if (!ParseCompression(argv[++i], settings))
+            {
+                RE_ERROR("Unknown format {0}", argv[i]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(arg, "--srgb") == 0) {
+            settings.SRGB = true;
+        }
+        else if (std::strcmp(arg, "--no-mips") == 0) {
+            settings.GenerateMips = false;
+        }
+        else if (std::strcmp(arg, "--virtual") == 0) {
+            settings.Virtual = true;
+        }
+        else if (std::strcmp(arg, "--tile-size") == 0 && hasValue) {
+            settings.TileSize = (uint32)std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(arg, "-o") == 0 && hasValue) {
+            settings.OutputPath = argv[++i];
+        }
+        else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        RE_ERROR("Usage: ReTextureCooker [--format auto|none|bc1|bc3|bc4|bc5|bc7] [--srgb] [--no-mips] [--virtual [--tile-size N]] [-o output] input...");
+        return 1;
+    }
+
+    if (!settings.OutputPath.empty() && inputs.size() > 1)
+    {
+        RE_ERROR("-o can only be used with a single input");
+        return 1;
+    }
+
+    WorkerPool::GetInstance().Init();
+
+    int32 numFailed = 0;
+    for (const std::string& input : inputs)
+    {
+        const std::string cookedPath = settings.Virtual ? VirtualTextureFile::GetCookedPath(input) : TextureFile::GetCookedPath(input);
+        const std::string output = settings.OutputPath.empty() ? cookedPath : settings.OutputPath;
+        if (!CookTexture(input, output, settings)) {
+            numFailed += 1;
+        }
+    }
+
+    WorkerPool::GetInstance().Shutdown();
+    return numFailed == 0 ? 0 : 1;
+}
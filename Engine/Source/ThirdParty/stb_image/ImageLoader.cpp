@@ -22,4 +22,9 @@ float* StbImage::LoadFloatFromMemory(const uint8* inBuffer, int32 inSize, int32*
 void StbImage::Free(uint8* data)
 {
     stbi_image_free(data);
+}
+
+bool StbImage::InfoFromMemory(const uint8* inBuffer, int32 inSize, int32* outWidth, int32* outHeight, int32* outComp)
+{
+    return stbi_info_from_memory(inBuffer, inSize, outWidth, outHeight, outComp) != 0;
 }
\ No newline at end of file
@@ -16,4 +16,7 @@ public:
 
     static void Free(uint8* data);
 
+    // 只解析文件头，拿到尺寸和通道数
+    static bool InfoFromMemory(const uint8* inBuffer, int32 inSize, int32* outWidth, int32* outHeight, int32* outComp);
+
 };
\ No newline at end of file